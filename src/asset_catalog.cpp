@@ -1,10 +1,18 @@
 #include "asset_catalog.h"
 
+#include "file_stamp.h"
+#include "hash.h"
+
 #include <SDL.h>
 #include <nlohmann/json.hpp>
 
+#include "cgltf.h"
+
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 
 using json = nlohmann::json;
 
@@ -22,21 +30,114 @@ glm::vec3 ParseVec3(const json& j, const char* key, const glm::vec3& fallback) {
     return glm::vec3((*it)[0].get<float>(), (*it)[1].get<float>(), (*it)[2].get<float>());
 }
 
+// "lods": [{"ratio": 0.5, "maxError": 0.01}, ...]; an empty array disables LODs.
+std::vector<LodSetting> ParseLods(const json& j) {
+    auto it = j.find("lods");
+    if (it == j.end() || !it->is_array()) return DefaultLodSettings();
+    std::vector<LodSetting> lods;
+    for (const auto& level : *it) {
+        if (!level.is_object()) continue;
+        LodSetting s;
+        s.ratio = std::clamp(level.value("ratio", 0.5f), 0.0f, 1.0f);
+        s.maxError = std::max(level.value("maxError", 0.01f), 0.0f);
+        lods.push_back(s);
+    }
+    return lods;
+}
+
 bool HasRequiredFields(const json& j) {
     return j.contains("version") && j.contains("id") && j.contains("type") && j.contains("mesh");
 }
 
+constexpr uint32_t CATALOG_MAGIC = 0x54414343; // "CCAT"
+constexpr uint32_t CATALOG_VERSION = 2; // 2: LOD settings
+// POSITION min/max from the glTF JSON alone; buffers are not loaded.
+bool ReadMeshBounds(const std::string& path, glm::vec3& bmin, glm::vec3& bmax) {
+    cgltf_options options{};
+    cgltf_data* data = nullptr;
+    if (cgltf_parse_file(&options, path.c_str(), &data) != cgltf_result_success) return false;
+    bool ok = false;
+    if (data->meshes_count > 0 && data->meshes[0].primitives_count > 0) {
+        const cgltf_primitive& prim = data->meshes[0].primitives[0];
+        for (cgltf_size i = 0; i < prim.attributes_count; i++) {
+            const cgltf_accessor* acc = prim.attributes[i].data;
+            if (prim.attributes[i].type != cgltf_attribute_type_position || !acc) continue;
+            if (acc->type == cgltf_type_vec3 && acc->has_min && acc->has_max) {
+                bmin = glm::vec3(acc->min[0], acc->min[1], acc->min[2]);
+                bmax = glm::vec3(acc->max[0], acc->max[1], acc->max[2]);
+                ok = true;
+            }
+            break;
+        }
+    }
+    cgltf_free(data);
+    return ok;
+}
+
+AssetTraits ComputeTraits(const AssetDef& def, const std::string& root) {
+    AssetTraits t;
+    if (!def.meshRelPath.empty()) t.flags |= ASSET_HAS_MESH;
+    if (def.category == "office") t.flags |= ASSET_FACADE;
+    if (std::find(def.tags.begin(), def.tags.end(), "large_lot") != def.tags.end()) t.flags |= ASSET_LARGE_LOT;
+    t.defaultScale = def.defaultScale;
+    t.footprintM = def.footprintM;
+    t.zonedFootprintM = def.zonedFootprintM;
+    if ((t.flags & ASSET_HAS_MESH) &&
+        ReadMeshBounds(JoinPath(root, def.meshRelPath), t.boundsMin, t.boundsMax)) {
+        t.flags |= ASSET_HAS_BOUNDS;
+    }
+    return t;
+}
+
+struct ByteWriter {
+    std::vector<uint8_t> bytes;
+    template <typename T>
+    void put(const T& v) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+        bytes.insert(bytes.end(), p, p + sizeof(T));
+    }
+    void putString(const std::string& s) {
+        put((uint32_t)s.size());
+        bytes.insert(bytes.end(), s.begin(), s.end());
+    }
+};
+
+struct ByteReader {
+    const uint8_t* p = nullptr;
+    const uint8_t* end = nullptr;
+    bool ok = true;
+    template <typename T>
+    T get() {
+        T v{};
+        if ((std::size_t)(end - p) < sizeof(T)) {
+            ok = false;
+            return v;
+        }
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    std::string getString() {
+        uint32_t n = get<uint32_t>();
+        if (!ok || (std::size_t)(end - p) < n) {
+            ok = false;
+            return std::string();
+        }
+        std::string s(reinterpret_cast<const char*>(p), n);
+        p += n;
+        return s;
+    }
+};
+
 } // namespace
 
+const std::vector<LodSetting>& DefaultLodSettings() {
+    static const std::vector<LodSetting> defaults = {{0.5f, 0.005f}, {0.25f, 0.015f}, {0.1f, 0.04f}};
+    return defaults;
+}
+
 AssetId AssetCatalog::HashId(const std::string& idStr) {
-    const uint32_t fnvOffset = 2166136261u;
-    const uint32_t fnvPrime = 16777619u;
-    uint32_t hash = fnvOffset;
-    for (unsigned char c : idStr) {
-        hash ^= c;
-        hash *= fnvPrime;
-    }
-    return hash;
+    return Fnv1a32(idStr.data(), idStr.size());
 }
 
 bool AssetCatalog::registerAsset(AssetDef def) {
@@ -65,26 +166,53 @@ void AssetCatalog::registerBuiltinDefaults() {
     fallback.footprintM = glm::vec2(1.0f, 1.0f);
     fallback.pivotM = glm::vec3(0.0f, 0.0f, 0.0f);
     fallback.tags = {"fallback"};
+    fallback.traits = ComputeTraits(fallback, rootPath);
     registerAsset(fallback);
     fallbackId = fallback.id;
 }
 
-bool AssetCatalog::loadAll(const std::string& assetsRoot) {
+bool AssetCatalog::loadAll(const std::string& assetsRoot, const std::string& compiledPath) {
     assetsById.clear();
     assetsByStr.clear();
     defaultByCategoryStr.clear();
+    traitsByIndex.clear();
     fallbackId = 0;
+    fromCompiled = false;
     rootPath = assetsRoot;
 
     registerBuiltinDefaults();
 
-    std::filesystem::path root(assetsRoot);
+    if (!compiledPath.empty() && loadCompiled(compiledPath)) {
+        fromCompiled = true;
+        buildIndex();
+        return assetsById.size() > 1;
+    }
+
+    std::vector<SourceStamp> sources;
+    bool loadedAny = scan(sources);
+    for (auto& kv : assetsById) kv.second.traits = ComputeTraits(kv.second, rootPath);
+    buildIndex();
+    if (loadedAny && !compiledPath.empty()) writeCompiled(compiledPath, sources);
+    return loadedAny;
+}
+
+bool AssetCatalog::scan(std::vector<SourceStamp>& sources) {
+    std::filesystem::path root(rootPath);
     std::error_code ec;
     if (!std::filesystem::exists(root, ec)) {
-        SDL_Log("AssetCatalog: assets root not found: %s", assetsRoot.c_str());
+        SDL_Log("AssetCatalog: assets root not found: %s", rootPath.c_str());
         return false;
     }
 
+    // Directories are stamped too: adding or removing an asset changes their mtime.
+    auto stamp = [&](const std::filesystem::path& p) {
+        SourceStamp s;
+        s.path = p.generic_string();
+        s.stamp = StampFile(s.path);
+        sources.push_back(std::move(s));
+    };
+    stamp(root);
+
     bool loadedAny = false;
     for (auto it = std::filesystem::recursive_directory_iterator(root, ec);
          it != std::filesystem::recursive_directory_iterator();
@@ -93,8 +221,13 @@ bool AssetCatalog::loadAll(const std::string& assetsRoot) {
             SDL_Log("AssetCatalog: error scanning assets: %s", ec.message().c_str());
             break;
         }
+        if (it->is_directory(ec)) {
+            stamp(it->path());
+            continue;
+        }
         if (!it->is_regular_file(ec)) continue;
         if (it->path().filename() != "asset.json") continue;
+        stamp(it->path());
 
         std::ifstream in(it->path(), std::ios::binary);
         if (!in) {
@@ -125,6 +258,7 @@ bool AssetCatalog::loadAll(const std::string& assetsRoot) {
         def.footprintM = ParseVec2(j, "footprintM", def.footprintM);
         def.zonedFootprintM = ParseVec2(j, "zonedFootprintM", def.zonedFootprintM);
         def.pivotM = ParseVec3(j, "pivotM", def.pivotM);
+        def.lods = ParseLods(j);
 
         auto tagsIt = j.find("tags");
         if (tagsIt != j.end() && tagsIt->is_array()) {
@@ -133,10 +267,13 @@ bool AssetCatalog::loadAll(const std::string& assetsRoot) {
             }
         }
 
+        std::string meshRel = def.meshRelPath;
         if (!registerAsset(def)) {
             SDL_Log("AssetCatalog: duplicate asset id %s (%s)", def.idStr.c_str(), it->path().string().c_str());
             continue;
         }
+        // Mesh bounds are compiled in, so the mesh is a source as well.
+        if (!meshRel.empty()) stamp(root / meshRel);
 
         loadedAny = true;
     }
@@ -144,12 +281,129 @@ bool AssetCatalog::loadAll(const std::string& assetsRoot) {
     return loadedAny;
 }
 
+void AssetCatalog::buildIndex() {
+    // Sorted by id string so indices do not depend on scan or hash order.
+    std::vector<AssetDef*> defs;
+    defs.reserve(assetsById.size());
+    for (auto& kv : assetsById) defs.push_back(&kv.second);
+    std::sort(defs.begin(), defs.end(), [](const AssetDef* a, const AssetDef* b) { return a->idStr < b->idStr; });
+    traitsByIndex.resize(defs.size());
+    for (uint32_t i = 0; i < (uint32_t)defs.size(); i++) {
+        defs[i]->index = i;
+        traitsByIndex[i] = defs[i]->traits;
+    }
+}
+
+bool AssetCatalog::loadCompiled(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ByteReader r{bytes.data(), bytes.data() + bytes.size()};
+    if (r.get<uint32_t>() != CATALOG_MAGIC || r.get<uint32_t>() != CATALOG_VERSION) return false;
+    if (r.getString() != rootPath) return false;
+
+    uint32_t sourceCount = r.get<uint32_t>();
+    for (uint32_t i = 0; i < sourceCount && r.ok; i++) {
+        std::string src = r.getString();
+        FileStamp stamp;
+        stamp.mtime = r.get<int64_t>();
+        stamp.size = r.get<uint64_t>();
+        if (!r.ok || StampFile(src) != stamp) return false;
+    }
+
+    uint32_t assetCount = r.get<uint32_t>();
+    std::vector<AssetDef> defs;
+    for (uint32_t i = 0; i < assetCount && r.ok; i++) {
+        AssetDef def;
+        def.idStr = r.getString();
+        def.id = HashId(def.idStr);
+        def.type = r.getString();
+        def.category = r.getString();
+        def.meshRelPath = r.getString();
+        def.defaultScale = r.get<glm::vec3>();
+        def.footprintM = r.get<glm::vec2>();
+        def.zonedFootprintM = r.get<glm::vec2>();
+        def.pivotM = r.get<glm::vec3>();
+        uint32_t tagCount = r.get<uint32_t>();
+        for (uint32_t t = 0; t < tagCount && r.ok; t++) def.tags.push_back(r.getString());
+        uint32_t lodCount = r.get<uint32_t>();
+        for (uint32_t l = 0; l < lodCount && r.ok; l++) def.lods.push_back(r.get<LodSetting>());
+        def.traits = r.get<AssetTraits>();
+        defs.push_back(std::move(def));
+    }
+    if (!r.ok || r.p != r.end) return false;
+    for (AssetDef& def : defs) registerAsset(std::move(def));
+    return true;
+}
+
+void AssetCatalog::writeCompiled(const std::string& path, const std::vector<SourceStamp>& sources) const {
+    ByteWriter w;
+    w.put(CATALOG_MAGIC);
+    w.put(CATALOG_VERSION);
+    w.putString(rootPath);
+    w.put((uint32_t)sources.size());
+    for (const SourceStamp& s : sources) {
+        w.putString(s.path);
+        w.put(s.stamp.mtime);
+        w.put(s.stamp.size);
+    }
+    uint32_t count = 0;
+    for (const auto& kv : assetsById) count += kv.first != fallbackId ? 1 : 0;
+    w.put(count);
+    for (const auto& kv : assetsById) {
+        const AssetDef& def = kv.second;
+        if (def.id == fallbackId) continue; // built in
+        w.putString(def.idStr);
+        w.putString(def.type);
+        w.putString(def.category);
+        w.putString(def.meshRelPath);
+        w.put(def.defaultScale);
+        w.put(def.footprintM);
+        w.put(def.zonedFootprintM);
+        w.put(def.pivotM);
+        w.put((uint32_t)def.tags.size());
+        for (const std::string& t : def.tags) w.putString(t);
+        w.put((uint32_t)def.lods.size());
+        for (const LodSetting& s : def.lods) w.put(s);
+        w.put(def.traits);
+    }
+
+    std::error_code ec;
+    std::filesystem::path target(path);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), ec);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(w.bytes.data()), (std::streamsize)w.bytes.size());
+        if (!out) {
+            SDL_Log("AssetCatalog: could not write %s", tmp.c_str());
+            return;
+        }
+    }
+    std::filesystem::rename(tmp, target, ec);
+    if (ec) SDL_Log("AssetCatalog: could not write %s (%s)", path.c_str(), ec.message().c_str());
+}
+
 const AssetDef* AssetCatalog::find(AssetId id) const {
     auto it = assetsById.find(id);
     if (it == assetsById.end()) return nullptr;
     return &it->second;
 }
 
+uint32_t AssetCatalog::indexOf(AssetId id) const {
+    const AssetDef* def = find(id);
+    return def ? def->index : INVALID_INDEX;
+}
+
+uint32_t AssetCatalog::resolveIndex(AssetId id) const {
+    uint32_t index = indexOf(id);
+    return index != INVALID_INDEX ? index : indexOf(fallbackId);
+}
+
+const AssetTraits& AssetCatalog::traitsOf(AssetId id) const {
+    return traitsByIndex[resolveIndex(id)];
+}
+
 AssetId AssetCatalog::findIdByString(const std::string& idStr) const {
     auto it = assetsByStr.find(idStr);
     if (it == assetsByStr.end()) return 0;
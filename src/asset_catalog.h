@@ -7,8 +7,39 @@
 #include <unordered_map>
 #include <vector>
 
+#include "file_stamp.h"
+
 using AssetId = uint32_t;
 
+enum AssetTraitFlags : uint32_t {
+    ASSET_HAS_MESH = 1u << 0,
+    ASSET_FACADE = 1u << 1,    // office facade textures (category "office")
+    ASSET_LARGE_LOT = 1u << 2, // "large_lot" tag
+    ASSET_HAS_BOUNDS = 1u << 3 // boundsMin/Max read from the mesh
+};
+
+// Everything the placement and render loops ask of an asset, precomputed by the
+// catalog compiler so they never touch strings.
+struct AssetTraits {
+    uint32_t flags = 0;
+    glm::vec3 defaultScale{1.0f, 1.0f, 1.0f};
+    glm::vec2 footprintM{0.0f, 0.0f};
+    glm::vec2 zonedFootprintM{0.0f, 0.0f};
+    glm::vec3 boundsMin{0.0f}; // mesh space, before defaultScale
+    glm::vec3 boundsMax{0.0f};
+};
+
+// One simplified level of an asset's mesh: its triangle budget as a fraction of
+// the full mesh, and the largest error it may introduce as a fraction of the
+// mesh's bounds diagonal.
+struct LodSetting {
+    float ratio = 1.0f;
+    float maxError = 0.0f;
+};
+
+// Used for assets whose asset.json has no "lods" array.
+const std::vector<LodSetting>& DefaultLodSettings();
+
 struct AssetDef {
     std::string idStr;
     AssetId id = 0;
@@ -20,12 +51,29 @@ struct AssetDef {
     glm::vec2 zonedFootprintM{0.0f, 0.0f};
     glm::vec3 pivotM{0.0f, 0.0f, 0.0f};
     std::vector<std::string> tags;
+    std::vector<LodSetting> lods;
+    uint32_t index = 0; // dense, stable for a given asset set
+    AssetTraits traits;
 };
 
+// Asset definitions from every asset.json under the assets root. With a
+// compiled path, the scan result (plus mesh bounds) is kept in one binary file
+// that is reused while none of the recorded sources or directories changed.
 class AssetCatalog {
 public:
-    bool loadAll(const std::string& assetsRoot);
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    bool loadAll(const std::string& assetsRoot, const std::string& compiledPath = std::string());
     const AssetDef* find(AssetId id) const;
+    uint32_t indexOf(AssetId id) const;
+    // indexOf(), with the fallback asset's index for unknown ids. Hot paths
+    // resolve once and keep the index for traits().
+    uint32_t resolveIndex(AssetId id) const;
+    const AssetTraits& traits(uint32_t index) const { return traitsByIndex[index]; }
+    // Fallback asset's traits for unknown ids.
+    const AssetTraits& traitsOf(AssetId id) const;
+    std::size_t size() const { return traitsByIndex.size(); }
+    bool loadedFromCompiled() const { return fromCompiled; }
     AssetId findIdByString(const std::string& idStr) const;
     AssetId resolveCategoryAsset(const std::string& category) const;
     AssetId fallbackAsset() const { return fallbackId; }
@@ -35,12 +83,23 @@ public:
     static AssetId HashId(const std::string& idStr);
 
 private:
+    struct SourceStamp {
+        std::string path;
+        FileStamp stamp;
+    };
+
     bool registerAsset(AssetDef def);
     void registerBuiltinDefaults();
+    bool scan(std::vector<SourceStamp>& sources);
+    bool loadCompiled(const std::string& path);
+    void writeCompiled(const std::string& path, const std::vector<SourceStamp>& sources) const;
+    void buildIndex();
 
     std::string rootPath;
     std::unordered_map<AssetId, AssetDef> assetsById;
     std::unordered_map<std::string, AssetId> assetsByStr;
     std::unordered_map<std::string, std::string> defaultByCategoryStr;
     AssetId fallbackId = 0;
+    std::vector<AssetTraits> traitsByIndex;
+    bool fromCompiled = false;
 };
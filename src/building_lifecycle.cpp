@@ -0,0 +1,202 @@
+#include "building_lifecycle.h"
+
+#include "zone_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+void TimingWheel::reset(uint64_t nowTick) {
+    for (auto& slot : root) slot.clear();
+    for (auto& level : levels) {
+        for (auto& slot : level) slot.clear();
+    }
+    current = nowTick;
+    count = 0;
+}
+
+std::vector<TimingWheel::Timer>& TimingWheel::slotFor(uint64_t due) {
+    uint64_t delta = due - current;
+    if (delta < ROOT_SIZE) return root[due & (ROOT_SIZE - 1)];
+    int shift = ROOT_BITS;
+    for (int l = 0; l < LEVELS - 1; l++) {
+        if (l == LEVELS - 2 || delta < (uint64_t(1) << (shift + LEVEL_BITS))) {
+            return levels[l][(due >> shift) & (LEVEL_SIZE - 1)];
+        }
+        shift += LEVEL_BITS;
+    }
+    return root[0]; // unreachable
+}
+
+void TimingWheel::insert(const Timer& t) {
+    slotFor(t.due).push_back(t);
+}
+
+void TimingWheel::schedule(uint32_t id, uint32_t gen, uint64_t dueTick) {
+    // Clamp into the future and below the top level's span so a slot never wraps.
+    const uint64_t maxDelta = (uint64_t(1) << (ROOT_BITS + LEVEL_BITS * (LEVELS - 1))) - 1;
+    dueTick = std::max(dueTick, current + 1);
+    dueTick = std::min(dueTick, current + maxDelta);
+    insert({id, gen, dueTick});
+    count++;
+}
+
+void TimingWheel::advance(uint64_t nowTick, std::vector<Timer>& fired) {
+    std::vector<Timer> moving;
+    while (current < nowTick) {
+        current++;
+        // Cascade coarser slots whose window starts at this tick, top level last
+        // so its entries land in the slots below before those are drained.
+        int shift = ROOT_BITS;
+        for (int l = 0; l < LEVELS - 1; l++) {
+            if ((current & ((uint64_t(1) << shift) - 1)) != 0) break;
+            moving.swap(levels[l][(current >> shift) & (LEVEL_SIZE - 1)]);
+            for (const Timer& t : moving) insert(t);
+            moving.clear();
+            shift += LEVEL_BITS;
+        }
+        std::vector<Timer>& slot = root[current & (ROOT_SIZE - 1)];
+        if (slot.empty()) continue;
+        fired.insert(fired.end(), slot.begin(), slot.end());
+        count -= slot.size();
+        slot.clear();
+    }
+}
+
+void BuildingLifecycle::clear(float nowSec) {
+    items.clear();
+    byChunk.clear();
+    dirty.clear();
+    epochSec = nowSec;
+    wheel.reset(0);
+    stat = {};
+}
+
+uint64_t BuildingLifecycle::toTick(float sec) const {
+    float t = (sec - epochSec) / TICK_SEC;
+    return (t <= 0.0f) ? 0 : (uint64_t)std::ceil(t);
+}
+
+float BuildingLifecycle::upgradeDelay(const Building& b) const {
+    uint32_t h = b.spec.seed * 2654435761u + b.level * 40503u;
+    h ^= h >> 15;
+    float u = (h & 0xffff) / 65535.0f;
+    return cfg.upgradeMinSec + (cfg.upgradeMaxSec - cfg.upgradeMinSec) * u;
+}
+
+void BuildingLifecycle::scheduleIn(uint32_t id, float delaySec, float nowSec) {
+    Building& b = items[id];
+    b.gen++;
+    wheel.schedule(id, b.gen, toTick(nowSec + delaySec));
+}
+
+uint32_t BuildingLifecycle::add(const BuildingSpec& spec, float startSec) {
+    uint32_t id = (uint32_t)items.size();
+    Building b;
+    b.spec = spec;
+    ChunkCoord cc = ChunkFromPosXZ(spec.pos);
+    b.chunkKey = PackChunk(cc.cx, cc.cz);
+    b.stateStart = startSec;
+    items.push_back(b);
+    byChunk[b.chunkKey].push_back(id);
+    dirty.insert(b.chunkKey);
+    stat.byState[(int)BuildingState::EmptyLot]++;
+    items[id].gen++;
+    wheel.schedule(id, items[id].gen, toTick(startSec));
+    return id;
+}
+
+uint32_t BuildingLifecycle::addOccupied(const BuildingSpec& spec) {
+    uint32_t id = add(spec, epochSec);
+    float now = epochSec + wheel.now() * TICK_SEC;
+    items[id].gen++; // drop the pending construction timer
+    enter(id, BuildingState::Occupied, now);
+    return id;
+}
+
+void BuildingLifecycle::enter(uint32_t id, BuildingState next, float nowSec) {
+    Building& b = items[id];
+    stat.byState[(int)b.state]--;
+    b.state = next;
+    b.stateStart = nowSec;
+    stat.byState[(int)next]++;
+    switch (next) {
+    case BuildingState::Construction:
+        scheduleIn(id, cfg.constructionSec, nowSec);
+        break;
+    case BuildingState::Upgrading:
+        // The GPU copy still holds the previous size; re-upload with the new growth window.
+        dirty.insert(b.chunkKey);
+        scheduleIn(id, cfg.constructionSec, nowSec);
+        break;
+    case BuildingState::Occupied:
+        if (b.level < cfg.maxLevel) scheduleIn(id, upgradeDelay(b), nowSec);
+        break;
+    case BuildingState::EmptyLot:
+        break;
+    }
+}
+
+int BuildingLifecycle::update(float nowSec) {
+    fired.clear();
+    uint64_t nowTick = toTick(nowSec);
+    wheel.advance(nowTick, fired);
+    int transitions = 0;
+    for (const TimingWheel::Timer& t : fired) {
+        if (t.id >= items.size() || items[t.id].gen != t.gen) continue; // superseded
+        Building& b = items[t.id];
+        switch (b.state) {
+        case BuildingState::EmptyLot:
+            // Start from the planned time so the state matches what the GPU shows.
+            b.fromScale = glm::vec3(0.0f);
+            enter(t.id, BuildingState::Construction, b.stateStart);
+            break;
+        case BuildingState::Construction:
+        case BuildingState::Upgrading:
+            enter(t.id, BuildingState::Occupied, nowSec);
+            break;
+        case BuildingState::Occupied:
+            b.fromScale = b.spec.scale;
+            b.spec.scale.y *= cfg.upgradeHeightScale;
+            b.spec.pos.y *= cfg.upgradeHeightScale;
+            b.level++;
+            enter(t.id, BuildingState::Upgrading, nowSec);
+            break;
+        }
+        transitions++;
+    }
+    stat.lastFired = transitions;
+    return transitions;
+}
+
+void BuildingLifecycle::takeDirtyChunks(std::vector<uint64_t>& out) {
+    out.assign(dirty.begin(), dirty.end());
+    dirty.clear();
+}
+
+const std::vector<uint32_t>* BuildingLifecycle::buildingsInChunk(uint64_t key) const {
+    auto it = byChunk.find(key);
+    return (it == byChunk.end()) ? nullptr : &it->second;
+}
+
+void BuildingLifecycle::chunkKeys(std::vector<uint64_t>& out) const {
+    out.clear();
+    out.reserve(byChunk.size());
+    for (const auto& kv : byChunk) out.push_back(kv.first);
+}
+
+glm::vec4 BuildingLifecycle::growth(const Building& b) const {
+    if (b.state == BuildingState::Occupied || cfg.constructionSec <= 0.0f) return glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    float invDur = 1.0f / cfg.constructionSec;
+    if (b.state == BuildingState::Upgrading) {
+        float fy = (b.spec.scale.y > 0.0f) ? b.fromScale.y / b.spec.scale.y : 1.0f;
+        return glm::vec4(b.stateStart, invDur, 1.0f, fy);
+    }
+    return glm::vec4(b.stateStart, invDur, 0.0f, 0.0f); // EmptyLot holds its planned start
+}
+
+LifecycleStats BuildingLifecycle::stats() const {
+    LifecycleStats s = stat;
+    s.buildings = (int)items.size();
+    s.timers = (int)wheel.size();
+    return s;
+}
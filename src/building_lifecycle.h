@@ -0,0 +1,135 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "asset_catalog.h"
+
+// Hierarchical timing wheel over integer ticks: 256 one-tick slots, then three
+// levels of 64 coarser slots that cascade down as time reaches them. Scheduling
+// and firing are O(1) per timer; advancing costs one slot per elapsed tick.
+class TimingWheel {
+public:
+    struct Timer {
+        uint32_t id = 0;
+        uint32_t gen = 0;
+        uint64_t due = 0;
+    };
+
+    void reset(uint64_t nowTick);
+    void schedule(uint32_t id, uint32_t gen, uint64_t dueTick);
+    // Steps to nowTick, appending every timer that came due.
+    void advance(uint64_t nowTick, std::vector<Timer>& fired);
+    uint64_t now() const { return current; }
+    size_t size() const { return count; }
+
+private:
+    static constexpr int ROOT_BITS = 8;
+    static constexpr int LEVEL_BITS = 6;
+    static constexpr int LEVELS = 4;
+    static constexpr int ROOT_SIZE = 1 << ROOT_BITS;
+    static constexpr int LEVEL_SIZE = 1 << LEVEL_BITS;
+
+    void insert(const Timer& t);
+    std::vector<Timer>& slotFor(uint64_t due);
+
+    std::vector<Timer> root[ROOT_SIZE];
+    std::vector<Timer> levels[LEVELS - 1][LEVEL_SIZE];
+    uint64_t current = 0;
+    size_t count = 0;
+};
+
+enum class BuildingState : uint8_t {
+    EmptyLot = 0,     // placed, waiting for its construction slot
+    Construction = 1, // growing in
+    Occupied = 2,
+    Upgrading = 3     // regrowing to the next level
+};
+constexpr int BUILDING_STATE_COUNT = 4;
+
+struct BuildingSpec {
+    glm::vec3 pos{};
+    glm::vec3 forward{0.0f, 0.0f, 1.0f};
+    glm::vec3 scale{1.0f};
+    AssetId asset = 0;
+    uint32_t assetIndex = 0; // AssetCatalog dense index, resolved when the lot is built
+    uint32_t seed = 0;
+};
+
+struct LifecycleSettings {
+    float constructionSec = 0.35f;
+    float upgradeMinSec = 120.0f;
+    float upgradeMaxSec = 480.0f;
+    float upgradeHeightScale = 1.3f;
+    int maxLevel = 3;
+};
+
+struct LifecycleStats {
+    int buildings = 0;
+    int byState[BUILDING_STATE_COUNT] = {};
+    int timers = 0; // pending, including superseded ones not yet reached
+    int lastFired = 0;
+};
+
+// Per-building state machine (empty lot -> construction -> occupied -> upgrading
+// -> occupied ...). Every transition is a timer in the wheel, so update() only
+// visits buildings whose timer fires. Buildings sit in their chunk list from the
+// moment they are added; growth is evaluated on the GPU from startSec/fromScale,
+// so a chunk only needs regathering when buildings are added or start upgrading.
+class BuildingLifecycle {
+public:
+    static constexpr float TICK_SEC = 1.0f / 32.0f;
+
+    struct Building {
+        BuildingSpec spec;
+        glm::vec3 fromScale{0.0f};
+        float stateStart = 0.0f; // for EmptyLot, when construction is due to start
+        uint64_t chunkKey = 0;
+        uint32_t gen = 0;
+        BuildingState state = BuildingState::EmptyLot;
+        uint8_t level = 1;
+    };
+
+    void configure(const LifecycleSettings& settings) { cfg = settings; }
+    const LifecycleSettings& settings() const { return cfg; }
+
+    void clear(float nowSec);
+    // Construction starts at startSec (immediately if already past).
+    uint32_t add(const BuildingSpec& spec, float startSec);
+    uint32_t addOccupied(const BuildingSpec& spec);
+
+    // Fires due timers; returns the number of transitions.
+    int update(float nowSec);
+
+    // Chunks whose buildings need re-uploading since the last call.
+    void takeDirtyChunks(std::vector<uint64_t>& out);
+    const std::vector<uint32_t>* buildingsInChunk(uint64_t key) const;
+    // Chunks holding at least one building.
+    void chunkKeys(std::vector<uint64_t>& out) const;
+    const Building& building(uint32_t id) const { return items[id]; }
+    // Growth window for the GPU: start time, 1/duration (0 once settled) and the
+    // starting scale factor (horizontal, vertical).
+    glm::vec4 growth(const Building& b) const;
+
+    size_t size() const { return items.size(); }
+    LifecycleStats stats() const;
+
+private:
+    uint64_t toTick(float sec) const;
+    void enter(uint32_t id, BuildingState next, float nowSec);
+    void scheduleIn(uint32_t id, float delaySec, float nowSec);
+    float upgradeDelay(const Building& b) const;
+
+    LifecycleSettings cfg;
+    std::vector<Building> items;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> byChunk;
+    std::unordered_set<uint64_t> dirty;
+    TimingWheel wheel;
+    std::vector<TimingWheel::Timer> fired;
+    float epochSec = 0.0f;
+    LifecycleStats stat;
+};
@@ -0,0 +1,170 @@
+#include "chunk_streamer.h"
+
+#include "zone_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+const char* ChunkLayerName(ChunkLayer layer) {
+    switch (layer) {
+    case ChunkLayer::ZoneGrid: return "Zone grid";
+    case ChunkLayer::Overlays: return "Overlays";
+    case ChunkLayer::Buildings: return "Buildings";
+    case ChunkLayer::GpuInstances: return "GPU instances";
+    default: return "?";
+    }
+}
+
+void ChunkStreamer::account(int layer, const Record& r, int sign) {
+    if (!r.resident) {
+        stat.evicted[layer] += sign;
+        return;
+    }
+    stat.resident[layer] += sign;
+    if (sign > 0) {
+        stat.residentBytes[layer] += r.bytes;
+        (isGpu(layer) ? stat.gpuBytes : stat.cpuBytes) += r.bytes;
+    } else {
+        stat.residentBytes[layer] -= r.bytes;
+        (isGpu(layer) ? stat.gpuBytes : stat.cpuBytes) -= r.bytes;
+    }
+}
+
+void ChunkStreamer::noteResident(ChunkLayer layer, uint64_t key, std::size_t bytes) {
+    int l = (int)layer;
+    if (bytes == 0) {
+        noteDropped(layer, key);
+        return;
+    }
+    auto it = records[l].find(key);
+    if (it != records[l].end()) {
+        account(l, it->second, -1);
+    } else {
+        it = records[l].emplace(key, Record{}).first;
+    }
+    it->second.bytes = bytes;
+    it->second.resident = true;
+    it->second.lastUse = frame;
+    account(l, it->second, +1);
+}
+
+void ChunkStreamer::noteDropped(ChunkLayer layer, uint64_t key) {
+    int l = (int)layer;
+    auto it = records[l].find(key);
+    if (it == records[l].end()) return;
+    account(l, it->second, -1);
+    records[l].erase(it);
+}
+
+void ChunkStreamer::resetLayer(ChunkLayer layer) {
+    int l = (int)layer;
+    for (const auto& kv : records[l]) account(l, kv.second, -1);
+    records[l].clear();
+}
+
+void ChunkStreamer::restoreAll(ChunkLayer layer) {
+    int l = (int)layer;
+    if (!stores[l] || stat.evicted[l] == 0) return;
+    std::vector<uint64_t> keys;
+    for (const auto& kv : records[l]) {
+        if (!kv.second.resident) keys.push_back(kv.first);
+    }
+    for (uint64_t key : keys) {
+        std::size_t bytes = stores[l]->load(key);
+        if (bytes > 0) noteResident(layer, key, bytes);
+        else noteDropped(layer, key);
+    }
+}
+
+bool ChunkStreamer::isResident(ChunkLayer layer, uint64_t key) const {
+    auto it = records[(int)layer].find(key);
+    return it != records[(int)layer].end() && it->second.resident;
+}
+
+void ChunkStreamer::update(const glm::vec3& cameraPos, const glm::vec3& cameraVelocity) {
+    frame++;
+    glm::vec3 predicted = cameraPos + cameraVelocity * cfg.lookaheadSec;
+    loadWanted(cameraPos, predicted);
+    ChunkCoord cc = ChunkFromPosXZ(cameraPos);
+    evictOverBudget(cc.cx, cc.cz);
+}
+
+// Wanted chunks are the pinned window around the camera plus the same window
+// around the extrapolated position; evicted ones load nearest-first.
+void ChunkStreamer::loadWanted(const glm::vec3& cameraPos, const glm::vec3& predicted) {
+    const int r = cfg.pinRadius;
+    ChunkCoord windows[2] = {ChunkFromPosXZ(cameraPos), ChunkFromPosXZ(predicted)};
+    int windowCount = (windows[0].cx == windows[1].cx && windows[0].cz == windows[1].cz) ? 1 : 2;
+
+    scratch.clear();
+    for (int w = 0; w < windowCount; w++) {
+        for (int dz = -r; dz <= r; dz++) {
+            for (int dx = -r; dx <= r; dx++) {
+                int cx = windows[w].cx + dx;
+                int cz = windows[w].cz + dz;
+                if (w == 1 && std::abs(cx - windows[0].cx) <= r && std::abs(cz - windows[0].cz) <= r) continue;
+                uint64_t key = PackChunk(cx, cz);
+                glm::vec2 center((cx + 0.5f) * CHUNK_SIZE_M, (cz + 0.5f) * CHUNK_SIZE_M);
+                float dCam = glm::length(center - glm::vec2(cameraPos.x, cameraPos.z));
+                float dPred = glm::length(center - glm::vec2(predicted.x, predicted.z));
+                for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+                    auto it = records[l].find(key);
+                    if (it == records[l].end()) continue;
+                    it->second.lastUse = frame;
+                    if (it->second.resident || !stores[l]) continue;
+                    // Layer index breaks ties so data lands before what is derived from it.
+                    scratch.push_back({std::min(dCam, dPred) + (float)l, l, key});
+                }
+            }
+        }
+    }
+    std::sort(scratch.begin(), scratch.end(), [](const Candidate& a, const Candidate& b) { return a.score < b.score; });
+
+    int limit = burst ? cfg.burstLoads : cfg.loadsPerFrame;
+    burst = false;
+    int loads = 0;
+    for (const Candidate& c : scratch) {
+        if (loads >= limit) break;
+        std::size_t bytes = stores[c.layer]->load(c.key);
+        if (bytes > 0) noteResident((ChunkLayer)c.layer, c.key, bytes);
+        else noteDropped((ChunkLayer)c.layer, c.key);
+        loads++;
+    }
+    stat.lastLoads = loads;
+    stat.pendingLoads = (int)scratch.size() - loads;
+}
+
+void ChunkStreamer::evictOverBudget(int camCx, int camCz) {
+    bool cpuOver = stat.cpuBytes > cfg.cpuBudgetBytes;
+    bool gpuOver = stat.gpuBytes > cfg.gpuBudgetBytes;
+    stat.lastEvictions = 0;
+    if (!cpuOver && !gpuOver) return;
+
+    scratch.clear();
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+        if (!stores[l] || (isGpu(l) ? !gpuOver : !cpuOver)) continue;
+        for (const auto& kv : records[l]) {
+            if (!kv.second.resident) continue;
+            int32_t cx, cz;
+            UnpackChunk(kv.first, cx, cz);
+            if (std::abs(cx - camCx) <= cfg.pinRadius && std::abs(cz - camCz) <= cfg.pinRadius) continue;
+            scratch.push_back({(float)kv.second.lastUse, l, kv.first});
+        }
+    }
+    std::sort(scratch.begin(), scratch.end(), [](const Candidate& a, const Candidate& b) { return a.score < b.score; });
+
+    int evictions = 0;
+    for (const Candidate& c : scratch) {
+        if (evictions >= cfg.evictionsPerFrame) break;
+        bool gpu = isGpu(c.layer);
+        if (gpu ? stat.gpuBytes <= cfg.gpuBudgetBytes : stat.cpuBytes <= cfg.cpuBudgetBytes) continue;
+        if (!stores[c.layer]->evict(c.key)) continue;
+        auto it = records[c.layer].find(c.key);
+        account(c.layer, it->second, -1);
+        it->second.resident = false;
+        account(c.layer, it->second, +1);
+        evictions++;
+    }
+    stat.lastEvictions = evictions;
+}
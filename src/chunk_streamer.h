@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+enum class ChunkLayer : uint8_t {
+    ZoneGrid = 0,     // zone flags + water mask
+    Overlays = 1,     // zone flag texture layers
+    Buildings = 2,    // per-chunk building instance lists
+    GpuInstances = 3, // renderer instance buffers
+    Count
+};
+constexpr int CHUNK_LAYER_COUNT = (int)ChunkLayer::Count;
+
+const char* ChunkLayerName(ChunkLayer layer);
+
+// Owner of one layer's per-chunk data.
+class IChunkStore {
+public:
+    virtual ~IChunkStore() = default;
+    // Brings an evicted chunk back; returns its resident size (0 = nothing to restore).
+    virtual std::size_t load(uint64_t key) = 0;
+    // Frees the chunk's resident data, persisting it first if it cannot be rebuilt.
+    virtual bool evict(uint64_t key) = 0;
+};
+
+struct ChunkStreamerSettings {
+    std::size_t cpuBudgetBytes = 96u << 20;
+    std::size_t gpuBudgetBytes = 64u << 20;
+    int pinRadius = 5;          // chunks around the camera that are never evicted
+    float lookaheadSec = 1.0f;  // how far ahead camera motion is extrapolated
+    int loadsPerFrame = 12;
+    int burstLoads = 160;       // after a teleport
+    int evictionsPerFrame = 48;
+};
+
+struct ChunkStreamerStats {
+    std::size_t residentBytes[CHUNK_LAYER_COUNT] = {};
+    int resident[CHUNK_LAYER_COUNT] = {};
+    int evicted[CHUNK_LAYER_COUNT] = {};
+    std::size_t cpuBytes = 0;
+    std::size_t gpuBytes = 0;
+    int lastLoads = 0;
+    int lastEvictions = 0;
+    int pendingLoads = 0;
+};
+
+// Tracks per-layer chunk residency against CPU and GPU byte budgets. Data is
+// produced by the normal code paths and reported with noteResident(); update()
+// restores evicted chunks near the camera (closest to the current or predicted
+// camera position first) and evicts least recently used chunks outside the
+// pinned window once a budget is exceeded.
+class ChunkStreamer {
+public:
+    void configure(const ChunkStreamerSettings& settings) { cfg = settings; }
+    const ChunkStreamerSettings& settings() const { return cfg; }
+    void setStore(ChunkLayer layer, IChunkStore* store) { stores[(int)layer] = store; }
+
+    void noteResident(ChunkLayer layer, uint64_t key, std::size_t bytes);
+    void noteDropped(ChunkLayer layer, uint64_t key);
+    // Forgets a layer's records (it is about to be regenerated from scratch).
+    void resetLayer(ChunkLayer layer);
+    // Synchronously restores every evicted chunk of a layer, for passes that read all of it.
+    void restoreAll(ChunkLayer layer);
+    bool isResident(ChunkLayer layer, uint64_t key) const;
+
+    // Next update loads with the burst budget (e.g. after a minimap jump).
+    void requestBurst() { burst = true; }
+    void update(const glm::vec3& cameraPos, const glm::vec3& cameraVelocity);
+
+    const ChunkStreamerStats& stats() const { return stat; }
+
+private:
+    struct Record {
+        std::size_t bytes = 0;
+        uint64_t lastUse = 0;
+        bool resident = true;
+    };
+    struct Candidate {
+        float score;
+        int layer;
+        uint64_t key;
+    };
+
+    bool isGpu(int layer) const {
+        return layer == (int)ChunkLayer::GpuInstances || layer == (int)ChunkLayer::Overlays;
+    }
+    void account(int layer, const Record& r, int sign);
+    void loadWanted(const glm::vec3& cameraPos, const glm::vec3& predicted);
+    void evictOverBudget(int camCx, int camCz);
+
+    ChunkStreamerSettings cfg;
+    IChunkStore* stores[CHUNK_LAYER_COUNT] = {};
+    std::unordered_map<uint64_t, Record> records[CHUNK_LAYER_COUNT];
+    uint64_t frame = 0;
+    bool burst = false;
+    std::vector<Candidate> scratch;
+    ChunkStreamerStats stat;
+};
@@ -0,0 +1,221 @@
+#include "chunk_summary.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+int PopCount(uint64_t v) {
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (int)((v * 0x0101010101010101ull) >> 56);
+}
+
+} // namespace
+
+void ChunkSummary::merge(const ChunkSummary& o) {
+    waterCells += o.waterCells;
+    for (int t = 0; t < ZONE_TYPE_COUNT; t++) zonedCells[t] += o.zonedCells[t];
+    roadCells += o.roadCells;
+    buildings += o.buildings;
+    maxHeight = std::max(maxHeight, o.maxHeight);
+}
+
+bool ChunkSummary::empty() const {
+    return waterCells == 0 && totalZoned() == 0 && roadCells == 0 && buildings == 0;
+}
+
+uint32_t ChunkSummary::totalZoned() const {
+    uint32_t n = 0;
+    for (int t = 0; t < ZONE_TYPE_COUNT; t++) n += zonedCells[t];
+    return n;
+}
+
+int ChunkSummary::dominantZone() const {
+    int best = -1;
+    uint32_t bestCount = 0;
+    for (int t = 0; t < ZONE_TYPE_COUNT; t++) {
+        if (zonedCells[t] > bestCount) {
+            bestCount = zonedCells[t];
+            best = t;
+        }
+    }
+    return best;
+}
+
+bool ChunkSummary::operator==(const ChunkSummary& o) const {
+    for (int t = 0; t < ZONE_TYPE_COUNT; t++) {
+        if (zonedCells[t] != o.zonedCells[t]) return false;
+    }
+    return waterCells == o.waterCells && roadCells == o.roadCells && buildings == o.buildings &&
+        maxHeight == o.maxHeight && waterMask == o.waterMask && zonedMask == o.zonedMask &&
+        roadMask == o.roadMask;
+}
+
+void SummarizeChunkCells(const uint8_t* zoneCells, const uint64_t* waterBits, ChunkSummary& out) {
+    constexpr int DIM = ZoneChunk::DIM;
+    constexpr int BLOCK = DIM / ChunkSummary::MASK_DIM;
+    out.waterCells = 0;
+    for (int t = 0; t < ZONE_TYPE_COUNT; t++) out.zonedCells[t] = 0;
+    out.roadCells = 0;
+    out.waterMask = out.zonedMask = out.roadMask = 0;
+
+    if (waterBits) {
+        // Rows are two words; a block row is the 16-bit slice of one of them.
+        int blockWater[ChunkSummary::MASK_DIM * ChunkSummary::MASK_DIM] = {};
+        for (int z = 0; z < DIM; z++) {
+            for (int w = 0; w < DIM / 64; w++) {
+                uint64_t word = waterBits[z * (DIM / 64) + w];
+                if (!word) continue;
+                out.waterCells += PopCount(word);
+                for (int b = 0; b < 64 / BLOCK; b++) {
+                    uint64_t slice = (word >> (b * BLOCK)) & ((uint64_t(1) << BLOCK) - 1);
+                    int bx = (w * 64) / BLOCK + b;
+                    blockWater[(z / BLOCK) * ChunkSummary::MASK_DIM + bx] += PopCount(slice);
+                }
+            }
+        }
+        for (int i = 0; i < ChunkSummary::MASK_DIM * ChunkSummary::MASK_DIM; i++) {
+            if (blockWater[i] * 2 >= BLOCK * BLOCK) out.waterMask |= uint64_t(1) << i;
+        }
+    }
+
+    if (zoneCells) {
+        for (int z = 0; z < DIM; z++) {
+            for (int x = 0; x < DIM; x++) {
+                int i = z * DIM + x;
+                uint8_t flags = zoneCells[i];
+                if (!flags) continue;
+                uint64_t bit = uint64_t(1) << ((z / BLOCK) * ChunkSummary::MASK_DIM + x / BLOCK);
+                if (flags & ZONE_FLAG_ZONED) {
+                    out.zonedCells[(int)ZoneTypeFromFlags(flags)]++;
+                    out.zonedMask |= bit;
+                } else if ((flags & ZONE_FLAG_BLOCKED) && (!waterBits || !WaterChunk::test(waterBits, i))) {
+                    out.roadCells++;
+                    out.roadMask |= bit;
+                }
+            }
+        }
+    }
+}
+
+void ChunkSummaryPyramid::configure(int32_t c0, int sideChunks) {
+    origin = c0;
+    sideLeaves = 1;
+    while (sideLeaves < sideChunks) sideLeaves <<= 1;
+    nodes.clear();
+    for (int s = sideLeaves; s >= 1; s >>= 1) nodes.emplace_back((size_t)s * s);
+    pending.clear();
+    pendingFlag.assign((size_t)sideLeaves * sideLeaves, 0);
+    hasDirtyRect = false;
+}
+
+void ChunkSummaryPyramid::clear() {
+    configure(origin, sideLeaves);
+}
+
+bool ChunkSummaryPyramid::contains(int32_t cx, int32_t cz) const {
+    return cx >= origin && cz >= origin && cx < origin + sideLeaves && cz < origin + sideLeaves;
+}
+
+bool ChunkSummaryPyramid::set(int32_t cx, int32_t cz, const ChunkSummary& sum) {
+    if (!contains(cx, cz)) return false;
+    int x = cx - origin;
+    int z = cz - origin;
+    uint32_t i = (uint32_t)z * sideLeaves + x;
+    ChunkSummary& cur = nodes[0][i];
+    if (cur == sum) return false;
+    cur = sum;
+    if (!pendingFlag[i]) {
+        pendingFlag[i] = 1;
+        pending.push_back(i);
+    }
+    if (!hasDirtyRect) {
+        dirty0[0] = dirty1[0] = cx;
+        dirty0[1] = dirty1[1] = cz;
+        hasDirtyRect = true;
+    } else {
+        dirty0[0] = std::min(dirty0[0], cx);
+        dirty0[1] = std::min(dirty0[1], cz);
+        dirty1[0] = std::max(dirty1[0], cx);
+        dirty1[1] = std::max(dirty1[1], cz);
+    }
+    return true;
+}
+
+const ChunkSummary& ChunkSummaryPyramid::leaf(int32_t cx, int32_t cz) const {
+    static const ChunkSummary none;
+    if (!contains(cx, cz)) return none;
+    return nodes[0][(size_t)(cz - origin) * sideLeaves + (cx - origin)];
+}
+
+void ChunkSummaryPyramid::update() {
+    if (pending.empty()) return;
+    for (uint32_t i : pending) pendingFlag[i] = 0;
+
+    // Walk the changed node set up one level at a time, merging each parent once.
+    std::vector<uint32_t> level = std::move(pending);
+    pending.clear();
+    for (int l = 1; l < levels(); l++) {
+        int childSide = side(l - 1);
+        int parentSide = side(l);
+        for (uint32_t& i : level) {
+            int x = (int)(i % childSide) >> 1;
+            int z = (int)(i / childSide) >> 1;
+            i = (uint32_t)z * parentSide + x;
+        }
+        std::sort(level.begin(), level.end());
+        level.erase(std::unique(level.begin(), level.end()), level.end());
+        for (uint32_t i : level) {
+            int x = (int)(i % parentSide) * 2;
+            int z = (int)(i / parentSide) * 2;
+            ChunkSummary sum;
+            sum.merge(node(l - 1, x, z));
+            sum.merge(node(l - 1, x + 1, z));
+            sum.merge(node(l - 1, x, z + 1));
+            sum.merge(node(l - 1, x + 1, z + 1));
+            nodes[l][i] = sum;
+        }
+    }
+}
+
+ChunkSummary ChunkSummaryPyramid::query(const glm::vec2& minXZ, const glm::vec2& maxXZ) const {
+    ChunkSummary out;
+    if (nodes.empty()) return out;
+    int lx0 = std::max(0, (int)std::floor(minXZ.x / CHUNK_SIZE_M) - origin);
+    int lz0 = std::max(0, (int)std::floor(minXZ.y / CHUNK_SIZE_M) - origin);
+    int lx1 = std::min(sideLeaves - 1, (int)std::floor(maxXZ.x / CHUNK_SIZE_M) - origin);
+    int lz1 = std::min(sideLeaves - 1, (int)std::floor(maxXZ.y / CHUNK_SIZE_M) - origin);
+    if (lx1 < lx0 || lz1 < lz0) return out;
+    queryNode(levels() - 1, 0, 0, lx0, lz0, lx1, lz1, out);
+    return out;
+}
+
+void ChunkSummaryPyramid::queryNode(int level, int x, int z, int lx0, int lz0, int lx1, int lz1, ChunkSummary& out) const {
+    const ChunkSummary& n = node(level, x, z);
+    if (n.empty()) return;
+    int span = 1 << level;
+    int nx0 = x * span, nz0 = z * span;
+    int nx1 = nx0 + span - 1, nz1 = nz0 + span - 1;
+    if (nx1 < lx0 || nz1 < lz0 || nx0 > lx1 || nz0 > lz1) return;
+    if (nx0 >= lx0 && nz0 >= lz0 && nx1 <= lx1 && nz1 <= lz1) {
+        out.merge(n);
+        return;
+    }
+    for (int dz = 0; dz < 2; dz++) {
+        for (int dx = 0; dx < 2; dx++) {
+            queryNode(level - 1, x * 2 + dx, z * 2 + dz, lx0, lz0, lx1, lz1, out);
+        }
+    }
+}
+
+bool ChunkSummaryPyramid::takeDirtyRect(int32_t& cx0, int32_t& cz0, int32_t& cx1, int32_t& cz1) {
+    if (!hasDirtyRect) return false;
+    cx0 = dirty0[0];
+    cz0 = dirty0[1];
+    cx1 = dirty1[0];
+    cz1 = dirty1[1];
+    hasDirtyRect = false;
+    return true;
+}
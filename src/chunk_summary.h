@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "zone_grid.h"
+
+// Aggregates of one chunk (or, higher in the pyramid, of a square of chunks).
+struct ChunkSummary {
+    static constexpr int MASK_DIM = 8; // coarse masks: 8x8 blocks of 128 m
+    uint32_t waterCells = 0;
+    uint32_t zonedCells[ZONE_TYPE_COUNT] = {};
+    uint32_t roadCells = 0;
+    uint32_t buildings = 0;
+    float maxHeight = 0.0f;
+    // One bit per block, row-major; leaves only.
+    uint64_t waterMask = 0;
+    uint64_t zonedMask = 0;
+    uint64_t roadMask = 0;
+
+    void merge(const ChunkSummary& o);
+    bool empty() const;
+    uint32_t totalZoned() const;
+    int dominantZone() const; // -1 when nothing is zoned
+    bool operator==(const ChunkSummary& o) const;
+    bool operator!=(const ChunkSummary& o) const { return !(*this == o); }
+    static bool maskBit(uint64_t mask, int bx, int bz) { return (mask >> (bz * MASK_DIM + bx)) & 1; }
+};
+
+// Grid-derived part of a leaf from a chunk's zone cells and water bits (either may be null).
+void SummarizeChunkCells(const uint8_t* zoneCells, const uint64_t* waterBits, ChunkSummary& out);
+
+// Quadtree over a square of chunks stored as dense levels: level 0 holds one
+// summary per chunk, each level above merges 2x2 nodes of the one below.
+// set() only touches the leaf; update() re-merges the ancestors of changed
+// leaves, and the chunk rect they cover is kept for takeDirtyRect().
+class ChunkSummaryPyramid {
+public:
+    // Chunks [c0, c0 + sideChunks) on both axes; the side is rounded up to a power of two.
+    void configure(int32_t c0, int sideChunks);
+    void clear();
+
+    int levels() const { return (int)nodes.size(); }
+    int side(int level) const { return sideLeaves >> level; }
+    int32_t originChunk() const { return origin; }
+    bool contains(int32_t cx, int32_t cz) const;
+
+    // Returns false when the chunk is outside the pyramid or the summary is unchanged.
+    bool set(int32_t cx, int32_t cz, const ChunkSummary& sum);
+    const ChunkSummary& leaf(int32_t cx, int32_t cz) const;
+    const ChunkSummary& node(int level, int x, int z) const { return nodes[level][(size_t)z * side(level) + x]; }
+    const ChunkSummary& root() const { return nodes.back()[0]; }
+    void update();
+
+    // Aggregate over every chunk overlapping the world XZ rectangle.
+    ChunkSummary query(const glm::vec2& minXZ, const glm::vec2& maxXZ) const;
+
+    // Inclusive chunk rect changed since the last call; false when nothing changed.
+    bool takeDirtyRect(int32_t& cx0, int32_t& cz0, int32_t& cx1, int32_t& cz1);
+
+private:
+    void queryNode(int level, int x, int z, int lx0, int lz0, int lx1, int lz1, ChunkSummary& out) const;
+
+    std::vector<std::vector<ChunkSummary>> nodes;
+    std::vector<uint32_t> pending; // changed leaf indices
+    std::vector<uint8_t> pendingFlag;
+    int32_t origin = 0;
+    int sideLeaves = 0;
+    bool hasDirtyRect = false;
+    int32_t dirty0[2] = {};
+    int32_t dirty1[2] = {};
+};
@@ -0,0 +1,391 @@
+#include "coverage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace {
+
+constexpr float INF_DIST = std::numeric_limits<float>::max();
+
+double MsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+const char* ServiceTypeName(ServiceType t) {
+    switch (t) {
+        case ServiceType::Police: return "Police";
+        case ServiceType::Fire: return "Fire";
+        case ServiceType::Health: return "Health";
+        case ServiceType::Education: return "Education";
+        default: return "Unknown";
+    }
+}
+
+CoverageField::Attach CoverageField::Resolve(const RoadGraph& graph, int roadId, float d) {
+    Attach a;
+    int e = graph.edgeAt(roadId, d);
+    if (e < 0 || !graph.edges()[e].alive) return a;
+    const RoadGraphEdge& edge = graph.edges()[e];
+    float dc = std::min(std::max(d, edge.d0), edge.d1);
+    a.edge = e;
+    a.nodeA = edge.nodeA;
+    a.nodeB = edge.nodeB;
+    a.offA = dc - edge.d0;
+    a.offB = edge.d1 - dc;
+    return a;
+}
+
+void CoverageField::resizeNodes(const RoadGraph& graph) {
+    size_t n = graph.nodes().size();
+    for (auto& f : fields) {
+        if (f.dist.size() >= n) continue;
+        f.dist.resize(n, INF_DIST);
+        f.pred.resize(n, -1);
+        f.owner.resize(n, 0);
+    }
+    if (touchedFlag.size() < n) touchedFlag.resize(n, 0);
+    if (regionFlag.size() < n) regionFlag.resize(n, 0);
+}
+
+void CoverageField::resolveSites(const RoadGraph& graph) {
+    siteAttach.resize(sites.size());
+    sitesOfEdge.clear();
+    for (size_t i = 0; i < sites.size(); i++) {
+        siteAttach[i] = Resolve(graph, sites[i].roadId, sites[i].d);
+        if (siteAttach[i].edge >= 0) sitesOfEdge[siteAttach[i].edge].push_back((int)i);
+    }
+}
+
+void CoverageField::seedSite(int t, const ServiceSite& site, const Attach& a) {
+    if (a.edge < 0) return;
+    TypeField& f = fields[t];
+    const float radius = settings.radiusM[t];
+    auto seed = [&](int node, float off) {
+        if (node < 0 || off > radius || off >= f.dist[node]) return;
+        f.dist[node] = off;
+        f.pred[node] = -1;
+        f.owner[node] = site.id;
+        heap.push_back({off, node});
+        std::push_heap(heap.begin(), heap.end(), std::greater<>());
+        if (!touchedFlag[node]) { touchedFlag[node] = 1; touched.push_back(node); }
+    };
+    seed(a.nodeA, a.offA);
+    seed(a.nodeB, a.offB);
+}
+
+// Dijkstra from whatever is on the heap; only strict improvements propagate, so
+// the work is bounded by the region whose distances actually change.
+void CoverageField::propagate(const RoadGraph& graph, int t) {
+    TypeField& f = fields[t];
+    const float radius = settings.radiusM[t];
+    const auto& gNodes = graph.nodes();
+    const auto& gEdges = graph.edges();
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+        auto [d, u] = heap.back();
+        heap.pop_back();
+        if (d > f.dist[u]) continue;
+        for (int e : gNodes[u].edges) {
+            const RoadGraphEdge& edge = gEdges[e];
+            if (!edge.alive) continue;
+            int w = (edge.nodeA == u) ? edge.nodeB : edge.nodeA;
+            float nd = d + edge.length();
+            if (nd > radius || nd >= f.dist[w]) continue;
+            f.dist[w] = nd;
+            f.pred[w] = u;
+            f.owner[w] = f.owner[u];
+            heap.push_back({nd, w});
+            std::push_heap(heap.begin(), heap.end(), std::greater<>());
+            if (!touchedFlag[w]) { touchedFlag[w] = 1; touched.push_back(w); }
+        }
+    }
+}
+
+// Grows the region to every shortest-path-tree descendant and resets it.
+void CoverageField::invalidate(const RoadGraph& graph, int t, std::vector<int>& region) {
+    TypeField& f = fields[t];
+    const auto& gNodes = graph.nodes();
+    const auto& gEdges = graph.edges();
+    for (int u : region) regionFlag[u] = 1;
+    for (size_t i = 0; i < region.size(); i++) {
+        int u = region[i];
+        for (int e : gNodes[u].edges) {
+            const RoadGraphEdge& edge = gEdges[e];
+            if (!edge.alive) continue;
+            int w = (edge.nodeA == u) ? edge.nodeB : edge.nodeA;
+            if (regionFlag[w] || f.pred[w] != u) continue;
+            regionFlag[w] = 1;
+            region.push_back(w);
+        }
+    }
+    for (int u : region) {
+        if (f.dist[u] == INF_DIST) continue;
+        f.dist[u] = INF_DIST;
+        f.pred[u] = -1;
+        f.owner[u] = 0;
+        if (!touchedFlag[u]) { touchedFlag[u] = 1; touched.push_back(u); }
+    }
+}
+
+// Seeds the reset region from its intact boundary and from the services, then repairs.
+void CoverageField::reseedRegion(const RoadGraph& graph, int t, const std::vector<int>& region) {
+    TypeField& f = fields[t];
+    const float radius = settings.radiusM[t];
+    const auto& gNodes = graph.nodes();
+    const auto& gEdges = graph.edges();
+    for (int u : region) {
+        if (!gNodes[u].alive) continue;
+        for (int e : gNodes[u].edges) {
+            const RoadGraphEdge& edge = gEdges[e];
+            if (!edge.alive) continue;
+            int w = (edge.nodeA == u) ? edge.nodeB : edge.nodeA;
+            if (regionFlag[w] || f.dist[w] == INF_DIST) continue;
+            float nd = f.dist[w] + edge.length();
+            if (nd > radius || nd >= f.dist[u]) continue;
+            f.dist[u] = nd;
+            f.pred[u] = w;
+            f.owner[u] = f.owner[w];
+            heap.push_back({nd, u});
+            std::push_heap(heap.begin(), heap.end(), std::greater<>());
+        }
+    }
+    for (int u : region) regionFlag[u] = 0;
+    for (size_t i = 0; i < sites.size(); i++) {
+        if ((int)sites[i].type == t) seedSite(t, sites[i], siteAttach[i]);
+    }
+    propagate(graph, t);
+}
+
+void CoverageField::rebuild(const RoadGraph& graph) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto& f : fields) {
+        f.dist.assign(graph.nodes().size(), INF_DIST);
+        f.pred.assign(graph.nodes().size(), -1);
+        f.owner.assign(graph.nodes().size(), 0);
+    }
+    resizeNodes(graph);
+    resolveSites(graph);
+    for (int t = 0; t < SERVICE_TYPE_COUNT; t++) {
+        for (size_t i = 0; i < sites.size(); i++) {
+            if ((int)sites[i].type == t) seedSite(t, sites[i], siteAttach[i]);
+        }
+        propagate(graph, t);
+    }
+    for (int u : touched) touchedFlag[u] = 0;
+    touched.clear();
+    reattachLots(graph, nullptr);
+    stat.lastTouchedNodes = graph.nodeCount();
+    stat.lastRepairMs = MsSince(t0);
+}
+
+void CoverageField::syncGraph(const RoadGraph& graph, const std::vector<int>& changedNodes) {
+    if (changedNodes.empty()) return;
+    auto t0 = std::chrono::steady_clock::now();
+    resizeNodes(graph);
+    resolveSites(graph);
+    std::vector<int> region;
+    for (int t = 0; t < SERVICE_TYPE_COUNT; t++) {
+        region.clear();
+        for (int u : changedNodes) {
+            if (u >= 0 && u < (int)graph.nodes().size()) region.push_back(u);
+        }
+        invalidate(graph, t, region);
+        reseedRegion(graph, t, region);
+    }
+    std::vector<int> changedLots;
+    reattachLots(graph, &changedLots);
+    finishRepair(graph, changedLots, t0);
+}
+
+void CoverageField::setLots(const RoadGraph& graph, const std::vector<CoverageLot>& lots) {
+    lotList = lots;
+    lotAttach.clear();
+    reattachLots(graph, nullptr);
+}
+
+void CoverageField::reattachLots(const RoadGraph& graph, std::vector<int>* changedLots) {
+    const size_t count = lotList.size();
+    lotAttach.resize(count);
+    lotsOfEdge.assign(graph.edges().size(), {});
+    for (size_t i = 0; i < count; i++) {
+        Attach a = Resolve(graph, lotList[i].roadId, lotList[i].d);
+        if (changedLots && (a.edge != lotAttach[i].edge || a.offA != lotAttach[i].offA)) {
+            changedLots->push_back((int)i);
+        }
+        lotAttach[i] = a;
+        if (a.edge >= 0) lotsOfEdge[a.edge].push_back((int)i);
+    }
+    if (changedLots) return;
+
+    lotDist.assign(count * SERVICE_TYPE_COUNT, INF_DIST);
+    lotsOfChunk.clear();
+    chunks.clear();
+    for (size_t i = 0; i < count; i++) {
+        lotsOfChunk[lotList[i].chunkKey].push_back((int)i);
+        evaluateLot((int)i);
+    }
+    for (const auto& kv : lotsOfChunk) refreshChunk(kv.first);
+    stat.lots = (int)count;
+}
+
+void CoverageField::evaluateLot(int lot) {
+    const Attach& a = lotAttach[lot];
+    for (int t = 0; t < SERVICE_TYPE_COUNT; t++) {
+        float best = INF_DIST;
+        if (a.edge >= 0) {
+            const TypeField& f = fields[t];
+            if (f.dist[a.nodeA] != INF_DIST) best = std::min(best, f.dist[a.nodeA] + a.offA);
+            if (f.dist[a.nodeB] != INF_DIST) best = std::min(best, f.dist[a.nodeB] + a.offB);
+            // A service on the same span is reached without passing either node.
+            auto it = sitesOfEdge.find(a.edge);
+            if (it != sitesOfEdge.end()) {
+                for (int si : it->second) {
+                    if ((int)sites[si].type != t) continue;
+                    best = std::min(best, std::abs(siteAttach[si].offA - a.offA));
+                }
+            }
+        }
+        if (best > settings.radiusM[t]) best = INF_DIST;
+        lotDist[(size_t)lot * SERVICE_TYPE_COUNT + t] = best;
+    }
+}
+
+void CoverageField::refreshChunk(uint64_t key) {
+    auto it = lotsOfChunk.find(key);
+    if (it == lotsOfChunk.end()) {
+        chunks.erase(key);
+        return;
+    }
+    CoverageChunk c;
+    c.lots = (int)it->second.size();
+    for (int lot : it->second) {
+        for (int t = 0; t < SERVICE_TYPE_COUNT; t++) c.coverage[t] += lotCoverage(lot, (ServiceType)t);
+        c.landValue += landValue(lot);
+    }
+    if (c.lots > 0) {
+        float inv = 1.0f / (float)c.lots;
+        for (float& v : c.coverage) v *= inv;
+        c.landValue *= inv;
+    }
+    chunks[key] = c;
+}
+
+// Re-evaluates lots on spans next to repaired nodes (plus any extras) and their chunks.
+void CoverageField::finishRepair(const RoadGraph& graph, std::vector<int>& extraLots,
+                                 std::chrono::steady_clock::time_point t0) {
+    const auto& gNodes = graph.nodes();
+    for (int u : touched) {
+        touchedFlag[u] = 0;
+        if (u >= (int)gNodes.size()) continue;
+        for (int e : gNodes[u].edges) {
+            if (e < (int)lotsOfEdge.size()) {
+                extraLots.insert(extraLots.end(), lotsOfEdge[e].begin(), lotsOfEdge[e].end());
+            }
+        }
+    }
+    stat.lastTouchedNodes = (int)touched.size();
+    touched.clear();
+
+    std::sort(extraLots.begin(), extraLots.end());
+    extraLots.erase(std::unique(extraLots.begin(), extraLots.end()), extraLots.end());
+    std::vector<uint64_t> dirtyChunks;
+    for (int lot : extraLots) {
+        evaluateLot(lot);
+        dirtyChunks.push_back(lotList[lot].chunkKey);
+    }
+    std::sort(dirtyChunks.begin(), dirtyChunks.end());
+    dirtyChunks.erase(std::unique(dirtyChunks.begin(), dirtyChunks.end()), dirtyChunks.end());
+    for (uint64_t key : dirtyChunks) refreshChunk(key);
+    stat.lastRepairMs = MsSince(t0);
+}
+
+void CoverageField::addService(const RoadGraph& graph, const ServiceSite& site) {
+    auto t0 = std::chrono::steady_clock::now();
+    resizeNodes(graph);
+    sites.push_back(site);
+    Attach a = Resolve(graph, site.roadId, site.d);
+    siteAttach.push_back(a);
+    if (a.edge >= 0) sitesOfEdge[a.edge].push_back((int)sites.size() - 1);
+    stat.services = (int)sites.size();
+
+    int t = (int)site.type;
+    seedSite(t, site, a);
+    propagate(graph, t);
+    std::vector<int> extra;
+    if (a.edge >= 0 && a.edge < (int)lotsOfEdge.size()) extra = lotsOfEdge[a.edge];
+    finishRepair(graph, extra, t0);
+}
+
+bool CoverageField::removeService(const RoadGraph& graph, int serviceId) {
+    auto it = std::find_if(sites.begin(), sites.end(), [&](const ServiceSite& s) { return s.id == serviceId; });
+    if (it == sites.end()) return false;
+    auto t0 = std::chrono::steady_clock::now();
+    resizeNodes(graph);
+    const int t = (int)it->type;
+    const Attach a = siteAttach[it - sites.begin()];
+    sites.erase(it);
+    resolveSites(graph);
+    stat.services = (int)sites.size();
+
+    // The service's territory is the connected set of nodes it owns.
+    TypeField& f = fields[t];
+    std::vector<int> region;
+    for (int seed : {a.nodeA, a.nodeB}) {
+        if (seed < 0 || seed >= (int)f.owner.size() || f.owner[seed] != serviceId || regionFlag[seed]) continue;
+        regionFlag[seed] = 1;
+        region.push_back(seed);
+    }
+    const auto& gNodes = graph.nodes();
+    const auto& gEdges = graph.edges();
+    for (size_t i = 0; i < region.size(); i++) {
+        for (int e : gNodes[region[i]].edges) {
+            if (!gEdges[e].alive) continue;
+            int w = (gEdges[e].nodeA == region[i]) ? gEdges[e].nodeB : gEdges[e].nodeA;
+            if (regionFlag[w] || f.owner[w] != serviceId) continue;
+            regionFlag[w] = 1;
+            region.push_back(w);
+        }
+    }
+    invalidate(graph, t, region);
+    reseedRegion(graph, t, region);
+
+    std::vector<int> extra;
+    if (a.edge >= 0 && a.edge < (int)lotsOfEdge.size()) extra = lotsOfEdge[a.edge];
+    finishRepair(graph, extra, t0);
+    return true;
+}
+
+void CoverageField::setServices(const std::vector<ServiceSite>& list) {
+    sites = list;
+    siteAttach.clear();
+    sitesOfEdge.clear();
+    stat.services = (int)sites.size();
+}
+
+float CoverageField::lotDistance(int lot, ServiceType t) const {
+    size_t i = (size_t)lot * SERVICE_TYPE_COUNT + (size_t)t;
+    if (lot < 0 || i >= lotDist.size() || lotDist[i] == INF_DIST) return -1.0f;
+    return lotDist[i];
+}
+
+float CoverageField::lotCoverage(int lot, ServiceType t) const {
+    float d = lotDistance(lot, t);
+    if (d < 0.0f) return 0.0f;
+    return 1.0f - d / settings.radiusM[(int)t];
+}
+
+float CoverageField::landValue(int lot) const {
+    float v = 1.0f;
+    for (int t = 0; t < SERVICE_TYPE_COUNT; t++) v += settings.landValueWeight[t] * lotCoverage(lot, (ServiceType)t);
+    return v;
+}
+
+const CoverageChunk* CoverageField::chunk(uint64_t key) const {
+    auto it = chunks.find(key);
+    return (it == chunks.end()) ? nullptr : &it->second;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "road_graph.h"
+
+enum class ServiceType : uint8_t {
+    Police = 0,
+    Fire = 1,
+    Health = 2,
+    Education = 3,
+    Count
+};
+
+constexpr int SERVICE_TYPE_COUNT = (int)ServiceType::Count;
+
+const char* ServiceTypeName(ServiceType t);
+
+struct ServiceSite {
+    int id = 0;
+    ServiceType type = ServiceType::Police;
+    glm::vec3 pos{};
+    int roadId = 0;
+    float d = 0.0f; // distance along the road it fronts
+};
+
+struct CoverageLot {
+    int roadId = 0;
+    float d = 0.0f;
+    uint64_t chunkKey = 0;
+};
+
+struct CoverageSettings {
+    // Network distance at which coverage reaches zero; also the search cutoff.
+    float radiusM[SERVICE_TYPE_COUNT] = {1500.0f, 1500.0f, 2500.0f, 1200.0f};
+    // Land value = 1 + sum(weight * coverage).
+    float landValueWeight[SERVICE_TYPE_COUNT] = {0.3f, 0.2f, 0.3f, 0.4f};
+};
+
+struct CoverageChunk {
+    int lots = 0;
+    float coverage[SERVICE_TYPE_COUNT] = {};
+    float landValue = 0.0f;
+};
+
+struct CoverageStats {
+    int services = 0;
+    int lots = 0;
+    int lastTouchedNodes = 0;
+    double lastRepairMs = 0.0;
+};
+
+// Per-type nearest-service network distance on road graph nodes, kept as a
+// multi-source shortest path forest so edits only repair the affected region.
+class CoverageField {
+public:
+    void setSettings(const CoverageSettings& s) { settings = s; }
+    const CoverageSettings& getSettings() const { return settings; }
+
+    // Full recompute, e.g. after a bulk graph load.
+    void rebuild(const RoadGraph& graph);
+    // Repairs the forest after incremental graph edits (see RoadGraph::takeChangedNodes).
+    void syncGraph(const RoadGraph& graph, const std::vector<int>& changedNodes);
+    void setLots(const RoadGraph& graph, const std::vector<CoverageLot>& lots);
+
+    void addService(const RoadGraph& graph, const ServiceSite& site);
+    bool removeService(const RoadGraph& graph, int serviceId);
+    // Replaces the service list without repairing; the next rebuild() applies it.
+    void setServices(const std::vector<ServiceSite>& list);
+    const std::vector<ServiceSite>& services() const { return sites; }
+
+    // Metres along the network to the nearest service, negative when beyond the radius.
+    float lotDistance(int lot, ServiceType t) const;
+    float lotCoverage(int lot, ServiceType t) const;
+    float landValue(int lot) const;
+    const CoverageChunk* chunk(uint64_t key) const;
+    const CoverageStats& stats() const { return stat; }
+
+private:
+    struct Attach {
+        int edge = -1;
+        int nodeA = -1;
+        int nodeB = -1;
+        float offA = 0.0f;
+        float offB = 0.0f;
+    };
+    struct TypeField {
+        std::vector<float> dist;
+        std::vector<int> pred;  // -1 when seeded directly by a service
+        std::vector<int> owner; // service id, 0 when unreached
+    };
+
+    static Attach Resolve(const RoadGraph& graph, int roadId, float d);
+    void resizeNodes(const RoadGraph& graph);
+    void seedSite(int t, const ServiceSite& site, const Attach& a);
+    void propagate(const RoadGraph& graph, int t);
+    void invalidate(const RoadGraph& graph, int t, std::vector<int>& region);
+    void reseedRegion(const RoadGraph& graph, int t, const std::vector<int>& region);
+    void resolveSites(const RoadGraph& graph);
+    void reattachLots(const RoadGraph& graph, std::vector<int>* changedLots);
+    void evaluateLot(int lot);
+    void refreshChunk(uint64_t key);
+    void finishRepair(const RoadGraph& graph, std::vector<int>& extraLots, std::chrono::steady_clock::time_point t0);
+
+    CoverageSettings settings;
+    CoverageStats stat;
+
+    TypeField fields[SERVICE_TYPE_COUNT];
+    std::vector<ServiceSite> sites;
+    std::vector<Attach> siteAttach;
+    std::unordered_map<int, std::vector<int>> sitesOfEdge;
+
+    std::vector<CoverageLot> lotList;
+    std::vector<Attach> lotAttach;
+    std::vector<float> lotDist; // lots x SERVICE_TYPE_COUNT
+    std::vector<std::vector<int>> lotsOfEdge;
+    std::unordered_map<uint64_t, std::vector<int>> lotsOfChunk;
+    std::unordered_map<uint64_t, CoverageChunk> chunks;
+
+    // Dijkstra scratch shared by all types.
+    std::vector<std::pair<float, int>> heap;
+    std::vector<int> touched;
+    std::vector<uint8_t> touchedFlag;
+    std::vector<uint8_t> regionFlag;
+};
@@ -0,0 +1,21 @@
+#include "file_stamp.h"
+
+#include <filesystem>
+
+FileStamp StampFile(const std::string& path) {
+    FileStamp s;
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time(path, ec);
+    if (ec) return s;
+    s.mtime = (int64_t)t.time_since_epoch().count();
+    if (std::filesystem::is_regular_file(path, ec)) {
+        uint64_t size = (uint64_t)std::filesystem::file_size(path, ec);
+        s.size = ec ? 0 : size;
+    }
+    return s;
+}
+
+std::string JoinPath(const std::string& root, const std::string& rel) {
+    if (root.empty()) return rel;
+    return (std::filesystem::path(root) / rel).string();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// What the compiled caches record per source to notice edits. Directories
+// stamp size 0 (their mtime moves when entries are added or removed); a
+// missing path stamps MISSING_MTIME, which no existing path matches.
+struct FileStamp {
+    static constexpr int64_t MISSING_MTIME = INT64_MIN;
+
+    int64_t mtime = MISSING_MTIME;
+    uint64_t size = 0;
+
+    bool operator==(const FileStamp& o) const { return mtime == o.mtime && size == o.size; }
+    bool operator!=(const FileStamp& o) const { return !(*this == o); }
+};
+
+FileStamp StampFile(const std::string& path);
+
+// root/rel, or rel alone when root is empty.
+std::string JoinPath(const std::string& root, const std::string& rel);
@@ -0,0 +1,280 @@
+#include "gpu_cull.h"
+
+#include <SDL.h>
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <string>
+
+// The loader is generated for 3.3; the few 4.3 entry points are fetched here.
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_MAX_COMPUTE_WORK_GROUP_COUNT
+#define GL_MAX_COMPUTE_WORK_GROUP_COUNT 0x91BE
+#endif
+
+namespace {
+
+typedef void (APIENTRYP DispatchComputeFn)(GLuint x, GLuint y, GLuint z);
+typedef void (APIENTRYP MemoryBarrierFn)(GLbitfield barriers);
+typedef void (APIENTRYP MultiDrawElementsIndirectFn)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+DispatchComputeFn pDispatchCompute = nullptr;
+MemoryBarrierFn pMemoryBarrier = nullptr;
+MultiDrawElementsIndirectFn pMultiDrawElementsIndirect = nullptr;
+
+// Matches HouseInstanceGPU and DrawElementsIndirectCommand; std430 throughout.
+const char* csCull = R"(
+    #version 430 core
+    layout(local_size_x = 64) in;
+    struct Instance { vec4 posYaw; vec4 scaleVar; vec4 anim; };
+    struct Batch { uint first; uint count; uint group; uint viewMask; };
+    struct Group { uint lodCount; float radius; vec2 pad; vec4 lodDist; uvec4 cmd; };
+    struct Command { uint count; uint instanceCount; uint firstIndex; int baseVertex; uint baseInstance; };
+    layout(std430, binding = 0) readonly buffer Src { Instance src[]; };
+    layout(std430, binding = 1) readonly buffer Batches { Batch batches[]; };
+    layout(std430, binding = 2) readonly buffer Groups { Group groups[]; };
+    layout(std430, binding = 3) buffer Commands { Command cmds[]; };
+    layout(std430, binding = 4) writeonly buffer Dst { Instance dst[]; };
+    uniform vec4 uPlanes[6];
+    uniform vec3 uEye;
+    uniform uint uViewBit;
+    uniform uint uBatchBase;
+    void main() {
+        Batch b = batches[uBatchBase + gl_WorkGroupID.x];
+        if ((b.viewMask & uViewBit) == 0u) return;
+        Group g = groups[b.group];
+        for (uint i = gl_LocalInvocationID.x; i < b.count; i += gl_WorkGroupSize.x) {
+            Instance inst = src[b.first + i];
+            vec3 s = inst.scaleVar.xyz * max(1.0, max(inst.anim.z, inst.anim.w));
+            float r = g.radius * max(s.x, max(s.y, s.z));
+            vec3 c = inst.posYaw.xyz;
+            bool visible = true;
+            for (int p = 0; p < 6; p++) visible = visible && dot(uPlanes[p].xyz, c) + uPlanes[p].w >= -r;
+            if (!visible) continue;
+            float d = max(distance(c, uEye) - r, 0.0);
+            uint lod = 0u;
+            while (lod < g.lodCount && d > g.lodDist[lod]) lod++;
+            if (lod == g.lodCount) continue;
+            uint cmd = g.cmd[lod];
+            uint slot = atomicAdd(cmds[cmd].instanceCount, 1u);
+            dst[cmds[cmd].baseInstance + slot] = inst;
+        }
+    }
+)";
+
+constexpr std::size_t INSTANCE_BYTES = 48;
+
+struct GroupGPU {
+    uint32_t lodCount;
+    float radius;
+    float pad[2];
+    float lodDist[4];
+    uint32_t cmd[4];
+};
+
+struct BatchGPU {
+    uint32_t first;
+    uint32_t count;
+    uint32_t group;
+    uint32_t viewMask;
+};
+
+// Grows (or orphans) a buffer so it holds `bytes`, then uploads `data` if given.
+void UploadBuffer(GLenum target, GLuint buffer, std::size_t& capBytes, std::size_t bytes, const void* data) {
+    glBindBuffer(target, buffer);
+    if (bytes > capBytes) capBytes = bytes + bytes / 2 + 256;
+    glBufferData(target, (GLsizeiptr)capBytes, nullptr, GL_DYNAMIC_DRAW);
+    if (data && bytes) glBufferSubData(target, 0, (GLsizeiptr)bytes, data);
+    glBindBuffer(target, 0);
+}
+
+GLuint BuildComputeProgram(const char* src) {
+    GLuint cs = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(cs, 1, &src, nullptr);
+    glCompileShader(cs);
+    GLint ok = 0;
+    glGetShaderiv(cs, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0;
+        glGetShaderiv(cs, GL_INFO_LOG_LENGTH, &len);
+        std::string log((size_t)len, '\0');
+        glGetShaderInfoLog(cs, len, &len, log.data());
+        SDL_Log("GpuCuller: compute shader compile failed: %s", log.c_str());
+        glDeleteShader(cs);
+        return 0;
+    }
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, cs);
+    glLinkProgram(prog);
+    glDeleteShader(cs);
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0;
+        glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
+        std::string log((size_t)len, '\0');
+        glGetProgramInfoLog(prog, len, &len, log.data());
+        SDL_Log("GpuCuller: compute program link failed: %s", log.c_str());
+        glDeleteProgram(prog);
+        return 0;
+    }
+    return prog;
+}
+
+} // namespace
+
+bool GpuCuller::init() {
+    if (GLVersion.major < 4 || (GLVersion.major == 4 && GLVersion.minor < 3)) return false;
+    pDispatchCompute = (DispatchComputeFn)SDL_GL_GetProcAddress("glDispatchCompute");
+    pMemoryBarrier = (MemoryBarrierFn)SDL_GL_GetProcAddress("glMemoryBarrier");
+    pMultiDrawElementsIndirect = (MultiDrawElementsIndirectFn)SDL_GL_GetProcAddress("glMultiDrawElementsIndirect");
+    if (!pDispatchCompute || !pMemoryBarrier || !pMultiDrawElementsIndirect) {
+        SDL_Log("GpuCuller: GL 4.3 entry points missing");
+        return false;
+    }
+
+    prog = BuildComputeProgram(csCull);
+    if (!prog) return false;
+    locPlanes = glGetUniformLocation(prog, "uPlanes");
+    locEye = glGetUniformLocation(prog, "uEye");
+    locViewBit = glGetUniformLocation(prog, "uViewBit");
+    locBatchBase = glGetUniformLocation(prog, "uBatchBase");
+    GLint maxGroups = 0;
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxGroups);
+    maxGroupsX = (uint32_t)std::max(maxGroups, 65535); // the spec minimum
+
+    glGenBuffers(1, &batchBuf);
+    glGenBuffers(1, &groupBuf);
+    for (View& v : views) {
+        glGenBuffers(1, &v.commandBuf);
+        glGenBuffers(1, &v.instances);
+    }
+    SDL_Log("GpuCuller: GL %d.%d, GPU-driven building path available", GLVersion.major, GLVersion.minor);
+    return true;
+}
+
+void GpuCuller::shutdown() {
+    if (prog) { glDeleteProgram(prog); prog = 0; }
+    if (batchBuf) { glDeleteBuffers(1, &batchBuf); batchBuf = 0; }
+    if (groupBuf) { glDeleteBuffers(1, &groupBuf); groupBuf = 0; }
+    for (View& v : views) {
+        if (v.commandBuf) glDeleteBuffers(1, &v.commandBuf);
+        if (v.instances) glDeleteBuffers(1, &v.instances);
+        v = View{};
+    }
+    batchCap = groupCap = 0;
+    commandTemplate.clear();
+    commands = commands16 = batchCount = totalInstances = 0;
+}
+
+void GpuCuller::begin(const std::vector<Group>& groups, const std::vector<Batch>& batches) {
+    std::vector<uint32_t> groupInstances(groups.size(), 0);
+    for (const Batch& b : batches) groupInstances[b.group] += b.count;
+
+    // Each LOD command of a group owns an output range big enough for all of the
+    // group's instances, so the atomics never need to share a range. Commands
+    // with 16-bit indices come first so each index type is one multi-draw.
+    std::vector<GroupGPU> groupData(groups.size(), GroupGPU{});
+    commandTemplate.clear();
+    commands = 0;
+    uint32_t outFirst = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (std::size_t g = 0; g < groups.size(); g++) {
+            const Group& src = groups[g];
+            GroupGPU& dst = groupData[g];
+            dst.lodCount = (uint32_t)src.lodCount;
+            dst.radius = src.radius;
+            for (int l = 0; l < src.lodCount; l++) {
+                if (src.lods[l].index16 != (pass == 0)) continue;
+                dst.lodDist[l] = src.lods[l].maxDistance;
+                dst.cmd[l] = commands;
+                commandTemplate.push_back(src.lods[l].indexCount);
+                commandTemplate.push_back(0);
+                commandTemplate.push_back(src.lods[l].firstIndex);
+                commandTemplate.push_back((uint32_t)src.lods[l].baseVertex);
+                commandTemplate.push_back(outFirst);
+                outFirst += groupInstances[g];
+                commands++;
+            }
+        }
+        if (pass == 0) commands16 = commands;
+    }
+
+    std::vector<BatchGPU> batchData;
+    batchData.reserve(batches.size());
+    totalInstances = 0;
+    for (const Batch& b : batches) {
+        if (b.count == 0) continue;
+        batchData.push_back({b.first, b.count, b.group, b.viewMask});
+        totalInstances += b.count;
+    }
+    batchCount = (uint32_t)batchData.size();
+
+    UploadBuffer(GL_SHADER_STORAGE_BUFFER, groupBuf, groupCap, groupData.size() * sizeof(GroupGPU), groupData.data());
+    UploadBuffer(GL_SHADER_STORAGE_BUFFER, batchBuf, batchCap, batchData.size() * sizeof(BatchGPU), batchData.data());
+    for (View& v : views) {
+        UploadBuffer(GL_DRAW_INDIRECT_BUFFER, v.commandBuf, v.commandCap,
+            commandTemplate.size() * sizeof(uint32_t), commandTemplate.data());
+        UploadBuffer(GL_ARRAY_BUFFER, v.instances, v.instanceCap, (std::size_t)outFirst * INSTANCE_BYTES, nullptr);
+    }
+}
+
+void GpuCuller::cull(int view, unsigned int sourceInstances, const glm::mat4& viewProj, const glm::vec3& eye) {
+    if (!prog || batchCount == 0) return;
+    const View& v = views[view];
+
+    // Frustum planes from the rows of the clip matrix, normalised for sphere tests.
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; i++) {
+        glm::vec4 row(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+        glm::vec4 w(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+        planes[i * 2 + 0] = w + row;
+        planes[i * 2 + 1] = w - row;
+    }
+    for (glm::vec4& p : planes) p /= glm::length(glm::vec3(p));
+
+    glUseProgram(prog);
+    glUniform4fv(locPlanes, 6, &planes[0][0]);
+    glUniform3f(locEye, eye.x, eye.y, eye.z);
+    glUniform1ui(locViewBit, 1u << view);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sourceInstances);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batchBuf);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, groupBuf);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, v.commandBuf);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, v.instances);
+    // One workgroup per batch, in dispatches no wider than the driver allows.
+    for (uint32_t base = 0; base < batchCount; base += maxGroupsX) {
+        glUniform1ui(locBatchBase, base);
+        pDispatchCompute(std::min(batchCount - base, maxGroupsX), 1, 1);
+    }
+}
+
+void GpuCuller::finish() {
+    if (!prog || batchCount == 0) return;
+    pMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    for (GLuint i = 0; i < 5; i++) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+}
+
+void GpuCuller::draw(int view) const {
+    if (!prog || batchCount == 0 || commands == 0) return;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, views[view].commandBuf);
+    if (commands16 > 0) pMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr, (GLsizei)commands16, 0);
+    if (commands > commands16) {
+        pMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)((std::size_t)commands16 * 5 * sizeof(uint32_t)),
+            (GLsizei)(commands - commands16), 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Optional GL 4.3 path for building instances. A compute pass culls every
+// instance of the submitted batches against a view's frustum and the draw
+// distance, picks a LOD by camera distance and compacts the survivors into
+// per-mesh ranges; the view then draws with one glMultiDrawElementsIndirect per
+// index type.
+// Needs a 4.3 core context (Mesa llvmpipe provides one, so the path can be
+// exercised with LIBGL_ALWAYS_SOFTWARE=1).
+class GpuCuller {
+public:
+    static constexpr int MAX_LODS = 4;
+    static constexpr int VIEW_COUNT = 2; // 0 = camera, 1 = shadow map
+
+    struct Lod {
+        int baseVertex = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        bool index16 = false; // GL_UNSIGNED_SHORT indices
+        float maxDistance = 0.0f; // instances farther from the camera use the next LOD
+    };
+    // One mesh; every batch drawing it shares the group's commands.
+    struct Group {
+        Lod lods[MAX_LODS];
+        int lodCount = 0;
+        float radius = 0.0f;
+    };
+    struct Batch {
+        uint32_t first = 0; // range of the source instance buffer
+        uint32_t count = 0;
+        uint32_t group = 0;
+        uint32_t viewMask = 3; // bit per view that culls this batch
+    };
+
+    // False when the context is older than 4.3 or the compute program fails.
+    bool init();
+    void shutdown();
+    bool ready() const { return prog != 0; }
+
+    // Uploads this frame's batches and command templates; call once before cull().
+    void begin(const std::vector<Group>& groups, const std::vector<Batch>& batches);
+    // Culls `sourceInstances` (HouseInstanceGPU records) for one view.
+    void cull(int view, unsigned int sourceInstances, const glm::mat4& viewProj, const glm::vec3& eye);
+    // Makes the cull results visible to the draws; call after the last cull().
+    void finish();
+    // Draws a view with the bound VAO; instance attributes must point at outputBuffer(view).
+    void draw(int view) const;
+    unsigned int outputBuffer(int view) const { return views[view].instances; }
+    // Indirect commands of a view (5 uints each, 16-bit index commands first).
+    unsigned int commandBuffer(int view) const { return views[view].commandBuf; }
+    uint32_t commandCount() const { return commands; }
+    uint32_t submittedInstances() const { return totalInstances; }
+
+private:
+    struct View {
+        unsigned int commandBuf = 0;
+        unsigned int instances = 0;
+        std::size_t commandCap = 0;  // bytes
+        std::size_t instanceCap = 0; // bytes
+    };
+
+    unsigned int prog = 0;
+    int locPlanes = -1;
+    int locEye = -1;
+    int locViewBit = -1;
+    int locBatchBase = -1;
+    uint32_t maxGroupsX = 65535;
+    unsigned int batchBuf = 0;
+    unsigned int groupBuf = 0;
+    std::size_t batchCap = 0;
+    std::size_t groupCap = 0;
+    View views[VIEW_COUNT];
+    std::vector<uint32_t> commandTemplate; // 5 uints per command, instanceCount = 0
+    uint32_t commands = 0;
+    uint32_t commands16 = 0; // leading commands with 16-bit indices
+    uint32_t batchCount = 0;
+    uint32_t totalInstances = 0;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// FNV-1a over bytes, for cache keys and ids that are stored on disk: the
+// values must never change. Chain calls by passing the previous result as h.
+constexpr uint32_t FNV1A32_OFFSET = 2166136261u;
+constexpr uint64_t FNV1A64_OFFSET = 1469598103934665603ull;
+
+inline uint32_t Fnv1a32(const void* data, std::size_t size, uint32_t h = FNV1A32_OFFSET) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (std::size_t i = 0; i < size; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+inline uint64_t Fnv1a64(const void* data, std::size_t size, uint64_t h = FNV1A64_OFFSET) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (std::size_t i = 0; i < size; i++) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+// Eight bytes per step, for change detection over large in-memory buffers;
+// not the byte-wise values above. A tail shorter than a word is zero-padded.
+inline uint64_t Fnv1a64Words(const void* data, std::size_t size, uint64_t h = FNV1A64_OFFSET) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (std::size_t o = 0; o < size; o += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, p + o, size - o < 8 ? size - o : 8);
+        h = (h ^ word) * 1099511628211ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
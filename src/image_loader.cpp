@@ -1,14 +1,31 @@
+#include "image_loader.h"
+
+#ifdef _WIN32
 #ifndef NOMINMAX
 #define NOMINMAX
 #endif
-
-#include "image_loader.h"
-
 #include <windows.h>
 #include <wincodec.h>
+#endif
 
+#include <cstring>
+#include <fstream>
 #include <string>
 
+bool ReadFileBytes(const char* path, std::vector<uint8_t>& out) {
+    out.clear();
+    if (!path || !path[0]) return false;
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    std::streamoff size = in.tellg();
+    if (size <= 0) return false;
+    out.resize((size_t)size);
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(out.data()), size);
+    return (bool)in;
+}
+
+#ifdef _WIN32
 namespace {
 
 std::wstring Utf8ToWide(const char* str) {
@@ -21,14 +38,7 @@ std::wstring Utf8ToWide(const char* str) {
     return out;
 }
 
-} // namespace
-
-bool LoadImageRGBA(const char* path, std::vector<uint8_t>& outPixels, int& outW, int& outH) {
-    outPixels.clear();
-    outW = 0;
-    outH = 0;
-    if (!path || !path[0]) return false;
-
+bool LoadImageWIC(const char* path, std::vector<uint8_t>& outPixels, int& outW, int& outH) {
     HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
     bool coInit = (hr == S_OK || hr == S_FALSE);
     if (hr == RPC_E_CHANGED_MODE) {
@@ -122,3 +132,54 @@ bool LoadImageRGBA(const char* path, std::vector<uint8_t>& outPixels, int& outW,
     outH = (int)h;
     return true;
 }
+
+} // namespace
+#endif
+
+bool LoadImageRGBA(const char* path, std::vector<uint8_t>& outPixels, int& outW, int& outH) {
+    outPixels.clear();
+    outW = 0;
+    outH = 0;
+    std::vector<uint8_t> bytes;
+    if (!ReadFileBytes(path, bytes)) return false;
+
+    if (IsPngData(bytes.data(), bytes.size())) {
+        bool ok = DecodePngRows(bytes.data(), bytes.size(),
+            [&](int w, int h) {
+                outW = w;
+                outH = h;
+                outPixels.resize((size_t)w * (size_t)h * 4);
+                return true;
+            },
+            [&](int y, const uint8_t* rgba) {
+                std::memcpy(outPixels.data() + (size_t)y * outW * 4, rgba, (size_t)outW * 4);
+            });
+        if (ok) return true;
+    }
+    outPixels.clear();
+    outW = 0;
+    outH = 0;
+#ifdef _WIN32
+    return LoadImageWIC(path, outPixels, outW, outH);
+#else
+    return false;
+#endif
+}
+
+bool ForEachImageRowRGBA(const char* path, const ImageSizeFn& onSize, const ImageRowFn& onRow) {
+    std::vector<uint8_t> bytes;
+    if (!ReadFileBytes(path, bytes)) return false;
+    if (IsPngData(bytes.data(), bytes.size()) && DecodePngRows(bytes.data(), bytes.size(), onSize, onRow)) {
+        return true;
+    }
+    bytes.clear();
+
+    // Formats the streaming decoder does not handle (e.g. interlaced PNG) are decoded whole.
+
+    std::vector<uint8_t> pixels;
+    int w = 0;
+    int h = 0;
+    if (!LoadImageRGBA(path, pixels, w, h) || !onSize(w, h)) return false;
+    for (int y = 0; y < h; y++) onRow(y, pixels.data() + (size_t)y * w * 4);
+    return true;
+}
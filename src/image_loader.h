@@ -3,4 +3,12 @@
 #include <cstdint>
 #include <vector>
 
+#include "png_decoder.h"
+
+// PNG is decoded portably; other formats go through WIC on Windows.
 bool LoadImageRGBA(const char* path, std::vector<uint8_t>& outPixels, int& outW, int& outH);
+
+// Streams the image row by row (PNG without holding the whole image in memory).
+bool ForEachImageRowRGBA(const char* path, const ImageSizeFn& onSize, const ImageRowFn& onRow);
+
+bool ReadFileBytes(const char* path, std::vector<uint8_t>& out);
@@ -58,12 +58,22 @@ LightingParams EvaluateTimeOfDay(float timeHours) {
     return out;
 }
 
-glm::mat4 BuildDirectionalLightMatrix(const glm::vec3& center, float radius, const glm::vec3& sunDir) {
+glm::mat4 BuildSnappedLightMatrix(const glm::vec3& center, float radius, const glm::vec3& sunDir, int mapSize, float depthRadius) {
     glm::vec3 lightDir = glm::normalize(-sunDir);
     glm::vec3 up = (std::fabs(lightDir.y) > 0.95f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
 
-    glm::vec3 lightPos = center - lightDir * radius;
-    glm::mat4 view = glm::lookAt(lightPos, center, up);
-    glm::mat4 proj = glm::ortho(-radius, radius, -radius, radius, 0.1f, radius * 3.0f);
+    // The view has no translation, so moving the center slides the ortho window over a fixed
+    // texel grid; snapping it to whole texels keeps shadow edges from crawling as the camera pans.
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+    glm::vec3 c = glm::vec3(view * glm::vec4(center, 1.0f));
+    float texel = 2.0f * radius / (float)mapSize;
+    c.x = std::floor(c.x / texel) * texel;
+    c.y = std::floor(c.y / texel) * texel;
+    // Depth in coarse steps too, or every pan would change the matrix; the range
+    // keeps 7/8 of depthRadius on either side of the true center.
+    float depthStep = depthRadius * 0.125f;
+    c.z = std::floor(c.z / depthStep) * depthStep;
+    glm::mat4 proj = glm::ortho(c.x - radius, c.x + radius, c.y - radius, c.y + radius,
+                                -c.z - depthRadius, -c.z + depthRadius);
     return proj * view;
 }
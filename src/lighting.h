@@ -15,4 +15,7 @@ struct LightingParams {
 };
 
 LightingParams EvaluateTimeOfDay(float timeHours);
-glm::mat4 BuildDirectionalLightMatrix(const glm::vec3& center, float radius, const glm::vec3& sunDir);
+// Sun view-projection for one shadow cascade: an ortho box of `radius` around `center`,
+// snapped to whole shadow-map texels so it stays stable under camera motion for a
+// fixed radius and map size.
+glm::mat4 BuildSnappedLightMatrix(const glm::vec3& center, float radius, const glm::vec3& sunDir, int mapSize, float depthRadius);
@@ -13,9 +13,24 @@
 #include "renderer.h"
 #include "asset_catalog.h"
 #include "mesh_cache.h"
+#include "mesh_archive.h"
 #include "config.h"
-#include "image_loader.h"
+#include "zone_grid.h"
 #include "lighting.h"
+#include "road_graph.h"
+#include "traffic.h"
+#include "coverage.h"
+#include "scalar_field.h"
+#include "travel_time_index.h"
+#include "simulation_clock.h"
+#include "building_lifecycle.h"
+#include "chunk_streamer.h"
+#include "region_file.h"
+#include "water_mask.h"
+#include "chunk_summary.h"
+#include "occlusion_culler.h"
+#include "parallel.h"
+#include "hash.h"
 
 #include <vector>
 #include <string>
@@ -23,8 +38,10 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdint>
+#include <cstring>
 #include <array>
 #include <fstream>
+#include <filesystem>
 #include <memory>
 #include <limits>
 #include <unordered_set>
@@ -90,22 +107,6 @@ static glm::vec3 ComputeRenderOrigin(const glm::vec3& target) {
     return o;
 }
 
-constexpr float CHUNK_SIZE_M = 1024.0f;
-struct ChunkCoord { int32_t cx; int32_t cz; };
-static uint64_t PackChunk(int32_t cx, int32_t cz) {
-    return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cz);
-}
-static void UnpackChunk(uint64_t key, int32_t& cx, int32_t& cz) {
-    cx = (int32_t)(key >> 32);
-    cz = (int32_t)(key & 0xffffffffu);
-}
-static ChunkCoord ChunkFromPosXZ(const glm::vec3& p) {
-    return {
-        (int32_t)std::floor(p.x / CHUNK_SIZE_M),
-        (int32_t)std::floor(p.z / CHUNK_SIZE_M)
-    };
-}
-
 struct Camera {
     glm::vec3 target{0.0f, 0.0f, 0.0f};
     float distance = 180.0f;
@@ -307,53 +308,14 @@ static bool SnapToAnyEndpoint(
 
 struct BuildingInstance {
     AssetId asset = 0;
+    uint32_t assetIndex = 0; // AssetCatalog dense index
     glm::vec3 localPos{};
     float yaw = 0.0f;
     glm::vec3 scale{1.0f, 1.0f, 1.0f};
     uint32_t seed = 0;
+    glm::vec4 growth{0.0f, 0.0f, 1.0f, 1.0f}; // see BuildingLifecycle::growth
 };
 
-struct HouseAnim {
-    glm::vec3 pos;
-    float spawnTime;
-    glm::vec3 forward;
-    AssetId asset = 0;
-    glm::vec3 scale{1.0f, 1.0f, 1.0f};
-    uint32_t seed = 0;
-};
-
-struct ZoneChunk {
-    static constexpr int DIM = 128;
-    std::array<uint8_t, DIM * DIM> cells{};
-    void clear() { cells.fill(0); }
-    void set(int x, int z, uint8_t v) {
-        if (x < 0 || x >= DIM || z < 0 || z >= DIM) return;
-        cells[z * DIM + x] = v;
-    }
-    uint8_t get(int x, int z) const {
-        if (x < 0 || x >= DIM || z < 0 || z >= DIM) return 0;
-        return cells[z * DIM + x];
-    }
-};
-
-struct WaterChunk {
-    static constexpr int DIM = ZoneChunk::DIM;
-    std::array<uint8_t, DIM * DIM> cells{};
-    void clear() { cells.fill(0); }
-    void set(int x, int z, uint8_t v) {
-        if (x < 0 || x >= DIM || z < 0 || z >= DIM) return;
-        cells[z * DIM + x] = v;
-    }
-    uint8_t get(int x, int z) const {
-        if (x < 0 || x >= DIM || z < 0 || z >= DIM) return 0;
-        return cells[z * DIM + x];
-    }
-};
-
-constexpr uint8_t ZONE_FLAG_BUILDABLE = 1 << 0;
-constexpr uint8_t ZONE_FLAG_ZONED = 1 << 1;
-constexpr uint8_t ZONE_FLAG_BLOCKED = 1 << 2;
-constexpr float ZONE_CELL_M = CHUNK_SIZE_M / ZoneChunk::DIM;
 constexpr int   ZONE_DEPTH_CELLS = 6;
 constexpr float ZONE_DEPTH_M = ZONE_DEPTH_CELLS * ZONE_CELL_M; // 48m with 8m cells
 constexpr float ROAD_WIDTH_M = 16.0f;
@@ -361,23 +323,6 @@ constexpr float ROAD_HALF_M = ROAD_WIDTH_M * 0.5f;
 constexpr float INTERSECTION_CLEAR_M = ROAD_HALF_M + ZONE_CELL_M * 0.5f;
 constexpr float ROAD_TEX_TILE_M = ROAD_WIDTH_M;
 constexpr float WATER_SURFACE_Y = 0.02f;
-constexpr uint8_t ZONE_TYPE_SHIFT = 3;
-constexpr uint8_t ZONE_TYPE_MASK = 0x18; // 2 bits for 4 zone types
-
-enum class ZoneType : uint8_t {
-    Residential = 0,
-    Commercial = 1,
-    Industrial = 2,
-    Office = 3
-};
-
-static uint8_t ZoneTypeBits(ZoneType t) {
-    return (uint8_t(t) << ZONE_TYPE_SHIFT) & ZONE_TYPE_MASK;
-}
-
-static ZoneType ZoneTypeFromFlags(uint8_t flags) {
-    return (ZoneType)((flags & ZONE_TYPE_MASK) >> ZONE_TYPE_SHIFT);
-}
 
 static const char* ZoneTypeName(ZoneType t) {
     switch (t) {
@@ -428,8 +373,32 @@ struct LotCell {
     ZoneType zoneType = ZoneType::Residential;
 };
 
+// Spatially sorted run of one asset's instances; the unit the occlusion pass
+// tests and the renderer draws as an instance sub-range.
+struct InstanceCluster {
+    AssetId asset = 0;
+    uint32_t first = 0;
+    uint32_t count = 0;
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+};
+
+// Shrunk box of a tall building, used as an occluder once fully grown.
+struct OccluderBox {
+    glm::vec3 center{};
+    glm::vec3 halfExtents{};
+    float yaw = 0.0f;
+    float readyAt = 0.0f;
+};
+
 struct BuildingChunk {
     std::unordered_map<AssetId, std::vector<BuildingInstance>> instancesByAsset;
+    // Built on upload by ClusterBuildingChunk; world space.
+    std::vector<InstanceCluster> clusters;
+    std::vector<OccluderBox> occluders;
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+    float animatingUntil = 0.0f; // last growth animation end; shadows redraw until then
 };
 
 struct LargeLotDebug {
@@ -445,7 +414,8 @@ struct LargeLotDebug {
 struct MinimapState {
     GLuint texture = 0;
     int size = 512;
-    bool dirty = true;
+    bool dirty = true; // full re-rasterize; otherwise only chunks the summaries report
+    std::vector<uint8_t> pixels;
 };
 
 struct AppState {
@@ -453,33 +423,66 @@ struct AppState {
     int nextZoneId = 1;
 
     std::vector<Road> roads;
+    RoadGraph roadGraph;
+    std::unordered_set<int> dirtyRoadIds;
+    bool roadGraphFullRebuild = true;
     std::vector<ZoneStrip> zones;
     std::vector<LotCell> lots;
     std::unordered_map<uint64_t, std::vector<int>> lotIndicesByChunk;
-    std::unordered_map<uint64_t, std::vector<glm::mat4>> houseStaticByChunk;
     std::unordered_map<uint64_t, BuildingChunk> buildingChunks;
     std::unordered_set<uint64_t> dirtyBuildingChunks;
+    std::unordered_set<uint64_t> uploadedBuildingChunks; // GPU copy valid for buildingUploadOrigin
+    glm::vec3 buildingUploadOrigin{0.0f};
     std::unordered_map<uint64_t, ZoneChunk> zoneChunks;
     std::unordered_set<uint64_t> dirtyZoneChunks;
     std::unordered_map<uint64_t, WaterChunk> waterChunks;
-    std::unordered_map<uint64_t, std::vector<glm::vec3>> overlayBuildableByChunk;
-    std::unordered_map<uint64_t, std::vector<glm::vec3>> overlayZonedResByChunk;
-    std::unordered_map<uint64_t, std::vector<glm::vec3>> overlayZonedComByChunk;
-    std::unordered_map<uint64_t, std::vector<glm::vec3>> overlayZonedIndByChunk;
-    std::unordered_map<uint64_t, std::vector<glm::vec3>> overlayZonedOfficeByChunk;
+    // Saved grids mapped read-only; zoneChunks/waterChunks hold copy-on-write edits on top.
+    RegionFile zoneRegion;
+    bool zoneBaseValid = false;
+    bool waterBaseValid = false;
+    bool zoneGridFromRegion = false; // skip the next zone grid rebuild
     LargeLotDebug largeLotDebug;
     std::string largeLotLastFail;
+    TrafficSolver traffic;
+    uint64_t trafficRequest = 0;  // last rebuild sent to the solver
+    uint64_t trafficSequence = 0; // last results shown
+    TravelTimeIndex travelIndex;
+    TravelTimeBuilder travelBuilder;
+    uint32_t travelIndexVersion = UINT32_MAX; // last topology sent to the builder
+    bool travelIndexUsesTraffic = false;
+    TravelTimeBenchmark travelBench;
+    CoverageField coverage;
+    int nextServiceId = 1;
+    ScalarField landValueField;
+    ScalarField pollutionField;
+    ScalarField noiseField;
+    bool fieldsDirty = true;
+    SimulationClock sim;
+    bool simSnapshotDirty = true;
 
     bool roadsDirty = true;
     bool zonesDirty = true;
     bool housesDirty = true;
-    bool overlayDirty = true;
-
-    std::vector<RoadVertex> roadMeshVerts;
+    std::unordered_set<uint64_t> dirtyZoneTextureChunks; // GPU zone flag layers older than the grid
+    bool trafficDirty = true;
+    bool trafficHeatmap = false;
+    bool heatmapDirty = true;
+    bool occlusionCulling = true;
+    OcclusionCuller occlusion;
+    std::unordered_set<uint64_t> shadowCasterChunks; // chunks submitted last frame
+
+    std::unordered_map<uint64_t, std::vector<RoadSegmentGPU>> roadSegmentsByChunk;
+    std::unordered_set<uint64_t> dirtyRoadChunks; // need re-uploading
     std::vector<glm::vec3> zonePreviewVerts;
 
-    std::vector<glm::mat4> houseStatic;
-    std::vector<HouseAnim> houseAnim;
+    BuildingLifecycle buildings;
+    ChunkStreamer streamer;
+
+    // Per-chunk aggregates for far-view queries and the minimap.
+    ChunkSummaryPyramid summaries;
+    std::unordered_set<uint64_t> dirtySummaryChunks;     // building counts changed
+    std::unordered_set<uint64_t> dirtySummaryGridChunks; // zone or water cells changed
+    std::unordered_map<uint64_t, uint64_t> gridChunkHashes; // cell contents as of the last grid rebuild
 };
 
 static bool ZonesOverlap(float a0, float a1, float b0, float b1) {
@@ -510,29 +513,61 @@ static bool ZoneOverlapsExisting(const AppState& s, int roadId, float d0, float
 
 static bool WorldToZoneCell(const glm::vec3& p, int& outCx, int& outCz, int& outXi, int& outZi);
 
+// Edited chunk if there is one, else the mapped region's cells (nullptr = empty chunk).
+static const uint8_t* ZoneCellsFor(const AppState& s, uint64_t key) {
+    auto it = s.zoneChunks.find(key);
+    if (it != s.zoneChunks.end()) return it->second.cells.data();
+    return s.zoneBaseValid ? s.zoneRegion.zoneCells(key) : nullptr;
+}
+
+static const uint64_t* WaterBitsFor(const AppState& s, uint64_t key) {
+    auto it = s.waterChunks.find(key);
+    if (it != s.waterChunks.end()) return it->second.bits.data();
+    return s.waterBaseValid ? s.zoneRegion.waterBits(key) : nullptr;
+}
+
+static uint8_t ChunkCellAt(const uint8_t* cells, int xi, int zi) {
+    if (!cells || xi < 0 || xi >= ZoneChunk::DIM || zi < 0 || zi >= ZoneChunk::DIM) return 0;
+    return cells[zi * ZoneChunk::DIM + xi];
+}
+
+// Keys of every chunk with zone (or water) cells, edited or mapped.
+static std::vector<uint64_t> ZoneGridKeys(const AppState& s, bool water) {
+    std::vector<uint64_t> keys;
+    if (water) {
+        for (const auto& kv : s.waterChunks) keys.push_back(kv.first);
+    } else {
+        for (const auto& kv : s.zoneChunks) keys.push_back(kv.first);
+    }
+    if (water ? s.waterBaseValid : s.zoneBaseValid) {
+        for (std::size_t i = 0; i < s.zoneRegion.chunkCount(); i++) {
+            const RegionChunkEntry& e = s.zoneRegion.entry(i);
+            if (!(water ? e.waterOffset : e.zoneOffset)) continue;
+            if (water ? s.waterChunks.count(e.key) : s.zoneChunks.count(e.key)) continue;
+            keys.push_back(e.key);
+        }
+    }
+    return keys;
+}
+
 static uint8_t GetZoneFlagsAt(const AppState& s, const glm::vec3& pos) {
     ChunkCoord cc = ChunkFromPosXZ(pos);
     uint64_t key = PackChunk(cc.cx, cc.cz);
-    auto it = s.zoneChunks.find(key);
-    if (it == s.zoneChunks.end()) return 0;
     float originX = cc.cx * CHUNK_SIZE_M;
     float originZ = cc.cz * CHUNK_SIZE_M;
     int xi = (int)std::floor((pos.x - originX) / ZONE_CELL_M);
     int zi = (int)std::floor((pos.z - originZ) / ZONE_CELL_M);
-    return it->second.get(xi, zi);
+    return ChunkCellAt(ZoneCellsFor(s, key), xi, zi);
 }
 
 static uint8_t GetWaterAt(const AppState& s, const glm::vec3& pos) {
     int cx, cz, xi, zi;
     if (!WorldToZoneCell(pos, cx, cz, xi, zi)) return 0;
-    uint64_t key = PackChunk(cx, cz);
-    auto it = s.waterChunks.find(key);
-    if (it == s.waterChunks.end()) return 0;
-    return it->second.get(xi, zi);
+    const uint64_t* bits = WaterBitsFor(s, PackChunk(cx, cz));
+    return bits ? WaterChunk::test(bits, zi * WaterChunk::DIM + xi) : 0;
 }
 
 static ZoneChunk& EnsureZoneChunk(AppState& s, uint64_t key);
-static WaterChunk& EnsureWaterChunk(AppState& s, uint64_t key);
 
 static bool WorldToZoneCell(const glm::vec3& p, int& outCx, int& outCz, int& outXi, int& outZi) {
     int cx = (int)std::floor(p.x / CHUNK_SIZE_M);
@@ -792,22 +827,14 @@ static ZoneChunk& EnsureZoneChunk(AppState& s, uint64_t key) {
     auto it = s.zoneChunks.find(key);
     if (it == s.zoneChunks.end()) {
         ZoneChunk z;
-        z.clear();
+        const uint8_t* base = s.zoneBaseValid ? s.zoneRegion.zoneCells(key) : nullptr;
+        if (base) std::memcpy(z.cells.data(), base, z.cells.size());
+        else z.clear();
         it = s.zoneChunks.emplace(key, std::move(z)).first;
     }
     return it->second;
 }
 
-static WaterChunk& EnsureWaterChunk(AppState& s, uint64_t key) {
-    auto it = s.waterChunks.find(key);
-    if (it == s.waterChunks.end()) {
-        WaterChunk w;
-        w.clear();
-        it = s.waterChunks.emplace(key, std::move(w)).first;
-    }
-    return it->second;
-}
-
 [[maybe_unused]] static void StampZoneStrip(AppState& s, const ZoneStrip& z, bool add) {
     int ridx = FindRoadIndexById(s.roads, z.roadId);
     if (ridx < 0) return;
@@ -949,121 +976,237 @@ static void StampRoadSurfaceBlocked(AppState& s, const Road& r) {
     }
 }
 
+// Works a chunk at a time on whole mask words instead of looking up every cell.
 static void StampWaterMask(AppState& s) {
-    if (s.waterChunks.empty()) return;
-    for (const auto& kv : s.waterChunks) {
-        int32_t cx, cz;
-        UnpackChunk(kv.first, cx, cz);
-        const WaterChunk& chunk = kv.second;
-        for (int zi = 0; zi < WaterChunk::DIM; ++zi) {
-            for (int xi = 0; xi < WaterChunk::DIM; ++xi) {
-                if (chunk.get(xi, zi) == 0) continue;
-                SetZoneCellFlags(
-                    s, cx, cz, xi, zi,
-                    ZONE_FLAG_BLOCKED,
-                    (uint8_t)(ZONE_FLAG_BUILDABLE | ZONE_FLAG_ZONED | ZONE_TYPE_MASK));
-                s.dirtyBuildingChunks.insert(PackChunk(cx, cz));
+    const uint8_t clearMask = (uint8_t)(ZONE_FLAG_BUILDABLE | ZONE_FLAG_ZONED | ZONE_TYPE_MASK);
+    for (uint64_t key : ZoneGridKeys(s, true)) {
+        const uint64_t* bits = WaterBitsFor(s, key);
+        ZoneChunk* chunk = nullptr;
+        for (int w = 0; w < WaterChunk::WORDS; ++w) {
+            uint64_t word = bits[w];
+            if (word == 0) continue;
+            if (!chunk) chunk = &EnsureZoneChunk(s, key);
+            for (int b = 0; word; ++b, word >>= 1) {
+                if (!(word & 1)) continue;
+                uint8_t& v = chunk->cells[w * 64 + b];
+                v = (uint8_t)((v & ~clearMask) | ZONE_FLAG_BLOCKED);
             }
         }
+        if (!chunk) continue;
+        s.dirtyZoneChunks.insert(key);
+        s.dirtyBuildingChunks.insert(key);
     }
 }
 
 static bool LoadWaterMaskFromImage(AppState& s, const char* path, float threshold) {
-    std::vector<uint8_t> pixels;
-    int w = 0;
-    int h = 0;
-    if (!LoadImageRGBA(path, pixels, w, h)) return false;
-    if (w <= 0 || h <= 0) return false;
-
-    s.waterChunks.clear();
+    uint64_t t0 = SDL_GetPerformanceCounter();
+    WaterMaskResult mask;
+    if (!BuildWaterMask(path, threshold, "cache/water", mask)) return false;
 
-    const float mapHalf = MAP_HALF_M;
-    const float invMap = 1.0f / MAP_SIDE_M;
-    const float startX = -mapHalf + ZONE_CELL_M * 0.5f;
-    const float startZ = -mapHalf + ZONE_CELL_M * 0.5f;
-    const int cellsPerSide = (int)std::ceil(MAP_SIDE_M / ZONE_CELL_M);
-
-    int waterCells = 0;
-    for (int gz = 0; gz < cellsPerSide; ++gz) {
-        float wz = startZ + gz * ZONE_CELL_M;
-        float v = 1.0f - ((wz + mapHalf) * invMap);
-        if (v < 0.0f || v > 1.0f) continue;
-        int pz = (int)Clamp(std::floor(v * (float)h), 0.0f, (float)(h - 1));
-        for (int gx = 0; gx < cellsPerSide; ++gx) {
-            float wx = startX + gx * ZONE_CELL_M;
-            float u = (wx + mapHalf) * invMap;
-            if (u < 0.0f || u > 1.0f) continue;
-            int px = (int)Clamp(std::floor(u * (float)w), 0.0f, (float)(w - 1));
-            const uint8_t* p = &pixels[(pz * w + px) * 4];
-            float lum = (p[0] + p[1] + p[2]) * (1.0f / (3.0f * 255.0f));
-            if (lum < threshold) continue;
-
-            glm::vec3 sample(wx, 0.0f, wz);
-            int cx, cz, xi, zi;
-            if (!WorldToZoneCell(sample, cx, cz, xi, zi)) continue;
-            WaterChunk& wc = EnsureWaterChunk(s, PackChunk(cx, cz));
-            if (wc.get(xi, zi) == 0) {
-                wc.set(xi, zi, 1);
-                waterCells++;
-            }
-        }
-    }
+    s.streamer.resetLayer(ChunkLayer::ZoneGrid); // evicted copies hold the old mask
+    s.waterChunks = std::move(mask.chunks);
+    s.waterBaseValid = false;
 
-    SDL_Log("Water mask loaded: %d cells from %s", waterCells, path);
+    double ms = (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    SDL_Log("Water mask loaded: %d cells from %s (%s, %.0f ms)", mask.waterCells, path,
+        mask.fromCache ? "cached" : "decoded", ms);
     s.zonesDirty = true;
     s.housesDirty = true;
-    s.overlayDirty = true;
     return true;
 }
 
-static void UpdateMinimapTexture(MinimapState& mm, const AppState& s) {
-    if (!mm.dirty && mm.texture != 0) return;
-    if (mm.size <= 0) return;
+static void SummarizeChunkBuildings(const AppState& s, uint64_t key, ChunkSummary& out) {
+    out.buildings = 0;
+    out.maxHeight = 0.0f;
+    const std::vector<uint32_t>* ids = s.buildings.buildingsInChunk(key);
+    if (!ids) return;
+    for (uint32_t id : *ids) {
+        const BuildingSpec& spec = s.buildings.building(id).spec;
+        out.buildings++;
+        out.maxHeight = std::max(out.maxHeight, spec.pos.y + spec.scale.y * 0.5f);
+    }
+}
 
-    if (mm.texture == 0) {
-        glGenTextures(1, &mm.texture);
+// Hashes every chunk's zone and water cells after a grid rebuild and returns the
+// chunks that differ from the previous rebuild (including chunks that emptied).
+// The rebuild restamps the whole grid, but consumers only redo these chunks.
+static std::vector<uint64_t> TakeChangedGridChunks(AppState& s) {
+    std::vector<uint64_t> keys = ZoneGridKeys(s, false);
+    std::vector<uint64_t> waterKeys = ZoneGridKeys(s, true);
+    keys.insert(keys.end(), waterKeys.begin(), waterKeys.end());
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<uint64_t> hashes(keys.size());
+    ParallelFor((int)keys.size(), [&](int i, int) {
+        const uint8_t* cells = ZoneCellsFor(s, keys[i]);
+        const uint64_t* bits = WaterBitsFor(s, keys[i]);
+        uint64_t present = (uint64_t)(cells != nullptr) | ((uint64_t)(bits != nullptr) << 1);
+        uint64_t h = Fnv1a64Words(&present, sizeof(present));
+        if (cells) h = Fnv1a64Words(cells, (std::size_t)ZoneChunk::DIM * ZoneChunk::DIM, h);
+        if (bits) h = Fnv1a64Words(bits, sizeof(uint64_t) * WaterChunk::WORDS, h);
+        hashes[i] = h;
+    });
+
+    std::vector<uint64_t> changed;
+    std::unordered_map<uint64_t, uint64_t> next;
+    next.reserve(keys.size());
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        next.emplace(keys[i], hashes[i]);
+        auto it = s.gridChunkHashes.find(keys[i]);
+        if (it == s.gridChunkHashes.end() || it->second != hashes[i]) changed.push_back(keys[i]);
+    }
+    for (const auto& kv : s.gridChunkHashes) {
+        if (next.find(kv.first) == next.end()) changed.push_back(kv.first);
+    }
+    s.gridChunkHashes.swap(next);
+    return changed;
+}
+
+// Only leaves of chunks whose grid cells changed in the last rebuild or whose
+// buildings the lifecycle reported are re-summarized; update() then re-merges
+// their ancestors. Unchanged leaves are skipped by set(), so only real changes
+// reach the minimap.
+static void RefreshChunkSummaries(AppState& s) {
+    ChunkSummaryPyramid& p = s.summaries;
+    if (s.dirtySummaryGridChunks.empty() && s.dirtySummaryChunks.empty()) return;
+    std::vector<uint64_t> keys(s.dirtySummaryGridChunks.begin(), s.dirtySummaryGridChunks.end());
+    for (uint64_t key : s.dirtySummaryChunks) {
+        if (s.dirtySummaryGridChunks.find(key) == s.dirtySummaryGridChunks.end()) keys.push_back(key);
+    }
+    std::vector<ChunkSummary> leaves(keys.size());
+    std::vector<uint8_t> inside(keys.size(), 0);
+    ParallelFor((int)keys.size(), [&](int i, int) {
+        int32_t cx, cz;
+        UnpackChunk(keys[i], cx, cz);
+        if (!p.contains(cx, cz)) return;
+        inside[i] = 1;
+        ChunkSummary& sum = leaves[i];
+        sum = p.leaf(cx, cz);
+        if (s.dirtySummaryGridChunks.count(keys[i])) {
+            SummarizeChunkCells(ZoneCellsFor(s, keys[i]), WaterBitsFor(s, keys[i]), sum);
+        }
+        if (s.dirtySummaryChunks.count(keys[i])) SummarizeChunkBuildings(s, keys[i], sum);
+    });
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        if (!inside[i]) continue;
+        int32_t cx, cz;
+        UnpackChunk(keys[i], cx, cz);
+        p.set(cx, cz, leaves[i]);
     }
+    s.dirtySummaryGridChunks.clear();
+    s.dirtySummaryChunks.clear();
+    p.update();
+}
+
+static int FloorDiv(int a, int b) {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// Rasterized from the leaf summaries' coarse masks: water and zoning are sampled at
+// the pixel centre, roads are drawn if any block under the pixel has road cells.
+// Only the pixels of chunks whose summaries changed are redone and re-uploaded.
+static void UpdateMinimapTexture(MinimapState& mm, ChunkSummaryPyramid& summaries) {
+    if (mm.size <= 0) return;
+    int32_t cx0 = 0, cz0 = 0, cx1 = 0, cz1 = 0;
+    bool changed = summaries.takeDirtyRect(cx0, cz0, cx1, cz1);
+    bool full = mm.dirty || mm.texture == 0 || mm.pixels.size() != (size_t)mm.size * mm.size * 4;
+    if (!full && !changed) return;
+
+    const float pxPerM = (float)mm.size / MAP_SIDE_M;
+    int x0 = 0, y0 = 0, x1 = mm.size - 1, y1 = mm.size - 1;
+    if (!full) {
+        // v = 0 is the +z edge of the map.
+        x0 = std::max(x0, (int)std::floor((cx0 * CHUNK_SIZE_M + MAP_HALF_M) * pxPerM));
+        x1 = std::min(x1, (int)std::floor(((cx1 + 1) * CHUNK_SIZE_M + MAP_HALF_M) * pxPerM));
+        y0 = std::max(y0, (int)std::floor((MAP_HALF_M - (cz1 + 1) * CHUNK_SIZE_M) * pxPerM));
+        y1 = std::min(y1, (int)std::floor((MAP_HALF_M - cz0 * CHUNK_SIZE_M) * pxPerM));
+        if (x1 < x0 || y1 < y0) return;
+    }
+    mm.pixels.resize((size_t)mm.size * (size_t)mm.size * 4);
 
-    std::vector<uint8_t> pixels;
-    pixels.resize((size_t)mm.size * (size_t)mm.size * 4);
-    const float mapHalf = MAP_HALF_M;
-    const float invMap = 1.0f / MAP_SIDE_M;
     const uint8_t land[3] = { 32, 96, 40 };
     const uint8_t water[3] = { 40, 80, 120 };
+    const uint8_t road[3] = { 205, 205, 205 };
+    const uint8_t zoned[ZONE_TYPE_COUNT][3] = {
+        { 40, 165, 90 },   // residential
+        { 50, 115, 230 },  // commercial
+        { 215, 190, 50 },  // industrial
+        { 115, 190, 240 }  // office
+    };
+    const float pxM = MAP_SIDE_M / (float)mm.size;
+    const float blockM = CHUNK_SIZE_M / ChunkSummary::MASK_DIM;
+    const int dim = ChunkSummary::MASK_DIM;
+    auto blockAt = [&](int gbx, int gbz, int& bx, int& bz) -> const ChunkSummary& {
+        int32_t cx = FloorDiv(gbx, dim);
+        int32_t cz = FloorDiv(gbz, dim);
+        bx = gbx - cx * dim;
+        bz = gbz - cz * dim;
+        return summaries.leaf(cx, cz);
+    };
 
-    const bool hasWater = !s.waterChunks.empty();
-    for (int y = 0; y < mm.size; ++y) {
-        float v = (y + 0.5f) / (float)mm.size;
-        float wz = (0.5f - v) * MAP_SIDE_M;
-        for (int x = 0; x < mm.size; ++x) {
-            float u = (x + 0.5f) / (float)mm.size;
-            float wx = (u - 0.5f) * MAP_SIDE_M;
-            bool isWater = false;
-            if (hasWater) {
-                isWater = GetWaterAt(s, glm::vec3(wx, 0.0f, wz)) != 0;
+    for (int y = y0; y <= y1; ++y) {
+        float wzHi = MAP_HALF_M - y * pxM;
+        float wzLo = wzHi - pxM;
+        int gbz0 = (int)std::floor(wzLo / blockM);
+        int gbz1 = (int)std::floor((wzHi - 0.01f) / blockM);
+        int gbzc = (int)std::floor((wzLo + 0.5f * pxM) / blockM);
+        for (int x = x0; x <= x1; ++x) {
+            float wxLo = -MAP_HALF_M + x * pxM;
+            int gbx0 = (int)std::floor(wxLo / blockM);
+            int gbx1 = (int)std::floor((wxLo + pxM - 0.01f) / blockM);
+            int gbxc = (int)std::floor((wxLo + 0.5f * pxM) / blockM);
+
+            int bx, bz;
+            const ChunkSummary& centre = blockAt(gbxc, gbzc, bx, bz);
+            const uint8_t* c = land;
+            if (ChunkSummary::maskBit(centre.waterMask, bx, bz)) c = water;
+            else if (ChunkSummary::maskBit(centre.zonedMask, bx, bz) && centre.dominantZone() >= 0) c = zoned[centre.dominantZone()];
+            bool anyRoad = false;
+            for (int gbz = gbz0; gbz <= gbz1 && !anyRoad; ++gbz) {
+                for (int gbx = gbx0; gbx <= gbx1 && !anyRoad; ++gbx) {
+                    const ChunkSummary& sum = blockAt(gbx, gbz, bx, bz);
+                    anyRoad = ChunkSummary::maskBit(sum.roadMask, bx, bz);
+                }
             }
-            const uint8_t* c = isWater ? water : land;
+            if (anyRoad) c = road;
+
             size_t idx = (size_t)(y * mm.size + x) * 4;
-            pixels[idx + 0] = c[0];
-            pixels[idx + 1] = c[1];
-            pixels[idx + 2] = c[2];
-            pixels[idx + 3] = 255;
+            mm.pixels[idx + 0] = c[0];
+            mm.pixels[idx + 1] = c[1];
+            mm.pixels[idx + 2] = c[2];
+            mm.pixels[idx + 3] = 255;
         }
     }
 
-    glBindTexture(GL_TEXTURE_2D, mm.texture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, mm.size, mm.size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    if (mm.texture == 0) {
+        glGenTextures(1, &mm.texture);
+        glBindTexture(GL_TEXTURE_2D, mm.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, mm.size, mm.size, 0, GL_RGBA, GL_UNSIGNED_BYTE, mm.pixels.data());
+    } else {
+        glBindTexture(GL_TEXTURE_2D, mm.texture);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, mm.size);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0 + 1, y1 - y0 + 1, GL_RGBA, GL_UNSIGNED_BYTE,
+            mm.pixels.data() + ((size_t)y0 * mm.size + x0) * 4);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
     glBindTexture(GL_TEXTURE_2D, 0);
 
     mm.dirty = false;
 }
 
 static void RebuildZoneGrid(AppState& s) {
+    if (s.zoneGridFromRegion) {
+        // Just opened from a region file that matches the loaded roads and zones.
+        s.zoneGridFromRegion = false;
+        return;
+    }
     s.zoneChunks.clear();
+    s.zoneBaseValid = false;
     s.dirtyZoneChunks.clear();
     if (s.roads.empty()) return;
 
@@ -1077,6 +1220,11 @@ static void RebuildZoneGrid(AppState& s) {
     }
 }
 
+static void MarkRoadDirty(AppState& s, int roadId) {
+    s.dirtyRoadIds.insert(roadId);
+    s.roadsDirty = true;
+}
+
 // --- Undo/Redo command system ---
 struct ICommand {
     virtual ~ICommand() = default;
@@ -1097,13 +1245,13 @@ struct CmdAddRoad : ICommand {
             s.roads.push_back(road);
             applied = true;
         }
-        s.roadsDirty = true;
+        MarkRoadDirty(s, road.id);
     }
 
     void undoIt(AppState& s) override {
         int idx = FindRoadIndexById(s.roads, road.id);
         if (idx >= 0) s.roads.erase(s.roads.begin() + idx);
-        s.roadsDirty = true;
+        MarkRoadDirty(s, road.id);
         s.housesDirty = true; // zones might refer to a removed road; for simplicity, we keep zones but houses will rebuild and skip invalid
     }
 };
@@ -1132,7 +1280,7 @@ struct CmdExtendRoad : ICommand {
             for (auto& p : added) r.pts.push_back(p);
         }
         r.rebuildCum();
-        s.roadsDirty = true;
+        MarkRoadDirty(s, roadId);
     }
 
     void undoIt(AppState& s) override {
@@ -1147,7 +1295,7 @@ struct CmdExtendRoad : ICommand {
             r.pts.erase(r.pts.end() - (int)added.size(), r.pts.end());
         }
         r.rebuildCum();
-        s.roadsDirty = true;
+        MarkRoadDirty(s, roadId);
     }
 };
 
@@ -1170,7 +1318,7 @@ struct CmdMoveRoadPoint : ICommand {
         r.pts[pointIndex] = newPos;
         r.pts[pointIndex].y = 0.0f;
         r.rebuildCum();
-        s.roadsDirty = true;
+        MarkRoadDirty(s, roadId);
         s.housesDirty = true;
     }
 
@@ -1182,7 +1330,7 @@ struct CmdMoveRoadPoint : ICommand {
         r.pts[pointIndex] = oldPos;
         r.pts[pointIndex].y = 0.0f;
         r.rebuildCum();
-        s.roadsDirty = true;
+        MarkRoadDirty(s, roadId);
         s.housesDirty = true;
     }
 };
@@ -1207,7 +1355,7 @@ struct CmdDeleteRoadPoint : ICommand {
         r.pts.erase(r.pts.begin() + pointIndex);
         r.rebuildCum();
         did = true;
-        s.roadsDirty = true;
+        MarkRoadDirty(s, roadId);
         s.housesDirty = true;
     }
 
@@ -1219,7 +1367,7 @@ struct CmdDeleteRoadPoint : ICommand {
         pointIndex = Clamp((float)pointIndex, 0.0f, (float)r.pts.size());
         r.pts.insert(r.pts.begin() + pointIndex, removed);
         r.rebuildCum();
-        s.roadsDirty = true;
+        MarkRoadDirty(s, roadId);
         s.housesDirty = true;
     }
 };
@@ -1274,6 +1422,26 @@ struct CmdClearZonesForRoad : ICommand {
     }
 };
 
+struct CmdAddService : ICommand {
+    ServiceSite site;
+
+    CmdAddService(const ServiceSite& ss) : site(ss) {}
+    const char* name() const override { return "AddService"; }
+
+    void doIt(AppState& s) override { s.coverage.addService(s.roadGraph, site); s.fieldsDirty = true; }
+    void undoIt(AppState& s) override { s.coverage.removeService(s.roadGraph, site.id); s.fieldsDirty = true; }
+};
+
+struct CmdRemoveService : ICommand {
+    ServiceSite site;
+
+    CmdRemoveService(const ServiceSite& ss) : site(ss) {}
+    const char* name() const override { return "RemoveService"; }
+
+    void doIt(AppState& s) override { s.coverage.removeService(s.roadGraph, site.id); s.fieldsDirty = true; }
+    void undoIt(AppState& s) override { s.coverage.addService(s.roadGraph, site); s.fieldsDirty = true; }
+};
+
 struct CommandStack {
     std::vector<std::unique_ptr<ICommand>> undo;
     std::vector<std::unique_ptr<ICommand>> redo;
@@ -1306,14 +1474,91 @@ struct CommandStack {
     }
 };
 
-static void RebuildAllRoadMesh(AppState& s) {
-    s.roadMeshVerts.clear();
-    const float roadWidth = ROAD_WIDTH_M;
-    const float y = 0.03f;
+// Bulk sweep on load, local re-split for the roads touched by commands otherwise.
+static void SyncRoadGraph(AppState& s) {
+    if (s.roadGraphFullRebuild) {
+        s.roadGraph.beginBulkLoad();
+        for (const auto& r : s.roads) s.roadGraph.bulkAddRoad(r.id, r.pts);
+        s.roadGraph.endBulkLoad();
+        s.roadGraphFullRebuild = false;
+        s.dirtyRoadIds.clear();
+        std::vector<int> changed;
+        s.roadGraph.takeChangedNodes(changed);
+        s.coverage.rebuild(s.roadGraph);
+        return;
+    }
+    std::vector<int> ids(s.dirtyRoadIds.begin(), s.dirtyRoadIds.end());
+    std::sort(ids.begin(), ids.end());
+    for (int id : ids) {
+        int idx = FindRoadIndexById(s.roads, id);
+        if (idx < 0) s.roadGraph.removeRoad(id);
+        else s.roadGraph.setRoad(id, s.roads[idx].pts);
+    }
+    s.dirtyRoadIds.clear();
+
+    // Service coverage only repairs around the nodes the edit re-linked.
+    std::vector<int> changed;
+    s.roadGraph.takeChangedNodes(changed);
+    s.coverage.syncGraph(s.roadGraph, changed);
+}
+
+// Appends the piece pa-pb (V in road tiles) to the chunks it crosses, split at
+// chunk borders so endpoints quantize to the owning chunk.
+static void AppendRoadSegment(
+    std::unordered_map<uint64_t, std::vector<RoadSegmentGPU>>& out,
+    const glm::vec3& pa, const glm::vec3& pb, float v0, float v1, int segment)
+{
+    thread_local std::vector<float> ts;
+    ts.assign(1, 0.0f);
+    for (int axis = 0; axis < 2; axis++) {
+        float p0 = axis ? pa.z : pa.x;
+        float p1 = axis ? pb.z : pb.x;
+        float lo = std::min(p0, p1), hi = std::max(p0, p1);
+        for (float edge = (std::floor(lo / CHUNK_SIZE_M) + 1.0f) * CHUNK_SIZE_M; edge < hi; edge += CHUNK_SIZE_M) {
+            ts.push_back((edge - p0) / (p1 - p0));
+        }
+    }
+    std::sort(ts.begin() + 1, ts.end());
+    ts.push_back(1.0f);
+    const int n = (int)ts.size();
+
+    auto quantize = [](float rel) {
+        return (uint16_t)std::lround(Clamp(rel / CHUNK_SIZE_M, 0.0f, 1.0f) * 65535.0f);
+    };
+    for (int i = 0; i + 1 < n; i++) {
+        float t0 = ts[i], t1 = ts[i + 1];
+        if (t1 - t0 < 1e-6f) continue;
+        glm::vec3 a = glm::mix(pa, pb, t0);
+        glm::vec3 b = glm::mix(pa, pb, t1);
+        ChunkCoord cc = ChunkFromPosXZ(0.5f * (a + b));
+        float ox = cc.cx * CHUNK_SIZE_M;
+        float oz = cc.cz * CHUNK_SIZE_M;
+        RoadSegmentGPU seg;
+        seg.ends[0] = quantize(a.x - ox);
+        seg.ends[1] = quantize(a.z - oz);
+        seg.ends[2] = quantize(b.x - ox);
+        seg.ends[3] = quantize(b.z - oz);
+        seg.v0 = v0 + (v1 - v0) * t0;
+        seg.v1 = v0 + (v1 - v0) * t1;
+        seg.segment = segment;
+        seg.halfWidth = (uint8_t)std::lround(ROAD_HALF_M * 8.0f);
+        out[PackChunk(cc.cx, cc.cz)].push_back(seg);
+    }
+}
+
+// Per-chunk segment records for the road shader. Chunks whose records differ from
+// the last build are queued in dirtyRoadChunks.
+static void RebuildRoadSegments(AppState& s) {
+    std::unordered_map<uint64_t, std::vector<RoadSegmentGPU>> chunks;
 
     for (const auto& r : s.roads) {
         if (r.pts.size() < 2) continue;
+        // Pieces are split at graph edge boundaries so each one carries a single
+        // segment index for the traffic heatmap lookup.
+        const std::vector<int>* edges = s.roadGraph.roadEdges(r.id);
+        size_t edgeIdx = 0;
         float vAccum = 0.0f;
+        float dAccum = 0.0f;
         for (size_t i = 0; i + 1 < r.pts.size(); i++) {
             glm::vec3 a = r.pts[i];
             glm::vec3 b = r.pts[i+1];
@@ -1321,30 +1566,48 @@ static void RebuildAllRoadMesh(AppState& s) {
             glm::vec3 dir = b - a;
             dir.y = 0.0f;
             float l = std::sqrt(dir.x*dir.x + dir.z*dir.z);
+            float segStart = dAccum;
+            dAccum += l;
             if (l < 1e-4f) continue;
             dir /= l;
 
-            glm::vec3 right = glm::normalize(glm::cross(glm::vec3(0,1,0), dir));
-            glm::vec3 off = right * (roadWidth * 0.5f);
-
-            glm::vec3 aL = a - off; aL.y = y;
-            glm::vec3 aR = a + off; aR.y = y;
-            glm::vec3 bL = b - off; bL.y = y;
-            glm::vec3 bR = b + off; bR.y = y;
+            float t0 = 0.0f;
+            while (t0 < l) {
+                int segment = -1;
+                float t1 = l;
+                if (edges) {
+                    while (edgeIdx + 1 < edges->size() &&
+                           s.roadGraph.edges()[(*edges)[edgeIdx]].d1 <= segStart + t0 + 1e-3f) {
+                        edgeIdx++;
+                    }
+                    if (edgeIdx < edges->size()) {
+                        segment = (*edges)[edgeIdx];
+                        if (edgeIdx + 1 < edges->size()) {
+                            t1 = std::min(l, std::max(t0, s.roadGraph.edges()[segment].d1 - segStart));
+                        }
+                    }
+                }
+                if (t1 - t0 < 1e-3f) t1 = l;
 
-            float v0 = vAccum / ROAD_TEX_TILE_M;
-            float v1 = (vAccum + l) / ROAD_TEX_TILE_M;
+                AppendRoadSegment(chunks, a + dir * t0, a + dir * t1,
+                    (vAccum + t0) / ROAD_TEX_TILE_M, (vAccum + t1) / ROAD_TEX_TILE_M, segment);
+                t0 = t1;
+            }
             vAccum += l;
-
-            s.roadMeshVerts.push_back({aL, glm::vec2(0.0f, v0)});
-            s.roadMeshVerts.push_back({aR, glm::vec2(1.0f, v0)});
-            s.roadMeshVerts.push_back({bR, glm::vec2(1.0f, v1)});
-
-            s.roadMeshVerts.push_back({aL, glm::vec2(0.0f, v0)});
-            s.roadMeshVerts.push_back({bR, glm::vec2(1.0f, v1)});
-            s.roadMeshVerts.push_back({bL, glm::vec2(0.0f, v1)});
         }
     }
+
+    auto same = [](const std::vector<RoadSegmentGPU>& x, const std::vector<RoadSegmentGPU>& y) {
+        return x.size() == y.size() && std::memcmp(x.data(), y.data(), x.size() * sizeof(RoadSegmentGPU)) == 0;
+    };
+    for (const auto& kv : s.roadSegmentsByChunk) {
+        if (!chunks.count(kv.first)) s.dirtyRoadChunks.insert(kv.first);
+    }
+    for (const auto& kv : chunks) {
+        auto it = s.roadSegmentsByChunk.find(kv.first);
+        if (it == s.roadSegmentsByChunk.end() || !same(it->second, kv.second)) s.dirtyRoadChunks.insert(kv.first);
+    }
+    s.roadSegmentsByChunk = std::move(chunks);
 }
 
 [[maybe_unused]] static void AppendZoneMesh(
@@ -1464,16 +1727,6 @@ static void AppendWaterCellQuad(std::vector<glm::vec3>& out, float originX, floa
     out.push_back({x0, y, z0}); out.push_back({x1, y, z1}); out.push_back({x0, y, z1});
 }
 
-static const ZoneStrip* FindZoneForRoadAt(const std::vector<const ZoneStrip*>& zones, float d, int sideBit) {
-    for (const ZoneStrip* z : zones) {
-        if (!(z->sideMask & sideBit)) continue;
-        float lo = std::min(z->d0, z->d1);
-        float hi = std::max(z->d0, z->d1);
-        if (d >= lo && d <= hi) return z;
-    }
-    return nullptr;
-}
-
 static bool ShouldCullForIntersection(
     const AppState& s,
     int roadId,
@@ -1485,16 +1738,34 @@ static bool ShouldCullForIntersection(
     if (fLenSq < 1e-6f) return false;
     glm::vec3 f = forward / std::sqrt(fLenSq);
     float clearSq = clearDist * clearDist;
-    for (const auto& other : s.roads) {
-        if (other.id == roadId) continue;
-        if (other.pts.size() < 2) continue;
-        float dAlong;
+
+    // Only segments inside the clear radius can matter; keep the closest one per road.
+    struct Closest {
+        int roadId;
+        float distSq;
         glm::vec3 tan;
-        float distSq = ClosestDistanceAlongRoadSq(other, pos, dAlong, tan);
+    };
+    thread_local std::vector<RoadGraphSegment> nearSegs;
+    thread_local std::vector<Closest> closest;
+    s.roadGraph.segmentsNear(pos, clearDist, nearSegs);
+    closest.clear();
+    for (const auto& seg : nearSegs) {
+        if (seg.roadId == roadId) continue;
+        glm::vec3 c;
+        ClosestParamOnSegmentXZ(pos, seg.a, seg.b, c);
+        glm::vec2 d(pos.x - c.x, pos.z - c.z);
+        float distSq = d.x*d.x + d.y*d.y;
         if (distSq >= clearSq) continue;
-        float tLenSq = glm::dot(tan, tan);
+        glm::vec3 tan = seg.b - seg.a;
+        tan.y = 0.0f;
+        auto it = std::find_if(closest.begin(), closest.end(), [&](const Closest& cl) { return cl.roadId == seg.roadId; });
+        if (it == closest.end()) closest.push_back({seg.roadId, distSq, tan});
+        else if (distSq < it->distSq) *it = {seg.roadId, distSq, tan};
+    }
+    for (const auto& cl : closest) {
+        float tLenSq = glm::dot(cl.tan, cl.tan);
         if (tLenSq < 1e-6f) return true;
-        glm::vec3 t = tan / std::sqrt(tLenSq);
+        glm::vec3 t = cl.tan / std::sqrt(tLenSq);
         float align = std::fabs(glm::dot(f, t));
         if (align > 0.85f) continue;
         return true;
@@ -1502,74 +1773,6 @@ static bool ShouldCullForIntersection(
     return false;
 }
 
-static void RebuildRoadAlignedOverlay(AppState& s) {
-    s.overlayBuildableByChunk.clear();
-    s.overlayZonedResByChunk.clear();
-    s.overlayZonedComByChunk.clear();
-    s.overlayZonedIndByChunk.clear();
-    s.overlayZonedOfficeByChunk.clear();
-
-    if (s.roads.empty()) return;
-
-    std::unordered_map<int, std::vector<const ZoneStrip*>> zonesByRoad;
-    zonesByRoad.reserve(s.zones.size());
-    for (const auto& z : s.zones) {
-        zonesByRoad[z.roadId].push_back(&z);
-    }
-
-    for (const auto& r : s.roads) {
-        if (r.pts.size() < 2) continue;
-        float total = r.totalLen();
-        int cols = (int)std::floor(total / ZONE_CELL_M);
-        if (cols <= 0) continue;
-
-        const std::vector<const ZoneStrip*>* zones = nullptr;
-        auto zIt = zonesByRoad.find(r.id);
-        if (zIt != zonesByRoad.end()) zones = &zIt->second;
-
-        for (int i = 0; i < cols; ++i) {
-            float d = (i + 0.5f) * ZONE_CELL_M;
-            glm::vec3 tan;
-            glm::vec3 pos = r.pointAt(d, tan);
-            if (glm::dot(tan, tan) < 1e-6f) continue;
-
-            glm::vec3 right = glm::normalize(glm::cross(glm::vec3(0, 1, 0), tan));
-            for (int side : {-1, +1}) {
-                glm::vec3 away = right * (float)side;
-                int sideBit = (side < 0) ? 1 : 2;
-                const ZoneStrip* z = zones ? FindZoneForRoadAt(*zones, d, sideBit) : nullptr;
-
-                for (int row = 0; row < ZONE_DEPTH_CELLS; ++row) {
-                    float off = ROAD_HALF_M + (row + 0.5f) * ZONE_CELL_M;
-                    glm::vec3 center = pos + away * off;
-                    if (GetWaterAt(s, center) != 0) continue;
-                    if (ShouldCullForIntersection(s, r.id, center, tan, INTERSECTION_CLEAR_M)) continue;
-
-                    ChunkCoord cc = ChunkFromPosXZ(center);
-                    uint64_t key = PackChunk(cc.cx, cc.cz);
-                    AppendOrientedZoneCellQuad(s.overlayBuildableByChunk[key], center, tan, away);
-
-                    if (!z) continue;
-                    switch (z->type) {
-                        case ZoneType::Commercial:
-                            AppendOrientedZoneCellQuad(s.overlayZonedComByChunk[key], center, tan, away);
-                            break;
-                        case ZoneType::Industrial:
-                            AppendOrientedZoneCellQuad(s.overlayZonedIndByChunk[key], center, tan, away);
-                            break;
-                        case ZoneType::Office:
-                            AppendOrientedZoneCellQuad(s.overlayZonedOfficeByChunk[key], center, tan, away);
-                            break;
-                        default:
-                            AppendOrientedZoneCellQuad(s.overlayZonedResByChunk[key], center, tan, away);
-                            break;
-                    }
-                }
-            }
-        }
-    }
-}
-
 struct PreviewCellKey {
     int32_t cx = 0;
     int32_t cz = 0;
@@ -1727,6 +1930,127 @@ static void RebuildLotCells(AppState& s) {
     }
 }
 
+// Every lot cell gets a coverage sample; chunk keys match lotIndicesByChunk.
+static void RebuildCoverageLots(AppState& s) {
+    std::vector<CoverageLot> lots;
+    lots.reserve(s.lots.size());
+    for (const auto& c : s.lots) {
+        CoverageLot cl;
+        cl.roadId = c.roadId;
+        cl.d = 0.5f * (c.d0 + c.d1);
+        ChunkCoord cc = ChunkFromPosXZ(c.center);
+        cl.chunkKey = PackChunk(cc.cx, cc.cz);
+        lots.push_back(cl);
+    }
+    s.coverage.setLots(s.roadGraph, lots);
+}
+
+// Per-chunk source tiles for the scalar fields. Tiles are diffed against the
+// previous sources, so only chunks whose zoning or lots changed get re-diffused.
+static void RebuildScalarFieldSources(AppState& s) {
+    const size_t cells = (size_t)ZoneChunk::DIM * ZoneChunk::DIM;
+    std::unordered_map<uint64_t, std::vector<float>> landByChunk;
+    for (int i = 0; i < (int)s.lots.size(); i++) {
+        int cx, cz, xi, zi;
+        if (!WorldToZoneCell(s.lots[i].center, cx, cz, xi, zi)) continue;
+        std::vector<float>& tile = landByChunk[PackChunk(cx, cz)];
+        if (tile.empty()) tile.assign(cells, 0.0f);
+        tile[(size_t)zi * ZoneChunk::DIM + xi] += s.coverage.landValue(i) - 1.0f;
+    }
+
+    std::unordered_set<uint64_t> seenPollution, seenNoise, seenLand;
+    std::vector<float> pollution(cells), noise(cells);
+    for (uint64_t key : ZoneGridKeys(s, false)) {
+        const uint8_t* zone = ZoneCellsFor(s, key);
+        const uint64_t* water = WaterBitsFor(s, key);
+        bool anyPollution = false, anyNoise = false;
+        for (size_t i = 0; i < cells; i++) {
+            uint8_t flags = zone[i];
+            pollution[i] = 0.0f;
+            noise[i] = 0.0f;
+            if (flags & ZONE_FLAG_ZONED) {
+                ZoneType zt = ZoneTypeFromFlags(flags);
+                if (zt == ZoneType::Industrial) { pollution[i] = 1.0f; noise[i] = 0.6f; }
+                else if (zt == ZoneType::Commercial) noise[i] = 0.3f;
+            } else if ((flags & ZONE_FLAG_BLOCKED) && (!water || !WaterChunk::test(water, (int)i))) {
+                noise[i] = 0.4f; // road surface
+            }
+            anyPollution |= pollution[i] != 0.0f;
+            anyNoise |= noise[i] != 0.0f;
+        }
+        if (anyPollution) { s.pollutionField.setTileSources(key, pollution); seenPollution.insert(key); }
+        if (anyNoise) { s.noiseField.setTileSources(key, noise); seenNoise.insert(key); }
+    }
+    for (const auto& kv : landByChunk) {
+        s.landValueField.setTileSources(kv.first, kv.second);
+        seenLand.insert(kv.first);
+    }
+
+    auto clearStale = [](ScalarField& f, const std::unordered_set<uint64_t>& seen) {
+        for (uint64_t key : f.sourceTileKeys()) {
+            if (seen.find(key) == seen.end()) f.setTileSources(key, {});
+        }
+    };
+    clearStale(s.pollutionField, seenPollution);
+    clearStale(s.noiseField, seenNoise);
+    clearStale(s.landValueField, seenLand);
+
+    s.pollutionField.update();
+    s.noiseField.update();
+    s.landValueField.update();
+}
+
+// Copies the counts the simulation tick needs; the worker only ever sees this copy.
+static std::shared_ptr<const SimSnapshot> BuildSimSnapshot(const AppState& s) {
+    auto snap = std::make_shared<SimSnapshot>();
+    float landSum = 0.0f, pollutionSum = 0.0f;
+    int zoned = 0;
+    for (int i = 0; i < (int)s.lots.size(); i++) {
+        const LotCell& c = s.lots[i];
+        if (!c.zoned) continue;
+        snap->zonedLots[(int)c.zoneType]++;
+        landSum += s.coverage.landValue(i);
+        pollutionSum += s.pollutionField.sample(c.center);
+        zoned++;
+    }
+    if (zoned > 0) {
+        snap->avgLandValue = landSum / (float)zoned;
+        snap->avgPollution = pollutionSum / (float)zoned;
+    }
+    snap->buildings = (int)s.buildings.size();
+    for (const ServiceSite& site : s.coverage.services()) snap->services[(int)site.type]++;
+
+    const auto& edges = s.roadGraph.edges();
+    float lengthM = 0.0f, congestionSum = 0.0f;
+    int liveEdges = 0;
+    const std::vector<float>& congestion = s.traffic.latest().congestion;
+    for (size_t e = 0; e < edges.size(); e++) {
+        if (!edges[e].alive) continue;
+        lengthM += edges[e].length();
+        congestionSum += (e < congestion.size()) ? congestion[e] : 0.0f;
+        liveEdges++;
+    }
+    snap->roadLengthKm = lengthM * 0.001f;
+    if (liveEdges > 0) snap->avgCongestion = congestionSum / (float)liveEdges;
+    return snap;
+}
+
+// Zoned lots become traffic demand: residential produces trips, the other zones attract them.
+static void RebuildTrafficDemand(AppState& s) {
+    std::vector<TrafficLot> lots;
+    lots.reserve(s.lots.size());
+    for (const auto& c : s.lots) {
+        if (!c.zoned) continue;
+        TrafficLot t;
+        t.pos = c.center;
+        t.roadId = c.roadId;
+        t.d = 0.5f * (c.d0 + c.d1);
+        t.origin = (c.zoneType == ZoneType::Residential);
+        lots.push_back(t);
+    }
+    s.trafficRequest = s.traffic.requestRebuild(SnapshotTrafficInput(s.roadGraph, std::move(lots)));
+}
+
 static void BuildRoadPreviewMesh(AppState& s, const glm::vec3& a, const glm::vec3& b) {
     const float roadWidth = ROAD_WIDTH_M;
     const float y = 0.05f;
@@ -1754,49 +2078,28 @@ static void BuildRoadPreviewMesh(AppState& s, const glm::vec3& a, const glm::vec
     s.zonePreviewVerts.push_back(bL);
 }
 
-static glm::vec3 ApplyAssetScale(const AssetCatalog& assets, AssetId assetId, const glm::vec3& baseSize) {
-    const AssetDef* def = assets.find(assetId);
-    if (!def) return baseSize;
-    glm::vec3 scaled = def->meshRelPath.empty() ? baseSize : def->defaultScale;
+static glm::vec3 ApplyAssetScale(const AssetTraits& t, const glm::vec3& baseSize) {
+    glm::vec3 scaled = (t.flags & ASSET_HAS_MESH) ? t.defaultScale : baseSize;
     if (scaled.x <= 0.0f || scaled.y <= 0.0f || scaled.z <= 0.0f) return baseSize;
     return scaled;
 }
 
-static glm::vec2 GetAssetFootprint(const AssetCatalog& assets, AssetId assetId, const glm::vec2& fallback) {
-    const AssetDef* def = assets.find(assetId);
-    if (!def) return fallback;
-    if (def->meshRelPath.empty()) return fallback;
-    if (def->footprintM.x > 0.0f && def->footprintM.y > 0.0f) return def->footprintM;
+static glm::vec2 GetAssetFootprint(const AssetTraits& t, const glm::vec2& fallback) {
+    if (!(t.flags & ASSET_HAS_MESH)) return fallback;
+    if (t.footprintM.x > 0.0f && t.footprintM.y > 0.0f) return t.footprintM;
     return fallback;
 }
 
-static glm::vec2 GetAssetZonedFootprint(
-    const AssetCatalog& assets,
-    AssetId assetId,
-    const glm::vec2& fallback,
-    const glm::vec2& maxFootprint)
-{
-    const AssetDef* def = assets.find(assetId);
-    if (!def) return fallback;
-    if (def->meshRelPath.empty()) return fallback;
-    if (def->zonedFootprintM.x <= 0.0f || def->zonedFootprintM.y <= 0.0f) return fallback;
-    glm::vec2 zoned = def->zonedFootprintM;
+static glm::vec2 GetAssetZonedFootprint(const AssetTraits& t, const glm::vec2& fallback, const glm::vec2& maxFootprint) {
+    if (!(t.flags & ASSET_HAS_MESH)) return fallback;
+    if (t.zonedFootprintM.x <= 0.0f || t.zonedFootprintM.y <= 0.0f) return fallback;
+    glm::vec2 zoned = t.zonedFootprintM;
     zoned.x = std::min(zoned.x, maxFootprint.x);
     zoned.y = std::min(zoned.y, maxFootprint.y);
     if (zoned.x <= 0.0f || zoned.y <= 0.0f) return fallback;
     return zoned;
 }
 
-static bool AssetHasTag(const AssetCatalog& assets, AssetId assetId, const char* tag) {
-    if (!tag || tag[0] == '\0') return false;
-    const AssetDef* def = assets.find(assetId);
-    if (!def) return false;
-    for (const auto& t : def->tags) {
-        if (t == tag) return true;
-    }
-    return false;
-}
-
 static float FootprintCoverage(
     const AppState& s,
     const glm::vec3& center,
@@ -2012,11 +2315,11 @@ static void ReserveFootprint(
 }
 
 static void RebuildHousesFromLots(AppState& s, const AssetCatalog& assets, bool animate, float nowSec) {
-    s.houseStatic.clear();
-    s.houseAnim.clear();
-    s.houseStaticByChunk.clear();
     s.buildingChunks.clear();
     s.dirtyBuildingChunks.clear();
+    s.uploadedBuildingChunks.clear();
+    s.streamer.resetLayer(ChunkLayer::Buildings);
+    s.buildings.clear(nowSec);
     s.largeLotDebug = {};
     s.largeLotLastFail.clear();
 
@@ -2027,6 +2330,14 @@ static void RebuildHousesFromLots(AppState& s, const AssetCatalog& assets, bool
     const AssetId commercialAsset = assets.resolveCategoryAsset(ZoneTypeCategory(ZoneType::Commercial));
     const AssetId industrialAsset = assets.resolveCategoryAsset(ZoneTypeCategory(ZoneType::Industrial));
     const AssetId officeAsset = assets.resolveCategoryAsset(ZoneTypeCategory(ZoneType::Office));
+    // Variants are resolved once, not per lot.
+    auto variantOr = [&](const char* idStr, AssetId fallbackId) {
+        AssetId id = assets.findIdByString(idStr);
+        return (id != 0 && assets.find(id) != nullptr) ? id : fallbackId;
+    };
+    const AssetId industrialAlt = variantOr("buildings.industrial_02", industrialAsset);
+    const AssetId industrialCustom = variantOr("buildings.industrial_03", industrialAsset);
+    const AssetId officeAlt = variantOr("buildings.office_02", officeAsset);
 
     std::unordered_set<uint64_t> occupied;
     auto cellKey = [](int32_t gx, int32_t gz) -> uint64_t {
@@ -2084,13 +2395,16 @@ static void RebuildHousesFromLots(AppState& s, const AssetCatalog& assets, bool
 
     std::unordered_map<uint64_t, ZoneChunk> reserved;
 
+    // Anything farther than the clear band passes, so a local graph query is enough.
+    std::vector<RoadGraphSegment> nearSegs;
     auto minCenterlineClearSq = [&](const glm::vec3& pos) -> float {
         float best = std::numeric_limits<float>::max();
-        for (const auto& other : s.roads) {
-            if (other.pts.size() < 2) continue;
-            float dAlong; glm::vec3 tan;
-            float distSq = ClosestDistanceAlongRoadSq(other, pos, dAlong, tan);
-            best = std::min(best, distSq);
+        s.roadGraph.segmentsNear(pos, roadHalf + desiredClear, nearSegs);
+        for (const auto& seg : nearSegs) {
+            glm::vec3 c;
+            ClosestParamOnSegmentXZ(pos, seg.a, seg.b, c);
+            glm::vec2 d(pos.x - c.x, pos.z - c.z);
+            best = std::min(best, d.x*d.x + d.y*d.y);
         }
         return best;
     };
@@ -2122,13 +2436,8 @@ static void RebuildHousesFromLots(AppState& s, const AssetCatalog& assets, bool
 
             variants[0] = {industrialAsset, defaultBase};
 
-            AssetId altId = assets.findIdByString("buildings.industrial_02");
-            AssetId altOrDefault = (altId != 0 && assets.find(altId) != nullptr) ? altId : industrialAsset;
-            variants[1] = {altOrDefault, glm::vec3(55.0f, 6.0f, 30.0f)};
-
-            AssetId customId = assets.findIdByString("buildings.industrial_03");
-            AssetId customOrDefault = (customId != 0 && assets.find(customId) != nullptr) ? customId : industrialAsset;
-            variants[2] = {customOrDefault, defaultBase};
+            variants[1] = {industrialAlt, glm::vec3(55.0f, 6.0f, 30.0f)};
+            variants[2] = {industrialCustom, defaultBase};
 
             const Variant& picked = variants[lotSeed % 3];
             assetId = picked.id;
@@ -2144,9 +2453,7 @@ static void RebuildHousesFromLots(AppState& s, const AssetCatalog& assets, bool
 
             variants[0] = {officeAsset, defaultBase};
 
-            AssetId altId = assets.findIdByString("buildings.office_02");
-            AssetId altOrDefault = (altId != 0 && assets.find(altId) != nullptr) ? altId : officeAsset;
-            variants[1] = {altOrDefault, glm::vec3(92.0f, 130.0f, 47.0f)};
+            variants[1] = {officeAlt, glm::vec3(92.0f, 130.0f, 47.0f)};
 
             const uint32_t pickIndex = lotSeed % 2;
             const Variant& picked = variants[pickIndex];
@@ -2159,9 +2466,11 @@ static void RebuildHousesFromLots(AppState& s, const AssetCatalog& assets, bool
                 baseSize.y = 100.0f + 2.0f * (float)step;
             }
         }
-        glm::vec3 houseSize = ApplyAssetScale(assets, assetId, baseSize);
-        glm::vec2 footprint = GetAssetFootprint(assets, assetId, glm::vec2(baseSize.x, baseSize.z));
-        glm::vec2 zonedFootprint = GetAssetZonedFootprint(assets, assetId, footprint, footprint);
+        const uint32_t assetIndex = assets.resolveIndex(assetId);
+        const AssetTraits& traits = assets.traits(assetIndex);
+        glm::vec3 houseSize = ApplyAssetScale(traits, baseSize);
+        glm::vec2 footprint = GetAssetFootprint(traits, glm::vec2(baseSize.x, baseSize.z));
+        glm::vec2 zonedFootprint = GetAssetZonedFootprint(traits, footprint, footprint);
         float alignedAlong = std::ceil(footprint.x / ZONE_CELL_M) * ZONE_CELL_M;
         float alignedDepth = std::ceil(footprint.y / ZONE_CELL_M) * ZONE_CELL_M;
         float alignedZonedAlong = std::ceil(zonedFootprint.x / ZONE_CELL_M) * ZONE_CELL_M;
@@ -2170,7 +2479,7 @@ static void RebuildHousesFromLots(AppState& s, const AssetCatalog& assets, bool
         alignedDepth = std::max(alignedDepth, ZONE_CELL_M);
         alignedZonedAlong = std::max(alignedZonedAlong, ZONE_CELL_M);
         alignedZonedDepth = std::max(alignedZonedDepth, ZONE_CELL_M);
-        bool wantsLargeLot = (alignedDepth > lotDepth) || AssetHasTag(assets, assetId, "large_lot");
+        bool wantsLargeLot = (alignedDepth > lotDepth) || (traits.flags & ASSET_LARGE_LOT) != 0;
         bool usedLargeLot = false;
         float placeAlong = alignedAlong;
         float placeDepth = alignedDepth;
@@ -2285,42 +2594,20 @@ static void RebuildHousesFromLots(AppState& s, const AssetCatalog& assets, bool
         if (isOccupied(pos)) continue; // avoid double builds/overlap
         if (!canPlace(pos, radius)) continue;
 
-        glm::vec3 up(0,1,0);
         glm::vec3 facing = glm::normalize(-float(c.side) * c.right); // face toward road
-        glm::vec3 basisRight = glm::normalize(glm::cross(up, facing));
-        glm::mat4 R(1.0f);
-        R[0] = glm::vec4(basisRight, 0.0f);
-        R[1] = glm::vec4(up, 0.0f);
-        R[2] = glm::vec4(facing, 0.0f);
-
-        uint32_t seed = lotSeed;
-        float yaw = std::atan2(facing.x, facing.z);
+        BuildingSpec spec;
+        spec.pos = pos;
+        spec.forward = facing;
+        spec.scale = houseSize;
+        spec.asset = assetId;
+        spec.assetIndex = assetIndex;
+        spec.seed = lotSeed;
         if (animate) {
-            float jitter = (seed % 120) / 1000.0f; // 0..0.119 sec
-            s.houseAnim.push_back({pos, nowSec + jitter, facing, assetId, houseSize, seed});
+            float jitter = (lotSeed % 120) / 1000.0f; // 0..0.119 sec
+            s.buildings.add(spec, nowSec + jitter);
         } else {
-            glm::mat4 M(1.0f);
-            M = glm::translate(M, pos);
-            M = M * R;
-            M = glm::scale(M, houseSize);
-            s.houseStatic.push_back(M);
-        }
-        // Chunked storage for rendering
-        glm::mat4 Ms(1.0f);
-        Ms = glm::translate(Ms, pos);
-        Ms = Ms * R;
-        Ms = glm::scale(Ms, houseSize);
-        ChunkCoord cc = ChunkFromPosXZ(pos);
-        uint64_t ckey = PackChunk(cc.cx, cc.cz);
-        s.houseStaticByChunk[ckey].push_back(Ms);
-        BuildingInstance inst;
-        inst.asset = assetId;
-        inst.localPos = pos;
-        inst.yaw = yaw;
-        inst.scale = houseSize;
-        inst.seed = seed;
-        s.buildingChunks[ckey].instancesByAsset[assetId].push_back(inst);
-        s.dirtyBuildingChunks.insert(ckey);
+            s.buildings.addOccupied(spec);
+        }
         if (usedLargeLot) {
             ReserveFootprint(reserved, pos, c.forward, away, placeAlong, placeDepth);
             s.largeLotDebug.placed++;
@@ -2365,15 +2652,269 @@ static bool SaveToJsonFile(const AppState& s, const AssetCatalog& assets, const
         j["zones"].push_back(jz);
     }
 
+    j["nextServiceId"] = s.nextServiceId;
+    j["services"] = json::array();
+    for (const auto& sv : s.coverage.services()) {
+        json js;
+        js["id"] = sv.id;
+        js["type"] = (int)sv.type;
+        js["roadId"] = sv.roadId;
+        js["d"] = sv.d;
+        js["pos"] = {sv.pos.x, sv.pos.y, sv.pos.z};
+        j["services"].push_back(js);
+    }
+
     std::ofstream out(path, std::ios::binary);
     if (!out) return false;
     out << j.dump(2);
     return true;
 }
 
-// Placeholder chunk save/load (binary) for zone/building chunks.
-static bool SaveChunkBin(const AppState&, uint64_t, const std::string&) { return true; }
-static bool LoadChunkBin(AppState&, uint64_t, const std::string&) { return true; }
+// Binary chunk files used by the streamer to spill layers that cannot be rebuilt
+// cheaply. Layout: magic, version, layer, key, then the layer's payload.
+constexpr uint32_t CHUNK_BIN_MAGIC = 0x4B484350; // "PCHK"
+constexpr uint32_t CHUNK_BIN_VERSION = 2;
+
+static std::size_t ChunkLayerBytes(AppState& s, ChunkLayer layer, uint64_t key) {
+    std::size_t bytes = 0;
+    if (layer == ChunkLayer::ZoneGrid) {
+        if (s.zoneChunks.count(key)) bytes += sizeof(ZoneChunk);
+        if (s.waterChunks.count(key)) bytes += sizeof(WaterChunk);
+    } else if (layer == ChunkLayer::Buildings) {
+        auto it = s.buildingChunks.find(key);
+        if (it != s.buildingChunks.end()) {
+            for (const auto& kv : it->second.instancesByAsset) bytes += kv.second.size() * sizeof(BuildingInstance);
+            bytes += it->second.clusters.size() * sizeof(InstanceCluster) + it->second.occluders.size() * sizeof(OccluderBox);
+        }
+    }
+    return bytes;
+}
+
+static void EraseChunkLayer(AppState& s, ChunkLayer layer, uint64_t key) {
+    if (layer == ChunkLayer::ZoneGrid) {
+        s.zoneChunks.erase(key);
+        s.waterChunks.erase(key);
+    }
+}
+
+static bool SaveChunkBin(AppState& s, ChunkLayer layer, uint64_t key, const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    uint32_t header[3] = {CHUNK_BIN_MAGIC, CHUNK_BIN_VERSION, (uint32_t)layer};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    if (layer == ChunkLayer::ZoneGrid) {
+        auto zit = s.zoneChunks.find(key);
+        auto wit = s.waterChunks.find(key);
+        uint8_t present = (zit != s.zoneChunks.end() ? 1 : 0) | (wit != s.waterChunks.end() ? 2 : 0);
+        out.write(reinterpret_cast<const char*>(&present), 1);
+        if (present & 1) out.write(reinterpret_cast<const char*>(zit->second.cells.data()), zit->second.cells.size());
+        if (present & 2) out.write(reinterpret_cast<const char*>(wit->second.bits.data()), sizeof(wit->second.bits));
+    } else {
+        return false;
+    }
+    return (bool)out;
+}
+
+static bool LoadChunkBin(AppState& s, ChunkLayer layer, uint64_t key, const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    uint32_t header[3] = {};
+    uint64_t fileKey = 0;
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    in.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey));
+    if (!in || header[0] != CHUNK_BIN_MAGIC || header[1] != CHUNK_BIN_VERSION ||
+        header[2] != (uint32_t)layer || fileKey != key) {
+        SDL_Log("Chunk file %s is invalid", path.c_str());
+        return false;
+    }
+    if (layer == ChunkLayer::ZoneGrid) {
+        uint8_t present = 0;
+        in.read(reinterpret_cast<char*>(&present), 1);
+        if (present & 1) in.read(reinterpret_cast<char*>(s.zoneChunks[key].cells.data()), ZoneChunk::DIM * ZoneChunk::DIM);
+        if (present & 2) in.read(reinterpret_cast<char*>(s.waterChunks[key].bits.data()), sizeof(WaterChunk::bits));
+    }
+    if (!in) {
+        SDL_Log("Chunk file %s is truncated", path.c_str());
+        EraseChunkLayer(s, layer, key);
+        return false;
+    }
+    return true;
+}
+
+static std::string ChunkCachePath(const std::string& dir, ChunkLayer layer, uint64_t key) {
+    int32_t cx, cz;
+    UnpackChunk(key, cx, cz);
+    char name[64];
+    std::snprintf(name, sizeof(name), "/L%d_%d_%d.bin", (int)layer, cx, cz);
+    return dir + name;
+}
+
+// Layers with no cheaper source are written to the chunk cache on eviction.
+class DiskChunkStore : public IChunkStore {
+public:
+    DiskChunkStore(AppState& s, ChunkLayer layer, std::string dir) : s(s), layer(layer), dir(std::move(dir)) {}
+    std::size_t load(uint64_t key) override {
+        if (!LoadChunkBin(s, layer, key, ChunkCachePath(dir, layer, key))) return 0;
+        return ChunkLayerBytes(s, layer, key);
+    }
+    bool evict(uint64_t key) override {
+        if (!SaveChunkBin(s, layer, key, ChunkCachePath(dir, layer, key))) return false;
+        EraseChunkLayer(s, layer, key);
+        return true;
+    }
+
+private:
+    AppState& s;
+    ChunkLayer layer;
+    std::string dir;
+};
+
+constexpr float CLUSTER_CELL_M = CHUNK_SIZE_M / 4.0f;
+constexpr float OCCLUDER_MIN_HEIGHT_M = 40.0f;
+constexpr float SHADOW_RECT_PAD_M = 64.0f; // buildings may overhang their chunk
+constexpr const char* MESH_ARCHIVE_PATH = "cache/meshes.archive";
+
+// Sorts each asset's instances into cluster cells and records cluster bounds,
+// chunk bounds and the occluder boxes of tall buildings. Instance order must be
+// settled before upload since clusters are drawn as sub-ranges.
+static void ClusterBuildingChunk(BuildingChunk& chunk, MeshCache& meshCache, const AssetCatalog& assets) {
+    chunk.clusters.clear();
+    chunk.occluders.clear();
+    chunk.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    chunk.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    chunk.animatingUntil = 0.0f;
+    auto cellOf = [](const BuildingInstance& inst) {
+        int32_t cx = (int32_t)std::floor(inst.localPos.x / CLUSTER_CELL_M);
+        int32_t cz = (int32_t)std::floor(inst.localPos.z / CLUSTER_CELL_M);
+        return ((int64_t)cz << 32) | (uint32_t)cx;
+    };
+    for (auto& assetPair : chunk.instancesByAsset) {
+        auto& list = assetPair.second;
+        std::stable_sort(list.begin(), list.end(), [&](const BuildingInstance& a, const BuildingInstance& b) {
+            return cellOf(a) < cellOf(b);
+        });
+        const MeshGpu& mesh = meshCache.getOrLoad(assetPair.first, assets);
+        glm::vec3 meshCenter = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+        glm::vec3 meshHalf = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+        for (uint32_t i = 0; i < (uint32_t)list.size(); i++) {
+            const BuildingInstance& inst = list[i];
+            if (i == 0 || cellOf(inst) != cellOf(list[i - 1])) {
+                InstanceCluster cl;
+                cl.asset = assetPair.first;
+                cl.first = i;
+                cl.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+                cl.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+                chunk.clusters.push_back(cl);
+            }
+            // Same rotation as the instance shader.
+            float c = std::cos(inst.yaw), s = std::sin(inst.yaw);
+            glm::vec3 lc = meshCenter * inst.scale;
+            glm::vec3 lh = meshHalf * inst.scale;
+            glm::vec3 center = inst.localPos + glm::vec3(c * lc.x + s * lc.z, lc.y, -s * lc.x + c * lc.z);
+            glm::vec3 half(std::abs(c) * lh.x + std::abs(s) * lh.z, lh.y, std::abs(s) * lh.x + std::abs(c) * lh.z);
+            InstanceCluster& cl = chunk.clusters.back();
+            cl.count++;
+            if (inst.growth.y > 0.0f) chunk.animatingUntil = std::max(chunk.animatingUntil, inst.growth.x + 1.0f / inst.growth.y);
+            cl.boundsMin = glm::min(cl.boundsMin, center - half);
+            cl.boundsMax = glm::max(cl.boundsMax, center + half);
+
+            if (lh.y * 2.0f >= OCCLUDER_MIN_HEIGHT_M) {
+                // Shrunk so setbacks and tapering tops do not over-occlude.
+                OccluderBox occ;
+                occ.center = center;
+                occ.halfExtents = lh * glm::vec3(0.8f, 0.9f, 0.8f);
+                occ.yaw = inst.yaw;
+                occ.readyAt = inst.growth.y > 0.0f ? inst.growth.x + 1.0f / inst.growth.y : 0.0f;
+                chunk.occluders.push_back(occ);
+            }
+        }
+    }
+    for (const InstanceCluster& cl : chunk.clusters) {
+        chunk.boundsMin = glm::min(chunk.boundsMin, cl.boundsMin);
+        chunk.boundsMax = glm::max(chunk.boundsMax, cl.boundsMax);
+    }
+}
+
+// Instance lists are regathered from the lifecycle; returns the chunk's size.
+static std::size_t GatherBuildingChunk(AppState& s, uint64_t key) {
+    const std::vector<uint32_t>* ids = s.buildings.buildingsInChunk(key);
+    if (!ids) {
+        s.buildingChunks.erase(key);
+        return 0;
+    }
+    BuildingChunk& chunk = s.buildingChunks[key];
+    chunk.instancesByAsset.clear();
+    chunk.clusters.clear();
+    chunk.occluders.clear();
+    for (uint32_t id : *ids) {
+        const BuildingLifecycle::Building& b = s.buildings.building(id);
+        BuildingInstance inst;
+        inst.asset = b.spec.asset;
+        inst.assetIndex = b.spec.assetIndex;
+        inst.localPos = b.spec.pos;
+        inst.yaw = std::atan2(b.spec.forward.x, b.spec.forward.z);
+        inst.scale = b.spec.scale;
+        inst.seed = b.spec.seed;
+        inst.growth = s.buildings.growth(b);
+        chunk.instancesByAsset[b.spec.asset].push_back(inst);
+    }
+    s.dirtyBuildingChunks.insert(key);
+    return ChunkLayerBytes(s, ChunkLayer::Buildings, key);
+}
+
+class BuildingChunkStore : public IChunkStore {
+public:
+    explicit BuildingChunkStore(AppState& s) : s(s) {}
+    std::size_t load(uint64_t key) override { return GatherBuildingChunk(s, key); }
+    bool evict(uint64_t key) override {
+        s.buildingChunks.erase(key);
+        return true;
+    }
+
+private:
+    AppState& s;
+};
+
+// GPU buffers are simply released; the draw path re-uploads visible chunks.
+class GpuInstanceStore : public IChunkStore {
+public:
+    GpuInstanceStore(AppState& s, Renderer& renderer) : s(s), renderer(renderer) {}
+    std::size_t load(uint64_t) override { return 0; }
+    bool evict(uint64_t key) override {
+        renderer.releaseHouseChunk(key);
+        s.uploadedBuildingChunks.erase(key);
+        return true;
+    }
+
+private:
+    AppState& s;
+    Renderer& renderer;
+};
+
+// Zone flag texture layers are re-uploaded from the grid when the chunk is visible again.
+class ZoneTextureStore : public IChunkStore {
+public:
+    explicit ZoneTextureStore(Renderer& renderer) : renderer(renderer) {}
+    std::size_t load(uint64_t) override { return 0; }
+    bool evict(uint64_t key) override {
+        renderer.releaseZoneChunk(key);
+        return true;
+    }
+
+private:
+    Renderer& renderer;
+};
+
+static void NoteLayerResident(AppState& s, ChunkLayer layer) {
+    s.streamer.resetLayer(layer);
+    std::unordered_set<uint64_t> keys;
+    if (layer == ChunkLayer::ZoneGrid) {
+        for (const auto& kv : s.zoneChunks) keys.insert(kv.first);
+        for (const auto& kv : s.waterChunks) keys.insert(kv.first);
+    }
+    for (uint64_t key : keys) s.streamer.noteResident(layer, key, ChunkLayerBytes(s, layer, key));
+}
 
 static bool LoadFromJsonFile(AppState& s, const std::string& path) {
     std::ifstream in(path, std::ios::binary);
@@ -2420,14 +2961,116 @@ static bool LoadFromJsonFile(AppState& s, const std::string& path) {
         s.zones.push_back(z);
     }
 
+    std::vector<ServiceSite> services;
+    s.nextServiceId = j.value("nextServiceId", 1);
+    if (j.contains("services")) {
+        for (auto& js : j["services"]) {
+            ServiceSite sv;
+            sv.id = js.value("id", 0);
+            int typeVal = (int)Clamp((float)js.value("type", 0), 0.0f, (float)(SERVICE_TYPE_COUNT - 1));
+            sv.type = (ServiceType)typeVal;
+            sv.roadId = js.value("roadId", 0);
+            sv.d = js.value("d", 0.0f);
+            if (js.contains("pos")) sv.pos = glm::vec3(js["pos"][0].get<float>(), js["pos"][1].get<float>(), js["pos"][2].get<float>());
+            services.push_back(sv);
+        }
+    }
+    s.coverage.setServices(services);
+
+    s.roadGraphFullRebuild = true;
+    s.dirtyRoadIds.clear();
     s.roadsDirty = true;
     s.zonesDirty = true;
     s.housesDirty = true;
     return true;
 }
 
+static const uint8_t* RegionZoneCells(const void* ctx, uint64_t key) {
+    return ZoneCellsFor(*static_cast<const AppState*>(ctx), key);
+}
+
+static const uint64_t* RegionWaterBits(const void* ctx, uint64_t key) {
+    return WaterBitsFor(*static_cast<const AppState*>(ctx), key);
+}
+
+static const uint8_t* RegionNoCells(const void*, uint64_t) {
+    return nullptr;
+}
+
+// Writes the zone/water grids next to the JSON save and re-maps them as the new base.
+static bool SaveZoneRegion(AppState& s, const std::string& jsonPath) {
+    const std::string path = jsonPath + ".region";
+    const std::string tmpPath = path + ".tmp";
+    s.streamer.restoreAll(ChunkLayer::ZoneGrid);
+
+    std::vector<uint64_t> keys = ZoneGridKeys(s, false);
+    std::vector<uint64_t> waterKeys = ZoneGridKeys(s, true);
+    keys.insert(keys.end(), waterKeys.begin(), waterKeys.end());
+    // A zone grid awaiting rebuild would not match the saved roads; keep only the water.
+    bool zonesCurrent = !s.zonesDirty && !s.roadsDirty;
+    if (!RegionFile::write(tmpPath, keys, zonesCurrent ? RegionZoneCells : RegionNoCells, RegionWaterBits, &s)) {
+        SDL_Log("Failed to write region file %s", tmpPath.c_str());
+        return false;
+    }
+
+    // The old mapping may still back cells; drop it only after the new file is complete.
+    s.zoneRegion.close();
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec || !s.zoneRegion.open(path)) {
+        SDL_Log("Failed to replace region file %s", path.c_str());
+        s.zoneBaseValid = false;
+        s.waterBaseValid = false;
+        return false;
+    }
+    if (zonesCurrent) {
+        s.zoneChunks.clear();
+        s.zoneBaseValid = true;
+    } else {
+        s.zoneBaseValid = false; // rebuilt from scratch this frame
+        s.zoneGridFromRegion = false;
+    }
+    s.waterChunks.clear();
+    s.waterBaseValid = true;
+    s.streamer.resetLayer(ChunkLayer::ZoneGrid);
+    NoteLayerResident(s, ChunkLayer::ZoneGrid);
+    return true;
+}
+
+static void OpenZoneRegion(AppState& s, const std::string& jsonPath) {
+    const std::string path = jsonPath + ".region";
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) return; // older save; the water mask stays as is
+    s.streamer.resetLayer(ChunkLayer::ZoneGrid);
+    s.zoneChunks.clear();
+    s.waterChunks.clear();
+    s.zoneBaseValid = false;
+    s.waterBaseValid = false;
+    s.zoneGridFromRegion = false;
+    if (!s.zoneRegion.open(path)) return;
+
+    bool hasZones = false;
+    for (std::size_t i = 0; i < s.zoneRegion.chunkCount() && !hasZones; i++) {
+        hasZones = s.zoneRegion.entry(i).zoneOffset != 0;
+    }
+    s.zoneBaseValid = hasZones;
+    s.waterBaseValid = true;
+    s.zoneGridFromRegion = hasZones;
+}
+
+static bool SaveCity(AppState& s, const AssetCatalog& assets, const std::string& path) {
+    if (!SaveToJsonFile(s, assets, path)) return false;
+    return SaveZoneRegion(s, path);
+}
+
+static bool LoadCity(AppState& s, const std::string& path) {
+    if (!LoadFromJsonFile(s, path)) return false;
+    OpenZoneRegion(s, path);
+    return true;
+}
+
 // Tool states
-enum class Mode { Road, Zone, Unzone };
+enum class Mode { Road, Zone, Unzone, Service };
 
 struct RoadTool {
     bool drawing = false;
@@ -2501,13 +3144,27 @@ static float ClosestDistanceAlongRoadSq(const Road& r, const glm::vec3& p, float
     return bestDistSq;
 }
 
-int main(int, char**) {
+int main(int argc, char** argv) {
+    // --build-assets runs the mesh import headless: catalog plus packed mesh archive.
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--build-assets") != 0) continue;
+        AssetCatalog assets;
+        if (!assets.loadAll("assets", "cache/assets.catalog")) return 1;
+        return MeshArchive::build(assets, MESH_ARCHIVE_PATH) ? 0 : 1;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
         SDL_Log("SDL_Init failed: %s", SDL_GetError());
         return 1;
     }
 
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    // A 4.3 context enables the GPU-driven building path; --gl33 forces the 3.3 renderer.
+    bool tryGL43 = true;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--gl33") == 0) tryGL43 = false;
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, tryGL43 ? 4 : 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
@@ -2527,6 +3184,11 @@ int main(int, char**) {
     }
 
     SDL_GLContext glctx = SDL_GL_CreateContext(window);
+    if (!glctx && tryGL43) {
+        SDL_Log("GL 4.3 context unavailable (%s); falling back to 3.3", SDL_GetError());
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        glctx = SDL_GL_CreateContext(window);
+    }
     if (!glctx) {
         SDL_Log("SDL_GL_CreateContext failed: %s", SDL_GetError());
         SDL_DestroyWindow(window);
@@ -2562,20 +3224,64 @@ int main(int, char**) {
     ImGui_ImplOpenGL3_Init("#version 330 core");
 
     AssetCatalog assets;
-    assets.loadAll("assets");
+    {
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        assets.loadAll("assets", "cache/assets.catalog");
+        SDL_Log("Assets: %d definitions %s (%.1f ms)", (int)assets.size(),
+            assets.loadedFromCompiled() ? "from the compiled catalog" : "scanned and compiled",
+            (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+    }
 
     MeshCache meshCache;
-    if (!meshCache.init()) {
-        SDL_Log("MeshCache init failed");
+    {
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        if (!meshCache.init(assets, MESH_ARCHIVE_PATH)) {
+            SDL_Log("MeshCache init failed");
+        }
+        SDL_Log("Meshes: %d from the archive, %.1f MB (%.1f ms)", meshCache.archivedMeshes(),
+            meshCache.memoryBytes() / 1048576.0,
+            (double)(SDL_GetPerformanceCounter() - t0) * 1000.0 / (double)SDL_GetPerformanceFrequency());
     }
 
     AppState state;
+    state.pollutionField.configure(2, 160.0f);
+    state.noiseField.configure(1, 48.0f);
+    state.landValueField.configure(2, 120.0f);
+    state.sim.start(SimSettings{});
+    state.travelBuilder.start();
+    state.traffic.start(TrafficSettings{});
+    {
+        ChunkCoord c0 = ChunkFromPosXZ(glm::vec3(-MAP_HALF_M, 0.0f, -MAP_HALF_M));
+        ChunkCoord c1 = ChunkFromPosXZ(glm::vec3(MAP_HALF_M, 0.0f, MAP_HALF_M));
+        state.summaries.configure(c0.cx, c1.cx - c0.cx + 1);
+    }
+
+    // Chunk residency: the zone grid spills to the cache directory, building
+    // lists are regathered from the lifecycle and GPU buffers are re-uploaded.
+    const std::string chunkCacheDir = "cache/chunks";
+    std::error_code cacheEc;
+    std::filesystem::create_directories(chunkCacheDir, cacheEc);
+    DiskChunkStore zoneGridStore(state, ChunkLayer::ZoneGrid, chunkCacheDir);
+    BuildingChunkStore buildingStore(state);
+    GpuInstanceStore gpuInstanceStore(state, renderer);
+    ZoneTextureStore zoneTextureStore(renderer);
+    if (cacheEc) {
+        SDL_Log("Chunk cache %s unavailable (%s); zone grid stays resident", chunkCacheDir.c_str(), cacheEc.message().c_str());
+    } else {
+        state.streamer.setStore(ChunkLayer::ZoneGrid, &zoneGridStore);
+    }
+    state.streamer.setStore(ChunkLayer::Buildings, &buildingStore);
+    state.streamer.setStore(ChunkLayer::GpuInstances, &gpuInstanceStore);
+    state.streamer.setStore(ChunkLayer::Overlays, &zoneTextureStore);
     CommandStack cmds;
 
     Camera cam;
+    glm::vec3 prevCamTarget = cam.target; // camera motion feeds streaming prediction
+    glm::vec3 camVelocity(0.0f);
     Mode mode = Mode::Road;
     RoadTool roadTool;
     ZoneTool zoneTool;
+    ServiceType serviceType = ServiceType::Police;
 
     // snapping + UX settings
     bool gridSnap = true;
@@ -2772,7 +3478,6 @@ int main(int, char**) {
 
         LightingParams lighting = EvaluateTimeOfDay(timeOfDayHours);
         float shadowRadius = Clamp(cam.distance * 2.4f, 400.0f, 9000.0f);
-        glm::mat4 lightViewProj = BuildDirectionalLightMatrix(tgt, shadowRadius, lighting.sunDir);
 
         glm::vec3 mouseHitRel;
         bool hasHit = ScreenToGroundHit(mx, my, winW, winH, view, proj, mouseHitRel);
@@ -2791,7 +3496,7 @@ int main(int, char**) {
         std::unordered_set<uint64_t> visibleChunkSet(visibleChunks.begin(), visibleChunks.end());
 
         // Update hover for zoning/unzoning
-        if ((mode == Mode::Zone || mode == Mode::Unzone) && hasHit) {
+        if ((mode == Mode::Zone || mode == Mode::Unzone || mode == Mode::Service) && hasHit) {
             updateZoneHover(mouseHit);
         }
 
@@ -2854,11 +3559,15 @@ int main(int, char**) {
                 if (k == SDLK_4) { mode = Mode::Zone; zoneTool.type = ZoneType::Industrial; statusText = "Zone: Industrial."; }
                 if (k == SDLK_5) { mode = Mode::Zone; zoneTool.type = ZoneType::Office; statusText = "Zone: Office."; }
                 if (k == SDLK_6) { mode = Mode::Unzone; statusText = "Unzone mode."; }
+                if (k == SDLK_7) { mode = Mode::Service; statusText = std::string("Service: ") + ServiceTypeName(serviceType) + "."; }
 
                 if (k == SDLK_g) { gridSnap = !gridSnap; statusText = gridSnap ? "Grid snap ON" : "Grid snap OFF"; }
                 if (k == SDLK_h) { angleSnap = !angleSnap; statusText = angleSnap ? "Angle snap ON" : "Angle snap OFF"; }
 
-                if (k == SDLK_v) {
+                if (k == SDLK_v && mode == Mode::Service) {
+                    serviceType = (ServiceType)(((int)serviceType + 1) % SERVICE_TYPE_COUNT);
+                    statusText = std::string("Service: ") + ServiceTypeName(serviceType) + ".";
+                } else if (k == SDLK_v) {
                     // cycle zoning side
                     if (zoneTool.sideMask == 3) zoneTool.sideMask = 1;
                     else if (zoneTool.sideMask == 1) zoneTool.sideMask = 2;
@@ -2878,13 +3587,14 @@ int main(int, char**) {
                 }
 
                 if (ctrl && k == SDLK_s) {
-                    if (SaveToJsonFile(state, assets, savePath)) statusText = "Saved.";
+                    if (SaveCity(state, assets, savePath)) statusText = "Saved.";
                     else statusText = "Save failed.";
                 }
 
                 if (ctrl && k == SDLK_o) {
-                    if (LoadFromJsonFile(state, savePath)) {
+                    if (LoadCity(state, savePath)) {
                         cmds.clear();
+                        minimap.dirty = true;
                         statusText = "Loaded.";
                     } else statusText = "Load failed.";
                 }
@@ -2896,6 +3606,19 @@ int main(int, char**) {
                         roadTool.selectedPointIndex = -1;
                     }
                 }
+                if (mode == Mode::Service && (k == SDLK_DELETE || k == SDLK_BACKSPACE) && hasHit) {
+                    const ServiceSite* nearest = nullptr;
+                    float bestSq = zoneTool.pickRadius * zoneTool.pickRadius * 4.0f;
+                    for (const auto& sv : state.coverage.services()) {
+                        glm::vec3 dv = sv.pos - mouseHit;
+                        float dSq = dv.x * dv.x + dv.z * dv.z;
+                        if (dSq < bestSq) { bestSq = dSq; nearest = &sv; }
+                    }
+                    if (nearest) {
+                        cmds.exec(state, std::make_unique<CmdRemoveService>(*nearest));
+                        statusText = "Service removed.";
+                    }
+                }
             }
 
             if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT && !io.WantCaptureMouse) {
@@ -2960,6 +3683,22 @@ int main(int, char**) {
                     }
                     cmds.exec(state, std::make_unique<CmdClearZonesForRoad>(rid, removed));
                     statusText = "Zones cleared.";
+                } else if (mode == Mode::Service) {
+                    if (!zoneTool.hoverValid) {
+                        statusText = "Invalid: services must front a road.";
+                        break;
+                    }
+                    int idx = FindRoadIndexById(state.roads, zoneTool.hoverRoadId);
+                    if (idx < 0) break;
+                    ServiceSite sv;
+                    sv.id = state.nextServiceId++;
+                    sv.type = serviceType;
+                    sv.roadId = zoneTool.hoverRoadId;
+                    sv.d = zoneTool.hoverD;
+                    glm::vec3 tan;
+                    sv.pos = state.roads[idx].pointAt(sv.d, tan);
+                    cmds.exec(state, std::make_unique<CmdAddService>(sv));
+                    statusText = std::string(ServiceTypeName(serviceType)) + " placed.";
                 }
             }
 
@@ -3042,7 +3781,7 @@ int main(int, char**) {
 
                     state.roads[idx].pts[roadTool.selectedPointIndex] = p;
                     state.roads[idx].rebuildCum();
-                    state.roadsDirty = true;
+                    MarkRoadDirty(state, roadTool.selectedRoadId);
                     state.housesDirty = true;
                 }
             }
@@ -3064,94 +3803,138 @@ int main(int, char**) {
                 if (r.cumLen.size() != r.pts.size()) r.rebuildCum();
             }
             if (state.roadsDirty) {
-                RebuildAllRoadMesh(state);
+                SyncRoadGraph(state);
+                RebuildRoadSegments(state);
             }
+            state.streamer.restoreAll(ChunkLayer::ZoneGrid); // water mask is an input
             RebuildZoneGrid(state);
+            std::vector<uint64_t> changedGrid = TakeChangedGridChunks(state);
+            state.dirtySummaryGridChunks.insert(changedGrid.begin(), changedGrid.end());
+            state.dirtyZoneTextureChunks.insert(changedGrid.begin(), changedGrid.end());
+            NoteLayerResident(state, ChunkLayer::ZoneGrid);
             RebuildLotCells(state);
-            state.overlayDirty = true;
+            RebuildCoverageLots(state);
+            state.fieldsDirty = true;
+            state.trafficDirty = true;
             state.roadsDirty = false;
             state.zonesDirty = false;
             state.housesDirty = true;
         }
 
+        if (state.fieldsDirty) {
+            state.streamer.restoreAll(ChunkLayer::ZoneGrid);
+            RebuildScalarFieldSources(state);
+            state.fieldsDirty = false;
+            state.simSnapshotDirty = true;
+        }
+
+        // Traffic: edits send a new demand to the solver thread, which iterates to
+        // equilibrium and publishes after every step. Results of an older request
+        // still describe the old network until the new one's first publish.
+        if (state.trafficDirty) {
+            RebuildTrafficDemand(state);
+            state.trafficDirty = false;
+            state.travelIndexUsesTraffic = false;
+        }
+        const TrafficResults& traffic = state.traffic.update();
+        const bool trafficCurrent = traffic.request == state.trafficRequest;
+        if (traffic.sequence != state.trafficSequence) {
+            state.trafficSequence = traffic.sequence;
+            state.heatmapDirty = true;
+        }
+        // Heatmap refresh is one float per road segment; road geometry is untouched.
+        if (state.trafficHeatmap && state.heatmapDirty) {
+            std::vector<float> congestion(traffic.congestion);
+            congestion.resize(state.roadGraph.edges().size(), 0.0f);
+            renderer.updateRoadCongestion(congestion);
+            state.heatmapDirty = false;
+        }
+
+        // Travel-time index: re-order only when topology changed, re-customize with
+        // congested times once the assignment settles. Both run on the builder's
+        // thread; queries keep using the previous index until a new one is taken.
+        if (state.travelIndexVersion != state.roadGraph.version()) {
+            state.travelBuilder.requestBuild(SnapshotTravelTimeGraph(state.roadGraph), state.traffic.getSettings().freeSpeedMps);
+            state.travelIndexVersion = state.roadGraph.version();
+            state.travelIndexUsesTraffic = false;
+        }
+        if (!state.travelIndexUsesTraffic && trafficCurrent && traffic.converged &&
+            traffic.time.size() == state.roadGraph.edges().size() * 2) {
+            state.travelBuilder.requestCustomize(state.travelIndexVersion, traffic.time);
+            state.travelIndexUsesTraffic = true;
+        }
+        state.travelBuilder.take(state.travelIndex);
+
         // Rebuild houses if zones changed
         if (state.housesDirty) {
             bool animate = true; // animate after zone/road edits for now
+            state.streamer.restoreAll(ChunkLayer::ZoneGrid);
+            // Chunks losing every building are not reported by the lifecycle.
+            std::vector<uint64_t> oldChunks;
+            state.buildings.chunkKeys(oldChunks);
+            state.dirtySummaryChunks.insert(oldChunks.begin(), oldChunks.end());
             RebuildHousesFromLots(state, assets, animate, nowSec);
             state.housesDirty = false;
+            state.simSnapshotDirty = true;
         }
 
-        // House animation step (move finished anim houses into static instances)
-        std::vector<HouseInstanceGPU> animInstances;
-        animInstances.reserve(state.houseAnim.size());
-
-        std::vector<HouseAnim> still;
-        still.reserve(state.houseAnim.size());
-
-        for (const auto& h : state.houseAnim) {
-            float t = (nowSec - h.spawnTime) / 0.35f;
-            float s = Clamp(t, 0.0f, 1.0f);
-            s = 1.0f - (1.0f - s) * (1.0f - s);
-            float facadeIndex = -1.0f;
-            const AssetDef* animDef = assets.find(h.asset);
-            if (animDef && animDef->category == "office") {
-                facadeIndex = (float)FacadeIndexFromSeed(h.seed, 4);
-            }
+        // The simulation worker reads the last published snapshot; republish only after edits.
+        if (state.simSnapshotDirty && trafficCurrent && traffic.converged) {
+            state.sim.publishSnapshot(BuildSimSnapshot(state));
+            state.simSnapshotDirty = false;
+        }
 
-            glm::mat4 M(1.0f);
-            M = glm::translate(M, h.pos);
-            glm::vec3 houseSizeAnim = h.scale;
-            glm::vec3 up(0,1,0);
-            glm::vec3 facing = glm::normalize(h.forward);
-            glm::vec3 basisRight = glm::normalize(glm::cross(up, facing));
-            glm::mat4 R(1.0f);
-            R[0] = glm::vec4(basisRight, 0.0f);
-            R[1] = glm::vec4(up, 0.0f);
-            R[2] = glm::vec4(facing, 0.0f);
-            M = M * R;
-            M = glm::scale(M, houseSizeAnim * s);
-
-            ChunkCoord cc = ChunkFromPosXZ(h.pos);
-            bool visible = (visibleChunkSet.find(PackChunk(cc.cx, cc.cz)) != visibleChunkSet.end());
-            if (visible) {
-                float yaw = std::atan2(h.forward.x, h.forward.z);
-                animInstances.push_back({glm::vec4(h.pos - renderOrigin, yaw), glm::vec4(houseSizeAnim * s, facadeIndex)});
+        // Building lifecycle: only buildings whose timer fired are visited. Growth
+        // animates in the instance shader, so only added/upgrading chunks are regathered.
+        state.buildings.update(nowSec);
+        {
+            std::vector<uint64_t> changedChunks;
+            state.buildings.takeDirtyChunks(changedChunks);
+            for (uint64_t key : changedChunks) {
+                state.streamer.noteResident(ChunkLayer::Buildings, key, GatherBuildingChunk(state, key));
+                state.dirtySummaryChunks.insert(key);
             }
+        }
+        RefreshChunkSummaries(state);
 
-            if (t >= 1.0f) {
-                glm::mat4 S(1.0f);
-                S = glm::translate(S, h.pos);
-                S = S * R;
-                S = glm::scale(S, houseSizeAnim);
-                state.houseStatic.push_back(S);
-                uint64_t ckey = PackChunk(cc.cx, cc.cz);
-                state.houseStaticByChunk[ckey].push_back(S);
-                BuildingInstance inst;
-                inst.asset = h.asset;
-                inst.localPos = h.pos;
-                inst.yaw = std::atan2(h.forward.x, h.forward.z);
-                inst.scale = houseSizeAnim;
-                inst.seed = h.seed;
-                state.buildingChunks[ckey].instancesByAsset[h.asset].push_back(inst);
-                state.dirtyBuildingChunks.insert(ckey);
-            } else {
-                still.push_back(h);
-            }
+        // Streaming: restore evicted chunks near the camera (and where it is heading),
+        // evict least recently used ones elsewhere when over budget.
+        if (fdt > 0.0f) {
+            glm::vec3 v = (cam.target - prevCamTarget) / fdt;
+            camVelocity = glm::mix(camVelocity, v, Clamp(fdt * 8.0f, 0.0f, 1.0f));
         }
-        state.houseAnim.swap(still);
+        prevCamTarget = cam.target;
+        state.streamer.update(cam.target, camVelocity);
 
-        // Upload visible chunk houses (static)
-        std::vector<RenderHouseBatch> visibleHouseBatches;
+        // Upload visible chunk houses; a chunk is re-sent only when its buildings
+        // changed or the render origin moved.
         glm::vec3 origin = renderOrigin;
+        if (origin != state.buildingUploadOrigin) {
+            state.uploadedBuildingChunks.clear();
+            state.buildingUploadOrigin = origin;
+        }
+        // Chunks whose shadow casters changed; cached shadow cascades over them are redrawn.
+        std::vector<glm::vec4> shadowDirtyRects;
+        auto markShadowDirty = [&](uint64_t key) {
+            int32_t cx, cz;
+            UnpackChunk(key, cx, cz);
+            float x0 = cx * CHUNK_SIZE_M - origin.x - SHADOW_RECT_PAD_M;
+            float z0 = cz * CHUNK_SIZE_M - origin.z - SHADOW_RECT_PAD_M;
+            float size = CHUNK_SIZE_M + 2.0f * SHADOW_RECT_PAD_M;
+            shadowDirtyRects.push_back(glm::vec4(x0, z0, x0 + size, z0 + size));
+        };
         for (uint64_t key : visibleChunks) {
             auto it = state.buildingChunks.find(key);
             if (it == state.buildingChunks.end()) continue;
-            const auto& chunk = it->second;
+            auto& chunk = it->second;
+            bool upload = state.dirtyBuildingChunks.count(key) != 0 || state.uploadedBuildingChunks.count(key) == 0;
+            if (!upload) continue;
+            ClusterBuildingChunk(chunk, meshCache, assets);
             for (const auto& assetPair : chunk.instancesByAsset) {
                 AssetId assetId = assetPair.first;
                 const auto& src = assetPair.second;
-                const AssetDef* def = assets.find(assetId);
-                const bool isOffice = (def && def->category == "office");
+                if (src.empty()) continue;
+                const bool isOffice = (assets.traits(src.front().assetIndex).flags & ASSET_FACADE) != 0;
                 const uint32_t facadeCount = 4;
                 std::vector<HouseInstanceGPU> shifted;
                 shifted.reserve(src.size());
@@ -3163,68 +3946,109 @@ int main(int, char**) {
                     float facadeIndex = -1.0f;
                     if (isOffice) facadeIndex = (float)FacadeIndexFromSeed(inst.seed, facadeCount);
                     sInst.scaleVar = glm::vec4(inst.scale, facadeIndex);
+                    sInst.anim = inst.growth;
                     shifted.push_back(sInst);
                 }
                 const MeshGpu& mesh = meshCache.getOrLoad(assetId, assets);
                 renderer.updateHouseChunk(key, assetId, mesh, shifted);
-                visibleHouseBatches.push_back({key, assetId});
             }
+            state.streamer.noteResident(ChunkLayer::GpuInstances, key, renderer.houseChunkBytes(key));
             state.dirtyBuildingChunks.erase(key);
+            state.uploadedBuildingChunks.insert(key);
+            markShadowDirty(key);
         }
+        // Loading a mesh above may have grown the shared mesh buffers.
+        renderer.setMeshBuffers(meshCache.vertexBuffer(), meshCache.indexBuffer(), meshCache.boundsTexture(), MeshCache::vertexStride());
 
-        renderer.updateAnimHouses(animInstances);
-
-        if (state.overlayDirty) {
-            RebuildRoadAlignedOverlay(state);
-            state.overlayDirty = false;
+        // Occlusion: the tallest nearby buildings are rasterized into a small depth
+        // buffer, then chunk and cluster bounds are tested against it. Hidden clusters
+        // are still submitted for the shadow map.
+        std::vector<RenderHouseBatch> visibleHouseBatches;
+        std::unordered_set<uint64_t> casterChunks;
+        {
+            const glm::vec3 shift(origin.x, 0.0f, origin.z);
+            const bool occlude = state.occlusionCulling;
+            if (occlude) {
+                constexpr std::size_t MAX_OCCLUDERS = 128;
+                std::vector<std::pair<float, const OccluderBox*>> candidates;
+                for (uint64_t key : visibleChunks) {
+                    auto it = state.buildingChunks.find(key);
+                    if (it == state.buildingChunks.end()) continue;
+                    for (const OccluderBox& occ : it->second.occluders) {
+                        if (occ.readyAt > nowSec) continue;
+                        float dist = std::max(glm::length(occ.center - shift - eye), 1.0f);
+                        candidates.push_back({occ.halfExtents.y * std::max(occ.halfExtents.x, occ.halfExtents.z) / (dist * dist), &occ});
+                    }
+                }
+                std::size_t n = std::min(candidates.size(), MAX_OCCLUDERS);
+                std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(),
+                    [](const auto& a, const auto& b) { return a.first > b.first; });
+                state.occlusion.begin(viewProj);
+                for (std::size_t i = 0; i < n; i++) {
+                    const OccluderBox& occ = *candidates[i].second;
+                    state.occlusion.addOccluderBox(occ.center - shift, occ.halfExtents, occ.yaw);
+                }
+            }
+            for (uint64_t key : visibleChunks) {
+                auto it = state.buildingChunks.find(key);
+                if (it == state.buildingChunks.end()) continue;
+                const BuildingChunk& chunk = it->second;
+                if (chunk.clusters.empty()) continue;
+                casterChunks.insert(key);
+                // Growth animates in the shader; give the finished pose a second to land.
+                if (chunk.animatingUntil + 1.0f > nowSec) markShadowDirty(key);
+                bool chunkVisible = !occlude || state.occlusion.testAabb(chunk.boundsMin - shift, chunk.boundsMax - shift);
+                for (const InstanceCluster& cl : chunk.clusters) {
+                    bool visible = chunkVisible && (!occlude || state.occlusion.testAabb(cl.boundsMin - shift, cl.boundsMax - shift));
+                    visibleHouseBatches.push_back({key, cl.asset, cl.first, cl.count, visible, cl.boundsMin - shift, cl.boundsMax - shift});
+                }
+            }
         }
-
-        // Overlay mesh generation (grid + zones + preview)
+        // Chunks that started or stopped casting (streamed, emptied, left the view).
+        for (uint64_t key : casterChunks) {
+            if (!state.shadowCasterChunks.count(key)) markShadowDirty(key);
+        }
+        for (uint64_t key : state.shadowCasterChunks) {
+            if (!casterChunks.count(key)) markShadowDirty(key);
+        }
+        state.shadowCasterChunks = std::move(casterChunks);
+
+        // Zone flags of visible chunks live in the renderer's texture array; the
+        // overlay shader shades cells from them. After a grid rebuild only the
+        // uploaded chunks whose cells changed are rewritten in place (or dropped
+        // when they emptied); the rest are uploaded when they become visible.
+        for (uint64_t key : state.dirtyZoneTextureChunks) {
+            if (!renderer.hasZoneChunk(key)) continue;
+            const uint8_t* cells = ZoneCellsFor(state, key);
+            if (cells && renderer.updateZoneChunk(key, cells)) continue;
+            renderer.releaseZoneChunk(key);
+            state.streamer.noteDropped(ChunkLayer::Overlays, key);
+        }
+        state.dirtyZoneTextureChunks.clear();
         bool showGrid = (mode == Mode::Zone || mode == Mode::Unzone || (mode == Mode::Road && roadTool.drawing));
-        std::vector<glm::vec3> buildableVerts;
-        std::vector<glm::vec3> zonedResidential;
-        std::vector<glm::vec3> zonedCommercial;
-        std::vector<glm::vec3> zonedIndustrial;
-        std::vector<glm::vec3> zonedOffice;
+        std::vector<RenderZoneChunk> zoneDraws;
         std::vector<glm::vec3> waterVerts;
         for (uint64_t key : visibleChunks) {
-            auto wit = state.waterChunks.find(key);
-            if (showGrid) {
-                auto bit = state.overlayBuildableByChunk.find(key);
-                if (bit != state.overlayBuildableByChunk.end()) {
-                    const auto& src = bit->second;
-                    buildableVerts.insert(buildableVerts.end(), src.begin(), src.end());
+            int32_t cx, cz;
+            UnpackChunk(key, cx, cz);
+            float originX = cx * CHUNK_SIZE_M;
+            float originZ = cz * CHUNK_SIZE_M;
+            bool zoneResident = renderer.hasZoneChunk(key);
+            if (!zoneResident) {
+                const uint8_t* cells = ZoneCellsFor(state, key);
+                if (cells && renderer.updateZoneChunk(key, cells)) {
+                    state.streamer.noteResident(ChunkLayer::Overlays, key, renderer.zoneChunkBytes());
+                    zoneResident = true;
                 }
             }
-            auto rit = state.overlayZonedResByChunk.find(key);
-            if (rit != state.overlayZonedResByChunk.end()) {
-                const auto& src = rit->second;
-                zonedResidential.insert(zonedResidential.end(), src.begin(), src.end());
-            }
-            auto cit = state.overlayZonedComByChunk.find(key);
-            if (cit != state.overlayZonedComByChunk.end()) {
-                const auto& src = cit->second;
-                zonedCommercial.insert(zonedCommercial.end(), src.begin(), src.end());
+            if (zoneResident) {
+                zoneDraws.push_back({key, glm::vec2(originX - renderOrigin.x, originZ - renderOrigin.z)});
             }
-            auto iit = state.overlayZonedIndByChunk.find(key);
-            if (iit != state.overlayZonedIndByChunk.end()) {
-                const auto& src = iit->second;
-                zonedIndustrial.insert(zonedIndustrial.end(), src.begin(), src.end());
-            }
-            auto oit = state.overlayZonedOfficeByChunk.find(key);
-            if (oit != state.overlayZonedOfficeByChunk.end()) {
-                const auto& src = oit->second;
-                zonedOffice.insert(zonedOffice.end(), src.begin(), src.end());
-            }
-            if (wit != state.waterChunks.end()) {
-                const WaterChunk& wchunk = wit->second;
-                int32_t cx, cz;
-                UnpackChunk(key, cx, cz);
-                float originX = cx * CHUNK_SIZE_M;
-                float originZ = cz * CHUNK_SIZE_M;
+            const uint64_t* wbits = WaterBitsFor(state, key);
+            if (wbits) {
                 for (int zi = 0; zi < WaterChunk::DIM; ++zi) {
                     for (int xi = 0; xi < WaterChunk::DIM; ++xi) {
-                        if (wchunk.get(xi, zi) == 0) continue;
+                        if (!WaterChunk::test(wbits, zi * WaterChunk::DIM + xi)) continue;
                         AppendWaterCellQuad(waterVerts, originX, originZ, xi, zi);
                     }
                 }
@@ -3250,29 +4074,12 @@ int main(int, char**) {
             }
         }
 
-        std::vector<glm::vec3> overlayAndPreview;
-        overlayAndPreview.reserve(
-            buildableVerts.size()
-            + zonedResidential.size()
-            + zonedCommercial.size()
-            + zonedIndustrial.size()
-            + zonedOffice.size()
-            + state.zonePreviewVerts.size());
-        overlayAndPreview.insert(overlayAndPreview.end(), buildableVerts.begin(), buildableVerts.end());
-        overlayAndPreview.insert(overlayAndPreview.end(), zonedResidential.begin(), zonedResidential.end());
-        overlayAndPreview.insert(overlayAndPreview.end(), zonedCommercial.begin(), zonedCommercial.end());
-        overlayAndPreview.insert(overlayAndPreview.end(), zonedIndustrial.begin(), zonedIndustrial.end());
-        overlayAndPreview.insert(overlayAndPreview.end(), zonedOffice.begin(), zonedOffice.end());
-        overlayAndPreview.insert(overlayAndPreview.end(), state.zonePreviewVerts.begin(), state.zonePreviewVerts.end());
-
-        std::size_t gridCount = buildableVerts.size();
-        std::size_t resCount = zonedResidential.size();
-        std::size_t comCount = zonedCommercial.size();
-        std::size_t indCount = zonedIndustrial.size();
-        std::size_t officeCount = zonedOffice.size();
         std::size_t previewCount = state.zonePreviewVerts.size();
-        for (auto& v : overlayAndPreview) v -= renderOrigin;
-        renderer.updatePreviewMesh(overlayAndPreview);
+        if (previewCount > 0) {
+            std::vector<glm::vec3> previewVerts = state.zonePreviewVerts;
+            for (auto& v : previewVerts) v -= renderOrigin;
+            renderer.updatePreviewMesh(previewVerts);
+        }
 
         for (auto& v : waterVerts) v -= renderOrigin;
         renderer.updateWaterMesh(waterVerts);
@@ -3282,13 +4089,7 @@ int main(int, char**) {
         ImGui_ImplSDL2_NewFrame();
         ImGui::NewFrame();
 
-        int houseCount = 0;
-        for (const auto& kv : state.buildingChunks) {
-            for (const auto& assetPair : kv.second.instancesByAsset) {
-                houseCount += (int)assetPair.second.size();
-            }
-        }
-        houseCount += (int)state.houseAnim.size();
+        int houseCount = (int)state.buildings.size();
 
         ImGui::Begin("City Painter (Phase 1)");
         const char* modeLabel = "Road (1)";
@@ -3301,11 +4102,21 @@ int main(int, char**) {
             }
         } else if (mode == Mode::Unzone) {
             modeLabel = "Unzone (6)";
+        } else if (mode == Mode::Service) {
+            modeLabel = "Service (7)";
         }
         ImGui::Text("Mode: %s", modeLabel);
         ImGui::Text("Roads: %d", (int)state.roads.size());
+        ImGui::Text("Road graph: %d nodes, %d edges", state.roadGraph.nodeCount(), state.roadGraph.edgeCount());
         ImGui::Text("Zones: %d", (int)state.zones.size());
         ImGui::Text("Houses: %d", houseCount);
+        {
+            LifecycleStats ls = state.buildings.stats();
+            ImGui::Text("Lots %d | building %d | occupied %d | upgrading %d", ls.byState[(int)BuildingState::EmptyLot],
+                ls.byState[(int)BuildingState::Construction], ls.byState[(int)BuildingState::Occupied],
+                ls.byState[(int)BuildingState::Upgrading]);
+            ImGui::Text("Timers %d | fired last frame %d", ls.timers, ls.lastFired);
+        }
         ImGui::Separator();
 
         ImGui::Text("Snapping");
@@ -3323,6 +4134,101 @@ int main(int, char**) {
         ImGui::Text("Sides (V cycles): %s", (zoneTool.sideMask == 3) ? "Both" : (zoneTool.sideMask == 1) ? "Left" : "Right");
         ImGui::Separator();
 
+        const TrafficResults& tr = state.traffic.latest();
+        const TrafficStats& ts = tr.stats;
+        ImGui::Text("Traffic");
+        ImGui::Text("Zones: %d (%d origins, %d destinations)", ts.zones, ts.origins, ts.destinations);
+        ImGui::Text("Links: %d | trips/h: %.0f", ts.links, ts.totalTrips);
+        ImGui::Text("Iterations: %d | gap: %.4f%s", ts.iterations, ts.relativeGap, tr.converged ? " (converged)" : "");
+        ImGui::Text("Build: %.1f ms | last iteration: %.1f ms", ts.buildMs, ts.iterationMs);
+        if (ImGui::Checkbox("Congestion heatmap", &state.trafficHeatmap)) state.heatmapDirty = true;
+        ImGui::Separator();
+
+        ImGui::Text("Routing (%s times)%s", state.travelIndexUsesTraffic ? "congested" : "free-flow",
+            state.travelBuilder.busy() ? " | rebuilding" : "");
+        ImGui::Text("Nodes: %d | arcs: %d", state.travelIndex.nodeCount(), state.travelIndex.arcCount());
+        ImGui::Text("Order: %.1f ms | customize: %.1f ms", state.travelIndex.buildMs(), state.travelIndex.customizeMs());
+        if (ImGui::Button("Run query benchmark")) {
+            state.travelBench = state.travelIndex.runBenchmark(2000, (uint32_t)SDL_GetTicks());
+            SDL_Log("Routing benchmark: %d queries, %.2f us/query, %.1f ms one-to-all, %d mismatches",
+                state.travelBench.queries, state.travelBench.oneToOneUs, state.travelBench.oneToAllMs, state.travelBench.mismatches);
+        }
+        if (state.travelBench.queries > 0) {
+            const TravelTimeBenchmark& tb = state.travelBench;
+            ImGui::Text("%.2f us/query (%.0f/s) | one-to-all %.2f ms", tb.oneToOneUs, tb.oneToOnePerSec, tb.oneToAllMs);
+            ImGui::Text("Customize %.1f ms | mismatches: %d", tb.customizeMs, tb.mismatches);
+        }
+        ImGui::Separator();
+
+        const CoverageStats& cs = state.coverage.stats();
+        ImGui::Text("Services (7, V cycles type, Del removes)");
+        ImGui::Text("Placing: %s | placed: %d | lots: %d", ServiceTypeName(serviceType), cs.services, cs.lots);
+        ImGui::Text("Last repair: %.2f ms, %d nodes", cs.lastRepairMs, cs.lastTouchedNodes);
+        ImGui::Separator();
+
+        ImGui::Text("Fields");
+        ImGui::Text("Pollution: %d tiles, last %d re-diffused (%.2f ms)", state.pollutionField.stats().tiles,
+            state.pollutionField.stats().lastDiffusedTiles, state.pollutionField.stats().lastUpdateMs);
+        ImGui::Text("Noise: %d tiles | land value: %d tiles", state.noiseField.stats().tiles, state.landValueField.stats().tiles);
+        if (hasHit) {
+            ImGui::Text("At cursor: land %.3f | pollution %.3f | noise %.3f", state.landValueField.sample(mouseHit),
+                state.pollutionField.sample(mouseHit), state.noiseField.sample(mouseHit));
+        }
+        if (hasHit) {
+            ChunkCoord hc = ChunkFromPosXZ(mouseHit);
+            if (const CoverageChunk* cc = state.coverage.chunk(PackChunk(hc.cx, hc.cz))) {
+                ImGui::Text("Chunk land value %.2f | P %.0f%% F %.0f%% H %.0f%% E %.0f%%", cc->landValue,
+                    cc->coverage[0] * 100.0f, cc->coverage[1] * 100.0f, cc->coverage[2] * 100.0f, cc->coverage[3] * 100.0f);
+            }
+        }
+        ImGui::Separator();
+
+        {
+            SimResults sr = state.sim.latest();
+            ImGui::Text("Simulation (day %.1f)", sr.day);
+            static const char* kDemandNames[SIM_ZONE_TYPES] = {"Residential", "Commercial", "Industrial", "Office"};
+            for (int t = 0; t < SIM_ZONE_TYPES; t++) {
+                char label[32];
+                std::snprintf(label, sizeof(label), "%+.2f", sr.demand[t]);
+                ImGui::ProgressBar(0.5f + 0.5f * sr.demand[t], ImVec2(120.0f, 0.0f), label);
+                ImGui::SameLine();
+                ImGui::TextUnformatted(kDemandNames[t]);
+            }
+            ImGui::Text("Population %d | jobs %d | unemployment %.0f%%", sr.population, sr.jobs, sr.unemployment * 100.0f);
+            ImGui::Text("Funds %.0f | income %.0f/day | expenses %.0f/day", sr.funds, sr.incomePerDay, sr.expensesPerDay);
+            ImGui::Text("Tick budget %.1f ms | last %.3f ms | %.1f ticks/s", sr.tickBudgetMs, sr.tickMs, sr.ticksPerSec);
+        }
+        ImGui::Separator();
+
+        {
+            const ChunkStreamerStats& st = state.streamer.stats();
+            ImGui::Text("Streaming: CPU %.1f / %.0f MB | GPU %.1f / %.0f MB", st.cpuBytes / 1048576.0,
+                state.streamer.settings().cpuBudgetBytes / 1048576.0, st.gpuBytes / 1048576.0,
+                state.streamer.settings().gpuBudgetBytes / 1048576.0);
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+                ImGui::Text("  %s: %d resident (%.1f MB), %d evicted", ChunkLayerName((ChunkLayer)l), st.resident[l],
+                    st.residentBytes[l] / 1048576.0, st.evicted[l]);
+            }
+            ImGui::Text("Loads %d | evictions %d | pending %d", st.lastLoads, st.lastEvictions, st.pendingLoads);
+            ImGui::Text("Textures: %.1f MB | roads: %.1f MB | meshes: %.1f MB", renderer.textureMemoryBytes() / 1048576.0,
+                renderer.roadMemoryBytes() / 1048576.0, meshCache.memoryBytes() / 1048576.0);
+            if (renderer.gpuDrivenAvailable()) {
+                bool gpuDriven = renderer.gpuDrivenEnabled();
+                if (ImGui::Checkbox("GPU-driven buildings (compute cull + indirect)", &gpuDriven)) renderer.setGpuDriven(gpuDriven);
+            } else {
+                ImGui::TextDisabled("GPU-driven buildings need GL 4.3 (CPU batches in use)");
+            }
+            ImGui::Text("Shadows: %d/%d cascades redrawn", renderer.shadowCascadesRendered(), Renderer::SHADOW_CASCADES);
+            ImGui::Checkbox("Occlusion culling", &state.occlusionCulling);
+            if (state.occlusionCulling) {
+                int hidden = 0;
+                for (const RenderHouseBatch& b : visibleHouseBatches) hidden += b.camera ? 0 : 1;
+                const OcclusionCuller::Stats& os = state.occlusion.stats();
+                ImGui::Text("  %d occluders | %d of %d clusters hidden", os.occluders, hidden, (int)visibleHouseBatches.size());
+            }
+        }
+        ImGui::Separator();
+
         ImGui::Text("Large-lot debug");
         ImGui::Text("Attempts: %d", state.largeLotDebug.attempts);
         ImGui::Text("Placed: %d", state.largeLotDebug.placed);
@@ -3341,13 +4247,14 @@ int main(int, char**) {
         ImGui::Text("Save/Load (JSON, versioned)");
         ImGui::InputText("File", savePath, sizeof(savePath));
         if (ImGui::Button("Save")) {
-            if (SaveToJsonFile(state, assets, savePath)) statusText = "Saved.";
+            if (SaveCity(state, assets, savePath)) statusText = "Saved.";
             else statusText = "Save failed.";
         }
         ImGui::SameLine();
         if (ImGui::Button("Load")) {
-            if (LoadFromJsonFile(state, savePath)) {
+            if (LoadCity(state, savePath)) {
                 cmds.clear();
+                minimap.dirty = true;
                 statusText = "Loaded.";
             } else statusText = "Load failed.";
         }
@@ -3367,10 +4274,11 @@ int main(int, char**) {
         }
         ImGui::SameLine();
         if (ImGui::Button("Clear Water")) {
+            state.streamer.resetLayer(ChunkLayer::ZoneGrid);
             state.waterChunks.clear();
+            state.waterBaseValid = false;
             state.zonesDirty = true;
             state.housesDirty = true;
-            state.overlayDirty = true;
             minimap.dirty = true;
             statusText = "Water cleared.";
         }
@@ -3385,7 +4293,13 @@ int main(int, char**) {
         ImGui::Separator();
 
         ImGui::Text("Minimap");
-        UpdateMinimapTexture(minimap, state);
+        UpdateMinimapTexture(minimap, state.summaries);
+        {
+            const ChunkSummary& city = state.summaries.root();
+            const float cellHa = ZONE_CELL_M * ZONE_CELL_M / 10000.0f;
+            ImGui::Text("City: %u buildings, %.0f ha zoned, tallest %.0f m",
+                city.buildings, city.totalZoned() * cellHa, city.maxHeight);
+        }
         ImVec2 mapSize(240.0f, 240.0f);
         ImGui::Image((ImTextureID)(intptr_t)minimap.texture, mapSize);
         ImVec2 mapMin = ImGui::GetItemRectMin();
@@ -3402,17 +4316,21 @@ int main(int, char**) {
             return ImVec2(sx, sy);
         };
 
-        for (const auto& r : state.roads) {
-            for (size_t i = 1; i < r.pts.size(); ++i) {
-                ImVec2 p0 = mapToScreen(r.pts[i - 1]);
-                ImVec2 p1 = mapToScreen(r.pts[i]);
-                drawList->AddLine(p0, p1, IM_COL32(220, 220, 220, 160), 1.0f);
-            }
-        }
-
         ImVec2 camPos = mapToScreen(cam.target);
         drawList->AddCircleFilled(camPos, 3.0f, IM_COL32(255, 230, 80, 220));
 
+        if (ImGui::IsItemHovered()) {
+            // Summary of the 4 km square under the cursor, answered from the pyramid.
+            ImVec2 mp = ImGui::GetIO().MousePos;
+            float u = Clamp((mp.x - mapMin.x) / (mapMax.x - mapMin.x), 0.0f, 1.0f);
+            float v = Clamp((mp.y - mapMin.y) / (mapMax.y - mapMin.y), 0.0f, 1.0f);
+            glm::vec2 c((u - 0.5f) * MAP_SIDE_M, (0.5f - v) * MAP_SIDE_M);
+            const float half = 2000.0f;
+            ChunkSummary area = state.summaries.query(c - glm::vec2(half), c + glm::vec2(half));
+            const float cellM2 = ZONE_CELL_M * ZONE_CELL_M;
+            ImGui::SetTooltip("Buildings: %u (tallest %.0f m)\nZoned: %.1f ha\nWater: %.1f km2",
+                area.buildings, area.maxHeight, area.totalZoned() * cellM2 / 10000.0f, area.waterCells * cellM2 / 1e6f);
+        }
         if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
             ImVec2 mp = ImGui::GetIO().MousePos;
             float u = (mp.x - mapMin.x) / (mapMax.x - mapMin.x);
@@ -3422,6 +4340,8 @@ int main(int, char**) {
             cam.target.x = (u - 0.5f) * MAP_SIDE_M;
             cam.target.z = (0.5f - v) * MAP_SIDE_M;
             cam.target.y = 0.0f;
+            prevCamTarget = cam.target; // a jump is not camera motion
+            state.streamer.requestBurst();
             statusText = "Teleported.";
         }
         ImGui::Separator();
@@ -3536,6 +4456,12 @@ int main(int, char**) {
         if (hasHit && mode == Mode::Road) {
             markers.push_back({mouseHit - renderOrigin, glm::vec3(0.95f, 0.25f, 0.25f), 0.9f});
         }
+        for (const auto& sv : state.coverage.services()) {
+            static const glm::vec3 serviceColors[SERVICE_TYPE_COUNT] = {
+                {0.2f, 0.35f, 0.95f}, {0.95f, 0.3f, 0.15f}, {0.95f, 0.95f, 0.95f}, {0.95f, 0.8f, 0.2f}
+            };
+            markers.push_back({sv.pos - renderOrigin, serviceColors[(int)sv.type], 1.6f});
+        }
         if (hasHit && mode == Mode::Zone && !zoneTool.hoverValid) {
             markers.push_back({mouseHit - renderOrigin, glm::vec3(0.95f, 0.25f, 0.25f), 0.9f});
         }
@@ -3547,33 +4473,30 @@ int main(int, char**) {
             }
         }
 
-        // Shifted road mesh for rendering
-        std::vector<RoadVertex> roadRenderVerts;
-        roadRenderVerts.reserve(state.roadMeshVerts.size());
-        for (const auto& v : state.roadMeshVerts) {
-            RoadVertex rv = v;
-            rv.pos -= renderOrigin;
-            roadRenderVerts.push_back(rv);
+        // Roads: only chunks whose segments changed are re-sent; the origin shift is a uniform.
+        for (uint64_t key : state.dirtyRoadChunks) {
+            auto it = state.roadSegmentsByChunk.find(key);
+            renderer.updateRoadChunk(key, it != state.roadSegmentsByChunk.end() ? it->second : std::vector<RoadSegmentGPU>{});
         }
-        renderer.updateRoadMesh(roadRenderVerts);
+        state.dirtyRoadChunks.clear();
 
         RenderFrame frame;
         frame.viewProj = viewProj;
         frame.viewProjSky = viewProjSky;
-        frame.lightViewProj = lightViewProj;
         frame.cameraPos = eye;
         frame.cameraTarget = tgt;
         frame.lighting = lighting;
-        frame.roadVertexCount = roadRenderVerts.size();
+        frame.shadowCenter = tgt;
+        frame.shadowRadius = shadowRadius;
+        frame.shadowDirtyRects = std::move(shadowDirtyRects);
+        frame.renderOrigin = renderOrigin;
         frame.waterVertexCount = waterVerts.size();
-        frame.gridVertexCount = gridCount;
-        frame.zoneResidentialVertexCount = resCount;
-        frame.zoneCommercialVertexCount = comCount;
-        frame.zoneIndustrialVertexCount = indCount;
-        frame.zoneOfficeVertexCount = officeCount;
+        frame.zoneChunks = std::move(zoneDraws);
+        frame.showBuildable = showGrid;
         frame.previewVertexCount = previewCount;
         frame.visibleHouseBatches = std::move(visibleHouseBatches);
-        frame.houseAnimCount = animInstances.size();
+        frame.timeSec = nowSec;
+        frame.roadHeatmap = state.trafficHeatmap;
         frame.drawRoadPreview = (mode == Mode::Road && roadTool.drawing && !state.zonePreviewVerts.empty());
         frame.zonePreviewValid = zoneTool.dragging ? true : zoneTool.hoverValid;
         frame.zonePreviewType = (uint8_t)zoneTool.type;
@@ -3586,6 +4509,9 @@ int main(int, char**) {
     }
 
     // Cleanup
+    state.sim.stop();
+    state.travelBuilder.stop();
+    state.traffic.stop();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,445 @@
+#include "mesh_archive.h"
+
+#include "file_stamp.h"
+#include "hash.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+#define CGLTF_IMPLEMENTATION
+#include "cgltf.h"
+
+namespace {
+
+constexpr uint32_t ARCHIVE_MAGIC = 0x48534d43; // "CMSH"
+constexpr uint32_t ARCHIVE_VERSION = 4; // 2: meshes are optimized before packing, 3: LODs, 4: measured LOD error
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t sourceCount;
+    uint64_t sourcesOffset;
+    uint64_t sourcesSize;
+    uint64_t tableOffset;
+    uint64_t vertexOffset;
+    uint64_t vertexSize;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+};
+
+void AlignTo(std::vector<uint8_t>& bytes, std::size_t align) {
+    bytes.resize((bytes.size() + align - 1) / align * align, 0);
+}
+
+template <typename T>
+void Put(std::vector<uint8_t>& bytes, const T& v) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+    bytes.insert(bytes.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+bool Get(const uint8_t*& p, const uint8_t* end, T& v) {
+    if ((std::size_t)(end - p) < sizeof(T)) return false;
+    std::memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+// Smooth normals for meshes that ship without them.
+void GenerateNormals(ImportedMesh& mesh) {
+    std::vector<glm::vec3>& normals = mesh.normals;
+    normals.assign(mesh.positions.size(), glm::vec3(0.0f));
+    for (std::size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+        uint32_t i0 = mesh.indices[t + 0];
+        uint32_t i1 = mesh.indices[t + 1];
+        uint32_t i2 = mesh.indices[t + 2];
+        glm::vec3 n = glm::cross(mesh.positions[i1] - mesh.positions[i0], mesh.positions[i2] - mesh.positions[i0]);
+        float len = glm::length(n);
+        if (len > 1e-6f) {
+            n /= len;
+            normals[i0] += n;
+            normals[i1] += n;
+            normals[i2] += n;
+        }
+    }
+    for (glm::vec3& n : normals) {
+        float len = glm::length(n);
+        n = (len > 1e-6f) ? n / len : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+}
+
+int16_t PackSnorm(float v) {
+    return (int16_t)std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+// Octahedral mapping: the unit sphere folded onto the [-1, 1] square.
+void PackNormal(glm::vec3 n, int16_t out[2]) {
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    n = l1 > 1e-12f ? n / l1 : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f) {
+        e = glm::vec2((1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    out[0] = PackSnorm(e.x);
+    out[1] = PackSnorm(e.y);
+}
+
+} // namespace
+
+bool ImportGltfMesh(const std::string& path, ImportedMesh& out) {
+    out = ImportedMesh{};
+    cgltf_options options{};
+    cgltf_data* data = nullptr;
+
+    cgltf_result result = cgltf_parse_file(&options, path.c_str(), &data);
+    if (result != cgltf_result_success) {
+        SDL_Log("MeshArchive: cgltf_parse_file failed: %s", path.c_str());
+        return false;
+    }
+    out.files.push_back(path);
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    for (cgltf_size i = 0; i < data->buffers_count; i++) {
+        const char* uri = data->buffers[i].uri;
+        if (uri && std::strncmp(uri, "data:", 5) != 0) out.files.push_back((dir / uri).string());
+    }
+
+    result = cgltf_load_buffers(&options, data, path.c_str());
+    if (result != cgltf_result_success) {
+        SDL_Log("MeshArchive: cgltf_load_buffers failed: %s", path.c_str());
+        cgltf_free(data);
+        return false;
+    }
+
+    if (data->meshes_count == 0 || data->meshes == nullptr ||
+        data->meshes[0].primitives_count == 0 || data->meshes[0].primitives == nullptr) {
+        SDL_Log("MeshArchive: no mesh primitives in %s", path.c_str());
+        cgltf_free(data);
+        return false;
+    }
+
+    const cgltf_primitive* prim = &data->meshes[0].primitives[0];
+    const cgltf_accessor* posAcc = nullptr;
+    const cgltf_accessor* normAcc = nullptr;
+    for (cgltf_size i = 0; i < prim->attributes_count; i++) {
+        const cgltf_attribute& attr = prim->attributes[i];
+        if (attr.type == cgltf_attribute_type_position) {
+            posAcc = attr.data;
+        } else if (attr.type == cgltf_attribute_type_normal) {
+            normAcc = attr.data;
+        }
+    }
+
+    if (!posAcc || posAcc->type != cgltf_type_vec3) {
+        SDL_Log("MeshArchive: missing POSITION attribute in %s", path.c_str());
+        cgltf_free(data);
+        return false;
+    }
+
+    const std::size_t vertCount = posAcc->count;
+    out.positions.resize(vertCount);
+    for (std::size_t i = 0; i < vertCount; i++) {
+        float v[3] = {0.0f, 0.0f, 0.0f};
+        cgltf_accessor_read_float(posAcc, i, v, 3);
+        out.positions[i] = glm::vec3(v[0], v[1], v[2]);
+    }
+
+    // Everything is drawn indexed; triangle soups get an identity list.
+    if (prim->indices) {
+        out.indices.resize(prim->indices->count - prim->indices->count % 3);
+        for (std::size_t i = 0; i < out.indices.size(); i++) {
+            out.indices[i] = (uint32_t)cgltf_accessor_read_index(prim->indices, i);
+        }
+    } else {
+        out.indices.resize(vertCount - vertCount % 3);
+        for (std::size_t i = 0; i < out.indices.size(); i++) out.indices[i] = (uint32_t)i;
+    }
+    for (uint32_t idx : out.indices) {
+        if (idx >= vertCount) {
+            SDL_Log("MeshArchive: index out of range in %s", path.c_str());
+            cgltf_free(data);
+            return false;
+        }
+    }
+
+    if (normAcc && normAcc->type == cgltf_type_vec3 && normAcc->count == vertCount) {
+        out.normals.resize(vertCount);
+        for (std::size_t i = 0; i < vertCount; i++) {
+            float v[3] = {0.0f, 1.0f, 0.0f};
+            cgltf_accessor_read_float(normAcc, i, v, 3);
+            out.normals[i] = glm::vec3(v[0], v[1], v[2]);
+        }
+    } else {
+        GenerateNormals(out);
+    }
+
+    cgltf_free(data);
+    if (out.indices.empty()) {
+        SDL_Log("MeshArchive: empty mesh in %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void PackMesh(const ImportedMesh& mesh, uint16_t slot, PackedMesh& out) {
+    out = PackedMesh{};
+    glm::vec3 bmin(1e30f), bmax(-1e30f);
+    float radius2 = 0.0f;
+    for (const glm::vec3& p : mesh.positions) {
+        bmin = glm::min(bmin, p);
+        bmax = glm::max(bmax, p);
+        radius2 = std::max(radius2, glm::dot(p, p));
+    }
+    out.boundsMin = bmin;
+    out.boundsMax = bmax;
+    out.radius = std::sqrt(radius2);
+
+    // Steps span exactly the bounds, so decoded positions never leave them.
+    glm::vec3 extent = glm::max(bmax - bmin, glm::vec3(1e-6f));
+    out.vertices.resize(mesh.positions.size());
+    for (std::size_t i = 0; i < mesh.positions.size(); i++) {
+        glm::vec3 q = glm::clamp((mesh.positions[i] - bmin) / extent, 0.0f, 1.0f) * 65535.0f;
+        PackedVertex& v = out.vertices[i];
+        v.pos[0] = (uint16_t)std::lround(q.x);
+        v.pos[1] = (uint16_t)std::lround(q.y);
+        v.pos[2] = (uint16_t)std::lround(q.z);
+        v.pos[3] = slot;
+        PackNormal(mesh.normals[i], v.normal);
+    }
+
+    out.indexCount = (uint32_t)mesh.indices.size();
+    out.index16 = mesh.positions.size() <= 65536;
+    auto append = [&out](const std::vector<uint32_t>& indices) {
+        AlignTo(out.indices, 4);
+        std::size_t offset = out.indices.size();
+        if (out.index16) {
+            out.indices.resize(offset + indices.size() * sizeof(uint16_t));
+            uint16_t* dst = reinterpret_cast<uint16_t*>(out.indices.data() + offset);
+            for (std::size_t i = 0; i < indices.size(); i++) dst[i] = (uint16_t)indices[i];
+        } else {
+            out.indices.resize(offset + indices.size() * sizeof(uint32_t));
+            std::memcpy(out.indices.data() + offset, indices.data(), indices.size() * sizeof(uint32_t));
+        }
+        return (uint32_t)offset;
+    };
+    append(mesh.indices);
+    for (const ImportedMesh::Level& level : mesh.lods) {
+        PackedMesh::Level packed;
+        packed.indexOffset = append(level.indices);
+        packed.indexCount = (uint32_t)level.indices.size();
+        packed.error = level.error;
+        out.lods.push_back(packed);
+    }
+}
+
+uint32_t MeshArchive::LodKey(const std::vector<LodSetting>& settings) {
+    return Fnv1a32(settings.data(), settings.size() * sizeof(LodSetting)) ^ (uint32_t)settings.size();
+}
+
+bool MeshArchive::build(const AssetCatalog& catalog, const std::string& path) {
+    // Id order keeps the archive byte-identical for the same sources.
+    std::vector<const AssetDef*> defs;
+    for (const auto& kv : catalog.assets()) {
+        if (!kv.second.meshRelPath.empty()) defs.push_back(&kv.second);
+    }
+    std::sort(defs.begin(), defs.end(), [](const AssetDef* a, const AssetDef* b) { return a->idStr < b->idStr; });
+    if (defs.size() >= 65535) {
+        SDL_Log("MeshArchive: %d meshes exceed the 16-bit bounds slot", (int)defs.size());
+        return false;
+    }
+
+    std::vector<std::string> sources;
+    std::vector<Entry> entries;
+    std::vector<uint8_t> vertexBlob;
+    std::vector<uint8_t> indexBlob;
+    uint32_t vertexTotal = 0;
+    double missesBefore = 0.0, missesAfter = 0.0, triangles = 0.0;
+    ImportedMesh imported;
+    PackedMesh packed;
+    for (std::size_t i = 0; i < defs.size(); i++) {
+        Entry e;
+        e.asset = defs[i]->id;
+        e.source = (uint32_t)sources.size();
+        e.lodKey = LodKey(defs[i]->lods);
+        std::string meshPath = JoinPath(catalog.root(), defs[i]->meshRelPath);
+        if (!ImportGltfMesh(meshPath, imported)) {
+            // Recorded as failed so the archive is not rebuilt on every start.
+            sources.push_back(meshPath);
+            entries.push_back(e);
+            continue;
+        }
+        sources.insert(sources.end(), imported.files.begin(), imported.files.end());
+        MeshOptimizeReport report = OptimizeMesh(imported);
+        double tris = (double)(imported.indices.size() / 3);
+        SDL_Log("MeshArchive: %s: %d tris, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %d -> %d verts", defs[i]->idStr.c_str(),
+            (int)tris, report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr,
+            (int)report.verticesBefore, (int)report.verticesAfter);
+        missesBefore += report.before.acmr * tris;
+        missesAfter += report.after.acmr * tris;
+        triangles += tris;
+        BuildLods(imported, defs[i]->lods);
+        for (const ImportedMesh::Level& level : imported.lods) {
+            SDL_Log("MeshArchive: %s: LOD %d tris, error %.4f", defs[i]->idStr.c_str(),
+                (int)(level.indices.size() / 3), level.error);
+        }
+        PackMesh(imported, (uint16_t)(i + 1), packed);
+        e.firstVertex = vertexTotal;
+        e.vertexCount = (uint32_t)packed.vertices.size();
+        e.indexOffset = (uint32_t)indexBlob.size();
+        e.indexCount = packed.indexCount;
+        e.index16 = packed.index16 ? 1u : 0u;
+        e.radius = packed.radius;
+        e.boundsMin = packed.boundsMin;
+        e.boundsMax = packed.boundsMax;
+        e.lodCount = (uint32_t)std::min<std::size_t>(packed.lods.size(), MESH_LOD_LEVELS);
+        for (uint32_t l = 0; l < e.lodCount; l++) {
+            e.lods[l] = packed.lods[l];
+            e.lods[l].indexOffset += e.indexOffset;
+        }
+        const uint8_t* v = reinterpret_cast<const uint8_t*>(packed.vertices.data());
+        vertexBlob.insert(vertexBlob.end(), v, v + packed.vertices.size() * sizeof(PackedVertex));
+        indexBlob.insert(indexBlob.end(), packed.indices.begin(), packed.indices.end());
+        AlignTo(indexBlob, 4);
+        vertexTotal += e.vertexCount;
+        entries.push_back(e);
+    }
+
+    std::vector<uint8_t> bytes(sizeof(ArchiveHeader), 0);
+    ArchiveHeader header{};
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_VERSION;
+    header.meshCount = (uint32_t)entries.size();
+    header.sourceCount = (uint32_t)sources.size();
+    header.sourcesOffset = bytes.size();
+    for (const std::string& s : sources) {
+        FileStamp stamp = StampFile(s);
+        Put(bytes, (uint32_t)s.size());
+        bytes.insert(bytes.end(), s.begin(), s.end());
+        Put(bytes, stamp.mtime);
+        Put(bytes, stamp.size);
+    }
+    header.sourcesSize = bytes.size() - header.sourcesOffset;
+    AlignTo(bytes, 16);
+    header.tableOffset = bytes.size();
+    for (const Entry& e : entries) Put(bytes, e);
+    AlignTo(bytes, 16);
+    header.vertexOffset = bytes.size();
+    header.vertexSize = vertexBlob.size();
+    bytes.insert(bytes.end(), vertexBlob.begin(), vertexBlob.end());
+    AlignTo(bytes, 16);
+    header.indexOffset = bytes.size();
+    header.indexSize = indexBlob.size();
+    bytes.insert(bytes.end(), indexBlob.begin(), indexBlob.end());
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    std::error_code ec;
+    std::filesystem::path target(path);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), ec);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(bytes.data()), (std::streamsize)bytes.size());
+        if (!out) {
+            SDL_Log("MeshArchive: could not write %s", tmp.c_str());
+            return false;
+        }
+    }
+    std::filesystem::rename(tmp, target, ec);
+    if (ec) {
+        SDL_Log("MeshArchive: could not write %s (%s)", path.c_str(), ec.message().c_str());
+        return false;
+    }
+    SDL_Log("MeshArchive: %d meshes, %u vertices, %.2f MB, ACMR %.3f -> %.3f -> %s", (int)entries.size(), vertexTotal,
+        bytes.size() / 1048576.0, triangles > 0.0 ? missesBefore / triangles : 0.0,
+        triangles > 0.0 ? missesAfter / triangles : 0.0, path.c_str());
+    return true;
+}
+
+bool MeshArchive::open(const std::string& path, const AssetCatalog& catalog) {
+    close();
+    if (!file.open(path)) return false;
+    if (!parse(catalog)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MeshArchive::parse(const AssetCatalog& catalog) {
+    const uint8_t* base = file.data();
+    const std::size_t size = file.size();
+    ArchiveHeader header{};
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, base, sizeof(header));
+    if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION) return false;
+    auto inside = [size](uint64_t offset, uint64_t bytes) { return offset <= size && bytes <= size - offset; };
+    if (!inside(header.sourcesOffset, header.sourcesSize) ||
+        !inside(header.tableOffset, (uint64_t)header.meshCount * sizeof(Entry)) ||
+        !inside(header.vertexOffset, header.vertexSize) || !inside(header.indexOffset, header.indexSize)) {
+        return false;
+    }
+
+    std::vector<std::string> sources;
+    const uint8_t* p = base + header.sourcesOffset;
+    const uint8_t* end = p + header.sourcesSize;
+    for (uint32_t i = 0; i < header.sourceCount; i++) {
+        uint32_t len = 0;
+        FileStamp stamp;
+        if (!Get(p, end, len) || (std::size_t)(end - p) < len) return false;
+        std::string s(reinterpret_cast<const char*>(p), len);
+        p += len;
+        if (!Get(p, end, stamp.mtime) || !Get(p, end, stamp.size)) return false;
+        if (StampFile(s) != stamp) return false;
+        sources.push_back(std::move(s));
+    }
+
+    table.resize(header.meshCount);
+    std::memcpy(table.data(), base + header.tableOffset, (std::size_t)header.meshCount * sizeof(Entry));
+    std::unordered_map<AssetId, const Entry*> byAsset;
+    for (const Entry& e : table) {
+        std::size_t indexSize = e.index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        if (e.source >= sources.size() ||
+            (uint64_t)e.firstVertex + e.vertexCount > header.vertexSize / sizeof(PackedVertex) ||
+            (uint64_t)e.indexOffset + (uint64_t)e.indexCount * indexSize > header.indexSize ||
+            e.lodCount > MESH_LOD_LEVELS) {
+            return false;
+        }
+        for (uint32_t l = 0; l < e.lodCount; l++) {
+            if ((uint64_t)e.lods[l].indexOffset + (uint64_t)e.lods[l].indexCount * indexSize > header.indexSize) return false;
+        }
+        byAsset[e.asset] = &e;
+    }
+
+    // Same meshes as the catalog, read from the same paths with the same LOD settings.
+    std::size_t meshes = 0;
+    for (const auto& kv : catalog.assets()) {
+        if (kv.second.meshRelPath.empty()) continue;
+        meshes++;
+        auto it = byAsset.find(kv.first);
+        if (it == byAsset.end() || sources[it->second->source] != JoinPath(catalog.root(), kv.second.meshRelPath) ||
+            it->second->lodKey != LodKey(kv.second.lods)) {
+            return false;
+        }
+    }
+    if (meshes != table.size()) return false;
+
+    vertexOffset = (std::size_t)header.vertexOffset;
+    vertexSize = (std::size_t)header.vertexSize;
+    indexOffset = (std::size_t)header.indexOffset;
+    indexSize = (std::size_t)header.indexSize;
+    return true;
+}
+
+void MeshArchive::close() {
+    file.close();
+    table.clear();
+    vertexOffset = vertexSize = indexOffset = indexSize = 0;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "asset_catalog.h"
+#include "mapped_file.h"
+
+// 12-byte building vertex. Positions are 16-bit steps across the mesh bounds;
+// pos[3] is the mesh's slot in MeshCache's bounds buffer, which the vertex
+// shader uses to dequantize. Normals are octahedral, two snorm16.
+struct PackedVertex {
+    uint16_t pos[4];
+    int16_t normal[2];
+};
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex layout");
+
+// Simplified levels kept past the full mesh.
+constexpr int MESH_LOD_LEVELS = 3;
+
+// A glTF mesh as imported, before quantization.
+struct ImportedMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<uint32_t> indices;   // always a triangle list
+    std::vector<std::string> files;  // the glTF and its external buffers
+
+    // Simplified levels over the same vertices, coarsest last.
+    struct Level {
+        std::vector<uint32_t> indices;
+        float error = 0.0f; // mesh units
+    };
+    std::vector<Level> lods;
+};
+
+// A mesh ready for the shared buffers. Indices are 16-bit when the vertex count
+// allows, 32-bit otherwise; LOD index lists follow the full mesh's, 4-aligned.
+struct PackedMesh {
+    struct Level {
+        uint32_t indexOffset = 0; // bytes into indices
+        uint32_t indexCount = 0;
+        float error = 0.0f;
+    };
+    std::vector<PackedVertex> vertices;
+    std::vector<uint8_t> indices;
+    uint32_t indexCount = 0;
+    bool index16 = false;
+    std::vector<Level> lods;
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+    float radius = 0.0f; // bounding sphere about the model origin
+};
+
+bool ImportGltfMesh(const std::string& path, ImportedMesh& out);
+void PackMesh(const ImportedMesh& mesh, uint16_t slot, PackedMesh& out);
+
+// Every catalog mesh imported, packed and concatenated into one file: a mesh
+// table, then one vertex blob and one index blob that are uploaded as they lie
+// in the mapping. Mesh i is packed for bounds slot i + 1 (slot 0 is the
+// fallback cube). The archive records the stamps of every glTF it read and is
+// stale as soon as one changes or the catalog's meshes or LOD settings differ.
+class MeshArchive {
+public:
+    struct Entry {
+        AssetId asset = 0;
+        uint32_t firstVertex = 0; // into the vertex blob
+        uint32_t vertexCount = 0; // 0 when the import failed
+        uint32_t indexOffset = 0; // bytes into the index blob, 4-aligned
+        uint32_t indexCount = 0;
+        uint32_t index16 = 0;
+        uint32_t source = 0;      // mesh path in the source list
+        float radius = 0.0f;
+        glm::vec3 boundsMin{0.0f};
+        glm::vec3 boundsMax{0.0f};
+        uint32_t lodKey = 0;      // hash of the LOD settings the levels were built with
+        uint32_t lodCount = 0;
+        PackedMesh::Level lods[MESH_LOD_LEVELS];
+    };
+
+    static uint32_t LodKey(const std::vector<LodSetting>& settings);
+
+    // The import step; reads every glTF in the catalog.
+    static bool build(const AssetCatalog& catalog, const std::string& path);
+
+    // False when the file is missing, malformed or stale for `catalog`.
+    bool open(const std::string& path, const AssetCatalog& catalog);
+    void close();
+
+    const std::vector<Entry>& entries() const { return table; }
+    const uint8_t* vertexData() const { return file.data() + vertexOffset; }
+    std::size_t vertexBytes() const { return vertexSize; }
+    const uint8_t* indexData() const { return file.data() + indexOffset; }
+    std::size_t indexBytes() const { return indexSize; }
+
+private:
+    bool parse(const AssetCatalog& catalog);
+
+    MappedFile file;
+    std::vector<Entry> table;
+    std::size_t vertexOffset = 0;
+    std::size_t vertexSize = 0;
+    std::size_t indexOffset = 0;
+    std::size_t indexSize = 0;
+};
@@ -1,43 +1,208 @@
 #include "mesh_cache.h"
 
+#include "file_stamp.h"
+#include "mesh_optimizer.h"
+
 #include <SDL.h>
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <vector>
 
-#define CGLTF_IMPLEMENTATION
-#include "cgltf.h"
-
 namespace {
 
-std::string JoinPath(const std::string& root, const std::string& rel) {
-    if (root.empty()) return rel;
-    std::filesystem::path full = std::filesystem::path(root) / rel;
-    return full.string();
+constexpr std::size_t INITIAL_VERTEX_CAP = 1 << 16;
+constexpr std::size_t INITIAL_INDEX_BYTES = 1 << 19;
+
+// Geometric error allowed per metre of camera distance when switching to a
+// simplified level: about 1.4 px at 1080p with a 60 degree field of view.
+constexpr float LOD_ERROR_PER_M = 0.0015f;
+
+// Level error (how far any full-mesh vertex lies from the level's surface, mesh
+// units) to switch distance, for instances at the asset's default scale.
+float LodDistance(float error, const glm::vec3& scale) {
+    float s = std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+    return error * s / LOD_ERROR_PER_M;
 }
 
-struct VertexPN {
-    glm::vec3 pos;
-    glm::vec3 normal;
-};
+// Reallocates `buffer` to `newBytes`, keeping its first `usedBytes`.
+void GrowBuffer(GLuint& buffer, std::size_t usedBytes, std::size_t newBytes) {
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newBytes, nullptr, GL_STATIC_DRAW);
+    if (buffer && usedBytes > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)usedBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (buffer) glDeleteBuffers(1, &buffer);
+    buffer = grown;
+}
 
 } // namespace
 
-bool MeshCache::init() {
-    buildFallbackCube();
-    return fallback.vbo != 0;
-}
+bool MeshCache::init(const AssetCatalog& catalog, const std::string& archivePath) {
+    glGenBuffers(1, &boundsBuf);
+    glGenTextures(1, &boundsTex);
+    glBindBuffer(GL_TEXTURE_BUFFER, boundsBuf);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4) * 2, nullptr, GL_STATIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, boundsTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, boundsBuf);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
 
-void MeshCache::destroyMesh(MeshGpu& mesh) {
-    if (mesh.vbo) glDeleteBuffers(1, &mesh.vbo);
-    if (mesh.ebo) glDeleteBuffers(1, &mesh.ebo);
-    mesh = MeshGpu{};
+    buildFallbackCube();
+    if (!archivePath.empty()) {
+        MeshArchive archive;
+        if (!archive.open(archivePath, catalog)) {
+            SDL_Log("MeshCache: %s missing or stale, rebuilding", archivePath.c_str());
+            if (MeshArchive::build(catalog, archivePath) && !archive.open(archivePath, catalog)) {
+                SDL_Log("MeshCache: could not open %s; importing meshes on demand", archivePath.c_str());
+            }
+        }
+        uploadArchive(archive, catalog);
+    }
+    uploadBounds();
+    return vbo != 0 && fallback.indexCount > 0;
 }
 
 void MeshCache::shutdown() {
-    for (auto& kv : loaded) destroyMesh(kv.second);
     loaded.clear();
     failed.clear();
-    destroyMesh(fallback);
+    fallback = MeshGpu{};
+    if (vbo) glDeleteBuffers(1, &vbo);
+    if (ebo) glDeleteBuffers(1, &ebo);
+    if (boundsBuf) glDeleteBuffers(1, &boundsBuf);
+    if (boundsTex) glDeleteTextures(1, &boundsTex);
+    vbo = ebo = boundsBuf = boundsTex = 0;
+    vertexCap = vertexUsed = indexCap = indexUsed = 0;
+    boundsTexels.clear();
+    nextSlot = 1;
+    archiveMeshes = 0;
+}
+
+GLsizei MeshCache::vertexStride() {
+    return (GLsizei)sizeof(PackedVertex);
+}
+
+std::size_t MeshCache::memoryBytes() const {
+    return vertexCap * sizeof(PackedVertex) + indexCap + boundsTexels.size() * sizeof(glm::vec4);
+}
+
+bool MeshCache::reserve(std::size_t vertexCount, std::size_t indexBytes) {
+    if (vertexUsed + vertexCount > vertexCap) {
+        std::size_t cap = vertexCap ? vertexCap : INITIAL_VERTEX_CAP;
+        while (cap < vertexUsed + vertexCount) cap *= 2;
+        GrowBuffer(vbo, vertexUsed * sizeof(PackedVertex), cap * sizeof(PackedVertex));
+        vertexCap = cap;
+    }
+    if (indexUsed + indexBytes > indexCap) {
+        std::size_t cap = indexCap ? indexCap : INITIAL_INDEX_BYTES;
+        while (cap < indexUsed + indexBytes) cap *= 2;
+        GrowBuffer(ebo, indexUsed, cap);
+        indexCap = cap;
+    }
+    return vbo != 0 && ebo != 0;
+}
+
+bool MeshCache::appendMesh(const PackedMesh& mesh, const glm::vec3& scale, MeshGpu& out) {
+    if (mesh.vertices.empty() || mesh.indexCount == 0) return false;
+    if (!reserve(mesh.vertices.size(), mesh.indices.size())) return false;
+
+    // Upload through the copy targets so no VAO's element binding is disturbed.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(vertexUsed * sizeof(PackedVertex)),
+        (GLsizeiptr)(mesh.vertices.size() * sizeof(PackedVertex)), mesh.vertices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)indexUsed, (GLsizeiptr)mesh.indices.size(), mesh.indices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    out.radius = mesh.radius;
+    out.boundsMin = mesh.boundsMin;
+    out.boundsMax = mesh.boundsMax;
+    out.baseVertex = (GLint)vertexUsed;
+    out.indexType = mesh.index16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    out.firstIndex = (GLuint)(indexUsed / (mesh.index16 ? sizeof(uint16_t) : sizeof(uint32_t)));
+    out.vertexCount = (GLsizei)mesh.vertices.size();
+    out.indexCount = (GLsizei)mesh.indexCount;
+    out.lodCount = 0;
+    float distance = 0.0f;
+    for (const PackedMesh::Level& level : mesh.lods) {
+        if (out.lodCount == MESH_LOD_LEVELS) break;
+        MeshLod& lod = out.lods[out.lodCount++];
+        lod.firstIndex = (GLuint)((indexUsed + level.indexOffset) / (mesh.index16 ? sizeof(uint16_t) : sizeof(uint32_t)));
+        lod.indexCount = (GLsizei)level.indexCount;
+        distance = std::max(distance, LodDistance(level.error, scale));
+        lod.distance = distance;
+    }
+    vertexUsed += mesh.vertices.size();
+    indexUsed = (indexUsed + mesh.indices.size() + 3) & ~(std::size_t)3;
+    return true;
+}
+
+void MeshCache::uploadArchive(const MeshArchive& archive, const AssetCatalog& catalog) {
+    const auto& entries = archive.entries();
+    if (entries.empty()) return;
+    std::size_t vertexCount = archive.vertexBytes() / sizeof(PackedVertex);
+    if (!reserve(vertexCount, archive.indexBytes())) return;
+
+    // Straight from the mapping into the GL buffers; nothing is staged on the heap.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(vertexUsed * sizeof(PackedVertex)),
+        (GLsizeiptr)archive.vertexBytes(), archive.vertexData());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)indexUsed, (GLsizeiptr)archive.indexBytes(), archive.indexData());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    for (std::size_t i = 0; i < entries.size(); i++) {
+        const MeshArchive::Entry& e = entries[i];
+        if (e.vertexCount == 0) {
+            failed.insert(e.asset);
+            continue;
+        }
+        std::size_t indexSize = e.index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        MeshGpu mesh;
+        mesh.baseVertex = (GLint)(vertexUsed + e.firstVertex);
+        mesh.indexType = e.index16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        mesh.firstIndex = (GLuint)((indexUsed + e.indexOffset) / indexSize);
+        mesh.vertexCount = (GLsizei)e.vertexCount;
+        mesh.indexCount = (GLsizei)e.indexCount;
+        mesh.radius = e.radius;
+        mesh.boundsMin = e.boundsMin;
+        mesh.boundsMax = e.boundsMax;
+        glm::vec3 scale = catalog.traitsOf(e.asset).defaultScale;
+        float distance = 0.0f;
+        for (uint32_t l = 0; l < e.lodCount; l++) {
+            MeshLod& lod = mesh.lods[mesh.lodCount++];
+            lod.firstIndex = (GLuint)((indexUsed + e.lods[l].indexOffset) / indexSize);
+            lod.indexCount = (GLsizei)e.lods[l].indexCount;
+            distance = std::max(distance, LodDistance(e.lods[l].error, scale));
+            lod.distance = distance;
+        }
+        loaded.emplace(e.asset, mesh);
+        setBounds((uint32_t)i + 1, e.boundsMin, e.boundsMax);
+        archiveMeshes++;
+    }
+    vertexUsed += vertexCount;
+    indexUsed = (indexUsed + archive.indexBytes() + 3) & ~(std::size_t)3;
+    nextSlot = (uint32_t)entries.size() + 1;
+}
+
+void MeshCache::setBounds(uint32_t slot, const glm::vec3& bmin, const glm::vec3& bmax) {
+    if (boundsTexels.size() < (slot + 1) * 2) boundsTexels.resize((slot + 1) * 2, glm::vec4(0.0f));
+    // Same step PackMesh quantized with.
+    glm::vec3 extent = glm::max(bmax - bmin, glm::vec3(1e-6f));
+    boundsTexels[slot * 2 + 0] = glm::vec4(bmin, 0.0f);
+    boundsTexels[slot * 2 + 1] = glm::vec4(extent / 65535.0f, 0.0f);
+}
+
+void MeshCache::uploadBounds() {
+    if (!boundsBuf || boundsTexels.empty()) return;
+    glBindBuffer(GL_TEXTURE_BUFFER, boundsBuf);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)(boundsTexels.size() * sizeof(glm::vec4)), boundsTexels.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
 }
 
 const MeshGpu& MeshCache::getOrLoad(AssetId assetId, const AssetCatalog& catalog) {
@@ -60,158 +225,29 @@ const MeshGpu& MeshCache::getOrLoad(AssetId assetId, const AssetCatalog& catalog
 }
 
 bool MeshCache::loadMeshForAsset(AssetId assetId, const AssetDef& def, const std::string& root) {
+    // Not in the archive: imported and packed here, into a slot of its own. This
+    // runs on the render thread, so it skips the simplifier and draws the full
+    // mesh at every distance; the next archive build adds its LODs.
+    if (nextSlot > UINT16_MAX) return false;
+    ImportedMesh imported;
+    if (!ImportGltfMesh(JoinPath(root, def.meshRelPath), imported)) return false;
+    OptimizeMesh(imported);
+    PackedMesh packed;
+    PackMesh(imported, (uint16_t)nextSlot, packed);
     MeshGpu mesh;
-    std::string path = JoinPath(root, def.meshRelPath);
-    if (!loadGltfMesh(path, mesh)) return false;
+    if (!appendMesh(packed, def.defaultScale, mesh)) return false;
+    setBounds(nextSlot++, packed.boundsMin, packed.boundsMax);
+    uploadBounds();
     loaded.emplace(assetId, mesh);
     return true;
 }
 
-bool MeshCache::loadGltfMesh(const std::string& path, MeshGpu& out) {
-    cgltf_options options{};
-    cgltf_data* data = nullptr;
-
-    cgltf_result result = cgltf_parse_file(&options, path.c_str(), &data);
-    if (result != cgltf_result_success) {
-        SDL_Log("MeshCache: cgltf_parse_file failed: %s", path.c_str());
-        return false;
-    }
-
-    result = cgltf_load_buffers(&options, data, path.c_str());
-    if (result != cgltf_result_success) {
-        SDL_Log("MeshCache: cgltf_load_buffers failed: %s", path.c_str());
-        cgltf_free(data);
-        return false;
-    }
-
-    if (data->meshes_count == 0 || data->meshes == nullptr) {
-        SDL_Log("MeshCache: no meshes in %s", path.c_str());
-        cgltf_free(data);
-        return false;
-    }
-
-    const cgltf_mesh* mesh = &data->meshes[0];
-    if (mesh->primitives_count == 0 || mesh->primitives == nullptr) {
-        SDL_Log("MeshCache: no primitives in %s", path.c_str());
-        cgltf_free(data);
-        return false;
-    }
-
-    const cgltf_primitive* prim = &mesh->primitives[0];
-    const cgltf_accessor* posAcc = nullptr;
-    const cgltf_accessor* normAcc = nullptr;
-    for (size_t i = 0; i < prim->attributes_count; i++) {
-        const cgltf_attribute& attr = prim->attributes[i];
-        if (attr.type == cgltf_attribute_type_position) {
-            posAcc = attr.data;
-        } else if (attr.type == cgltf_attribute_type_normal) {
-            normAcc = attr.data;
-        }
-    }
-
-    if (!posAcc || posAcc->type != cgltf_type_vec3) {
-        SDL_Log("MeshCache: missing POSITION attribute in %s", path.c_str());
-        cgltf_free(data);
-        return false;
-    }
-
-    const size_t vertCount = posAcc->count;
-    std::vector<glm::vec3> positions(vertCount);
-    for (size_t i = 0; i < vertCount; i++) {
-        float v[3] = {0.0f, 0.0f, 0.0f};
-        cgltf_accessor_read_float(posAcc, i, v, 3);
-        positions[i] = glm::vec3(v[0], v[1], v[2]);
-    }
-
-    std::vector<uint32_t> indices;
-    bool indexed = prim->indices != nullptr;
-    if (indexed) {
-        const cgltf_accessor* idxAcc = prim->indices;
-        indices.resize(idxAcc->count);
-        for (size_t i = 0; i < idxAcc->count; i++) {
-            indices[i] = (uint32_t)cgltf_accessor_read_index(idxAcc, i);
-        }
-    }
-
-    std::vector<glm::vec3> normals(vertCount, glm::vec3(0.0f));
-    bool hasNormals = (normAcc && normAcc->type == cgltf_type_vec3 && normAcc->count == vertCount);
-    if (hasNormals) {
-        for (size_t i = 0; i < vertCount; i++) {
-            float v[3] = {0.0f, 1.0f, 0.0f};
-            cgltf_accessor_read_float(normAcc, i, v, 3);
-            normals[i] = glm::vec3(v[0], v[1], v[2]);
-        }
-    } else {
-        if (indexed && indices.size() >= 3) {
-            size_t triCount = indices.size() / 3;
-            for (size_t t = 0; t < triCount; t++) {
-                uint32_t i0 = indices[t * 3 + 0];
-                uint32_t i1 = indices[t * 3 + 1];
-                uint32_t i2 = indices[t * 3 + 2];
-                if (i0 >= vertCount || i1 >= vertCount || i2 >= vertCount) continue;
-                glm::vec3 e0 = positions[i1] - positions[i0];
-                glm::vec3 e1 = positions[i2] - positions[i0];
-                glm::vec3 n = glm::cross(e0, e1);
-                float len = glm::length(n);
-                if (len > 1e-6f) {
-                    n /= len;
-                    normals[i0] += n;
-                    normals[i1] += n;
-                    normals[i2] += n;
-                }
-            }
-            for (size_t i = 0; i < vertCount; i++) {
-                float len = glm::length(normals[i]);
-                normals[i] = (len > 1e-6f) ? normals[i] / len : glm::vec3(0.0f, 1.0f, 0.0f);
-            }
-        } else {
-            for (size_t i = 0; i + 2 < vertCount; i += 3) {
-                glm::vec3 e0 = positions[i + 1] - positions[i];
-                glm::vec3 e1 = positions[i + 2] - positions[i];
-                glm::vec3 n = glm::cross(e0, e1);
-                float len = glm::length(n);
-                n = (len > 1e-6f) ? (n / len) : glm::vec3(0.0f, 1.0f, 0.0f);
-                normals[i] = n;
-                normals[i + 1] = n;
-                normals[i + 2] = n;
-            }
-        }
-    }
-
-    cgltf_free(data);
-
-    std::vector<VertexPN> vertices(vertCount);
-    for (size_t i = 0; i < vertCount; i++) {
-        vertices[i].pos = positions[i];
-        vertices[i].normal = normals[i];
-    }
-
-    MeshGpu meshOut;
-    glGenBuffers(1, &meshOut.vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, meshOut.vbo);
-    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertices.size() * sizeof(VertexPN)), vertices.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    if (indexed && !indices.empty()) {
-        glGenBuffers(1, &meshOut.ebo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshOut.ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(indices.size() * sizeof(uint32_t)), indices.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        meshOut.indexed = true;
-        meshOut.indexCount = (GLsizei)indices.size();
-    } else {
-        meshOut.indexed = false;
-        meshOut.vertexCount = (GLsizei)vertCount;
-    }
-
-    meshOut.vertexStride = (GLsizei)sizeof(VertexPN);
-    meshOut.vertexCount = (GLsizei)vertCount;
-    out = meshOut;
-    return true;
-}
-
 void MeshCache::buildFallbackCube() {
-    static const VertexPN cubeVerts[] = {
+    struct CubeVertex {
+        glm::vec3 pos;
+        glm::vec3 normal;
+    };
+    static const CubeVertex cubeVerts[] = {
         {{-0.5f,-0.5f, 0.5f},{ 0.0f, 0.0f, 1.0f}}, {{ 0.5f,-0.5f, 0.5f},{ 0.0f, 0.0f, 1.0f}}, {{ 0.5f, 0.5f, 0.5f},{ 0.0f, 0.0f, 1.0f}},
         {{-0.5f,-0.5f, 0.5f},{ 0.0f, 0.0f, 1.0f}}, {{ 0.5f, 0.5f, 0.5f},{ 0.0f, 0.0f, 1.0f}}, {{-0.5f, 0.5f, 0.5f},{ 0.0f, 0.0f, 1.0f}},
         {{ 0.5f,-0.5f,-0.5f},{ 0.0f, 0.0f,-1.0f}}, {{-0.5f,-0.5f,-0.5f},{ 0.0f, 0.0f,-1.0f}}, {{-0.5f, 0.5f,-0.5f},{ 0.0f, 0.0f,-1.0f}},
@@ -226,13 +262,13 @@ void MeshCache::buildFallbackCube() {
         {{-0.5f,-0.5f,-0.5f},{ 0.0f,-1.0f, 0.0f}}, {{ 0.5f,-0.5f, 0.5f},{ 0.0f,-1.0f, 0.0f}}, {{-0.5f,-0.5f, 0.5f},{ 0.0f,-1.0f, 0.0f}},
     };
 
-    glGenBuffers(1, &fallback.vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, fallback.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVerts), cubeVerts, GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    fallback.vertexStride = (GLsizei)sizeof(VertexPN);
-    fallback.vertexCount = 36;
-    fallback.indexCount = 0;
-    fallback.indexed = false;
+    ImportedMesh cube;
+    for (uint32_t i = 0; i < 36; i++) {
+        cube.positions.push_back(cubeVerts[i].pos);
+        cube.normals.push_back(cubeVerts[i].normal);
+        cube.indices.push_back(i);
+    }
+    PackedMesh packed;
+    PackMesh(cube, 0, packed);
+    if (appendMesh(packed, glm::vec3(1.0f), fallback)) setBounds(0, packed.boundsMin, packed.boundsMax);
 }
@@ -3,35 +3,84 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "asset_catalog.h"
+#include "mesh_archive.h"
 
+// A simplified level of a mesh: same vertices, its own index range. Used from
+// `distance` (world units, camera to the instance's bounding sphere) outwards.
+struct MeshLod {
+    GLuint firstIndex = 0; // in units of indexType
+    GLsizei indexCount = 0;
+    float distance = 0.0f;
+};
+
+// A mesh's range inside MeshCache's shared buffers; draw with
+// glDrawElements*BaseVertex(indexCount, indexType, indexByteOffset(), baseVertex).
 struct MeshGpu {
-    GLuint vbo = 0;
-    GLuint ebo = 0;
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0; // in units of indexType
     GLsizei vertexCount = 0;
     GLsizei indexCount = 0;
-    GLsizei vertexStride = 0;
-    bool indexed = false;
+    GLenum indexType = GL_UNSIGNED_INT;
+    float radius = 0.0f; // bounding sphere about the model origin
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+    MeshLod lods[MESH_LOD_LEVELS];
+    int lodCount = 0;
+
+    std::size_t indexByteOffset() const {
+        return (std::size_t)firstIndex * (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+    }
 };
 
 class MeshCache {
 public:
-    bool init();
+    // Uploads every mesh of the archive, rebuilding it first when it is missing
+    // or stale; meshes it lacks are imported from glTF on first use.
+    bool init(const AssetCatalog& catalog, const std::string& archivePath);
     void shutdown();
     const MeshGpu& getOrLoad(AssetId assetId, const AssetCatalog& catalog);
     const MeshGpu& fallbackMesh() const { return fallback; }
 
+    // Every mesh lives in one PackedVertex buffer and one index buffer holding
+    // 16- and 32-bit ranges. Growing them replaces the buffer names, so readers
+    // re-fetch them per frame. The bounds texture (RGBA32F buffer, two texels per
+    // slot: min and step) dequantizes positions.
+    GLuint vertexBuffer() const { return vbo; }
+    GLuint indexBuffer() const { return ebo; }
+    GLuint boundsTexture() const { return boundsTex; }
+    static GLsizei vertexStride();
+    std::size_t memoryBytes() const;
+    int archivedMeshes() const { return archiveMeshes; }
+
 private:
     bool loadMeshForAsset(AssetId assetId, const AssetDef& def, const std::string& root);
-    bool loadGltfMesh(const std::string& path, MeshGpu& out);
-    void destroyMesh(MeshGpu& mesh);
+    bool reserve(std::size_t vertexCount, std::size_t indexBytes);
+    bool appendMesh(const PackedMesh& mesh, const glm::vec3& scale, MeshGpu& out);
+    void uploadArchive(const MeshArchive& archive, const AssetCatalog& catalog);
+    void setBounds(uint32_t slot, const glm::vec3& bmin, const glm::vec3& bmax);
+    void uploadBounds();
     void buildFallbackCube();
 
     std::unordered_map<AssetId, MeshGpu> loaded;
     std::unordered_set<AssetId> failed;
     MeshGpu fallback;
+
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    GLuint boundsBuf = 0;
+    GLuint boundsTex = 0;
+    std::size_t vertexCap = 0; // in vertices
+    std::size_t vertexUsed = 0;
+    std::size_t indexCap = 0;  // in bytes
+    std::size_t indexUsed = 0; // in bytes, kept 4-aligned
+    std::vector<glm::vec4> boundsTexels;
+    uint32_t nextSlot = 1; // slot 0 is the fallback cube
+    int archiveMeshes = 0;
 };
@@ -0,0 +1,275 @@
+#include "mesh_optimizer.h"
+
+#include "hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint32_t NO_TRIANGLE = UINT32_MAX;
+constexpr int MAX_VALENCE = 32;
+
+// FIFO cache replay: a vertex is resident while fewer than cacheSize misses
+// happened since it was loaded.
+class FifoCache {
+public:
+    FifoCache(std::size_t vertexCount, int size) : loadedAt(vertexCount, 0), cacheSize((uint32_t)size) {}
+    // True on a miss.
+    bool access(uint32_t v) {
+        if (loadedAt[v] != 0 && misses + 1 - loadedAt[v] <= cacheSize) return false;
+        misses++;
+        loadedAt[v] = misses;
+        return true;
+    }
+    uint32_t missCount() const { return misses; }
+
+private:
+    std::vector<uint32_t> loadedAt; // miss number that loaded the vertex, 0 = never
+    uint32_t cacheSize;
+    uint32_t misses = 0;
+};
+
+struct ScoreTables {
+    float cache[VERTEX_CACHE_SIZE];
+    float valence[MAX_VALENCE + 1];
+    ScoreTables() {
+        // Forsyth's constants: the last triangle's vertices score flat, older
+        // entries decay, and vertices with few triangles left are finished first.
+        for (int i = 0; i < VERTEX_CACHE_SIZE; i++) {
+            cache[i] = i < 3 ? 0.75f : std::pow(1.0f - (float)(i - 3) / (float)(VERTEX_CACHE_SIZE - 3), 1.5f);
+        }
+        valence[0] = 0.0f;
+        for (int i = 1; i <= MAX_VALENCE; i++) valence[i] = 2.0f / std::sqrt((float)i);
+    }
+};
+
+float VertexScore(const ScoreTables& tables, int cachePos, uint32_t liveTriangles) {
+    if (liveTriangles == 0) return -1.0f;
+    float score = cachePos >= 0 ? tables.cache[cachePos] : 0.0f;
+    return score + tables.valence[std::min<uint32_t>(liveTriangles, MAX_VALENCE)];
+}
+
+} // namespace
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, std::size_t vertexCount, int cacheSize) {
+    VertexCacheStats stats;
+    if (indices.size() < 3 || vertexCount == 0) return stats;
+    FifoCache cache(vertexCount, cacheSize);
+    for (uint32_t v : indices) cache.access(v);
+    stats.acmr = (float)cache.missCount() / (float)(indices.size() / 3);
+    stats.atvr = (float)cache.missCount() / (float)vertexCount;
+    return stats;
+}
+
+void WeldVertices(ImportedMesh& mesh) {
+    struct Key {
+        float v[6];
+        bool operator==(const Key& o) const { return std::memcmp(v, o.v, sizeof(v)) == 0; }
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& k) const { return (std::size_t)Fnv1a64(k.v, sizeof(k.v)); }
+    };
+
+    const std::size_t count = mesh.positions.size();
+    std::unordered_map<Key, uint32_t, KeyHash> unique;
+    unique.reserve(count);
+    std::vector<uint32_t> remap(count);
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    for (std::size_t i = 0; i < count; i++) {
+        const glm::vec3& p = mesh.positions[i];
+        const glm::vec3& n = mesh.normals[i];
+        // Adding zero folds -0 into +0 so the bit compare treats them as equal.
+        Key key{{p.x + 0.0f, p.y + 0.0f, p.z + 0.0f, n.x + 0.0f, n.y + 0.0f, n.z + 0.0f}};
+        auto [it, added] = unique.emplace(key, (uint32_t)positions.size());
+        if (added) {
+            positions.push_back(p);
+            normals.push_back(n);
+        }
+        remap[i] = it->second;
+    }
+    for (uint32_t& idx : mesh.indices) idx = remap[idx];
+    mesh.positions = std::move(positions);
+    mesh.normals = std::move(normals);
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, std::size_t vertexCount) {
+    const std::size_t triCount = indices.size() / 3;
+    if (triCount < 2) return;
+    static const ScoreTables tables;
+
+    // Triangles of each vertex; the live ones are kept at the front of its range.
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (std::size_t i = 0; i < triCount * 3; i++) live[indices[i]]++;
+    std::vector<uint32_t> adjOffset(vertexCount + 1, 0);
+    for (std::size_t v = 0; v < vertexCount; v++) adjOffset[v + 1] = adjOffset[v] + live[v];
+    std::vector<uint32_t> adj(adjOffset[vertexCount]);
+    {
+        std::vector<uint32_t> fill(adjOffset.begin(), adjOffset.end() - 1);
+        for (std::size_t i = 0; i < triCount * 3; i++) adj[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; v++) vertexScore[v] = VertexScore(tables, -1, live[v]);
+    std::vector<float> triScore(triCount);
+    std::vector<uint8_t> emitted(triCount, 0);
+    uint32_t best = 0;
+    for (std::size_t t = 0; t < triCount; t++) {
+        triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triScore[t] > triScore[best]) best = (uint32_t)t;
+    }
+
+    std::vector<uint32_t> out;
+    out.reserve(triCount * 3);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> next;
+    std::size_t deadEndCursor = 0;
+    for (std::size_t emittedCount = 0; emittedCount < triCount; emittedCount++) {
+        if (best == NO_TRIANGLE) {
+            // Nothing left around the cache: continue with the next triangle in input order.
+            while (emitted[deadEndCursor]) deadEndCursor++;
+            best = (uint32_t)deadEndCursor;
+        }
+        const uint32_t* tri = &indices[(std::size_t)best * 3];
+        out.insert(out.end(), tri, tri + 3);
+        emitted[best] = 1;
+
+        next.assign(tri, tri + 3);
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = tri[k];
+            uint32_t* begin = &adj[adjOffset[v]];
+            uint32_t* end = begin + live[v];
+            uint32_t* at = std::find(begin, end, best);
+            if (at != end) {
+                std::swap(*at, *(end - 1));
+                live[v]--;
+            }
+        }
+        for (uint32_t v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) next.push_back(v);
+        }
+
+        // Vertices pushed past the cache lose their cache score.
+        for (std::size_t i = 0; i < next.size(); i++) {
+            uint32_t v = next[i];
+            cachePos[v] = i < (std::size_t)VERTEX_CACHE_SIZE ? (int)i : -1;
+            vertexScore[v] = VertexScore(tables, cachePos[v], live[v]);
+        }
+
+        best = NO_TRIANGLE;
+        float bestScore = -1.0f;
+        for (uint32_t v : next) {
+            for (uint32_t a = adjOffset[v]; a < adjOffset[v] + live[v]; a++) {
+                uint32_t t = adj[a];
+                const uint32_t* tv = &indices[(std::size_t)t * 3];
+                triScore[t] = vertexScore[tv[0]] + vertexScore[tv[1]] + vertexScore[tv[2]];
+                if (cachePos[v] >= 0 && triScore[t] > bestScore) {
+                    bestScore = triScore[t];
+                    best = t;
+                }
+            }
+        }
+
+        if (next.size() > (std::size_t)VERTEX_CACHE_SIZE) next.resize(VERTEX_CACHE_SIZE);
+        cache.swap(next);
+    }
+    indices.swap(out);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions) {
+    const std::size_t triCount = indices.size() / 3;
+    if (triCount < 2) return;
+
+    // A triangle that misses on all three vertices starts a cluster; moving
+    // clusters around costs almost nothing in cache efficiency.
+    std::vector<std::size_t> clusterStart;
+    FifoCache cache(positions.size(), VERTEX_CACHE_SIZE);
+    for (std::size_t t = 0; t < triCount; t++) {
+        int misses = 0;
+        for (int k = 0; k < 3; k++) misses += cache.access(indices[t * 3 + k]) ? 1 : 0;
+        if (t == 0 || misses == 3) clusterStart.push_back(t);
+    }
+    if (clusterStart.size() < 2) return;
+    clusterStart.push_back(triCount);
+
+    struct Cluster {
+        std::size_t first;
+        std::size_t count;
+        float key;
+    };
+    std::vector<Cluster> clusters;
+    std::vector<glm::vec3> centroids;
+    std::vector<glm::vec3> normals;
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (std::size_t c = 0; c + 1 < clusterStart.size(); c++) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (std::size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++) {
+            const glm::vec3& a = positions[indices[t * 3]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& d = positions[indices[t * 3 + 2]];
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float triArea = glm::length(n);
+            centroid += (a + b + d) * (triArea / 3.0f);
+            normal += n;
+            area += triArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids.push_back(area > 0.0f ? centroid / area : centroid);
+        normals.push_back(normal);
+        clusters.push_back({clusterStart[c], clusterStart[c + 1] - clusterStart[c], 0.0f});
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // Clusters facing away from the centre are the outer shell; drawn first,
+    // they occlude what lies behind them.
+    for (std::size_t c = 0; c < clusters.size(); c++) {
+        float len = glm::length(normals[c]);
+        clusters[c].key = len > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / len) : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+    for (const Cluster& c : clusters) {
+        out.insert(out.end(), indices.begin() + c.first * 3, indices.begin() + (c.first + c.count) * 3);
+    }
+    indices.swap(out);
+}
+
+void OptimizeVertexFetch(ImportedMesh& mesh) {
+    std::vector<uint32_t> remap(mesh.positions.size(), UINT32_MAX);
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    positions.reserve(mesh.positions.size());
+    normals.reserve(mesh.normals.size());
+    for (uint32_t& idx : mesh.indices) {
+        if (remap[idx] == UINT32_MAX) {
+            remap[idx] = (uint32_t)positions.size();
+            positions.push_back(mesh.positions[idx]);
+            normals.push_back(mesh.normals[idx]);
+        }
+        idx = remap[idx];
+    }
+    mesh.positions = std::move(positions);
+    mesh.normals = std::move(normals);
+}
+
+MeshOptimizeReport OptimizeMesh(ImportedMesh& mesh) {
+    MeshOptimizeReport report;
+    report.verticesBefore = mesh.positions.size();
+    report.before = AnalyzeVertexCache(mesh.indices, mesh.positions.size());
+    WeldVertices(mesh);
+    OptimizeVertexCache(mesh.indices, mesh.positions.size());
+    OptimizeOverdraw(mesh.indices, mesh.positions);
+    OptimizeVertexFetch(mesh);
+    report.verticesAfter = mesh.positions.size();
+    report.after = AnalyzeVertexCache(mesh.indices, mesh.positions.size());
+    return report;
+}
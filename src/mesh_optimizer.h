@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mesh_archive.h"
+
+// Import-time mesh optimization, run before packing: weld duplicate vertices,
+// order triangles for the post-transform cache (Forsyth's linear-speed
+// algorithm), then reorder cache clusters so outward-facing ones draw first,
+// and finally renumber vertices in first-use order for fetch locality.
+// Everything is deterministic for a given input.
+
+// Transform counts of a FIFO post-transform cache replaying an index list.
+struct VertexCacheStats {
+    float acmr = 0.0f; // transformed vertices per triangle; 3 is the worst case
+    float atvr = 0.0f; // transformed vertices per vertex; 1 is ideal
+};
+
+struct MeshOptimizeReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    std::size_t verticesBefore = 0;
+    std::size_t verticesAfter = 0;
+};
+
+constexpr int VERTEX_CACHE_SIZE = 16;
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, std::size_t vertexCount,
+    int cacheSize = VERTEX_CACHE_SIZE);
+
+// Merges vertices with bit-identical position and normal.
+void WeldVertices(ImportedMesh& mesh);
+void OptimizeVertexCache(std::vector<uint32_t>& indices, std::size_t vertexCount);
+// Keeps the triangle order inside each run that starts cold in the cache, so
+// the cache optimization survives; only whole runs move.
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions);
+// Renumbers vertices by first use and drops unreferenced ones.
+void OptimizeVertexFetch(ImportedMesh& mesh);
+
+MeshOptimizeReport OptimizeMesh(ImportedMesh& mesh);
@@ -0,0 +1,446 @@
+#include "mesh_simplifier.h"
+
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+constexpr double BORDER_WEIGHT = 10.0;
+
+// Symmetric 4x4 plane quadric; weight is the summed triangle area so errors
+// come out as an area-weighted RMS distance.
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+    double weight = 0;
+
+    void addPlane(const glm::dvec3& n, double d, double w) {
+        a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+        b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+        c2 += w * n.z * n.z; cd += w * n.z * d;
+        d2 += w * d * d;
+        weight += w;
+    }
+    void add(const Quadric& q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+        bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+        weight += q.weight;
+    }
+    double eval(const glm::dvec3& p) const {
+        double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x +
+                   b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y +
+                   c2 * p.z * p.z + 2 * cd * p.z + d2;
+        return std::max(e, 0.0);
+    }
+};
+
+struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    bool border;
+};
+
+// A triangle around a collapse, with a bounding sphere to skip distance tests.
+struct FanTriangle {
+    std::array<glm::dvec3, 3> corner;
+    glm::dvec3 center;
+    double radius;
+    uint32_t owner; // ring vertex that takes the positions nearest to it
+};
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) {
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+// Squared distance from p to triangle abc (Ericson, Real-Time Collision Detection 5.1.5).
+double PointTriangleDistance2(const glm::dvec3& p, const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c) {
+    glm::dvec3 ab = b - a, ac = c - a, ap = p - a;
+    double d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    auto dist2 = [&p](const glm::dvec3& q) { return glm::dot(p - q, p - q); };
+    if (d1 <= 0.0 && d2 <= 0.0) return dist2(a);
+    glm::dvec3 bp = p - b;
+    double d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0 && d4 <= d3) return dist2(b);
+    double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) return dist2(a + ab * (d1 / (d1 - d3)));
+    glm::dvec3 cp = p - c;
+    double d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0 && d5 <= d6) return dist2(c);
+    double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) return dist2(a + ac * (d2 / (d2 - d6)));
+    double va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) return dist2(b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+    double denom = 1.0 / (va + vb + vc);
+    return dist2(a + ab * (vb * denom) + ac * (vc * denom));
+}
+
+} // namespace
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+    const std::vector<uint32_t>& indices, std::size_t targetTriangles, float maxError, float& error) {
+    error = 0.0f;
+    const std::size_t wedgeCount = positions.size();
+    std::vector<uint32_t> tris(indices.begin(), indices.end() - indices.size() % 3);
+    if (tris.size() / 3 <= targetTriangles || wedgeCount == 0) return tris;
+
+    // Connectivity is by position; wedges (vertices split at normal seams) of
+    // one position collapse together.
+    std::vector<uint32_t> pidOf(wedgeCount);
+    std::vector<glm::vec3> pos;
+    {
+        std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+        for (std::size_t w = 0; w < wedgeCount; w++) {
+            const glm::vec3& p = positions[w];
+            uint32_t bits[3];
+            glm::vec3 folded = p + glm::vec3(0.0f); // -0 == +0
+            std::memcpy(bits, &folded, sizeof(bits));
+            uint64_t h = ((uint64_t)bits[0] * 73856093u) ^ ((uint64_t)bits[1] * 19349663u) ^ ((uint64_t)bits[2] * 83492791u);
+            auto& bucket = buckets[h];
+            uint32_t pid = UINT32_MAX;
+            for (uint32_t other : bucket) {
+                if (pos[other] == folded) {
+                    pid = other;
+                    break;
+                }
+            }
+            if (pid == UINT32_MAX) {
+                pid = (uint32_t)pos.size();
+                pos.push_back(folded);
+                bucket.push_back(pid);
+            }
+            pidOf[w] = pid;
+        }
+    }
+    const std::size_t pidCount = pos.size();
+    std::vector<std::vector<uint32_t>> wedgesOf(pidCount);
+    for (std::size_t w = 0; w < wedgeCount; w++) wedgesOf[pidOf[w]].push_back((uint32_t)w);
+
+    const std::size_t triCount = tris.size() / 3;
+    std::vector<uint8_t> alive(triCount, 1);
+    std::size_t aliveCount = 0;
+    auto P = [&](std::size_t t, int k) { return pidOf[tris[t * 3 + k]]; };
+    for (std::size_t t = 0; t < triCount; t++) {
+        if (P(t, 0) == P(t, 1) || P(t, 1) == P(t, 2) || P(t, 0) == P(t, 2)) alive[t] = 0;
+        aliveCount += alive[t];
+    }
+
+    // Face quadrics, plus perpendicular planes along open borders.
+    std::vector<Quadric> quadrics(pidCount);
+    std::vector<uint64_t> edges;
+    for (std::size_t t = 0; t < triCount; t++) {
+        if (!alive[t]) continue;
+        glm::dvec3 p0(pos[P(t, 0)]), p1(pos[P(t, 1)]), p2(pos[P(t, 2)]);
+        glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+        double area = glm::length(n);
+        if (area <= 0.0) continue;
+        n /= area;
+        for (int k = 0; k < 3; k++) quadrics[P(t, k)].addPlane(n, -glm::dot(n, p0), area * 0.5);
+        for (int k = 0; k < 3; k++) edges.push_back(EdgeKey(P(t, k), P(t, (k + 1) % 3)));
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<uint8_t> borderVertex(pidCount, 0);
+    for (std::size_t t = 0; t < triCount; t++) {
+        if (!alive[t]) continue;
+        glm::dvec3 p0(pos[P(t, 0)]), p1(pos[P(t, 1)]), p2(pos[P(t, 2)]);
+        glm::dvec3 faceN = glm::cross(p1 - p0, p2 - p0);
+        if (glm::length(faceN) <= 0.0) continue;
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = P(t, k), b = P(t, (k + 1) % 3);
+            uint64_t key = EdgeKey(a, b);
+            auto range = std::equal_range(edges.begin(), edges.end(), key);
+            if (range.second - range.first != 1) continue;
+            borderVertex[a] = borderVertex[b] = 1;
+            glm::dvec3 pa(pos[a]), pb(pos[b]);
+            glm::dvec3 n = glm::cross(pb - pa, faceN);
+            double len = glm::length(n);
+            if (len <= 0.0) continue;
+            n /= len;
+            double w = glm::dot(pb - pa, pb - pa) * BORDER_WEIGHT;
+            quadrics[a].addPlane(n, -glm::dot(n, pa), w);
+            quadrics[b].addPlane(n, -glm::dot(n, pa), w);
+        }
+    }
+
+    // Bounds faces each vertex lies on; the base face locks the footprint.
+    glm::vec3 bmin(1e30f), bmax(-1e30f);
+    for (const glm::vec3& p : pos) {
+        bmin = glm::min(bmin, p);
+        bmax = glm::max(bmax, p);
+    }
+    const float eps = glm::length(bmax - bmin) * 1e-4f;
+    std::vector<uint8_t> faceMask(pidCount, 0);
+    for (std::size_t v = 0; v < pidCount; v++) {
+        for (int axis = 0; axis < 3; axis++) {
+            if (pos[v][axis] <= bmin[axis] + eps) faceMask[v] |= (uint8_t)(1u << (axis * 2));
+            if (pos[v][axis] >= bmax[axis] - eps) faceMask[v] |= (uint8_t)(1u << (axis * 2 + 1));
+        }
+    }
+    const uint8_t BASE_FACE = 1u << 2; // min Y
+
+    // Original positions, each kept with a vertex whose fan holds its nearest
+    // point on the surface; a collapse re-measures those of every fan it changes.
+    std::vector<std::vector<uint32_t>> members(pidCount);
+    for (uint32_t v = 0; v < (uint32_t)pidCount; v++) members[v].push_back(v);
+    std::vector<uint32_t> regionMark(pidCount, 0);
+    uint32_t regionStamp = 0;
+    std::vector<uint32_t> triMark(triCount, 0);
+    std::vector<FanTriangle> fan;
+    std::vector<std::pair<uint32_t, uint32_t>> assigned;
+
+    const double maxCost = (double)maxError * (double)maxError;
+    double worstDist2 = 0.0;
+    std::vector<uint32_t> adjOffset(pidCount + 1);
+    std::vector<uint32_t> adj;
+    std::vector<uint8_t> touched(pidCount);
+    std::vector<uint8_t> target(pidCount);
+    std::vector<Collapse> candidates;
+    std::vector<uint32_t> ringA, ringB;
+    for (;;) {
+        if (aliveCount <= targetTriangles) break;
+
+        // Triangles around each position.
+        std::fill(adjOffset.begin(), adjOffset.end(), 0);
+        for (std::size_t t = 0; t < triCount; t++) {
+            if (!alive[t]) continue;
+            for (int k = 0; k < 3; k++) adjOffset[P(t, k) + 1]++;
+        }
+        for (std::size_t v = 0; v < pidCount; v++) adjOffset[v + 1] += adjOffset[v];
+        adj.assign(adjOffset[pidCount], 0);
+        {
+            std::vector<uint32_t> fill(adjOffset.begin(), adjOffset.end() - 1);
+            for (std::size_t t = 0; t < triCount; t++) {
+                if (!alive[t]) continue;
+                for (int k = 0; k < 3; k++) adj[fill[P(t, k)]++] = (uint32_t)t;
+            }
+        }
+
+        edges.clear();
+        for (std::size_t t = 0; t < triCount; t++) {
+            if (!alive[t]) continue;
+            for (int k = 0; k < 3; k++) edges.push_back(EdgeKey(P(t, k), P(t, (k + 1) % 3)));
+        }
+        std::sort(edges.begin(), edges.end());
+
+        candidates.clear();
+        for (std::size_t i = 0; i < edges.size();) {
+            std::size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i]) j++;
+            bool border = j - i == 1;
+            uint32_t a = (uint32_t)(edges[i] >> 32), b = (uint32_t)edges[i];
+            i = j;
+            Collapse best{-1.0, 0, 0, border};
+            for (int dir = 0; dir < 2; dir++) {
+                uint32_t from = dir ? b : a, to = dir ? a : b;
+                if (faceMask[from] & BASE_FACE) continue;
+                if ((faceMask[from] & faceMask[to]) != faceMask[from]) continue;
+                if (borderVertex[from] && !border) continue;
+                Quadric q = quadrics[from];
+                q.add(quadrics[to]);
+                double cost = q.weight > 0.0 ? q.eval(glm::dvec3(pos[to])) / q.weight : 0.0;
+                if (best.cost < 0.0 || cost < best.cost) best = {cost, from, to, border};
+            }
+            // The quadric cost is an area-weighted RMS plane distance: it orders
+            // collapses and prunes hopeless ones, the bound is measured below.
+            if (best.cost >= 0.0 && best.cost <= maxCost) candidates.push_back(best);
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& x, const Collapse& y) {
+            if (x.cost != y.cost) return x.cost < y.cost;
+            if (x.from != y.from) return x.from < y.from;
+            return x.to < y.to;
+        });
+
+        // Independent collapses: a collapse touches everything around its
+        // source, and later ones in the pass may not involve those vertices.
+        std::fill(touched.begin(), touched.end(), 0);
+        std::fill(target.begin(), target.end(), 0);
+        std::size_t collapsed = 0;
+        for (const Collapse& c : candidates) {
+            if (aliveCount <= targetTriangles) break;
+            const uint32_t a = c.from, b = c.to;
+            if (touched[a] || touched[b]) continue;
+
+            // Link condition: the rings may only share the edge's opposite vertices.
+            ringA.clear();
+            ringB.clear();
+            int edgeTris = 0;
+            for (uint32_t i = adjOffset[a]; i < adjOffset[a + 1]; i++) {
+                uint32_t t = adj[i];
+                if (!alive[t]) continue;
+                bool hasB = false;
+                for (int k = 0; k < 3; k++) {
+                    if (P(t, k) != a) ringA.push_back(P(t, k));
+                    hasB = hasB || P(t, k) == b;
+                }
+                edgeTris += hasB ? 1 : 0;
+            }
+            for (uint32_t i = adjOffset[b]; i < adjOffset[b + 1]; i++) {
+                uint32_t t = adj[i];
+                if (!alive[t]) continue;
+                for (int k = 0; k < 3; k++) {
+                    if (P(t, k) != b) ringB.push_back(P(t, k));
+                }
+            }
+            std::sort(ringA.begin(), ringA.end());
+            ringA.erase(std::unique(ringA.begin(), ringA.end()), ringA.end());
+            std::sort(ringB.begin(), ringB.end());
+            ringB.erase(std::unique(ringB.begin(), ringB.end()), ringB.end());
+            int shared = 0;
+            for (std::size_t i = 0, j = 0; i < ringA.size() && j < ringB.size();) {
+                if (ringA[i] < ringB[j]) i++;
+                else if (ringB[j] < ringA[i]) j++;
+                else { shared++; i++; j++; }
+            }
+            // b itself is in a's ring but not in b's, so shared counts opposite vertices only.
+            if (edgeTris == 0 || shared != edgeTris) continue;
+            // The fans measured below come from this pass's adjacency, which
+            // misses the triangles an earlier collapse handed to its target.
+            bool staleRing = false;
+            for (uint32_t v : ringA) staleRing = staleRing || target[v];
+            if (staleRing) continue;
+
+            // No triangle around a may flip or degenerate.
+            bool flips = false;
+            for (uint32_t i = adjOffset[a]; i < adjOffset[a + 1] && !flips; i++) {
+                uint32_t t = adj[i];
+                if (!alive[t]) continue;
+                glm::vec3 p[3], q[3];
+                bool hasB = false;
+                for (int k = 0; k < 3; k++) {
+                    p[k] = pos[P(t, k)];
+                    q[k] = P(t, k) == a ? pos[b] : p[k];
+                    hasB = hasB || P(t, k) == b;
+                }
+                if (hasB) continue;
+                glm::vec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 n1 = glm::cross(q[1] - q[0], q[2] - q[0]);
+                flips = glm::dot(n0, n1) <= 0.1f * glm::length(n0) * glm::length(n1) || glm::length(n1) <= 0.0f;
+            }
+            if (flips) continue;
+
+            // Every original position around the collapse stays within maxError
+            // of the surface. Each is measured against all triangles around the
+            // ring and handed to a ring vertex of the nearest one, so it is
+            // measured again whenever that vertex's fan changes.
+            regionStamp++;
+            for (uint32_t v : ringA) regionMark[v] = regionStamp;
+            fan.clear();
+            for (uint32_t v : ringA) {
+                for (uint32_t i = adjOffset[v]; i < adjOffset[v + 1]; i++) {
+                    uint32_t t = adj[i];
+                    if (!alive[t] || triMark[t] == regionStamp) continue;
+                    triMark[t] = regionStamp;
+                    bool hasA = P(t, 0) == a || P(t, 1) == a || P(t, 2) == a;
+                    bool hasB = P(t, 0) == b || P(t, 1) == b || P(t, 2) == b;
+                    if (hasA && hasB) continue; // removed by the collapse
+                    std::array<glm::dvec3, 3> tri;
+                    uint32_t owner = UINT32_MAX;
+                    for (int k = 0; k < 3; k++) {
+                        uint32_t w = P(t, k) == a ? b : P(t, k);
+                        tri[k] = glm::dvec3(pos[w]);
+                        if (owner == UINT32_MAX && regionMark[w] == regionStamp) owner = w;
+                    }
+                    glm::dvec3 center = (tri[0] + tri[1] + tri[2]) / 3.0;
+                    double radius = std::sqrt(std::max({glm::dot(tri[0] - center, tri[0] - center),
+                        glm::dot(tri[1] - center, tri[1] - center), glm::dot(tri[2] - center, tri[2] - center)}));
+                    fan.push_back({tri, center, radius, owner});
+                }
+            }
+            double collapseDist2 = 0.0;
+            assigned.clear();
+            auto measure = [&](uint32_t x) {
+                for (uint32_t m : members[x]) {
+                    glm::dvec3 p(pos[m]);
+                    double best = 1e300;
+                    uint32_t owner = UINT32_MAX;
+                    for (const FanTriangle& f : fan) {
+                        double near = std::max(glm::length(p - f.center) - f.radius, 0.0);
+                        if (near * near >= best) continue;
+                        double d = PointTriangleDistance2(p, f.corner[0], f.corner[1], f.corner[2]);
+                        if (d < best) {
+                            best = d;
+                            owner = f.owner;
+                        }
+                    }
+                    collapseDist2 = std::max(collapseDist2, best);
+                    assigned.push_back({m, owner});
+                }
+            };
+            measure(a);
+            for (std::size_t i = 0; i < ringA.size() && collapseDist2 <= maxCost; i++) measure(ringA[i]);
+            if (collapseDist2 > maxCost) continue;
+
+            for (uint32_t i = adjOffset[a]; i < adjOffset[a + 1]; i++) {
+                uint32_t t = adj[i];
+                if (!alive[t]) continue;
+                bool hasB = P(t, 0) == b || P(t, 1) == b || P(t, 2) == b;
+                if (hasB) {
+                    alive[t] = 0;
+                    aliveCount--;
+                    continue;
+                }
+                for (int k = 0; k < 3; k++) {
+                    touched[P(t, k)] = 1;
+                    if (P(t, k) != a) continue;
+                    // The wedge of b whose normal best matches the corner's.
+                    const glm::vec3& n = normals[tris[t * 3 + k]];
+                    uint32_t bestWedge = wedgesOf[b].front();
+                    float bestDot = -2.0f;
+                    for (uint32_t w : wedgesOf[b]) {
+                        float d = glm::dot(normals[w], n);
+                        if (d > bestDot) {
+                            bestDot = d;
+                            bestWedge = w;
+                        }
+                    }
+                    tris[t * 3 + k] = bestWedge;
+                }
+            }
+            quadrics[b].add(quadrics[a]);
+            members[a].clear();
+            for (uint32_t v : ringA) members[v].clear();
+            for (const auto& m : assigned) members[m.second].push_back(m.first);
+            touched[a] = touched[b] = 1;
+            target[b] = 1;
+            worstDist2 = std::max(worstDist2, collapseDist2);
+            collapsed++;
+        }
+        if (collapsed == 0) break;
+    }
+
+    std::vector<uint32_t> out;
+    out.reserve(aliveCount * 3);
+    for (std::size_t t = 0; t < triCount; t++) {
+        if (alive[t]) out.insert(out.end(), tris.begin() + t * 3, tris.begin() + t * 3 + 3);
+    }
+    error = (float)std::sqrt(worstDist2);
+    return out;
+}
+
+void BuildLods(ImportedMesh& mesh, const std::vector<LodSetting>& settings) {
+    mesh.lods.clear();
+    glm::vec3 bmin(1e30f), bmax(-1e30f);
+    for (const glm::vec3& p : mesh.positions) {
+        bmin = glm::min(bmin, p);
+        bmax = glm::max(bmax, p);
+    }
+    const float diagonal = glm::length(bmax - bmin);
+    const std::size_t fullTris = mesh.indices.size() / 3;
+    std::size_t prevTris = fullTris;
+    for (const LodSetting& s : settings) {
+        if ((int)mesh.lods.size() == MESH_LOD_LEVELS) break;
+        std::size_t target = std::max<std::size_t>(1, (std::size_t)((double)fullTris * s.ratio));
+        if (target >= prevTris) continue;
+        ImportedMesh::Level level;
+        level.indices = SimplifyMesh(mesh.positions, mesh.normals, mesh.indices, target, s.maxError * diagonal, level.error);
+        std::size_t tris = level.indices.size() / 3;
+        if (tris == 0 || tris * 10 > prevTris * 9) continue;
+        OptimizeVertexCache(level.indices, mesh.positions.size());
+        prevTris = tris;
+        mesh.lods.push_back(std::move(level));
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "asset_catalog.h"
+#include "mesh_archive.h"
+
+// Quadric edge-collapse simplification (Garland-Heckbert). Collapses are
+// half-edge, so every level reuses the full mesh's vertices: corners keep the
+// wedge whose normal is closest to their own, which keeps hard edges hard.
+// To hold the silhouette and footprint, vertices on the base of the mesh never
+// move, vertices on a bounds face only collapse along that face and open
+// borders only collapse along themselves. Deterministic: ties go to the lower
+// vertex index.
+//
+// The error is geometric: every vertex of the input lies within `error` (mesh
+// units) of the simplified surface. Stops at `targetTriangles` or when no
+// collapse stays within `maxError`; `error` receives the bound reached.
+std::vector<uint32_t> SimplifyMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+    const std::vector<uint32_t>& indices, std::size_t targetTriangles, float maxError, float& error);
+
+// Fills mesh.lods from the asset's settings (at most MESH_LOD_LEVELS), each
+// level cache-optimized. Levels that do not cut at least a tenth of the
+// previous level's triangles are dropped.
+void BuildLods(ImportedMesh& mesh, const std::vector<LodSetting>& settings);
@@ -0,0 +1,172 @@
+#include "occlusion_culler.h"
+
+#include <algorithm>
+#include <cmath>
+
+// OCCLUSION_NO_SIMD forces the scalar rasterizer (the tests build both).
+#if !defined(OCCLUSION_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define OCCLUSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr float NEAR_W = 1e-3f;
+
+// Box corners are indexed by sign bits (1 = +x, 2 = +y, 4 = +z); faces wind
+// counter-clockwise seen from outside.
+const int kBoxFaces[6][4] = {
+    {0, 4, 6, 2}, {1, 3, 7, 5}, // -x, +x
+    {0, 1, 5, 4}, {2, 6, 7, 3}, // -y, +y
+    {0, 2, 3, 1}, {4, 5, 7, 6}, // -z, +z
+};
+
+} // namespace
+
+void OcclusionCuller::begin(const glm::mat4& viewProj, int width, int height) {
+    vp = viewProj;
+    w = (std::max(width, 4) + 3) & ~3;
+    h = std::max(height, 1);
+    buffer.assign((size_t)w * h, 1.0f);
+    st = Stats{};
+}
+
+bool OcclusionCuller::addOccluderBox(const glm::vec3& center, const glm::vec3& halfExtents, float yaw) {
+    float c = std::cos(yaw), s = std::sin(yaw);
+    glm::vec3 ax(c * halfExtents.x, 0.0f, -s * halfExtents.x);
+    glm::vec3 ay(0.0f, halfExtents.y, 0.0f);
+    glm::vec3 az(s * halfExtents.z, 0.0f, c * halfExtents.z);
+
+    ScreenVert sv[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 p = center + ((i & 1) ? ax : -ax) + ((i & 2) ? ay : -ay) + ((i & 4) ? az : -az);
+        glm::vec4 clip = vp * glm::vec4(p, 1.0f);
+        // Clipping is not worth it for occluders; a box touching the near plane is skipped.
+        if (clip.w <= NEAR_W) {
+            st.rejectedOccluders++;
+            return false;
+        }
+        float iw = 1.0f / clip.w;
+        sv[i].x = (clip.x * iw * 0.5f + 0.5f) * (float)w;
+        sv[i].y = (clip.y * iw * 0.5f + 0.5f) * (float)h;
+        sv[i].z = clip.z * iw * 0.5f + 0.5f;
+    }
+
+    for (const auto& f : kBoxFaces) {
+        rasterizeTriangle(sv[f[0]], sv[f[1]], sv[f[2]]);
+        rasterizeTriangle(sv[f[0]], sv[f[2]], sv[f[3]]);
+    }
+    st.occluders++;
+    return true;
+}
+
+void OcclusionCuller::rasterizeTriangle(const ScreenVert& v0, const ScreenVert& v1, const ScreenVert& v2) {
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (area <= 0.0f) return; // back face or degenerate
+
+    float minX = std::min({v0.x, v1.x, v2.x});
+    float maxX = std::max({v0.x, v1.x, v2.x});
+    float minY = std::min({v0.y, v1.y, v2.y});
+    float maxY = std::max({v0.y, v1.y, v2.y});
+    int x0 = std::max(0, (int)std::floor(minX)) & ~3;
+    int x1 = std::min(w - 1, (int)std::ceil(maxX));
+    int y0 = std::max(0, (int)std::floor(minY));
+    int y1 = std::min(h - 1, (int)std::ceil(maxY));
+    if (x0 > x1 || y0 > y1) return;
+
+    // Edge functions e_ab(p) = A * x + B * y + C, positive inside; each weights the
+    // opposite vertex, which gives depth as a plane over the screen.
+    float A0 = v1.y - v2.y, B0 = v2.x - v1.x, C0 = v1.x * v2.y - v1.y * v2.x; // weights v0
+    float A1 = v2.y - v0.y, B1 = v0.x - v2.x, C1 = v2.x * v0.y - v2.y * v0.x; // weights v1
+    float A2 = v0.y - v1.y, B2 = v1.x - v0.x, C2 = v0.x * v1.y - v0.y * v1.x; // weights v2
+    float ia = 1.0f / area;
+    float zA = (A0 * v0.z + A1 * v1.z + A2 * v2.z) * ia;
+    float zB = (B0 * v0.z + B1 * v1.z + B2 * v2.z) * ia;
+    float zC = (C0 * v0.z + C1 * v1.z + C2 * v2.z) * ia;
+
+#if OCCLUSION_SSE2
+    const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 a0 = _mm_set1_ps(A0), a1 = _mm_set1_ps(A1), a2 = _mm_set1_ps(A2), az = _mm_set1_ps(zA);
+    const __m128 step0 = _mm_set1_ps(A0 * 4.0f), step1 = _mm_set1_ps(A1 * 4.0f), step2 = _mm_set1_ps(A2 * 4.0f);
+    const __m128 stepZ = _mm_set1_ps(zA * 4.0f);
+    for (int y = y0; y <= y1; y++) {
+        float py = (float)y + 0.5f;
+        __m128 px = _mm_add_ps(_mm_set1_ps((float)x0), lane);
+        __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), _mm_set1_ps(B0 * py + C0));
+        __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), _mm_set1_ps(B1 * py + C1));
+        __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), _mm_set1_ps(B2 * py + C2));
+        __m128 z = _mm_add_ps(_mm_mul_ps(az, px), _mm_set1_ps(zB * py + zC));
+        float* row = buffer.data() + (size_t)y * w;
+        for (int x = x0; x <= x1; x += 4) {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+            if (_mm_movemask_ps(inside)) {
+                __m128 d = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(d, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, d)));
+            }
+            e0 = _mm_add_ps(e0, step0);
+            e1 = _mm_add_ps(e1, step1);
+            e2 = _mm_add_ps(e2, step2);
+            z = _mm_add_ps(z, stepZ);
+        }
+    }
+#else
+    for (int y = y0; y <= y1; y++) {
+        float py = (float)y + 0.5f;
+        float* row = buffer.data() + (size_t)y * w;
+        for (int x = x0; x <= x1; x++) {
+            float px = (float)x + 0.5f;
+            if (A0 * px + B0 * py + C0 < 0.0f || A1 * px + B1 * py + C1 < 0.0f || A2 * px + B2 * py + C2 < 0.0f) continue;
+            float z = zA * px + zB * py + zC;
+            if (z < row[x]) row[x] = z;
+        }
+    }
+#endif
+}
+
+bool OcclusionCuller::testAabb(const glm::vec3& minB, const glm::vec3& maxB) {
+    st.tests++;
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1e30f;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 p((i & 1) ? maxB.x : minB.x, (i & 2) ? maxB.y : minB.y, (i & 4) ? maxB.z : minB.z);
+        glm::vec4 clip = vp * glm::vec4(p, 1.0f);
+        if (clip.w <= NEAR_W) return true; // reaches behind the camera; assume visible
+        float iw = 1.0f / clip.w;
+        float sx = (clip.x * iw * 0.5f + 0.5f) * (float)w;
+        float sy = (clip.y * iw * 0.5f + 0.5f) * (float)h;
+        minX = std::min(minX, sx);
+        maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy);
+        maxY = std::max(maxY, sy);
+        minZ = std::min(minZ, clip.z * iw * 0.5f + 0.5f);
+    }
+    if (maxX < 0.0f || maxY < 0.0f || minX > (float)w || minY > (float)h || minZ > 1.0f) {
+        st.culled++;
+        return false;
+    }
+
+    // Widening the rect to whole SIMD groups only adds pixels, so stays conservative.
+    int x0 = std::max(0, (int)std::floor(minX)) & ~3;
+    int x1 = std::min(w - 1, (int)std::ceil(maxX));
+    int y0 = std::max(0, (int)std::floor(minY));
+    int y1 = std::min(h - 1, (int)std::ceil(maxY));
+#if OCCLUSION_SSE2
+    const __m128 zmin = _mm_set1_ps(minZ);
+    for (int y = y0; y <= y1; y++) {
+        const float* row = buffer.data() + (size_t)y * w;
+        for (int x = x0; x <= x1; x += 4) {
+            if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), zmin))) return true;
+        }
+    }
+#else
+    for (int y = y0; y <= y1; y++) {
+        const float* row = buffer.data() + (size_t)y * w;
+        for (int x = x0; x <= x1; x++) {
+            if (row[x] >= minZ) return true;
+        }
+    }
+#endif
+    st.culled++;
+    return false;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// CPU occlusion culling against a small software depth buffer. Occluders are
+// boxes rasterized four pixels at a time (SSE2 where available, scalar
+// otherwise); bounds are then tested against the nearest depth they could
+// have. Pure CPU, no GL state.
+class OcclusionCuller {
+public:
+    struct Stats {
+        int occluders = 0;
+        int rejectedOccluders = 0; // reaching behind the near plane
+        int tests = 0;
+        int culled = 0;
+    };
+
+    // Clears the buffer for a new view; width is rounded up to a multiple of 4.
+    void begin(const glm::mat4& viewProj, int width = 256, int height = 128);
+
+    // Oriented box (yaw about +Y). Returns false if it was not rasterized.
+    bool addOccluderBox(const glm::vec3& center, const glm::vec3& halfExtents, float yaw);
+
+    // False only when the box is certainly hidden (or entirely off screen).
+    bool testAabb(const glm::vec3& minB, const glm::vec3& maxB);
+
+    int width() const { return w; }
+    int height() const { return h; }
+    const float* depth() const { return buffer.data(); } // 0 = near, 1 = far / empty
+    const Stats& stats() const { return st; }
+
+private:
+    struct ScreenVert {
+        float x, y, z;
+    };
+    void rasterizeTriangle(const ScreenVert& v0, const ScreenVert& v1, const ScreenVert& v2);
+
+    glm::mat4 vp{1.0f};
+    int w = 0;
+    int h = 0;
+    std::vector<float> buffer;
+    Stats st;
+};
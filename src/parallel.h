@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+inline int ParallelWorkerCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return (n == 0) ? 4 : (int)n;
+}
+
+// ParallelWorkerCount() - 1 threads started on first use and kept for the life of
+// the process; the calling thread is the remaining worker. Several threads may
+// run jobs at once: idle pool threads join whichever job still has indices left.
+class ParallelPool {
+public:
+    struct Job {
+        int count = 0;
+        std::atomic<int> next{0};
+        int helpers = 0; // pool threads inside the job, under the pool mutex
+        void (*call)(void* fn, int index, int worker) = nullptr;
+        void* fn = nullptr;
+
+        void drain(int worker) {
+            for (;;) {
+                int i = next.fetch_add(1, std::memory_order_relaxed);
+                if (i >= count) break;
+                call(fn, i, worker);
+            }
+        }
+    };
+
+    static ParallelPool& instance() {
+        static ParallelPool pool;
+        return pool;
+    }
+
+    // Returns once every index of `job` has run; the caller is worker 0.
+    void run(Job& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(&job);
+        }
+        wake.notify_all();
+        job.drain(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+        idle.wait(lock, [&job] { return job.helpers == 0; });
+    }
+
+private:
+    ParallelPool() {
+        for (int w = 1; w < ParallelWorkerCount(); w++) threads.emplace_back(&ParallelPool::loop, this, w);
+    }
+
+    ~ParallelPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    Job* openJob() const {
+        for (Job* job : jobs) {
+            if (job->next.load(std::memory_order_relaxed) < job->count) return job;
+        }
+        return nullptr;
+    }
+
+    void loop(int worker) {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            Job* job = nullptr;
+            wake.wait(lock, [&] { return quit || (job = openJob()) != nullptr; });
+            if (quit) return;
+            job->helpers++;
+            lock.unlock();
+            job->drain(worker);
+            lock.lock();
+            if (--job->helpers == 0) idle.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::vector<Job*> jobs;
+    std::vector<std::thread> threads;
+    bool quit = false;
+};
+
+// Calls fn(index, worker) for every index in [0, count) on the shared pool.
+// Indices are handed out one at a time so uneven jobs balance themselves;
+// worker is in [0, ParallelWorkerCount()) and can index per-thread scratch.
+template <typename Fn>
+void ParallelFor(int count, Fn&& fn) {
+    if (count <= 0) return;
+    if (count == 1 || ParallelWorkerCount() == 1) {
+        for (int i = 0; i < count; i++) fn(i, 0);
+        return;
+    }
+    using F = std::remove_reference_t<Fn>;
+    ParallelPool::Job job;
+    job.count = count;
+    job.fn = (void*)&fn;
+    job.call = [](void* f, int index, int worker) { (*static_cast<F*>(f))(index, worker); };
+    ParallelPool::instance().run(job);
+}
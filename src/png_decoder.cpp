@@ -0,0 +1,475 @@
+#include "png_decoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+uint32_t ReadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// --- inflate (RFC 1950/1951) ---
+
+constexpr int MAX_BITS = 15;
+constexpr int FAST_BITS = 10;
+
+struct Huffman {
+    uint16_t count[MAX_BITS + 1] = {};
+    uint16_t symbol[288] = {};
+    uint16_t fast[1 << FAST_BITS] = {}; // (length << 9) | symbol, 0 = use the slow path
+
+    bool build(const uint8_t* lengths, int n) {
+        std::memset(count, 0, sizeof(count));
+        std::memset(fast, 0, sizeof(fast));
+        for (int i = 0; i < n; i++) count[lengths[i]]++;
+        count[0] = 0;
+        int left = 1;
+        for (int len = 1; len <= MAX_BITS; len++) {
+            left = (left << 1) - count[len];
+            if (left < 0) return false; // over-subscribed
+        }
+        uint16_t offs[MAX_BITS + 2] = {};
+        for (int len = 1; len <= MAX_BITS; len++) offs[len + 1] = offs[len] + count[len];
+        for (int i = 0; i < n; i++) {
+            if (lengths[i]) symbol[offs[lengths[i]]++] = (uint16_t)i;
+        }
+        // Canonical codes are assigned MSB-first but read LSB-first, so the fast
+        // table is indexed by the bit-reversed code.
+        int code = 0;
+        int index = 0;
+        for (int len = 1; len <= FAST_BITS; len++) {
+            for (int k = 0; k < count[len]; k++, index++, code++) {
+                int rev = 0;
+                for (int b = 0; b < len; b++) rev |= ((code >> b) & 1) << (len - 1 - b);
+                for (int j = rev; j < (1 << FAST_BITS); j += 1 << len) {
+                    fast[j] = (uint16_t)((len << 9) | symbol[index]);
+                }
+            }
+            code <<= 1;
+        }
+        return true;
+    }
+};
+
+const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+constexpr std::size_t WINDOW = 32768;
+
+// Inflates into a buffer that is handed to drain() whenever it fills up; drain
+// consumes what it can and the buffer is compacted down to the 32 KB window.
+class Inflater {
+public:
+    Inflater(const uint8_t* in, std::size_t size, std::function<bool(Inflater&)> drain)
+        : in(in), inSize(size), drain(std::move(drain)) {
+        out.resize(FLUSH_AT + 512);
+    }
+
+    bool run() {
+        if (inSize < 2) return false;
+        uint8_t cmf = in[0], flg = in[1];
+        if ((cmf & 0x0f) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) return false;
+        pos = 2;
+        bool last = false;
+        while (!last) {
+            last = bits(1) != 0;
+            int type = (int)bits(2);
+            bool ok = false;
+            if (type == 0) ok = stored();
+            else if (type == 1) ok = fixed();
+            else if (type == 2) ok = dynamic();
+            if (!ok || overrun) return false;
+        }
+        return flush();
+    }
+
+    // Decoded bytes not yet consumed by drain().
+    const uint8_t* pending() const { return out.data() + consumed; }
+    std::size_t pendingSize() const { return outLen - consumed; }
+    void consume(std::size_t n) { consumed += n; }
+
+private:
+    static constexpr std::size_t FLUSH_AT = 4u << 20;
+
+    uint32_t bits(int need) {
+        while (bitCount < need) {
+            uint64_t byte = 0;
+            if (pos < inSize) byte = in[pos++];
+            else if (++padBytes > 4) overrun = true;
+            bitBuf |= byte << bitCount;
+            bitCount += 8;
+        }
+        uint32_t v = (uint32_t)(bitBuf & ((uint64_t(1) << need) - 1));
+        bitBuf >>= need;
+        bitCount -= need;
+        return v;
+    }
+
+    void fill() {
+        while (bitCount <= 56) {
+            uint64_t byte = 0;
+            if (pos < inSize) byte = in[pos++];
+            else if (++padBytes > 8) { overrun = true; return; }
+            bitBuf |= byte << bitCount;
+            bitCount += 8;
+        }
+    }
+
+    int decode(const Huffman& h) {
+        if (bitCount < 16) fill();
+        uint16_t e = h.fast[bitBuf & ((1u << FAST_BITS) - 1)];
+        if (e) {
+            int len = e >> 9;
+            bitBuf >>= len;
+            bitCount -= len;
+            return e & 511;
+        }
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= MAX_BITS; len++) {
+            code |= (int)bits(1);
+            int count = h.count[len];
+            if (code - count < first) return h.symbol[index + (code - first)];
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    bool flush() {
+        if (!drain(*this)) return false;
+        // Keep the window plus whatever drain could not use yet.
+        std::size_t keepFrom = std::min(consumed, outLen > WINDOW ? outLen - WINDOW : 0);
+        if (keepFrom > 0) {
+            std::memmove(out.data(), out.data() + keepFrom, outLen - keepFrom);
+            outLen -= keepFrom;
+            consumed -= keepFrom;
+        }
+        if (out.size() < outLen + FLUSH_AT) out.resize(outLen + FLUSH_AT + 512);
+        flushAt = outLen + FLUSH_AT;
+        return true;
+    }
+
+    bool put(uint8_t b) {
+        if (outLen >= flushAt && !flush()) return false;
+        out[outLen++] = b;
+        return true;
+    }
+
+    bool stored() {
+        bitBuf >>= bitCount & 7;
+        bitCount -= bitCount & 7;
+        uint32_t len = bits(16);
+        uint32_t nlen = bits(16);
+        if ((len ^ 0xffff) != nlen) return false;
+        while (len > 0 && bitCount >= 8) {
+            if (!put((uint8_t)bits(8))) return false;
+            len--;
+        }
+        if (pos + len > inSize) return false;
+        for (uint32_t i = 0; i < len; i++) {
+            if (!put(in[pos + i])) return false;
+        }
+        pos += len;
+        return true;
+    }
+
+    bool codes(const Huffman& lit, const Huffman& dist) {
+        for (;;) {
+            int sym = decode(lit);
+            if (sym < 0 || overrun) return false;
+            if (sym < 256) {
+                if (!put((uint8_t)sym)) return false;
+                continue;
+            }
+            if (sym == 256) return true;
+            sym -= 257;
+            if (sym >= 29) return false;
+            std::size_t len = LENGTH_BASE[sym] + bits(LENGTH_EXTRA[sym]);
+            int dsym = decode(dist);
+            if (dsym < 0 || dsym >= 30) return false;
+            std::size_t d = DIST_BASE[dsym] + bits(DIST_EXTRA[dsym]);
+            if (outLen + len > flushAt && !flush()) return false;
+            if (d > outLen) return false;
+            uint8_t* dst = out.data() + outLen;
+            const uint8_t* src = dst - d;
+            for (std::size_t i = 0; i < len; i++) dst[i] = src[i]; // may overlap
+            outLen += len;
+        }
+    }
+
+    struct FixedTables {
+        Huffman lit;
+        Huffman dist;
+    };
+
+    static FixedTables BuildFixed() {
+        FixedTables t;
+        uint8_t lengths[288];
+        int i = 0;
+        for (; i < 144; i++) lengths[i] = 8;
+        for (; i < 256; i++) lengths[i] = 9;
+        for (; i < 280; i++) lengths[i] = 7;
+        for (; i < 288; i++) lengths[i] = 8;
+        t.lit.build(lengths, 288);
+        for (i = 0; i < 30; i++) lengths[i] = 5;
+        t.dist.build(lengths, 30);
+        return t;
+    }
+
+    bool fixed() {
+        // Built once; the static's initialization is thread-safe, and texture
+        // cooking decodes from several workers.
+        static const FixedTables tables = BuildFixed();
+        return codes(tables.lit, tables.dist);
+    }
+
+    bool dynamic() {
+        static const uint8_t ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        int nlen = (int)bits(5) + 257;
+        int ndist = (int)bits(5) + 1;
+        int ncode = (int)bits(4) + 4;
+        if (nlen > 286 || ndist > 30) return false;
+        uint8_t lengths[320] = {};
+        for (int i = 0; i < ncode; i++) lengths[ORDER[i]] = (uint8_t)bits(3);
+        Huffman lencode;
+        if (!lencode.build(lengths, 19)) return false;
+        std::memset(lengths, 0, sizeof(lengths));
+        int index = 0;
+        while (index < nlen + ndist) {
+            int sym = decode(lencode);
+            if (sym < 0) return false;
+            if (sym < 16) {
+                lengths[index++] = (uint8_t)sym;
+                continue;
+            }
+            uint8_t len = 0;
+            int repeat;
+            if (sym == 16) {
+                if (index == 0) return false;
+                len = lengths[index - 1];
+                repeat = 3 + (int)bits(2);
+            } else if (sym == 17) {
+                repeat = 3 + (int)bits(3);
+            } else {
+                repeat = 11 + (int)bits(7);
+            }
+            if (index + repeat > nlen + ndist) return false;
+            while (repeat--) lengths[index++] = len;
+        }
+        if (lengths[256] == 0) return false;
+        Huffman lit, dist;
+        if (!lit.build(lengths, nlen) || !dist.build(lengths + nlen, ndist)) return false;
+        return codes(lit, dist);
+    }
+
+    const uint8_t* in;
+    std::size_t inSize;
+    std::size_t pos = 0;
+    uint64_t bitBuf = 0;
+    int bitCount = 0;
+    int padBytes = 0;
+    bool overrun = false;
+
+    std::function<bool(Inflater&)> drain;
+    std::vector<uint8_t> out;
+    std::size_t outLen = 0;
+    std::size_t consumed = 0;
+    std::size_t flushAt = FLUSH_AT;
+};
+
+// --- PNG ---
+
+struct PngInfo {
+    int w = 0, h = 0;
+    int depth = 0;
+    int colorType = 0;
+    int channels = 0;
+    uint8_t palette[256][4] = {};
+    bool hasKey = false;
+    uint16_t key[3] = {};
+};
+
+int Paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return (pb <= pc) ? b : c;
+}
+
+bool Unfilter(int filter, uint8_t* row, const uint8_t* prev, std::size_t len, int bpp) {
+    switch (filter) {
+    case 0: break;
+    case 1: for (std::size_t i = bpp; i < len; i++) row[i] = (uint8_t)(row[i] + row[i - bpp]); break;
+    case 2: for (std::size_t i = 0; i < len; i++) row[i] = (uint8_t)(row[i] + prev[i]); break;
+    case 3:
+        for (std::size_t i = 0; i < len; i++) {
+            int left = (i >= (std::size_t)bpp) ? row[i - bpp] : 0;
+            row[i] = (uint8_t)(row[i] + ((left + prev[i]) >> 1));
+        }
+        break;
+    case 4:
+        for (std::size_t i = 0; i < len; i++) {
+            int left = (i >= (std::size_t)bpp) ? row[i - bpp] : 0;
+            int upLeft = (i >= (std::size_t)bpp) ? prev[i - bpp] : 0;
+            row[i] = (uint8_t)(row[i] + Paeth(left, prev[i], upLeft));
+        }
+        break;
+    default: return false;
+    }
+    return true;
+}
+
+void ExpandRow(const PngInfo& info, const uint8_t* src, uint8_t* rgba) {
+    const int w = info.w;
+    if (info.depth < 8) {
+        const int perByte = 8 / info.depth;
+        const int mask = (1 << info.depth) - 1;
+        const int scale = (info.colorType == 0) ? 255 / mask : 1;
+        for (int x = 0; x < w; x++) {
+            int shift = 8 - info.depth * (x % perByte + 1);
+            int v = (src[x / perByte] >> shift) & mask;
+            uint8_t* p = rgba + x * 4;
+            if (info.colorType == 3) {
+                std::memcpy(p, info.palette[v], 4);
+            } else {
+                uint8_t g = (uint8_t)(v * scale);
+                p[0] = p[1] = p[2] = g;
+                p[3] = (info.hasKey && v == info.key[0]) ? 0 : 255;
+            }
+        }
+        return;
+    }
+    const int bytes = info.depth / 8; // 1 or 2, high byte first
+    const int c = info.channels;
+    for (int x = 0; x < w; x++) {
+        const uint8_t* s = src + (std::size_t)x * c * bytes;
+        uint8_t* p = rgba + x * 4;
+        uint16_t raw[4] = {};
+        for (int i = 0; i < c; i++) raw[i] = (bytes == 2) ? (uint16_t)((s[i * 2] << 8) | s[i * 2 + 1]) : s[i];
+        auto to8 = [&](int i) { return (uint8_t)(bytes == 2 ? raw[i] >> 8 : raw[i]); };
+        switch (info.colorType) {
+        case 0:
+            p[0] = p[1] = p[2] = to8(0);
+            p[3] = (info.hasKey && raw[0] == info.key[0]) ? 0 : 255;
+            break;
+        case 2:
+            p[0] = to8(0); p[1] = to8(1); p[2] = to8(2);
+            p[3] = (info.hasKey && raw[0] == info.key[0] && raw[1] == info.key[1] && raw[2] == info.key[2]) ? 0 : 255;
+            break;
+        case 3:
+            std::memcpy(p, info.palette[raw[0]], 4);
+            break;
+        case 4:
+            p[0] = p[1] = p[2] = to8(0);
+            p[3] = to8(1);
+            break;
+        default:
+            p[0] = to8(0); p[1] = to8(1); p[2] = to8(2); p[3] = to8(3);
+            break;
+        }
+    }
+}
+
+} // namespace
+
+bool IsPngData(const uint8_t* data, std::size_t size) {
+    static const uint8_t SIG[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    return size >= 8 && std::memcmp(data, SIG, 8) == 0;
+}
+
+bool DecodePngRows(const uint8_t* data, std::size_t size, const ImageSizeFn& onSize, const ImageRowFn& onRow) {
+    if (!IsPngData(data, size)) return false;
+
+    PngInfo info;
+    for (int i = 0; i < 256; i++) info.palette[i][3] = 255;
+    std::vector<uint8_t> idat;
+    bool haveHeader = false;
+    std::size_t p = 8;
+    while (p + 12 <= size) {
+        uint32_t len = ReadBE32(data + p);
+        const uint8_t* type = data + p + 4;
+        const uint8_t* body = data + p + 8;
+        if (len > size - p - 12) return false;
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (len < 13) return false;
+            info.w = (int)ReadBE32(body);
+            info.h = (int)ReadBE32(body + 4);
+            info.depth = body[8];
+            info.colorType = body[9];
+            if (body[10] != 0 || body[11] != 0) return false;
+            if (body[12] != 0) return false; // Adam7 interlacing is not supported
+            haveHeader = true;
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            for (uint32_t i = 0; i < len / 3 && i < 256; i++) {
+                info.palette[i][0] = body[i * 3 + 0];
+                info.palette[i][1] = body[i * 3 + 1];
+                info.palette[i][2] = body[i * 3 + 2];
+            }
+        } else if (std::memcmp(type, "tRNS", 4) == 0) {
+            if (info.colorType == 3) {
+                for (uint32_t i = 0; i < len && i < 256; i++) info.palette[i][3] = body[i];
+            } else if (info.colorType == 0 && len >= 2) {
+                info.hasKey = true;
+                info.key[0] = (uint16_t)((body[0] << 8) | body[1]);
+            } else if (info.colorType == 2 && len >= 6) {
+                info.hasKey = true;
+                for (int i = 0; i < 3; i++) info.key[i] = (uint16_t)((body[i * 2] << 8) | body[i * 2 + 1]);
+            }
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            idat.insert(idat.end(), body, body + len);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        p += 12 + (std::size_t)len;
+    }
+    if (!haveHeader || info.w <= 0 || info.h <= 0 || idat.empty()) return false;
+
+    switch (info.colorType) {
+    case 0: info.channels = 1; break;
+    case 2: info.channels = 3; break;
+    case 3: info.channels = 1; break;
+    case 4: info.channels = 2; break;
+    case 6: info.channels = 4; break;
+    default: return false;
+    }
+    bool depthOk = (info.depth == 8) ||
+        (info.depth == 16 && info.colorType != 3) ||
+        ((info.depth == 1 || info.depth == 2 || info.depth == 4) && (info.colorType == 0 || info.colorType == 3));
+    if (!depthOk) return false;
+    if (!onSize(info.w, info.h)) return false;
+
+    const int bitsPerPixel = info.depth * info.channels;
+    const int bpp = std::max(1, bitsPerPixel / 8);
+    const std::size_t stride = ((std::size_t)info.w * bitsPerPixel + 7) / 8;
+    std::vector<uint8_t> prev(stride, 0), cur(stride), rgba((std::size_t)info.w * 4);
+    int y = 0;
+    bool bad = false;
+
+    auto drain = [&](Inflater& inf) {
+        while (y < info.h && inf.pendingSize() >= stride + 1) {
+            const uint8_t* line = inf.pending();
+            std::memcpy(cur.data(), line + 1, stride);
+            if (!Unfilter(line[0], cur.data(), prev.data(), stride, bpp)) {
+                bad = true;
+                return false;
+            }
+            ExpandRow(info, cur.data(), rgba.data());
+            onRow(y, rgba.data());
+            prev.swap(cur);
+            inf.consume(stride + 1);
+            y++;
+        }
+        return true;
+    };
+    Inflater inflater(idat.data(), idat.size(), drain);
+    return inflater.run() && !bad && y == info.h;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+using ImageSizeFn = std::function<bool(int w, int h)>;
+// Called once per row, top to bottom, with w RGBA8 pixels.
+using ImageRowFn = std::function<void(int y, const uint8_t* rgba)>;
+
+// Streams a non-interlaced PNG (any bit depth / colour type) row by row, so the
+// full image never has to be held in memory. Returns false on unsupported or
+// corrupt input, or when onSize declines the image.
+bool DecodePngRows(const uint8_t* data, std::size_t size, const ImageSizeFn& onSize, const ImageRowFn& onRow);
+
+bool IsPngData(const uint8_t* data, std::size_t size);
@@ -0,0 +1,133 @@
+#include "region_file.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+struct RegionHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t cellDim;
+    uint32_t pageSize;
+    uint64_t chunkCount;
+    uint64_t indexOffset;
+};
+constexpr std::size_t HEADER_BYTES = 64;
+static_assert(sizeof(RegionHeader) <= HEADER_BYTES, "region header too large");
+static_assert(sizeof(RegionChunkEntry) == 24, "region index entry must stay packed");
+
+std::size_t AlignUp(std::size_t v, std::size_t a) {
+    return (v + a - 1) / a * a;
+}
+
+} // namespace
+
+bool RegionFile::write(const std::string& path, const std::vector<uint64_t>& keys,
+    ZoneCellsFn zoneCells, WaterBitsFn waterBits, const void* ctx)
+{
+    std::vector<RegionChunkEntry> entries;
+    entries.reserve(keys.size());
+    for (uint64_t key : keys) {
+        RegionChunkEntry e;
+        e.key = key;
+        // Offsets are assigned below; a non-zero marker records presence for now.
+        e.zoneOffset = zoneCells(ctx, key) ? 1 : 0;
+        e.waterOffset = waterBits(ctx, key) ? 1 : 0;
+        if (e.zoneOffset || e.waterOffset) entries.push_back(e);
+    }
+    std::sort(entries.begin(), entries.end(), [](const RegionChunkEntry& a, const RegionChunkEntry& b) { return a.key < b.key; });
+    entries.erase(std::unique(entries.begin(), entries.end(),
+        [](const RegionChunkEntry& a, const RegionChunkEntry& b) { return a.key == b.key; }), entries.end());
+
+    std::size_t offset = AlignUp(HEADER_BYTES + entries.size() * sizeof(RegionChunkEntry), PAGE);
+    for (RegionChunkEntry& e : entries) {
+        if (e.zoneOffset) { e.zoneOffset = offset; offset += AlignUp(CELLS, PAGE); }
+        if (e.waterOffset) { e.waterOffset = offset; offset += AlignUp(WATER_BYTES, PAGE); }
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    RegionHeader header{MAGIC, VERSION, (uint32_t)ZoneChunk::DIM, (uint32_t)PAGE, entries.size(), HEADER_BYTES};
+    std::vector<char> pad(PAGE, 0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(pad.data(), HEADER_BYTES - sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), (std::streamsize)(entries.size() * sizeof(RegionChunkEntry)));
+    std::size_t written = HEADER_BYTES + entries.size() * sizeof(RegionChunkEntry);
+    auto padTo = [&](std::size_t target) {
+        while (written < target) {
+            std::size_t n = std::min(pad.size(), target - written);
+            out.write(pad.data(), (std::streamsize)n);
+            written += n;
+        }
+    };
+    for (const RegionChunkEntry& e : entries) {
+        if (e.zoneOffset) {
+            padTo(e.zoneOffset);
+            out.write(reinterpret_cast<const char*>(zoneCells(ctx, e.key)), CELLS);
+            written += CELLS;
+        }
+        if (e.waterOffset) {
+            padTo(e.waterOffset);
+            out.write(reinterpret_cast<const char*>(waterBits(ctx, e.key)), WATER_BYTES);
+            written += WATER_BYTES;
+        }
+    }
+    padTo(offset);
+    return (bool)out;
+}
+
+bool RegionFile::open(const std::string& path) {
+    close();
+    if (!file.open(path)) return false;
+    const uint8_t* data = file.data();
+    std::size_t size = file.size();
+    RegionHeader header{};
+    if (size >= sizeof(header)) std::memcpy(&header, data, sizeof(header));
+    if (size < HEADER_BYTES || header.magic != MAGIC || header.version != VERSION ||
+        header.cellDim != (uint32_t)ZoneChunk::DIM || header.pageSize != PAGE ||
+        header.indexOffset + header.chunkCount * sizeof(RegionChunkEntry) > size) {
+        SDL_Log("Region file %s is invalid", path.c_str());
+        file.close();
+        return false;
+    }
+    index = reinterpret_cast<const RegionChunkEntry*>(data + header.indexOffset);
+    count = (std::size_t)header.chunkCount;
+    for (std::size_t i = 0; i < count; i++) {
+        const RegionChunkEntry& e = index[i];
+        if ((e.zoneOffset && e.zoneOffset + CELLS > size) || (e.waterOffset && e.waterOffset + WATER_BYTES > size)) {
+            SDL_Log("Region file %s is truncated", path.c_str());
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void RegionFile::close() {
+    file.close();
+    index = nullptr;
+    count = 0;
+}
+
+const RegionChunkEntry* RegionFile::find(uint64_t key) const {
+    if (!index) return nullptr;
+    const RegionChunkEntry* end = index + count;
+    const RegionChunkEntry* it = std::lower_bound(index, end, key,
+        [](const RegionChunkEntry& e, uint64_t k) { return e.key < k; });
+    return (it != end && it->key == key) ? it : nullptr;
+}
+
+const uint8_t* RegionFile::zoneCells(uint64_t key) const {
+    const RegionChunkEntry* e = find(key);
+    return (e && e->zoneOffset) ? file.data() + e->zoneOffset : nullptr;
+}
+
+const uint64_t* RegionFile::waterBits(uint64_t key) const {
+    const RegionChunkEntry* e = find(key);
+    return (e && e->waterOffset) ? reinterpret_cast<const uint64_t*>(file.data() + e->waterOffset) : nullptr;
+}
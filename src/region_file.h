@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "zone_grid.h"
+
+struct RegionChunkEntry {
+    uint64_t key = 0;
+    uint64_t zoneOffset = 0;  // 0 = chunk has no zone cells
+    uint64_t waterOffset = 0; // 0 = chunk has no water cells
+};
+
+// Zone and water cells for every chunk of a city in one file. The index is sorted
+// by chunk key and every cell payload starts on its own page, so chunks are read
+// straight out of the mapping and the OS pages them in on first touch.
+class RegionFile {
+public:
+    static constexpr uint32_t MAGIC = 0x47525043; // "CPRG"
+    static constexpr uint32_t VERSION = 2;
+    static constexpr std::size_t PAGE = 4096;
+    static constexpr std::size_t CELLS = (std::size_t)ZoneChunk::DIM * ZoneChunk::DIM;
+    static constexpr std::size_t WATER_BYTES = sizeof(WaterChunk::bits);
+
+    using ZoneCellsFn = const uint8_t* (*)(const void* ctx, uint64_t key);
+    using WaterBitsFn = const uint64_t* (*)(const void* ctx, uint64_t key);
+
+    // Writes every chunk that has zone or water cells; cells come from the callbacks
+    // so chunks can be sourced from an existing mapping as well as from memory.
+    static bool write(const std::string& path, const std::vector<uint64_t>& keys,
+        ZoneCellsFn zoneCells, WaterBitsFn waterBits, const void* ctx);
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return file.data() != nullptr; }
+
+    std::size_t chunkCount() const { return count; }
+    const RegionChunkEntry& entry(std::size_t i) const { return index[i]; }
+    const uint8_t* zoneCells(uint64_t key) const;
+    const uint64_t* waterBits(uint64_t key) const;
+
+private:
+    const RegionChunkEntry* find(uint64_t key) const;
+
+    MappedFile file;
+    const RegionChunkEntry* index = nullptr;
+    std::size_t count = 0;
+};
@@ -1,14 +1,18 @@
 #include "renderer.h"
 
 #include "config.h"
-#include "image_loader.h"
 #include "mesh_cache.h"
+#include "texture_cache.h"
+#include "zone_grid.h"
 
 #include <SDL.h>
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <iterator>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -20,95 +24,46 @@ struct VertexPN {
     glm::vec3 normal;
 };
 
-GLuint MakeProgram(const char* vsSrc, const char* fsSrc);
-bool GLCheckShader(GLuint shader, const char* label);
-bool GLCheckProgram(GLuint prog);
-void SetupInstanceAttribs(GLuint vao, GLuint instanceVbo);
+// std140 mirror of the FrameLighting block; vec3 + float pairs fill one slot each.
+struct FrameLightingUBO {
+    glm::mat4 lightViewProj[Renderer::SHADOW_CASCADES];
+    glm::vec4 shadowBias;
+    glm::vec3 sunDir;
+    float sunIntensity;
+    glm::vec3 sunColor;
+    float exposure;
+    glm::vec3 ambientColor;
+    float ambientIntensity;
+    glm::vec2 shadowTexel;
+    float shadowStrength;
+    float pad;
+};
+static_assert(sizeof(FrameLightingUBO) == 336, "FrameLightingUBO must match the std140 layout");
+static_assert(Renderer::SHADOW_CASCADES == 4, "uShadowBias is a vec4");
+
+constexpr GLuint FRAME_LIGHTING_BINDING = 0;
+
+// GL 4.2 / ARB_base_instance entry point; glad only loads 3.3.
+typedef void (APIENTRYP DrawElementsInstancedBaseVertexBaseInstanceFn)(GLenum mode, GLsizei count, GLenum type,
+    const void* indices, GLsizei instanceCount, GLint baseVertex, GLuint baseInstance);
+DrawElementsInstancedBaseVertexBaseInstanceFn pDrawElementsInstancedBaseVertexBaseInstance = nullptr;
+
+void PointInstanceAttribs(std::size_t firstInstance);
 void UploadDynamicVerts(GLuint vbo, std::size_t& capacityBytes, const std::vector<glm::vec3>& verts);
-void UploadDynamicRoadVerts(GLuint vbo, std::size_t& capacityBytes, const std::vector<RoadVertex>& verts);
 void UploadDynamicMats(GLuint vbo, std::size_t& capacityBytes, const std::vector<glm::mat4>& mats);
 GLuint CreateTextureFromRGBA(const uint8_t* pixels, int w, int h, bool srgb);
 GLuint CreateSolidTexture(uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool srgb);
-GLuint LoadTexture2D(const char* path, uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool srgb, bool* outOk);
 GLuint CreateSolidCubemap(uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool srgb);
-GLuint LoadCubemap(const char* faces[6], bool srgb, bool* outOk);
-bool CreateShadowMap(int size, GLuint& outFbo, GLuint& outTex);
-
-bool GLCheckShader(GLuint shader, const char* label) {
-    GLint ok = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
-    if (!ok) {
-        GLint len = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &len);
-        std::string log((size_t)len, '\0');
-        glGetShaderInfoLog(shader, len, &len, log.data());
-        SDL_Log("Shader compile failed (%s): %s", label, log.c_str());
-        return false;
-    }
-    return true;
-}
-
-bool GLCheckProgram(GLuint prog) {
-    GLint ok = 0;
-    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok) {
-        GLint len = 0;
-        glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
-        std::string log((size_t)len, '\0');
-        glGetProgramInfoLog(prog, len, &len, log.data());
-        SDL_Log("Program link failed: %s", log.c_str());
-        return false;
-    }
-    return true;
-}
-
-GLuint MakeProgram(const char* vsSrc, const char* fsSrc) {
-    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vs, 1, &vsSrc, nullptr);
-    glCompileShader(vs);
-    if (!GLCheckShader(vs, "VS")) {
-        glDeleteShader(vs);
-        return 0;
-    }
-
-    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, &fsSrc, nullptr);
-    glCompileShader(fs);
-    if (!GLCheckShader(fs, "FS")) {
-        glDeleteShader(vs);
-        glDeleteShader(fs);
-        return 0;
-    }
-
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
-    glLinkProgram(prog);
-    if (!GLCheckProgram(prog)) {
-        glDeleteShader(vs);
-        glDeleteShader(fs);
-        glDeleteProgram(prog);
-        return 0;
-    }
-
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-    return prog;
-}
-
-void SetupInstanceAttribs(GLuint vao, GLuint instanceVbo) {
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(HouseInstanceGPU), (void*)0);
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(HouseInstanceGPU), (void*)(sizeof(glm::vec4)));
-
-    glVertexAttribDivisor(2, 1);
-    glVertexAttribDivisor(3, 1);
-
-    glBindVertexArray(0);
+GLuint UploadCookedTexture(const CookedTexture& tex);
+bool CreateShadowMap(int size, int layers, GLuint& outFbo, GLuint& outTex);
+
+// Without base instance (GL 3.3) a batch's instance range is selected by moving
+// the attribute offsets. Expects the house VAO and instance buffer to be bound.
+void PointInstanceAttribs(std::size_t firstInstance) {
+    std::size_t base = firstInstance * sizeof(HouseInstanceGPU);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(HouseInstanceGPU), (void*)base);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(HouseInstanceGPU), (void*)(base + sizeof(glm::vec4)));
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(HouseInstanceGPU), (void*)(base + 2 * sizeof(glm::vec4)));
 }
 
 void UploadDynamicVerts(GLuint vbo, std::size_t& capacityBytes, const std::vector<glm::vec3>& verts) {
@@ -129,24 +84,6 @@ void UploadDynamicVerts(GLuint vbo, std::size_t& capacityBytes, const std::vecto
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void UploadDynamicRoadVerts(GLuint vbo, std::size_t& capacityBytes, const std::vector<RoadVertex>& verts) {
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    std::size_t bytes = verts.size() * sizeof(RoadVertex);
-    if (bytes == 0) {
-        glBufferData(GL_ARRAY_BUFFER, 1, nullptr, GL_DYNAMIC_DRAW);
-        capacityBytes = 0;
-    } else {
-        if (bytes > capacityBytes) {
-            capacityBytes = (std::size_t)(bytes * 1.5f) + 256;
-            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacityBytes, nullptr, GL_DYNAMIC_DRAW);
-        } else {
-            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacityBytes, nullptr, GL_DYNAMIC_DRAW); // orphan
-        }
-        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, verts.data());
-    }
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-}
-
 void UploadDynamicMats(GLuint vbo, std::size_t& capacityBytes, const std::vector<glm::mat4>& mats) {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     std::size_t bytes = mats.size() * sizeof(glm::mat4);
@@ -193,19 +130,6 @@ GLuint CreateSolidTexture(uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool srgb)
     return CreateTextureFromRGBA(pixel, 1, 1, srgb);
 }
 
-GLuint LoadTexture2D(const char* path, uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool srgb, bool* outOk) {
-    std::vector<uint8_t> pixels;
-    int w = 0;
-    int h = 0;
-    if (LoadImageRGBA(path, pixels, w, h)) {
-        if (outOk) *outOk = true;
-        return CreateTextureFromRGBA(pixels.data(), w, h, srgb);
-    }
-    if (outOk) *outOk = false;
-    SDL_Log("Texture load failed: %s", path);
-    return CreateSolidTexture(r, g, b, a, srgb);
-}
-
 GLuint CreateSolidCubemap(uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool srgb) {
     GLuint tex = 0;
     glGenTextures(1, &tex);
@@ -224,67 +148,81 @@ GLuint CreateSolidCubemap(uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool srgb)
     return tex;
 }
 
-GLuint LoadCubemap(const char* faces[6], bool srgb, bool* outOk) {
-    GLuint tex = 0;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, tex);
+// S3TC enums (EXT_texture_compression_s3tc / EXT_texture_sRGB) are not in the core header.
+constexpr GLenum GL_COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+constexpr GLenum GL_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+constexpr GLenum GL_COMPRESSED_SRGB_S3TC_DXT1 = 0x8C4C;
+constexpr GLenum GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5 = 0x8C4F;
+
+// Uploads every precooked level; cubemaps stay clamped as before.
+GLuint UploadCookedTexture(const CookedTexture& tex) {
+    const bool cube = tex.faces == 6;
+    const GLenum target = cube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    GLenum internalFormat = 0;
+    switch (tex.format) {
+    case TexFormat::RGBA8: internalFormat = tex.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8; break;
+    case TexFormat::BC1: internalFormat = tex.srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1 : GL_COMPRESSED_RGB_S3TC_DXT1; break;
+    case TexFormat::BC3: internalFormat = tex.srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5 : GL_COMPRESSED_RGBA_S3TC_DXT5; break;
+    case TexFormat::BC4: internalFormat = GL_COMPRESSED_RED_RGTC1; break;
+    }
 
-    bool ok = true;
-    int w = 0;
-    int h = 0;
-    std::vector<uint8_t> pixels;
-    GLenum internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
-    for (int i = 0; i < 6; ++i) {
-        int wi = 0;
-        int hi = 0;
-        if (!LoadImageRGBA(faces[i], pixels, wi, hi)) {
-            ok = false;
-            break;
-        }
-        if (i == 0) {
-            w = wi;
-            h = hi;
-        } else if (wi != w || hi != h) {
-            ok = false;
-            break;
+    GLuint handle = 0;
+    glGenTextures(1, &handle);
+    glBindTexture(target, handle);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int f = 0; f < tex.faces; ++f) {
+        GLenum faceTarget = cube ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + f : GL_TEXTURE_2D;
+        for (int l = 0; l < tex.levels; ++l) {
+            const TexLevel& level = tex.level(f, l);
+            if (tex.format == TexFormat::RGBA8) {
+                glTexImage2D(faceTarget, l, internalFormat, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex.levelData(f, l));
+            } else {
+                glCompressedTexImage2D(faceTarget, l, internalFormat, level.width, level.height, 0, (GLsizei)level.size, tex.levelData(f, l));
+            }
         }
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
     }
-
-    if (!ok) {
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-        glDeleteTextures(1, &tex);
-        if (outOk) *outOk = false;
-        return CreateSolidCubemap(120, 160, 210, 255, srgb);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, tex.levels - 1);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, tex.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (cube) {
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    } else {
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+#ifdef GL_TEXTURE_MAX_ANISOTROPY_EXT
+        float maxAniso = 0.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAniso);
+        if (maxAniso > 0.0f) {
+            float aniso = (maxAniso < 8.0f) ? maxAniso : 8.0f;
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, aniso);
+        }
+#endif
     }
-
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-    if (outOk) *outOk = true;
-    return tex;
+    glBindTexture(target, 0);
+    return handle;
 }
 
-bool CreateShadowMap(int size, GLuint& outFbo, GLuint& outTex) {
+bool CreateShadowMap(int size, int layers, GLuint& outFbo, GLuint& outTex) {
     glGenTextures(1, &outTex);
-    glBindTexture(GL_TEXTURE_2D, outTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, outTex);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
     float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
+    // The shadow pass re-attaches the layer of each cascade it redraws.
     glGenFramebuffers(1, &outFbo);
     glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, outTex, 0);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, outTex, 0, 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
@@ -298,6 +236,24 @@ bool CreateShadowMap(int size, GLuint& outFbo, GLuint& outTex) {
     return ok;
 }
 
+// True when every corner of the box is outside the same clip plane.
+bool AabbOutsideClip(const glm::mat4& viewProj, const glm::vec3& minB, const glm::vec3& maxB) {
+    int outside[6] = {};
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 p = viewProj * glm::vec4((i & 1) ? maxB.x : minB.x, (i & 2) ? maxB.y : minB.y, (i & 4) ? maxB.z : minB.z, 1.0f);
+        outside[0] += p.x < -p.w;
+        outside[1] += p.x > p.w;
+        outside[2] += p.y < -p.w;
+        outside[3] += p.y > p.w;
+        outside[4] += p.z < -p.w;
+        outside[5] += p.z > p.w;
+    }
+    for (int n : outside) {
+        if (n == 8) return true;
+    }
+    return false;
+}
+
 } // namespace
 
 bool Renderer::init() {
@@ -317,36 +273,49 @@ bool Renderer::init() {
 
     const char* vsInstanced = R"(
         #version 330 core
-        layout(location=0) in vec3 aPos;
-        layout(location=1) in vec3 aNormal;
+        layout(location=0) in uvec4 aPosQ;    // steps across the mesh bounds, w = bounds slot
+        layout(location=1) in vec2 aNormalOct;
         layout(location=2) in vec4 iPosYaw;   // xyz, yaw
         layout(location=3) in vec4 iScaleVar; // xyz scale
+        layout(location=4) in vec4 iAnim;     // start, 1/duration, start factor xz, y
         uniform mat4 uViewProj;
-        uniform mat4 uLightViewProj;
+        uniform float uTime;
+        uniform samplerBuffer uMeshBounds;    // per slot: min, step
         out vec3 vNormal;
-        out vec4 vLightPos;
+        out vec3 vShadowPos; // render space; the fragment shader picks the cascade
         out vec3 vLocalPos;
         out vec3 vLocalNormal;
         flat out float vFacadeIndex;
         flat out vec3 vScale;
+        vec3 DecodeOct(vec2 e) {
+            vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+            if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+            return normalize(n);
+        }
         void main() {
+            int slot = int(aPosQ.w) * 2;
+            vec3 meshPos = texelFetch(uMeshBounds, slot).xyz + vec3(aPosQ.xyz) * texelFetch(uMeshBounds, slot + 1).xyz;
+            vec3 meshNormal = DecodeOct(aNormalOct);
             float yaw = iPosYaw.w;
             mat3 R = mat3(
                 cos(yaw), 0.0, -sin(yaw),
                 0.0,      1.0,  0.0,
                 sin(yaw), 0.0,  cos(yaw)
             );
-            vec3 scale = max(iScaleVar.xyz, vec3(0.0001));
-            vec3 localPos = aPos * scale;
+            float t = clamp((uTime - iAnim.x) * iAnim.y, 0.0, 1.0);
+            float grow = 1.0 - (1.0 - t) * (1.0 - t);
+            vec3 scale = max(iScaleVar.xyz * mix(iAnim.zwz, vec3(1.0), grow), vec3(0.0001));
+            vec3 localPos = meshPos * scale;
             vec3 scaled = R * localPos;
             vec3 worldPos = iPosYaw.xyz + scaled;
+            worldPos.y -= 0.5 * (iScaleVar.y - scale.y); // grow from the ground; position is the final centre
             worldPos.y += 0.05; // lift houses off the ground to avoid z-fighting
             gl_Position = uViewProj * vec4(worldPos, 1.0);
             vec3 invScale = 1.0 / scale;
-            vNormal = normalize(R * (aNormal * invScale));
-            vLightPos = uLightViewProj * vec4(worldPos, 1.0);
+            vNormal = normalize(R * (meshNormal * invScale));
+            vShadowPos = worldPos;
             vLocalPos = localPos;
-            vLocalNormal = aNormal;
+            vLocalNormal = meshNormal;
             vFacadeIndex = iScaleVar.w;
             vScale = scale;
         }
@@ -359,35 +328,51 @@ bool Renderer::init() {
         uniform mat4 uModel;
         uniform float uGrassTileM;
         uniform float uNoiseTileM;
-        uniform mat4 uLightViewProj;
         out vec2 vGrassUV;
         out vec2 vNoiseUV;
         out vec3 vNormal;
-        out vec4 vLightPos;
+        out vec3 vShadowPos; // render space; the fragment shader picks the cascade
         void main() {
             vec4 world = uModel * vec4(aPos, 1.0);
             vGrassUV = world.xz / uGrassTileM;
             vNoiseUV = world.xz / uNoiseTileM;
             vNormal = vec3(0.0, 1.0, 0.0);
-            vLightPos = uLightViewProj * world;
+            vShadowPos = world.xyz;
             gl_Position = uViewProj * world;
         }
     )";
 
+    // One instance per RoadSegmentGPU; gl_VertexID picks the quad corner.
     const char* vsRoad = R"(
         #version 330 core
-        layout(location=0) in vec3 aPos;
-        layout(location=1) in vec2 aUV;
+        layout(location=0) in vec4 iEnds;     // a.xz, b.xz as fractions of the chunk
+        layout(location=1) in vec2 iV;        // texture V at a, b
+        layout(location=2) in int iSegment;
+        layout(location=3) in uint iHalfWidth; // 1/8 m
         uniform mat4 uViewProj;
-        uniform mat4 uLightViewProj;
+        uniform vec2 uOrigin;                 // chunk corner, render space
+        uniform float uChunkSize;
         out vec2 vUV;
         out vec3 vNormal;
-        out vec4 vLightPos;
+        out vec3 vShadowPos; // render space; the fragment shader picks the cascade
+        flat out int vSegment;
+        const float kEnd[6] = float[6](0.0, 0.0, 1.0, 0.0, 1.0, 1.0);
+        const float kSide[6] = float[6](-1.0, 1.0, 1.0, -1.0, 1.0, -1.0);
         void main() {
-            vec4 world = vec4(aPos, 1.0);
-            vUV = aUV;
+            vec2 a = uOrigin + iEnds.xy * uChunkSize;
+            vec2 b = uOrigin + iEnds.zw * uChunkSize;
+            vec2 d = b - a;
+            float len = length(d);
+            vec2 dir = (len > 1e-5) ? d / len : vec2(1.0, 0.0);
+            vec2 right = vec2(dir.y, -dir.x);
+            float end = kEnd[gl_VertexID];
+            float side = kSide[gl_VertexID];
+            vec2 p = mix(a, b, end) + right * side * (float(iHalfWidth) * 0.125);
+            vec4 world = vec4(p.x, 0.03, p.y, 1.0);
+            vUV = vec2(side * 0.5 + 0.5, mix(iV.x, iV.y, end));
+            vSegment = iSegment;
             vNormal = vec3(0.0, 1.0, 0.0);
-            vLightPos = uLightViewProj * world;
+            vShadowPos = world.xyz;
             gl_Position = uViewProj * world;
         }
     )";
@@ -445,43 +430,49 @@ bool Renderer::init() {
         in vec2 vGrassUV;
         in vec2 vNoiseUV;
         in vec3 vNormal;
-        in vec4 vLightPos;
+        in vec3 vShadowPos;
         out vec4 FragColor;
         uniform sampler2D uGrassTex;
         uniform sampler2D uNoiseTex;
-        uniform vec3 uSunDir;
-        uniform vec3 uSunColor;
-        uniform float uSunIntensity;
-        uniform vec3 uAmbientColor;
-        uniform float uAmbientIntensity;
-        uniform float uExposure;
-        uniform sampler2DShadow uShadowMap;
-        uniform vec2 uShadowTexel;
-        uniform float uShadowStrength;
+        const int SHADOW_CASCADES = 4;
+        layout(std140) uniform FrameLighting {
+            mat4 uLightViewProj[SHADOW_CASCADES];
+            vec4 uShadowBias; // depth units per cascade
+            vec3 uSunDir;
+            float uSunIntensity;
+            vec3 uSunColor;
+            float uExposure;
+            vec3 uAmbientColor;
+            float uAmbientIntensity;
+            vec2 uShadowTexel;
+            float uShadowStrength;
+        };
+        uniform sampler2DArrayShadow uShadowMap;
         vec3 ToneMap(vec3 color) {
             color *= uExposure;
             color = color / (color + vec3(1.0));
             color = pow(color, vec3(1.0 / 2.2));
             return color;
         }
-        float ShadowVisibility(vec4 lightPos, vec3 normal) {
+        float ShadowVisibility(vec3 worldPos, vec3 normal) {
             if (uShadowStrength <= 0.0) return 1.0;
-            vec3 proj = lightPos.xyz / lightPos.w;
-            proj = proj * 0.5 + 0.5;
-            if (proj.z > 1.0 || proj.x < 0.0 || proj.x > 1.0 || proj.y < 0.0 || proj.y > 1.0) {
-                return 1.0;
-            }
             float ndotl = max(dot(normal, uSunDir), 0.0);
-            float bias = max(0.0015 * (1.0 - ndotl), 0.0005);
-            float shadow = 0.0;
-            for (int x = -1; x <= 1; x++) {
-                for (int y = -1; y <= 1; y++) {
-                    vec2 offset = vec2(x, y) * uShadowTexel;
-                    shadow += texture(uShadowMap, vec3(proj.xy + offset, proj.z - bias));
+            vec2 margin = 2.0 * uShadowTexel;
+            // Nearest cascade that covers the point with room for the filter taps
+            for (int c = 0; c < SHADOW_CASCADES; c++) {
+                vec3 proj = (uLightViewProj[c] * vec4(worldPos, 1.0)).xyz * 0.5 + 0.5;
+                if (any(lessThan(proj.xy, margin)) || any(greaterThan(proj.xy, 1.0 - margin)) || proj.z > 1.0) continue;
+                float bias = uShadowBias[c] * (1.0 + 2.0 * (1.0 - ndotl));
+                float shadow = 0.0;
+                for (int x = -1; x <= 1; x++) {
+                    for (int y = -1; y <= 1; y++) {
+                        vec2 offset = vec2(x, y) * uShadowTexel;
+                        shadow += texture(uShadowMap, vec4(proj.xy + offset, float(c), proj.z - bias));
+                    }
                 }
+                return mix(1.0, shadow / 9.0, uShadowStrength);
             }
-            shadow /= 9.0;
-            return mix(1.0, shadow, uShadowStrength);
+            return 1.0;
         }
         void main() {
             vec3 grass = texture(uGrassTex, vGrassUV).rgb;
@@ -490,7 +481,7 @@ bool Renderer::init() {
             vec3 base = grass * shade;
             vec3 normal = normalize(vNormal);
             float ndotl = max(dot(normal, uSunDir), 0.0);
-            float shadow = ShadowVisibility(vLightPos, normal);
+            float shadow = ShadowVisibility(vShadowPos, normal);
             vec3 ambient = uAmbientColor * uAmbientIntensity;
             vec3 direct = uSunColor * uSunIntensity * ndotl * shadow;
             vec3 color = base * (ambient + direct);
@@ -502,48 +493,63 @@ bool Renderer::init() {
         #version 330 core
         in vec2 vUV;
         in vec3 vNormal;
-        in vec4 vLightPos;
+        in vec3 vShadowPos;
+        flat in int vSegment;
         out vec4 FragColor;
         uniform sampler2D uRoadTex;
-        uniform vec3 uSunDir;
-        uniform vec3 uSunColor;
-        uniform float uSunIntensity;
-        uniform vec3 uAmbientColor;
-        uniform float uAmbientIntensity;
-        uniform float uExposure;
-        uniform sampler2DShadow uShadowMap;
-        uniform vec2 uShadowTexel;
-        uniform float uShadowStrength;
+        uniform samplerBuffer uCongestion;
+        uniform float uHeatmap;
+        const int SHADOW_CASCADES = 4;
+        layout(std140) uniform FrameLighting {
+            mat4 uLightViewProj[SHADOW_CASCADES];
+            vec4 uShadowBias; // depth units per cascade
+            vec3 uSunDir;
+            float uSunIntensity;
+            vec3 uSunColor;
+            float uExposure;
+            vec3 uAmbientColor;
+            float uAmbientIntensity;
+            vec2 uShadowTexel;
+            float uShadowStrength;
+        };
+        uniform sampler2DArrayShadow uShadowMap;
         vec3 ToneMap(vec3 color) {
             color *= uExposure;
             color = color / (color + vec3(1.0));
             color = pow(color, vec3(1.0 / 2.2));
             return color;
         }
-        float ShadowVisibility(vec4 lightPos, vec3 normal) {
+        float ShadowVisibility(vec3 worldPos, vec3 normal) {
             if (uShadowStrength <= 0.0) return 1.0;
-            vec3 proj = lightPos.xyz / lightPos.w;
-            proj = proj * 0.5 + 0.5;
-            if (proj.z > 1.0 || proj.x < 0.0 || proj.x > 1.0 || proj.y < 0.0 || proj.y > 1.0) {
-                return 1.0;
-            }
             float ndotl = max(dot(normal, uSunDir), 0.0);
-            float bias = max(0.0015 * (1.0 - ndotl), 0.0005);
-            float shadow = 0.0;
-            for (int x = -1; x <= 1; x++) {
-                for (int y = -1; y <= 1; y++) {
-                    vec2 offset = vec2(x, y) * uShadowTexel;
-                    shadow += texture(uShadowMap, vec3(proj.xy + offset, proj.z - bias));
+            vec2 margin = 2.0 * uShadowTexel;
+            // Nearest cascade that covers the point with room for the filter taps
+            for (int c = 0; c < SHADOW_CASCADES; c++) {
+                vec3 proj = (uLightViewProj[c] * vec4(worldPos, 1.0)).xyz * 0.5 + 0.5;
+                if (any(lessThan(proj.xy, margin)) || any(greaterThan(proj.xy, 1.0 - margin)) || proj.z > 1.0) continue;
+                float bias = uShadowBias[c] * (1.0 + 2.0 * (1.0 - ndotl));
+                float shadow = 0.0;
+                for (int x = -1; x <= 1; x++) {
+                    for (int y = -1; y <= 1; y++) {
+                        vec2 offset = vec2(x, y) * uShadowTexel;
+                        shadow += texture(uShadowMap, vec4(proj.xy + offset, float(c), proj.z - bias));
+                    }
                 }
+                return mix(1.0, shadow / 9.0, uShadowStrength);
             }
-            shadow /= 9.0;
-            return mix(1.0, shadow, uShadowStrength);
+            return 1.0;
         }
         void main() {
             vec3 base = texture(uRoadTex, vUV).rgb;
+            if (uHeatmap > 0.0 && vSegment >= 0 && vSegment < textureSize(uCongestion)) {
+                float vc = texelFetch(uCongestion, vSegment).r;
+                vec3 heat = (vc < 0.7) ? mix(vec3(0.15, 0.7, 0.2), vec3(0.95, 0.8, 0.1), vc / 0.7)
+                                       : mix(vec3(0.95, 0.8, 0.1), vec3(0.9, 0.1, 0.1), clamp((vc - 0.7) / 0.5, 0.0, 1.0));
+                base = mix(base, heat * (0.6 + 0.4 * dot(base, vec3(0.333))), uHeatmap);
+            }
             vec3 normal = normalize(vNormal);
             float ndotl = max(dot(normal, uSunDir), 0.0);
-            float shadow = ShadowVisibility(vLightPos, normal);
+            float shadow = ShadowVisibility(vShadowPos, normal);
             vec3 ambient = uAmbientColor * uAmbientIntensity;
             vec3 direct = uSunColor * uSunIntensity * ndotl * shadow;
             vec3 color = base * (ambient + direct);
@@ -554,7 +560,7 @@ bool Renderer::init() {
     const char* fsInst = R"(
         #version 330 core
         in vec3 vNormal;
-        in vec4 vLightPos;
+        in vec3 vShadowPos;
         in vec3 vLocalPos;
         in vec3 vLocalNormal;
         flat in float vFacadeIndex;
@@ -562,15 +568,20 @@ bool Renderer::init() {
         out vec4 FragColor;
         uniform vec3 uColor;
         uniform float uAlpha;
-        uniform vec3 uSunDir;
-        uniform vec3 uSunColor;
-        uniform float uSunIntensity;
-        uniform vec3 uAmbientColor;
-        uniform float uAmbientIntensity;
-        uniform float uExposure;
-        uniform sampler2DShadow uShadowMap;
-        uniform vec2 uShadowTexel;
-        uniform float uShadowStrength;
+        const int SHADOW_CASCADES = 4;
+        layout(std140) uniform FrameLighting {
+            mat4 uLightViewProj[SHADOW_CASCADES];
+            vec4 uShadowBias; // depth units per cascade
+            vec3 uSunDir;
+            float uSunIntensity;
+            vec3 uSunColor;
+            float uExposure;
+            vec3 uAmbientColor;
+            float uAmbientIntensity;
+            vec2 uShadowTexel;
+            float uShadowStrength;
+        };
+        uniform sampler2DArrayShadow uShadowMap;
         uniform sampler2D uFacadeTex0;
         uniform sampler2D uFacadeTex1;
         uniform sampler2D uFacadeTex2;
@@ -583,29 +594,30 @@ bool Renderer::init() {
             color = pow(color, vec3(1.0 / 2.2));
             return color;
         }
-        float ShadowVisibility(vec4 lightPos, vec3 normal) {
+        float ShadowVisibility(vec3 worldPos, vec3 normal) {
             if (uShadowStrength <= 0.0) return 1.0;
-            vec3 proj = lightPos.xyz / lightPos.w;
-            proj = proj * 0.5 + 0.5;
-            if (proj.z > 1.0 || proj.x < 0.0 || proj.x > 1.0 || proj.y < 0.0 || proj.y > 1.0) {
-                return 1.0;
-            }
             float ndotl = max(dot(normal, uSunDir), 0.0);
-            float bias = max(0.0015 * (1.0 - ndotl), 0.0005);
-            float shadow = 0.0;
-            for (int x = -1; x <= 1; x++) {
-                for (int y = -1; y <= 1; y++) {
-                    vec2 offset = vec2(x, y) * uShadowTexel;
-                    shadow += texture(uShadowMap, vec3(proj.xy + offset, proj.z - bias));
+            vec2 margin = 2.0 * uShadowTexel;
+            // Nearest cascade that covers the point with room for the filter taps
+            for (int c = 0; c < SHADOW_CASCADES; c++) {
+                vec3 proj = (uLightViewProj[c] * vec4(worldPos, 1.0)).xyz * 0.5 + 0.5;
+                if (any(lessThan(proj.xy, margin)) || any(greaterThan(proj.xy, 1.0 - margin)) || proj.z > 1.0) continue;
+                float bias = uShadowBias[c] * (1.0 + 2.0 * (1.0 - ndotl));
+                float shadow = 0.0;
+                for (int x = -1; x <= 1; x++) {
+                    for (int y = -1; y <= 1; y++) {
+                        vec2 offset = vec2(x, y) * uShadowTexel;
+                        shadow += texture(uShadowMap, vec4(proj.xy + offset, float(c), proj.z - bias));
+                    }
                 }
+                return mix(1.0, shadow / 9.0, uShadowStrength);
             }
-            shadow /= 9.0;
-            return mix(1.0, shadow, uShadowStrength);
+            return 1.0;
         }
         void main() {
             vec3 normal = normalize(vNormal);
             float ndotl = max(dot(normal, uSunDir), 0.0);
-            float shadow = ShadowVisibility(vLightPos, normal);
+            float shadow = ShadowVisibility(vShadowPos, normal);
             vec3 ambient = uAmbientColor * uAmbientIntensity;
             vec3 direct = uSunColor * uSunIntensity * ndotl * shadow;
             vec3 baseColor = uColor;
@@ -649,20 +661,28 @@ bool Renderer::init() {
 
     const char* vsDepthInst = R"(
         #version 330 core
-        layout(location=0) in vec3 aPos;
+        layout(location=0) in uvec4 aPosQ;
         layout(location=2) in vec4 iPosYaw;
         layout(location=3) in vec4 iScaleVar;
+        layout(location=4) in vec4 iAnim;
         uniform mat4 uLightViewProj;
+        uniform float uTime;
+        uniform samplerBuffer uMeshBounds;
         void main() {
+            int slot = int(aPosQ.w) * 2;
+            vec3 meshPos = texelFetch(uMeshBounds, slot).xyz + vec3(aPosQ.xyz) * texelFetch(uMeshBounds, slot + 1).xyz;
             float yaw = iPosYaw.w;
             mat3 R = mat3(
                 cos(yaw), 0.0, -sin(yaw),
                 0.0,      1.0,  0.0,
                 sin(yaw), 0.0,  cos(yaw)
             );
-            vec3 scale = max(iScaleVar.xyz, vec3(0.0001));
-            vec3 scaled = R * (aPos * scale);
+            float t = clamp((uTime - iAnim.x) * iAnim.y, 0.0, 1.0);
+            float grow = 1.0 - (1.0 - t) * (1.0 - t);
+            vec3 scale = max(iScaleVar.xyz * mix(iAnim.zwz, vec3(1.0), grow), vec3(0.0001));
+            vec3 scaled = R * (meshPos * scale);
             vec3 worldPos = iPosYaw.xyz + scaled;
+            worldPos.y -= 0.5 * (iScaleVar.y - scale.y);
             worldPos.y += 0.05;
             gl_Position = uLightViewProj * vec4(worldPos, 1.0);
         }
@@ -674,14 +694,69 @@ bool Renderer::init() {
         }
     )";
 
-    progBasic = MakeProgram(vsBasic, fsColor);
-    progInst = MakeProgram(vsInstanced, fsInst);
-    progGround = MakeProgram(vsGround, fsGround);
-    progRoad = MakeProgram(vsRoad, fsRoad);
-    progSky = MakeProgram(vsSky, fsSky);
-    progDepth = MakeProgram(vsDepth, fsDepth);
-    progDepthInst = MakeProgram(vsDepthInst, fsDepth);
-    if (!progBasic || !progInst || !progGround || !progRoad || !progSky || !progDepth || !progDepthInst) return false;
+    // One quad per chunk; aQuad is (meters x, z, cells x, z) from the chunk corner.
+    const char* vsZone = R"(
+        #version 330 core
+        layout(location=0) in vec4 aQuad;
+        uniform mat4 uViewProj;
+        uniform vec2 uOrigin;
+        out vec2 vCell;
+        void main() {
+            vCell = aQuad.zw;
+            gl_Position = uViewProj * vec4(uOrigin.x + aQuad.x, 0.04, uOrigin.y + aQuad.y, 1.0);
+        }
+    )";
+
+    // Flag bits match zone_grid.h: 1 buildable, 2 zoned, 4 blocked, 0x18 zone type.
+    const char* fsZone = R"(
+        #version 330 core
+        in vec2 vCell;
+        out vec4 FragColor;
+        uniform usampler2DArray uFlags;
+        uniform int uLayer;
+        uniform int uShowBuildable;
+        uniform float uExposure;
+        const vec3 kZoneColors[4] = vec3[4](
+            vec3(0.15, 0.65, 0.35),  // residential
+            vec3(0.20, 0.45, 0.90),  // commercial (blue)
+            vec3(0.85, 0.75, 0.20),  // industrial (yellow)
+            vec3(0.45, 0.75, 0.95)); // office (light blue)
+        vec3 ToneMap(vec3 color) {
+            color *= uExposure;
+            color = color / (color + vec3(1.0));
+            color = pow(color, vec3(1.0 / 2.2));
+            return color;
+        }
+        void main() {
+            ivec2 dim = textureSize(uFlags, 0).xy;
+            ivec2 cell = clamp(ivec2(floor(vCell)), ivec2(0), dim - 1);
+            vec2 f = vCell - vec2(cell);
+            if (any(lessThan(f, vec2(0.02))) || any(greaterThan(f, vec2(0.98)))) discard; // cell inset
+            uint flags = texelFetch(uFlags, ivec3(cell, uLayer), 0).r;
+            if ((flags & 2u) != 0u) {
+                FragColor = vec4(ToneMap(kZoneColors[int((flags >> 3) & 3u)]), 0.30);
+            } else if (uShowBuildable != 0 && (flags & 5u) == 1u) {
+                FragColor = vec4(ToneMap(vec3(0.10, 0.60, 0.75)), 0.15);
+            } else {
+                discard;
+            }
+        }
+    )";
+
+    Uint64 shaderStart = SDL_GetPerformanceCounter();
+    shaderCache.init("cache/shaders");
+    progBasic = shaderCache.build(vsBasic, fsColor);
+    progInst = shaderCache.build(vsInstanced, fsInst);
+    progGround = shaderCache.build(vsGround, fsGround);
+    progRoad = shaderCache.build(vsRoad, fsRoad);
+    progSky = shaderCache.build(vsSky, fsSky);
+    progDepth = shaderCache.build(vsDepth, fsDepth);
+    progDepthInst = shaderCache.build(vsDepthInst, fsDepth);
+    progZone = shaderCache.build(vsZone, fsZone);
+    if (!progBasic || !progInst || !progGround || !progRoad || !progSky || !progDepth || !progDepthInst || !progZone) return false;
+    SDL_Log("Renderer: %d programs from the binary cache, %d compiled (%.1f ms)%s", shaderCache.loaded(), shaderCache.compiled(),
+        (double)(SDL_GetPerformanceCounter() - shaderStart) * 1000.0 / (double)SDL_GetPerformanceFrequency(),
+        shaderCache.binariesSupported() ? "" : "; program binaries unsupported");
 
     locVP_B = glGetUniformLocation(progBasic, "uViewProj");
     locM_B = glGetUniformLocation(progBasic, "uModel");
@@ -692,50 +767,29 @@ bool Renderer::init() {
     locVP_I = glGetUniformLocation(progInst, "uViewProj");
     locC_I = glGetUniformLocation(progInst, "uColor");
     locA_I = glGetUniformLocation(progInst, "uAlpha");
-    locSunDir_I = glGetUniformLocation(progInst, "uSunDir");
-    locSunColor_I = glGetUniformLocation(progInst, "uSunColor");
-    locSunInt_I = glGetUniformLocation(progInst, "uSunIntensity");
-    locAmbColor_I = glGetUniformLocation(progInst, "uAmbientColor");
-    locAmbInt_I = glGetUniformLocation(progInst, "uAmbientIntensity");
-    locExposure_I = glGetUniformLocation(progInst, "uExposure");
-    locLightVP_I = glGetUniformLocation(progInst, "uLightViewProj");
+    locTime_I = glGetUniformLocation(progInst, "uTime");
     locShadowMap_I = glGetUniformLocation(progInst, "uShadowMap");
-    locShadowTexel_I = glGetUniformLocation(progInst, "uShadowTexel");
-    locShadowStrength_I = glGetUniformLocation(progInst, "uShadowStrength");
     locFacadeTex0_I = glGetUniformLocation(progInst, "uFacadeTex0");
     locFacadeTex1_I = glGetUniformLocation(progInst, "uFacadeTex1");
     locFacadeTex2_I = glGetUniformLocation(progInst, "uFacadeTex2");
     locFacadeTex3_I = glGetUniformLocation(progInst, "uFacadeTex3");
     locFacadeTile_I = glGetUniformLocation(progInst, "uFacadeTileM");
     locFacadeTint_I = glGetUniformLocation(progInst, "uFacadeTint");
+    locMeshBounds_I = glGetUniformLocation(progInst, "uMeshBounds");
     locVP_G = glGetUniformLocation(progGround, "uViewProj");
     locM_G = glGetUniformLocation(progGround, "uModel");
     locGrassTile_G = glGetUniformLocation(progGround, "uGrassTileM");
     locNoiseTile_G = glGetUniformLocation(progGround, "uNoiseTileM");
     locGrassTex_G = glGetUniformLocation(progGround, "uGrassTex");
     locNoiseTex_G = glGetUniformLocation(progGround, "uNoiseTex");
-    locSunDir_G = glGetUniformLocation(progGround, "uSunDir");
-    locSunColor_G = glGetUniformLocation(progGround, "uSunColor");
-    locSunInt_G = glGetUniformLocation(progGround, "uSunIntensity");
-    locAmbColor_G = glGetUniformLocation(progGround, "uAmbientColor");
-    locAmbInt_G = glGetUniformLocation(progGround, "uAmbientIntensity");
-    locExposure_G = glGetUniformLocation(progGround, "uExposure");
-    locLightVP_G = glGetUniformLocation(progGround, "uLightViewProj");
     locShadowMap_G = glGetUniformLocation(progGround, "uShadowMap");
-    locShadowTexel_G = glGetUniformLocation(progGround, "uShadowTexel");
-    locShadowStrength_G = glGetUniformLocation(progGround, "uShadowStrength");
     locVP_R = glGetUniformLocation(progRoad, "uViewProj");
-    locLightVP_R = glGetUniformLocation(progRoad, "uLightViewProj");
+    locOrigin_R = glGetUniformLocation(progRoad, "uOrigin");
+    locChunkSize_R = glGetUniformLocation(progRoad, "uChunkSize");
     locRoadTex_R = glGetUniformLocation(progRoad, "uRoadTex");
-    locSunDir_R = glGetUniformLocation(progRoad, "uSunDir");
-    locSunColor_R = glGetUniformLocation(progRoad, "uSunColor");
-    locSunInt_R = glGetUniformLocation(progRoad, "uSunIntensity");
-    locAmbColor_R = glGetUniformLocation(progRoad, "uAmbientColor");
-    locAmbInt_R = glGetUniformLocation(progRoad, "uAmbientIntensity");
-    locExposure_R = glGetUniformLocation(progRoad, "uExposure");
     locShadowMap_R = glGetUniformLocation(progRoad, "uShadowMap");
-    locShadowTexel_R = glGetUniformLocation(progRoad, "uShadowTexel");
-    locShadowStrength_R = glGetUniformLocation(progRoad, "uShadowStrength");
+    locCongestion_R = glGetUniformLocation(progRoad, "uCongestion");
+    locHeatmap_R = glGetUniformLocation(progRoad, "uHeatmap");
     locVP_S = glGetUniformLocation(progSky, "uViewProj");
     locSkyTex_S = glGetUniformLocation(progSky, "uSkybox");
     locSkyBright_S = glGetUniformLocation(progSky, "uSkyBrightness");
@@ -744,69 +798,81 @@ bool Renderer::init() {
     locLightVP_D = glGetUniformLocation(progDepth, "uLightViewProj");
     locM_D = glGetUniformLocation(progDepth, "uModel");
     locLightVP_DI = glGetUniformLocation(progDepthInst, "uLightViewProj");
+    locTime_DI = glGetUniformLocation(progDepthInst, "uTime");
+    locMeshBounds_DI = glGetUniformLocation(progDepthInst, "uMeshBounds");
+    locVP_Z = glGetUniformLocation(progZone, "uViewProj");
+    locOrigin_Z = glGetUniformLocation(progZone, "uOrigin");
+    locLayer_Z = glGetUniformLocation(progZone, "uLayer");
+    locFlags_Z = glGetUniformLocation(progZone, "uFlags");
+    locBuildable_Z = glGetUniformLocation(progZone, "uShowBuildable");
+    locExposure_Z = glGetUniformLocation(progZone, "uExposure");
     if (locVP_B < 0 || locM_B < 0 || locC_B < 0 || locA_B < 0 || locExposure_B < 0 ||
-        locVP_I < 0 || locC_I < 0 || locA_I < 0 || locSunDir_I < 0 || locSunColor_I < 0 ||
-        locSunInt_I < 0 || locAmbColor_I < 0 || locAmbInt_I < 0 || locExposure_I < 0 ||
-        locLightVP_I < 0 || locShadowMap_I < 0 || locShadowTexel_I < 0 || locShadowStrength_I < 0 ||
+        locVP_I < 0 || locC_I < 0 || locA_I < 0 || locTime_I < 0 || locShadowMap_I < 0 ||
         locFacadeTex0_I < 0 || locFacadeTex1_I < 0 || locFacadeTex2_I < 0 || locFacadeTex3_I < 0 ||
-        locFacadeTile_I < 0 || locFacadeTint_I < 0 ||
+        locFacadeTile_I < 0 || locFacadeTint_I < 0 || locMeshBounds_I < 0 ||
         locVP_G < 0 || locM_G < 0 || locGrassTile_G < 0 || locNoiseTile_G < 0 ||
-        locGrassTex_G < 0 || locNoiseTex_G < 0 || locSunDir_G < 0 || locSunColor_G < 0 ||
-        locSunInt_G < 0 || locAmbColor_G < 0 || locAmbInt_G < 0 || locExposure_G < 0 ||
-        locLightVP_G < 0 || locShadowMap_G < 0 || locShadowTexel_G < 0 || locShadowStrength_G < 0 ||
-        locVP_R < 0 || locLightVP_R < 0 || locRoadTex_R < 0 || locSunDir_R < 0 ||
-        locSunColor_R < 0 || locSunInt_R < 0 || locAmbColor_R < 0 || locAmbInt_R < 0 ||
-        locExposure_R < 0 || locShadowMap_R < 0 || locShadowTexel_R < 0 || locShadowStrength_R < 0 ||
+        locGrassTex_G < 0 || locNoiseTex_G < 0 || locShadowMap_G < 0 ||
+        locVP_R < 0 || locOrigin_R < 0 || locChunkSize_R < 0 || locRoadTex_R < 0 || locShadowMap_R < 0 ||
+        locCongestion_R < 0 || locHeatmap_R < 0 ||
         locVP_S < 0 || locSkyTex_S < 0 || locSkyBright_S < 0 || locExposure_S < 0 ||
         locSkyExposure_S < 0 ||
-        locLightVP_D < 0 || locM_D < 0 || locLightVP_DI < 0) {
+        locLightVP_D < 0 || locM_D < 0 || locLightVP_DI < 0 || locTime_DI < 0 || locMeshBounds_DI < 0 ||
+        locVP_Z < 0 || locOrigin_Z < 0 || locLayer_Z < 0 || locFlags_Z < 0 ||
+        locBuildable_Z < 0 || locExposure_Z < 0) {
         SDL_Log("Renderer init failed: missing uniforms.");
         return false;
     }
 
-    if (!CreateShadowMap(shadowMapSize, shadowFbo, shadowTex)) {
-        SDL_Log("Renderer: shadow map init failed, shadows disabled.");
+    // Per-frame lighting shared by the lit programs through one uniform buffer.
+    for (GLuint prog : {progInst, progGround, progRoad}) {
+        GLuint block = glGetUniformBlockIndex(prog, "FrameLighting");
+        GLint size = 0;
+        if (block != GL_INVALID_INDEX) glGetActiveUniformBlockiv(prog, block, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+        if (block == GL_INVALID_INDEX || size != (GLint)sizeof(FrameLightingUBO)) {
+            SDL_Log("Renderer init failed: FrameLighting block mismatch (%d bytes, expected %d).", size, (int)sizeof(FrameLightingUBO));
+            return false;
+        }
+        glUniformBlockBinding(prog, block, FRAME_LIGHTING_BINDING);
     }
+    glGenBuffers(1, &uboLighting);
+    glBindBuffer(GL_UNIFORM_BUFFER, uboLighting);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameLightingUBO), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_LIGHTING_BINDING, uboLighting);
 
-    bool grassOk = false;
-    bool noiseOk = false;
-    texGrass = LoadTexture2D("assets/textures/grass.png", 80, 110, 70, 255, true, &grassOk);
-    texNoise = LoadTexture2D("assets/textures/grayscale.png", 128, 128, 128, 255, false, &noiseOk);
-    if (!grassOk || !noiseOk) {
-        SDL_Log("Renderer: using fallback ground texture(s).");
-    }
-    bool waterOk = false;
-    texWater = LoadTexture2D("assets/textures/water.png", 40, 80, 120, 255, true, &waterOk);
-    if (!waterOk) {
-        SDL_Log("Renderer: using fallback water texture.");
-    }
-    bool roadOk = false;
-    texRoad = LoadTexture2D("assets/textures/residentialroad.png", 70, 70, 70, 255, true, &roadOk);
-    if (!roadOk) {
-        SDL_Log("Renderer: using fallback road texture.");
-    }
-    bool office0Ok = false;
-    texOfficeFacade0 = LoadTexture2D("assets/textures/office_facade_artdeco.png", 180, 180, 180, 255, true, &office0Ok);
-    if (!office0Ok) {
-        SDL_Log("Renderer: using fallback office facade texture 0.");
-    }
-    bool office1Ok = false;
-    texOfficeFacade1 = LoadTexture2D("assets/textures/office_facade_modern1.png", 180, 180, 180, 255, true, &office1Ok);
-    if (!office1Ok) {
-        SDL_Log("Renderer: using fallback office facade texture 1.");
-    }
-    bool office2Ok = false;
-    texOfficeFacade2 = LoadTexture2D("assets/textures/office_facade_modern2.png", 180, 180, 180, 255, true, &office2Ok);
-    if (!office2Ok) {
-        SDL_Log("Renderer: using fallback office facade texture 2.");
-    }
-    bool office3Ok = false;
-    texOfficeFacade3 = LoadTexture2D("assets/textures/office_facade_modern3.png", 180, 180, 180, 255, true, &office3Ok);
-    if (!office3Ok) {
-        SDL_Log("Renderer: using fallback office facade texture 3.");
+    if (!CreateShadowMap(shadowMapSize, SHADOW_CASCADES, shadowFbo, shadowTex)) {
+        SDL_Log("Renderer: shadow map init failed, shadows disabled.");
     }
 
-    const char* skyFaces[6] = {
+    // Decoded, mipped and block-compressed on worker threads; later runs map the cooked files.
+    struct TextureSlot {
+        unsigned int* tex;
+        const char* label;
+        uint8_t fallback[4];
+    };
+    const TextureSlot slots[] = {
+        {&texGrass, "grass", {80, 110, 70, 255}},
+        {&texNoise, "noise", {128, 128, 128, 255}},
+        {&texWater, "water", {40, 80, 120, 255}},
+        {&texRoad, "road", {70, 70, 70, 255}},
+        {&texOfficeFacade0, "office facade 0", {180, 180, 180, 255}},
+        {&texOfficeFacade1, "office facade 1", {180, 180, 180, 255}},
+        {&texOfficeFacade2, "office facade 2", {180, 180, 180, 255}},
+        {&texOfficeFacade3, "office facade 3", {180, 180, 180, 255}},
+        {&texSkybox, "skybox", {120, 160, 210, 255}},
+    };
+    std::vector<TextureJob> texJobs(sizeof(slots) / sizeof(slots[0]));
+    texJobs[0].sources = {"assets/textures/grass.png"};
+    texJobs[1].sources = {"assets/textures/grayscale.png"};
+    texJobs[1].srgb = false;
+    texJobs[1].gray = true;
+    texJobs[2].sources = {"assets/textures/water.png"};
+    texJobs[3].sources = {"assets/textures/residentialroad.png"};
+    texJobs[4].sources = {"assets/textures/office_facade_artdeco.png"};
+    texJobs[5].sources = {"assets/textures/office_facade_modern1.png"};
+    texJobs[6].sources = {"assets/textures/office_facade_modern2.png"};
+    texJobs[7].sources = {"assets/textures/office_facade_modern3.png"};
+    texJobs[8].sources = {
         "assets/textures/Daylight Box_Right.png",
         "assets/textures/Daylight Box_Left.png",
         "assets/textures/Daylight Box_Top.png",
@@ -814,11 +880,35 @@ bool Renderer::init() {
         "assets/textures/Daylight Box_Front.png",
         "assets/textures/Daylight Box_Back.png"
     };
-    bool skyOk = false;
-    texSkybox = LoadCubemap(skyFaces, true, &skyOk);
-    if (!skyOk) {
-        SDL_Log("Renderer: using fallback skybox texture.");
+    texJobs[8].mips = false;
+
+    TextureCookSettings cookSettings;
+    cookSettings.allowBC = SDL_GL_ExtensionSupported("GL_EXT_texture_compression_s3tc") == SDL_TRUE;
+    cookSettings.allowSrgbBC = cookSettings.allowBC &&
+        (SDL_GL_ExtensionSupported("GL_EXT_texture_sRGB") == SDL_TRUE ||
+         SDL_GL_ExtensionSupported("GL_EXT_texture_compression_s3tc_srgb") == SDL_TRUE);
+    uint64_t texStart = SDL_GetPerformanceCounter();
+    LoadTextureJobs(texJobs, "cache/textures", cookSettings);
+    int texCached = 0;
+    textureBytes = 0;
+    for (size_t i = 0; i < texJobs.size(); ++i) {
+        const TextureSlot& slot = slots[i];
+        if (texJobs[i].ok) {
+            *slot.tex = UploadCookedTexture(*texJobs[i].result);
+            textureBytes += texJobs[i].result->gpuBytes();
+            if (texJobs[i].fromCache) texCached++;
+            continue;
+        }
+        SDL_Log("Renderer: using fallback %s texture.", slot.label);
+        const uint8_t* c = slot.fallback;
+        bool srgb = texJobs[i].srgb;
+        *slot.tex = (texJobs[i].sources.size() == 6) ? CreateSolidCubemap(c[0], c[1], c[2], c[3], srgb)
+                                                      : CreateSolidTexture(c[0], c[1], c[2], c[3], srgb);
     }
+    SDL_Log("Renderer: %d textures (%d cached) in %.0f ms, %.1f MB",
+        (int)texJobs.size(), texCached,
+        (double)(SDL_GetPerformanceCounter() - texStart) * 1000.0 / (double)SDL_GetPerformanceFrequency(),
+        textureBytes / (1024.0 * 1024.0));
 
     // Ground quad
     const float HALF = MAP_HALF_M;
@@ -841,16 +931,16 @@ bool Renderer::init() {
     glBindVertexArray(0);
 
     // Dynamic buffers
-    glGenVertexArrays(1, &vaoRoad);
-    glGenBuffers(1, &vboRoad);
-    glBindVertexArray(vaoRoad);
-    glBindBuffer(GL_ARRAY_BUFFER, vboRoad);
-    glBufferData(GL_ARRAY_BUFFER, 1, nullptr, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RoadVertex), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(RoadVertex), (void*)(sizeof(glm::vec3)));
-    glBindVertexArray(0);
+    // Per-segment congestion, fetched by segment index in the road shader
+    glGenBuffers(1, &tboCongestion);
+    glBindBuffer(GL_TEXTURE_BUFFER, tboCongestion);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glGenTextures(1, &texCongestion);
+    glBindTexture(GL_TEXTURE_BUFFER, texCongestion);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, tboCongestion);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    capCongestion = sizeof(float);
 
     glGenVertexArrays(1, &vaoPreview);
     glGenBuffers(1, &vboPreview);
@@ -861,6 +951,24 @@ bool Renderer::init() {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
     glBindVertexArray(0);
 
+    const float C = CHUNK_SIZE_M;
+    const float N = (float)ZoneChunk::DIM;
+    glm::vec4 zoneQuad[6] = {
+        {0.0f, 0.0f, 0.0f, 0.0f}, {C, 0.0f, N, 0.0f}, {C, C, N, N},
+        {0.0f, 0.0f, 0.0f, 0.0f}, {C, C, N, N}, {0.0f, C, 0.0f, N},
+    };
+    glGenVertexArrays(1, &vaoZone);
+    glGenBuffers(1, &vboZone);
+    glBindVertexArray(vaoZone);
+    glBindBuffer(GL_ARRAY_BUFFER, vboZone);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(zoneQuad), zoneQuad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+    glBindVertexArray(0);
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    zoneLayerMax = std::min(maxLayers, 2048);
+
     glGenVertexArrays(1, &vaoWater);
     glGenBuffers(1, &vboWater);
     glBindVertexArray(vaoWater);
@@ -906,20 +1014,30 @@ bool Renderer::init() {
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPN), (void*)(sizeof(glm::vec3)));
     glBindVertexArray(0);
 
-    glGenVertexArrays(1, &vaoCubeInstAnim);
-    glGenBuffers(1, &vboInstAnim);
+    // Shared house VAO; mesh attributes are attached by setMeshBuffers().
+    houseInstCap = 1 << 16;
+    glGenBuffers(1, &vboHouseInst);
+    glBindBuffer(GL_ARRAY_BUFFER, vboHouseInst);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)houseInstCap * sizeof(HouseInstanceGPU), nullptr, GL_DYNAMIC_DRAW);
+    houseInstFree.clear();
+    houseInstFree[0] = houseInstCap;
+    glGenVertexArrays(1, &vaoHouse);
+    glBindVertexArray(vaoHouse);
+    for (GLuint loc = 2; loc <= 4; loc++) {
+        glEnableVertexAttribArray(loc);
+        glVertexAttribDivisor(loc, 1);
+    }
+    PointInstanceAttribs(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    glBindVertexArray(vaoCubeInstAnim);
-    glBindBuffer(GL_ARRAY_BUFFER, vboCube);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPN), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPN), (void*)(sizeof(glm::vec3)));
-    glBindBuffer(GL_ARRAY_BUFFER, vboInstAnim);
-    glBufferData(GL_ARRAY_BUFFER, 1, nullptr, GL_DYNAMIC_DRAW);
-    SetupInstanceAttribs(vaoCubeInstAnim, vboInstAnim);
+    bool baseInstance = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2) ||
+        SDL_GL_ExtensionSupported("GL_ARB_base_instance");
+    pDrawElementsInstancedBaseVertexBaseInstance = baseInstance
+        ? (DrawElementsInstancedBaseVertexBaseInstanceFn)SDL_GL_GetProcAddress("glDrawElementsInstancedBaseVertexBaseInstance")
+        : nullptr;
 
-    glBindVertexArray(0);
+    culler.init();
     return true;
 }
 
@@ -929,8 +1047,63 @@ void Renderer::resize(int w, int h) {
     glViewport(0, 0, w, h);
 }
 
-void Renderer::updateRoadMesh(const std::vector<RoadVertex>& verts) {
-    UploadDynamicRoadVerts(vboRoad, capRoad, verts);
+void Renderer::updateRoadChunk(uint64_t key, const std::vector<RoadSegmentGPU>& segments) {
+    auto it = roadChunks.find(key);
+    if (segments.empty()) {
+        if (it == roadChunks.end()) return;
+        glDeleteVertexArrays(1, &it->second.vao);
+        glDeleteBuffers(1, &it->second.vbo);
+        roadChunks.erase(it);
+        return;
+    }
+    RoadChunkBuf& buf = roadChunks[key];
+    if (!buf.vao) {
+        glGenVertexArrays(1, &buf.vao);
+        glGenBuffers(1, &buf.vbo);
+        glBindVertexArray(buf.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, buf.vbo);
+        const GLsizei stride = sizeof(RoadSegmentGPU);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(RoadSegmentGPU, ends));
+        glVertexAttribDivisor(0, 1);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(RoadSegmentGPU, v0));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribIPointer(2, 1, GL_INT, stride, (void*)offsetof(RoadSegmentGPU, segment));
+        glVertexAttribDivisor(2, 1);
+        glEnableVertexAttribArray(3);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_BYTE, stride, (void*)offsetof(RoadSegmentGPU, halfWidth));
+        glVertexAttribDivisor(3, 1);
+        glBindVertexArray(0);
+    }
+    std::size_t bytes = segments.size() * sizeof(RoadSegmentGPU);
+    glBindBuffer(GL_ARRAY_BUFFER, buf.vbo);
+    if (bytes > buf.capacity) {
+        buf.capacity = bytes + bytes / 4;
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)buf.capacity, nullptr, GL_STATIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, segments.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    buf.count = segments.size();
+}
+
+std::size_t Renderer::roadMemoryBytes() const {
+    std::size_t bytes = 0;
+    for (const auto& kv : roadChunks) bytes += kv.second.capacity;
+    return bytes;
+}
+
+void Renderer::updateRoadCongestion(const std::vector<float>& perSegment) {
+    if (perSegment.empty()) return;
+    std::size_t bytes = perSegment.size() * sizeof(float);
+    glBindBuffer(GL_TEXTURE_BUFFER, tboCongestion);
+    if (bytes > capCongestion) {
+        capCongestion = std::max(bytes, capCongestion * 2);
+        glBufferData(GL_TEXTURE_BUFFER, capCongestion, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, perSegment.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
 }
 
 void Renderer::updateWaterMesh(const std::vector<glm::vec3>& verts) {
@@ -941,75 +1114,319 @@ void Renderer::updatePreviewMesh(const std::vector<glm::vec3>& verts) {
     UploadDynamicVerts(vboPreview, capPreview, verts);
 }
 
-void Renderer::updateHouseChunk(uint64_t key, AssetId assetId, const MeshGpu& mesh, const std::vector<HouseInstanceGPU>& instances) {
-    auto& assetMap = houseChunks[key];
-    auto& buf = assetMap[assetId];
-    if (buf.vao == 0 || buf.meshVbo != mesh.vbo || buf.meshEbo != mesh.ebo) {
-        if (buf.vao == 0) glGenVertexArrays(1, &buf.vao);
-        if (buf.vbo == 0) glGenBuffers(1, &buf.vbo);
-        glBindVertexArray(buf.vao);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-        glEnableVertexAttribArray(0);
-        GLsizei stride = mesh.vertexStride > 0 ? mesh.vertexStride : (GLsizei)sizeof(glm::vec3);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec3)));
-        if (mesh.indexed && mesh.ebo) {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-        } else {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+void Renderer::setMeshBuffers(unsigned int vbo, unsigned int ebo, unsigned int boundsTex, int stride) {
+    meshBoundsTex = boundsTex;
+    if (vbo == meshVboBound && ebo == meshEboBound) return;
+    // PackedVertex: uint16 x, y, z, bounds slot, then a snorm16 octahedral normal.
+    glBindVertexArray(vaoHouse);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 4, GL_UNSIGNED_SHORT, stride, (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)(4 * sizeof(uint16_t)));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    meshVboBound = vbo;
+    meshEboBound = ebo;
+}
+
+bool Renderer::allocHouseInstances(uint32_t count, uint32_t& first) {
+    for (;;) {
+        // First fit keeps live ranges packed toward the front of the buffer.
+        for (auto it = houseInstFree.begin(); it != houseInstFree.end(); ++it) {
+            if (it->second < count) continue;
+            first = it->first;
+            uint32_t rest = it->second - count;
+            houseInstFree.erase(it);
+            if (rest) houseInstFree[first + count] = rest;
+            return true;
         }
-        glBindBuffer(GL_ARRAY_BUFFER, buf.vbo);
-        glBufferData(GL_ARRAY_BUFFER, 1, nullptr, GL_DYNAMIC_DRAW);
-        SetupInstanceAttribs(buf.vao, buf.vbo);
-        glBindVertexArray(0);
 
-        buf.meshVbo = mesh.vbo;
-        buf.meshEbo = mesh.ebo;
-        buf.vertexCount = mesh.vertexCount;
-        buf.indexCount = mesh.indexCount;
-        buf.indexed = mesh.indexed;
-    } else {
-        buf.vertexCount = mesh.vertexCount;
-        buf.indexCount = mesh.indexCount;
-        buf.indexed = mesh.indexed;
+        // Grow by doubling; the copy keeps every live range at its offset.
+        uint32_t oldCap = houseInstCap;
+        uint32_t newCap = oldCap * 2;
+        while (newCap - oldCap < count) newCap *= 2;
+        if ((std::size_t)newCap * sizeof(HouseInstanceGPU) > (std::size_t)1 << 30) {
+            SDL_Log("Renderer: house instance buffer limit reached (%u instances)", oldCap);
+            return false;
+        }
+        GLuint grown = 0;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newCap * sizeof(HouseInstanceGPU), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, vboHouseInst);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)oldCap * sizeof(HouseInstanceGPU));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &vboHouseInst);
+        vboHouseInst = grown;
+        houseInstCap = newCap;
+        freeHouseInstances(oldCap, newCap - oldCap);
     }
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, buf.vbo);
-    std::size_t bytes = instances.size() * sizeof(HouseInstanceGPU);
-    if (bytes == 0) {
-        glBufferData(GL_ARRAY_BUFFER, 1, nullptr, GL_DYNAMIC_DRAW);
+void Renderer::freeHouseInstances(uint32_t first, uint32_t count) {
+    if (count == 0) return;
+    auto next = houseInstFree.lower_bound(first);
+    if (next != houseInstFree.end() && first + count == next->first) {
+        count += next->second;
+        next = houseInstFree.erase(next);
+    }
+    if (next != houseInstFree.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == first) {
+            prev->second += count;
+            return;
+        }
+    }
+    houseInstFree[first] = count;
+}
+
+void Renderer::updateHouseChunk(uint64_t key, AssetId assetId, const MeshGpu& mesh, const std::vector<HouseInstanceGPU>& instances) {
+    auto& buf = houseChunks[key][assetId];
+    buf.baseVertex = mesh.baseVertex;
+    buf.lods[0] = {mesh.firstIndex, mesh.indexCount, 0.0f};
+    buf.lodCount = 1;
+    for (int l = 0; l < mesh.lodCount && buf.lodCount < GpuCuller::MAX_LODS; l++) {
+        buf.lods[buf.lodCount++] = {mesh.lods[l].firstIndex, mesh.lods[l].indexCount, mesh.lods[l].distance};
+    }
+    buf.indexType = mesh.indexType;
+    buf.radius = mesh.radius;
+
+    uint32_t count = (uint32_t)instances.size();
+    if (count > buf.capacity) {
+        freeHouseInstances(buf.first, buf.capacity);
         buf.capacity = 0;
         buf.count = 0;
-    } else {
-        if (bytes > buf.capacity) {
-            buf.capacity = (std::size_t)(bytes * 1.5f) + 256;
-            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)buf.capacity, nullptr, GL_DYNAMIC_DRAW);
+        uint32_t want = count + count / 2 + 4;
+        if (!allocHouseInstances(want, buf.first)) return;
+        buf.capacity = want;
+    }
+    buf.count = count;
+    if (count == 0) return;
+    glBindBuffer(GL_ARRAY_BUFFER, vboHouseInst);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)buf.first * sizeof(HouseInstanceGPU),
+        (GLsizeiptr)count * sizeof(HouseInstanceGPU), instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Renderer::releaseHouseChunk(uint64_t key) {
+    auto it = houseChunks.find(key);
+    if (it == houseChunks.end()) return;
+    for (auto& assetKv : it->second) freeHouseInstances(assetKv.second.first, assetKv.second.capacity);
+    houseChunks.erase(it);
+}
+
+std::size_t Renderer::houseChunkBytes(uint64_t key) const {
+    auto it = houseChunks.find(key);
+    if (it == houseChunks.end()) return 0;
+    std::size_t bytes = 0;
+    for (const auto& assetKv : it->second) bytes += (std::size_t)assetKv.second.capacity * sizeof(HouseInstanceGPU);
+    return bytes;
+}
+
+void Renderer::cullHouseBatches(const RenderFrame& frame, bool shadows) {
+    // One group per mesh; the batches of every chunk using it feed its commands.
+    std::vector<GpuCuller::Group> groups;
+    std::vector<GpuCuller::Batch> batches;
+    std::unordered_map<AssetId, uint32_t> groupOf;
+    for (const auto& batch : frame.visibleHouseBatches) {
+        auto chunkIt = houseChunks.find(batch.chunkKey);
+        if (chunkIt == houseChunks.end()) continue;
+        auto assetIt = chunkIt->second.find(batch.asset);
+        if (assetIt == chunkIt->second.end()) continue;
+        const ChunkBuf& buf = assetIt->second;
+        if (batch.first >= buf.count || buf.lods[0].indexCount == 0) continue;
+        if (!batch.camera && !shadows) continue;
+        auto [it, added] = groupOf.emplace(batch.asset, (uint32_t)groups.size());
+        if (added) {
+            // Each level reaches to where the next starts; levels starting past
+            // the draw distance are never used.
+            GpuCuller::Group g;
+            for (int l = 0; l < buf.lodCount; l++) {
+                if (l > 0 && buf.lods[l].distance >= houseDrawDistance) break;
+                GpuCuller::Lod& lod = g.lods[g.lodCount++];
+                lod.baseVertex = buf.baseVertex;
+                lod.firstIndex = buf.lods[l].firstIndex;
+                lod.indexCount = (uint32_t)buf.lods[l].indexCount;
+                lod.index16 = buf.indexType == GL_UNSIGNED_SHORT;
+                lod.maxDistance = l + 1 < buf.lodCount ? std::min(buf.lods[l + 1].distance, houseDrawDistance) : houseDrawDistance;
+            }
+            g.radius = buf.radius;
+            groups.push_back(g);
+        }
+        uint32_t count = std::min(batch.count, buf.count - batch.first);
+        batches.push_back({buf.first + batch.first, count, it->second, batch.camera ? 3u : 2u});
+    }
+
+    culler.begin(groups, batches);
+    // One shadow view: the outermost cascade contains the others.
+    if (shadows) culler.cull(1, vboHouseInst, cascades[SHADOW_CASCADES - 1].viewProj, frame.cameraPos);
+    culler.cull(0, vboHouseInst, frame.viewProj, frame.cameraPos);
+    culler.finish();
+}
+
+void Renderer::drawHouseBatches(const RenderFrame& frame, int view, const glm::mat4* cullViewProj) {
+    if (!meshEboBound) return;
+    glBindVertexArray(vaoHouse);
+    if (gpuDrivenEnabled()) {
+        glBindBuffer(GL_ARRAY_BUFFER, culler.outputBuffer(view));
+        PointInstanceAttribs(0);
+        culler.draw(view);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+        return;
+    }
+
+    // With base instance the attributes point at the start of the shared
+    // buffer once and each draw selects its range.
+    glBindBuffer(GL_ARRAY_BUFFER, vboHouseInst);
+    const bool baseInstance = pDrawElementsInstancedBaseVertexBaseInstance != nullptr;
+    if (baseInstance) PointInstanceAttribs(0);
+    for (const auto& batch : frame.visibleHouseBatches) {
+        auto chunkIt = houseChunks.find(batch.chunkKey);
+        if (chunkIt == houseChunks.end()) continue;
+        auto assetIt = chunkIt->second.find(batch.asset);
+        if (assetIt == chunkIt->second.end()) continue;
+        const ChunkBuf& buf = assetIt->second;
+        if (batch.first >= buf.count || buf.lods[0].indexCount == 0) continue;
+        if (view == 0 && !batch.camera) continue;
+        if (cullViewProj && batch.boundsMin.x <= batch.boundsMax.x &&
+            AabbOutsideClip(*cullViewProj, batch.boundsMin, batch.boundsMax)) {
+            continue;
+        }
+        // One level for the whole batch, from its nearest point; the full mesh
+        // when the bounds are unknown. Batches wholly past the draw distance
+        // are skipped, as the GPU path skips each instance.
+        const LodRange* lod = &buf.lods[0];
+        if (batch.boundsMin.x <= batch.boundsMax.x) {
+            glm::vec3 nearest = glm::clamp(frame.cameraPos, batch.boundsMin, batch.boundsMax);
+            float d = glm::distance(nearest, frame.cameraPos);
+            if (d > houseDrawDistance) continue;
+            for (int l = 1; l < buf.lodCount && d > buf.lods[l].distance; l++) lod = &buf.lods[l];
+        }
+        uint32_t count = std::min(batch.count, buf.count - batch.first);
+        std::size_t indexSize = buf.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        const void* indices = (void*)((std::size_t)lod->firstIndex * indexSize);
+        if (baseInstance) {
+            pDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, lod->indexCount, buf.indexType, indices,
+                (GLsizei)count, buf.baseVertex, buf.first + batch.first);
         } else {
-            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)buf.capacity, nullptr, GL_DYNAMIC_DRAW); // orphan
+            PointInstanceAttribs(buf.first + batch.first);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod->indexCount, buf.indexType, indices, (GLsizei)count,
+                buf.baseVertex);
         }
-        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, instances.data());
-        buf.count = instances.size();
     }
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 }
 
-void Renderer::updateAnimHouses(const std::vector<HouseInstanceGPU>& animHouses) {
-    glBindBuffer(GL_ARRAY_BUFFER, vboInstAnim);
-    std::size_t bytes = animHouses.size() * sizeof(HouseInstanceGPU);
-    if (bytes == 0) {
-        glBufferData(GL_ARRAY_BUFFER, 1, nullptr, GL_DYNAMIC_DRAW);
-        capInstAnim = 0;
+bool Renderer::updateZoneChunk(uint64_t key, const uint8_t* cells) {
+    constexpr int DIM = ZoneChunk::DIM;
+    int layer = -1;
+    auto it = zoneLayers.find(key);
+    if (it != zoneLayers.end()) {
+        layer = it->second;
+    } else if (!freeZoneLayers.empty()) {
+        layer = freeZoneLayers.back();
+        freeZoneLayers.pop_back();
     } else {
-        if (bytes > capInstAnim) {
-            capInstAnim = (std::size_t)(bytes * 1.5f) + 256;
-            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capInstAnim, nullptr, GL_DYNAMIC_DRAW);
-        } else {
-            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capInstAnim, nullptr, GL_DYNAMIC_DRAW); // orphan
+        int used = zoneLayerCap;
+        if (used >= zoneLayerMax) return false;
+        int cap = std::min(zoneLayerMax, std::max(64, used * 2));
+        GLuint tex = 0;
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8UI, DIM, DIM, cap, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        if (texZoneFlags) {
+            // No image copy in GL 3.3: read the old layers back through a framebuffer.
+            GLuint fbo = 0;
+            glGenFramebuffers(1, &fbo);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+            for (int l = 0; l < used; ++l) {
+                glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texZoneFlags, 0, l);
+                glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, l, 0, 0, DIM, DIM);
+            }
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteTextures(1, &texZoneFlags);
         }
-        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, animHouses.data());
+        texZoneFlags = tex;
+        textureBytes += (std::size_t)(cap - used) * zoneChunkBytes();
+        for (int l = cap - 1; l > used; --l) freeZoneLayers.push_back(l);
+        zoneLayerCap = cap;
+        layer = used;
     }
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texZoneFlags);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, DIM, DIM, 1, GL_RED_INTEGER, GL_UNSIGNED_BYTE, cells);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    zoneLayers[key] = layer;
+    return true;
+}
+
+void Renderer::releaseZoneChunk(uint64_t key) {
+    auto it = zoneLayers.find(key);
+    if (it == zoneLayers.end()) return;
+    freeZoneLayers.push_back(it->second);
+    zoneLayers.erase(it);
+}
+
+std::size_t Renderer::zoneChunkBytes() const {
+    return (std::size_t)ZoneChunk::DIM * ZoneChunk::DIM;
+}
+
+int Renderer::updateShadowCascades(const RenderFrame& frame, bool redraw[SHADOW_CASCADES]) {
+    constexpr float MIN_RADIUS_M = 60.0f;
+    constexpr float SUN_EPSILON_DEG = 0.25f;
+    constexpr float CASTER_HEIGHT_M = 600.0f; // dirty rects are extruded up to this
+    constexpr int STATIC_CASCADES = 2;        // the far ones only move in steps
+
+    if (frame.renderOrigin != cascadeOrigin) {
+        for (ShadowCascade& c : cascades) c.valid = false;
+        cascadeOrigin = frame.renderOrigin;
+    }
+    const float cosSunEpsilon = std::cos(glm::radians(SUN_EPSILON_DEG));
+    const glm::vec3 sun = glm::normalize(frame.lighting.sunDir);
+    int count = 0;
+    for (int i = 0; i < SHADOW_CASCADES; i++) {
+        ShadowCascade& c = cascades[i];
+        float radius = std::max(frame.shadowRadius / std::pow(3.0f, (float)(SHADOW_CASCADES - 1 - i)), MIN_RADIUS_M);
+        glm::vec3 center = frame.shadowCenter;
+        if (i >= SHADOW_CASCADES - STATIC_CASCADES) {
+            // Radius in steps of 1.25x with 25% slack, so the center can stay put until
+            // the view drifts a quarter radius; zooming and panning then rarely move it.
+            radius = std::pow(1.25f, std::ceil(std::log(radius) / std::log(1.25f)));
+            glm::vec2 drift(center.x - c.center.x, center.z - c.center.z);
+            if (c.valid && c.radius == radius * 1.25f && glm::length(drift) < radius * 0.25f) center = c.center;
+            radius *= 1.25f;
+        }
+        // The sun crawls with the clock; keep the cached direction until it moved visibly.
+        glm::vec3 sunDir = (c.valid && glm::dot(c.sunDir, sun) >= cosSunEpsilon) ? c.sunDir : sun;
+        float depthRadius = std::max(2.0f * radius, 1500.0f);
+        glm::mat4 viewProj = BuildSnappedLightMatrix(center, radius, sunDir, shadowMapSize, depthRadius);
+
+        bool dirty = !c.valid || viewProj != c.viewProj;
+        for (std::size_t r = 0; !dirty && r < frame.shadowDirtyRects.size(); r++) {
+            const glm::vec4& rect = frame.shadowDirtyRects[r];
+            dirty = !AabbOutsideClip(viewProj, glm::vec3(rect.x, 0.0f, rect.y), glm::vec3(rect.z, CASTER_HEIGHT_M, rect.w));
+        }
+        c.viewProj = viewProj;
+        c.center = center;
+        c.sunDir = sunDir;
+        c.radius = radius;
+        // About 1.5 texels of world depth; receivers scale it up on grazing slopes.
+        c.bias = 1.5f * (2.0f * radius / (float)shadowMapSize) / (2.0f * depthRadius);
+        c.valid = true;
+        redraw[i] = dirty;
+        count += dirty ? 1 : 0;
+    }
+    return count;
 }
 
 void Renderer::render(const RenderFrame& frame) {
@@ -1017,11 +1434,20 @@ void Renderer::render(const RenderFrame& frame) {
         ? frame.lighting.shadowStrength
         : 0.0f;
 
+    bool redraw[SHADOW_CASCADES] = {};
+    cascadesRendered = 0;
     if (shadowStrength > 0.0f) {
+        cascadesRendered = updateShadowCascades(frame, redraw);
+    } else {
+        for (ShadowCascade& c : cascades) c.valid = false;
+    }
+
+    if (gpuDrivenEnabled()) cullHouseBatches(frame, cascadesRendered > 0);
+
+    if (cascadesRendered > 0) {
         glBindFramebuffer(GL_FRAMEBUFFER, shadowFbo);
         glViewport(0, 0, shadowMapSize, shadowMapSize);
         glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-        glClear(GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);
         glEnable(GL_CULL_FACE);
         glCullFace(GL_FRONT);
@@ -1029,29 +1455,19 @@ void Renderer::render(const RenderFrame& frame) {
         glPolygonOffset(2.0f, 4.0f);
 
         glUseProgram(progDepthInst);
-        glUniformMatrix4fv(locLightVP_DI, 1, GL_FALSE, &frame.lightViewProj[0][0]);
-
-        for (const auto& batch : frame.visibleHouseBatches) {
-            auto chunkIt = houseChunks.find(batch.chunkKey);
-            if (chunkIt == houseChunks.end()) continue;
-            auto assetIt = chunkIt->second.find(batch.asset);
-            if (assetIt == chunkIt->second.end()) continue;
-            const ChunkBuf& buf = assetIt->second;
-            if (buf.count == 0) continue;
-            glBindVertexArray(buf.vao);
-            if (buf.indexed) {
-                glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)buf.indexCount, GL_UNSIGNED_INT, (void*)0, (GLsizei)buf.count);
-            } else {
-                glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei)buf.vertexCount, (GLsizei)buf.count);
-            }
-        }
-
-        if (frame.houseAnimCount > 0) {
-            glBindVertexArray(vaoCubeInstAnim);
-            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)frame.houseAnimCount);
+        glUniform1f(locTime_DI, frame.timeSec);
+        glActiveTexture(GL_TEXTURE7);
+        glBindTexture(GL_TEXTURE_BUFFER, meshBoundsTex);
+        glUniform1i(locMeshBounds_DI, 7);
+        glActiveTexture(GL_TEXTURE0);
+        for (int i = 0; i < SHADOW_CASCADES; i++) {
+            if (!redraw[i]) continue;
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowTex, 0, i);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            glUniformMatrix4fv(locLightVP_DI, 1, GL_FALSE, &cascades[i].viewProj[0][0]);
+            drawHouseBatches(frame, 1, &cascades[i].viewProj);
         }
 
-        glBindVertexArray(0);
         glDisable(GL_POLYGON_OFFSET_FILL);
         glCullFace(GL_BACK);
         glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
@@ -1059,6 +1475,23 @@ void Renderer::render(const RenderFrame& frame) {
         glViewport(0, 0, viewportW, viewportH);
     }
 
+    FrameLightingUBO lit{};
+    for (int i = 0; i < SHADOW_CASCADES; i++) {
+        lit.lightViewProj[i] = cascades[i].viewProj;
+        lit.shadowBias[i] = cascades[i].bias;
+    }
+    lit.sunDir = frame.lighting.sunDir;
+    lit.sunIntensity = frame.lighting.sunIntensity;
+    lit.sunColor = frame.lighting.sunColor;
+    lit.exposure = frame.lighting.exposure;
+    lit.ambientColor = frame.lighting.ambientColor;
+    lit.ambientIntensity = frame.lighting.ambientIntensity;
+    lit.shadowTexel = glm::vec2(1.0f / (float)shadowMapSize);
+    lit.shadowStrength = shadowStrength;
+    glBindBuffer(GL_UNIFORM_BUFFER, uboLighting);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(lit), &lit, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
     glClearColor(0.55f, 0.75f, 0.95f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -1084,18 +1517,9 @@ void Renderer::render(const RenderFrame& frame) {
     glUseProgram(progGround);
     glUniformMatrix4fv(locVP_G, 1, GL_FALSE, &frame.viewProj[0][0]);
     glUniformMatrix4fv(locM_G, 1, GL_FALSE, &I[0][0]);
-    glUniformMatrix4fv(locLightVP_G, 1, GL_FALSE, &frame.lightViewProj[0][0]);
-    glUniform3f(locSunDir_G, frame.lighting.sunDir.x, frame.lighting.sunDir.y, frame.lighting.sunDir.z);
-    glUniform3f(locSunColor_G, frame.lighting.sunColor.x, frame.lighting.sunColor.y, frame.lighting.sunColor.z);
-    glUniform1f(locSunInt_G, frame.lighting.sunIntensity);
-    glUniform3f(locAmbColor_G, frame.lighting.ambientColor.x, frame.lighting.ambientColor.y, frame.lighting.ambientColor.z);
-    glUniform1f(locAmbInt_G, frame.lighting.ambientIntensity);
-    glUniform1f(locExposure_G, frame.lighting.exposure);
-    glUniform1f(locShadowStrength_G, shadowStrength);
     glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, shadowTex);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowTex);
     glUniform1i(locShadowMap_G, 2);
-    glUniform2f(locShadowTexel_G, 1.0f / (float)shadowMapSize, 1.0f / (float)shadowMapSize);
     glUniform1f(locGrassTile_G, 4.0f);
     glUniform1f(locNoiseTile_G, 96.0f);
     glActiveTexture(GL_TEXTURE0);
@@ -1120,26 +1544,52 @@ void Renderer::render(const RenderFrame& frame) {
         glDrawArrays(GL_TRIANGLES, 0, (GLsizei)frame.waterVertexCount);
     }
 
-    if (frame.roadVertexCount > 0) {
+    if (!roadChunks.empty()) {
         glUseProgram(progRoad);
         glUniformMatrix4fv(locVP_R, 1, GL_FALSE, &frame.viewProj[0][0]);
-        glUniformMatrix4fv(locLightVP_R, 1, GL_FALSE, &frame.lightViewProj[0][0]);
-        glUniform3f(locSunDir_R, frame.lighting.sunDir.x, frame.lighting.sunDir.y, frame.lighting.sunDir.z);
-        glUniform3f(locSunColor_R, frame.lighting.sunColor.x, frame.lighting.sunColor.y, frame.lighting.sunColor.z);
-        glUniform1f(locSunInt_R, frame.lighting.sunIntensity);
-        glUniform3f(locAmbColor_R, frame.lighting.ambientColor.x, frame.lighting.ambientColor.y, frame.lighting.ambientColor.z);
-        glUniform1f(locAmbInt_R, frame.lighting.ambientIntensity);
-        glUniform1f(locExposure_R, frame.lighting.exposure);
-        glUniform1f(locShadowStrength_R, shadowStrength);
+        glUniform1f(locChunkSize_R, CHUNK_SIZE_M);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, texRoad);
         glUniform1i(locRoadTex_R, 0);
         glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, shadowTex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowTex);
         glUniform1i(locShadowMap_R, 2);
-        glUniform2f(locShadowTexel_R, 1.0f / (float)shadowMapSize, 1.0f / (float)shadowMapSize);
-        glBindVertexArray(vaoRoad);
-        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)frame.roadVertexCount);
+        glActiveTexture(GL_TEXTURE8);
+        glBindTexture(GL_TEXTURE_BUFFER, texCongestion);
+        glUniform1i(locCongestion_R, 8);
+        glUniform1f(locHeatmap_R, frame.roadHeatmap ? 0.85f : 0.0f);
+        for (const auto& kv : roadChunks) {
+            int32_t cx, cz;
+            UnpackChunk(kv.first, cx, cz);
+            glUniform2f(locOrigin_R, cx * CHUNK_SIZE_M - frame.renderOrigin.x, cz * CHUNK_SIZE_M - frame.renderOrigin.z);
+            glBindVertexArray(kv.second.vao);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)kv.second.count);
+        }
+    }
+
+    // Zone overlay: one quad per chunk, cells shaded from the flag texture array
+    if (!frame.zoneChunks.empty() && texZoneFlags) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+        glUseProgram(progZone);
+        glUniformMatrix4fv(locVP_Z, 1, GL_FALSE, &frame.viewProj[0][0]);
+        glUniform1f(locExposure_Z, frame.lighting.exposure);
+        glUniform1i(locBuildable_Z, frame.showBuildable ? 1 : 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texZoneFlags);
+        glUniform1i(locFlags_Z, 0);
+        glBindVertexArray(vaoZone);
+        for (const auto& zc : frame.zoneChunks) {
+            auto it = zoneLayers.find(zc.chunkKey);
+            if (it == zoneLayers.end()) continue;
+            glUniform2f(locOrigin_Z, zc.origin.x, zc.origin.y);
+            glUniform1i(locLayer_Z, it->second);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
     }
 
     glUseProgram(progBasic);
@@ -1147,74 +1597,28 @@ void Renderer::render(const RenderFrame& frame) {
     glUniformMatrix4fv(locM_B, 1, GL_FALSE, &I[0][0]);
     glUniform1f(locExposure_B, frame.lighting.exposure);
 
-    // Preview overlay
-    std::size_t overlayTotal = frame.zoneResidentialVertexCount
-        + frame.zoneCommercialVertexCount
-        + frame.zoneIndustrialVertexCount
-        + frame.zoneOfficeVertexCount;
-    if (frame.gridVertexCount + overlayTotal + frame.previewVertexCount > 0) {
+    // Active preview
+    if (frame.previewVertexCount > 0) {
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         glDepthMask(GL_FALSE);
-
         glBindVertexArray(vaoPreview);
-
-        // Lot grid
-        if (frame.gridVertexCount > 0) {
-            glUniform3f(locC_B, 0.10f, 0.60f, 0.75f);
-            glUniform1f(locA_B, 0.15f);
-            glDrawArrays(GL_TRIANGLES, 0, (GLsizei)frame.gridVertexCount);
-        }
-
-        auto applyZoneColor = [&](uint8_t zoneType) {
-            switch (zoneType) {
+        if (frame.drawRoadPreview) {
+            glUniform3f(locC_B, 0.20f, 0.65f, 0.95f);
+            glUniform1f(locA_B, 0.50f);
+        } else if (frame.zonePreviewValid) {
+            switch (frame.zonePreviewType) {
                 case 1: glUniform3f(locC_B, 0.20f, 0.45f, 0.90f); break; // commercial (blue)
                 case 2: glUniform3f(locC_B, 0.85f, 0.75f, 0.20f); break; // industrial (yellow)
                 case 3: glUniform3f(locC_B, 0.45f, 0.75f, 0.95f); break; // office (light blue)
                 default: glUniform3f(locC_B, 0.15f, 0.65f, 0.35f); break; // residential
             }
-        };
-
-        // Existing zones overlay (by type)
-        GLint offset = (GLint)frame.gridVertexCount;
-        if (frame.zoneResidentialVertexCount > 0) {
-            applyZoneColor(0);
-            glUniform1f(locA_B, 0.30f);
-            glDrawArrays(GL_TRIANGLES, offset, (GLsizei)frame.zoneResidentialVertexCount);
-            offset += (GLint)frame.zoneResidentialVertexCount;
-        }
-        if (frame.zoneCommercialVertexCount > 0) {
-            applyZoneColor(1);
-            glUniform1f(locA_B, 0.30f);
-            glDrawArrays(GL_TRIANGLES, offset, (GLsizei)frame.zoneCommercialVertexCount);
-            offset += (GLint)frame.zoneCommercialVertexCount;
-        }
-        if (frame.zoneIndustrialVertexCount > 0) {
-            applyZoneColor(2);
-            glUniform1f(locA_B, 0.30f);
-            glDrawArrays(GL_TRIANGLES, offset, (GLsizei)frame.zoneIndustrialVertexCount);
-            offset += (GLint)frame.zoneIndustrialVertexCount;
-        }
-        if (frame.zoneOfficeVertexCount > 0) {
-            applyZoneColor(3);
-            glUniform1f(locA_B, 0.30f);
-            glDrawArrays(GL_TRIANGLES, offset, (GLsizei)frame.zoneOfficeVertexCount);
-            offset += (GLint)frame.zoneOfficeVertexCount;
-        }
-
-        // Active preview
-        if (frame.previewVertexCount > 0) {
-            if (frame.drawRoadPreview) {
-                glUniform3f(locC_B, 0.20f, 0.65f, 0.95f);
-                glUniform1f(locA_B, 0.50f);
-            } else {
-                if (frame.zonePreviewValid) applyZoneColor(frame.zonePreviewType);
-                else glUniform3f(locC_B, 0.90f, 0.20f, 0.20f);
-                glUniform1f(locA_B, 0.35f);
-            }
-            glDrawArrays(GL_TRIANGLES, offset, (GLsizei)frame.previewVertexCount);
+            glUniform1f(locA_B, 0.35f);
+        } else {
+            glUniform3f(locC_B, 0.90f, 0.20f, 0.20f);
+            glUniform1f(locA_B, 0.35f);
         }
-
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)frame.previewVertexCount);
         glDepthMask(GL_TRUE);
         glDisable(GL_BLEND);
     }
@@ -1234,18 +1638,10 @@ void Renderer::render(const RenderFrame& frame) {
     // Houses
     glUseProgram(progInst);
     glUniformMatrix4fv(locVP_I, 1, GL_FALSE, &frame.viewProj[0][0]);
-    glUniformMatrix4fv(locLightVP_I, 1, GL_FALSE, &frame.lightViewProj[0][0]);
-    glUniform3f(locSunDir_I, frame.lighting.sunDir.x, frame.lighting.sunDir.y, frame.lighting.sunDir.z);
-    glUniform3f(locSunColor_I, frame.lighting.sunColor.x, frame.lighting.sunColor.y, frame.lighting.sunColor.z);
-    glUniform1f(locSunInt_I, frame.lighting.sunIntensity);
-    glUniform3f(locAmbColor_I, frame.lighting.ambientColor.x, frame.lighting.ambientColor.y, frame.lighting.ambientColor.z);
-    glUniform1f(locAmbInt_I, frame.lighting.ambientIntensity);
-    glUniform1f(locExposure_I, frame.lighting.exposure);
-    glUniform1f(locShadowStrength_I, shadowStrength);
+    glUniform1f(locTime_I, frame.timeSec);
     glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, shadowTex);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowTex);
     glUniform1i(locShadowMap_I, 2);
-    glUniform2f(locShadowTexel_I, 1.0f / (float)shadowMapSize, 1.0f / (float)shadowMapSize);
     glActiveTexture(GL_TEXTURE3);
     glBindTexture(GL_TEXTURE_2D, texOfficeFacade0);
     glUniform1i(locFacadeTex0_I, 3);
@@ -1258,6 +1654,10 @@ void Renderer::render(const RenderFrame& frame) {
     glActiveTexture(GL_TEXTURE6);
     glBindTexture(GL_TEXTURE_2D, texOfficeFacade3);
     glUniform1i(locFacadeTex3_I, 6);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_BUFFER, meshBoundsTex);
+    glUniform1i(locMeshBounds_I, 7);
+    glActiveTexture(GL_TEXTURE0);
     glUniform2f(locFacadeTile_I, 8.0f, 4.0f);
     glUniform3f(locFacadeTint_I, 1.0f, 1.0f, 1.0f);
     glUniform3f(locC_I, 0.75f, 0.72f, 0.62f);
@@ -1266,27 +1666,7 @@ void Renderer::render(const RenderFrame& frame) {
     // Houses are closed meshes; enable culling here for perf
     glEnable(GL_CULL_FACE);
 
-    for (const auto& batch : frame.visibleHouseBatches) {
-        auto chunkIt = houseChunks.find(batch.chunkKey);
-        if (chunkIt == houseChunks.end()) continue;
-        auto assetIt = chunkIt->second.find(batch.asset);
-        if (assetIt == chunkIt->second.end()) continue;
-        const ChunkBuf& buf = assetIt->second;
-        if (buf.count == 0) continue;
-        glBindVertexArray(buf.vao);
-        if (buf.indexed) {
-            glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)buf.indexCount, GL_UNSIGNED_INT, (void*)0, (GLsizei)buf.count);
-        } else {
-            glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei)buf.vertexCount, (GLsizei)buf.count);
-        }
-    }
-
-    if (frame.houseAnimCount > 0) {
-        glBindVertexArray(vaoCubeInstAnim);
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)frame.houseAnimCount);
-    }
-
-    glBindVertexArray(0);
+    drawHouseBatches(frame, 0);
 }
 
 void Renderer::destroyGL() {
@@ -1297,6 +1677,7 @@ void Renderer::destroyGL() {
     if (progSky) { glDeleteProgram(progSky); progSky = 0; }
     if (progDepth) { glDeleteProgram(progDepth); progDepth = 0; }
     if (progDepthInst) { glDeleteProgram(progDepthInst); progDepthInst = 0; }
+    if (progZone) { glDeleteProgram(progZone); progZone = 0; }
     if (texGrass) { glDeleteTextures(1, &texGrass); texGrass = 0; }
     if (texNoise) { glDeleteTextures(1, &texNoise); texNoise = 0; }
     if (texWater) { glDeleteTextures(1, &texWater); texWater = 0; }
@@ -1306,25 +1687,38 @@ void Renderer::destroyGL() {
     if (texOfficeFacade2) { glDeleteTextures(1, &texOfficeFacade2); texOfficeFacade2 = 0; }
     if (texOfficeFacade3) { glDeleteTextures(1, &texOfficeFacade3); texOfficeFacade3 = 0; }
     if (texSkybox) { glDeleteTextures(1, &texSkybox); texSkybox = 0; }
+    if (texCongestion) { glDeleteTextures(1, &texCongestion); texCongestion = 0; }
+    if (texZoneFlags) { glDeleteTextures(1, &texZoneFlags); texZoneFlags = 0; }
+    zoneLayers.clear();
+    freeZoneLayers.clear();
+    zoneLayerCap = 0;
+    if (uboLighting) { glDeleteBuffers(1, &uboLighting); uboLighting = 0; }
     if (shadowTex) { glDeleteTextures(1, &shadowTex); shadowTex = 0; }
     if (shadowFbo) { glDeleteFramebuffers(1, &shadowFbo); shadowFbo = 0; }
 
-    GLuint vaos[] = { vaoGround, vaoRoad, vaoPreview, vaoSkybox, vaoWater, vaoCubeSingle, vaoCubeInstAnim };
-    GLuint vbos[] = { vboGround, vboRoad, vboPreview, vboWater, vboCube, vboInstAnim };
+    GLuint vaos[] = { vaoGround, vaoPreview, vaoZone, vaoSkybox, vaoWater, vaoCubeSingle };
+    GLuint vbos[] = { vboGround, tboCongestion, vboPreview, vboZone, vboWater, vboCube };
 
     glDeleteVertexArrays((GLsizei)std::size(vaos), vaos);
     glDeleteBuffers((GLsizei)std::size(vbos), vbos);
 
-    for (auto& chunkKv : houseChunks) {
-        for (auto& assetKv : chunkKv.second) {
-            if (assetKv.second.vao) glDeleteVertexArrays(1, &assetKv.second.vao);
-            if (assetKv.second.vbo) glDeleteBuffers(1, &assetKv.second.vbo);
-        }
-    }
     houseChunks.clear();
+    culler.shutdown();
+    if (vaoHouse) { glDeleteVertexArrays(1, &vaoHouse); vaoHouse = 0; }
+    if (vboHouseInst) { glDeleteBuffers(1, &vboHouseInst); vboHouseInst = 0; }
+    houseInstCap = 0;
+    houseInstFree.clear();
+    meshVboBound = meshEboBound = meshBoundsTex = 0;
+
+    for (auto& kv : roadChunks) {
+        glDeleteVertexArrays(1, &kv.second.vao);
+        glDeleteBuffers(1, &kv.second.vbo);
+    }
+    roadChunks.clear();
 
-    vaoGround = vaoRoad = vaoPreview = vaoSkybox = vaoWater = vaoCubeSingle = vaoCubeInstAnim = 0;
-    vboGround = vboRoad = vboPreview = vboWater = vboCube = vboInstAnim = 0;
+    vaoGround = vaoPreview = vaoZone = vaoSkybox = vaoWater = vaoCubeSingle = 0;
+    vboGround = tboCongestion = vboPreview = vboZone = vboWater = vboCube = 0;
+    capCongestion = 0;
 }
 
 void Renderer::shutdown() {
@@ -2,11 +2,14 @@
 
 #include <glm/glm.hpp>
 #include <vector>
+#include <map>
 #include <unordered_map>
 #include <cstdint>
 
 #include "asset_catalog.h"
+#include "gpu_cull.h"
 #include "lighting.h"
+#include "shader_cache.h"
 
 struct RenderMarker {
     glm::vec3 pos{};
@@ -17,39 +20,58 @@ struct RenderMarker {
 struct RenderHouseBatch {
     uint64_t chunkKey = 0;
     AssetId asset = 0;
+    uint32_t first = 0;          // sub-range of the chunk's instances of this asset
+    uint32_t count = UINT32_MAX; // clipped to the uploaded count
+    bool camera = true;          // false: occluded from the camera, shadow map only
+    glm::vec3 boundsMin{0.0f};   // render space; min > max means unknown (never culled)
+    glm::vec3 boundsMax{-1.0f};
 };
 
-struct RoadVertex {
-    glm::vec3 pos{};
-    glm::vec2 uv{};
+struct RenderZoneChunk {
+    uint64_t chunkKey = 0;
+    glm::vec2 origin{}; // chunk corner (min x, min z) relative to the render origin
+};
+
+// One straight piece of road inside a chunk; the road shader extrudes it to a quad.
+struct RoadSegmentGPU {
+    uint16_t ends[4] = {};  // a.x, a.z, b.x, b.z from the chunk corner; 65535 = CHUNK_SIZE_M
+    float v0 = 0.0f;        // texture V (road tiles) at a and b
+    float v1 = 0.0f;
+    int32_t segment = -1;   // road graph edge; indexes the congestion buffer
+    uint8_t halfWidth = 0;  // 1/8 m units
+    uint8_t type = 0;       // 0 = street (the only type so far)
+    uint16_t pad = 0;
 };
 
 struct RenderFrame {
     glm::mat4 viewProj{1.0f};
     glm::mat4 viewProjSky{1.0f};
-    glm::mat4 lightViewProj{1.0f};
     glm::vec3 cameraPos{0.0f};
     glm::vec3 cameraTarget{0.0f};
+    glm::vec3 renderOrigin{0.0f}; // world position of the render-space origin
     LightingParams lighting;
-    std::size_t roadVertexCount = 0;
+    glm::vec3 shadowCenter{0.0f}; // render space; cascades are fitted around it
+    float shadowRadius = 1000.0f; // covered by the outermost cascade
+    // Render-space xz rects (min x, min z, max x, max z) whose casters changed this
+    // frame; cached cascades overlapping one are redrawn.
+    std::vector<glm::vec4> shadowDirtyRects;
     std::size_t waterVertexCount = 0;
-    std::size_t gridVertexCount = 0;
-    std::size_t zoneResidentialVertexCount = 0;
-    std::size_t zoneCommercialVertexCount = 0;
-    std::size_t zoneIndustrialVertexCount = 0;
-    std::size_t zoneOfficeVertexCount = 0;
     std::size_t previewVertexCount = 0;
+    std::vector<RenderZoneChunk> zoneChunks; // drawn from the zone flag texture array
+    bool showBuildable = false;
     bool drawRoadPreview = false;
+    bool roadHeatmap = false;
     bool zonePreviewValid = true;
     uint8_t zonePreviewType = 0;
     std::vector<RenderMarker> markers;
     std::vector<RenderHouseBatch> visibleHouseBatches;
-    std::size_t houseAnimCount = 0;
+    float timeSec = 0.0f; // clock the instance spawn animation is evaluated against
 };
 
 struct HouseInstanceGPU {
     glm::vec4 posYaw;    // xyz position, w = yaw (radians)
     glm::vec4 scaleVar;  // xyz scale, w = office facade index (negative = none)
+    glm::vec4 anim{0.0f, 0.0f, 1.0f, 1.0f}; // x = start time, y = 1/duration (0 = static), z/w = start scale factor (horizontal, vertical)
 };
 
 struct MeshGpu;
@@ -58,18 +80,47 @@ class Renderer {
 public:
     bool init();
     void resize(int w, int h);
-    void updateRoadMesh(const std::vector<RoadVertex>& verts);
+    // Replaces a chunk's road segments; an empty list frees the chunk.
+    void updateRoadChunk(uint64_t key, const std::vector<RoadSegmentGPU>& segments);
+    std::size_t roadMemoryBytes() const;
+    // One value per road segment (volume/capacity); only this buffer changes when traffic does.
+    void updateRoadCongestion(const std::vector<float>& perSegment);
     void updateWaterMesh(const std::vector<glm::vec3>& verts);
     void updatePreviewMesh(const std::vector<glm::vec3>& verts);
+    // Points the house VAO at MeshCache's shared buffers; cheap when they are unchanged.
+    void setMeshBuffers(unsigned int vbo, unsigned int ebo, unsigned int boundsTex, int stride);
     void updateHouseChunk(uint64_t key, AssetId assetId, const MeshGpu& mesh, const std::vector<HouseInstanceGPU>& instances);
-    void updateAnimHouses(const std::vector<HouseInstanceGPU>& animHouses);
+    // Frees every instance range of a chunk; the next updateHouseChunk reallocates them.
+    void releaseHouseChunk(uint64_t key);
+    std::size_t houseChunkBytes(uint64_t key) const;
+    // Zone flags of one chunk (ZoneChunk cells) into a layer of the flag texture array;
+    // false when no layer is free.
+    bool updateZoneChunk(uint64_t key, const uint8_t* cells);
+    bool hasZoneChunk(uint64_t key) const { return zoneLayers.count(key) != 0; }
+    void releaseZoneChunk(uint64_t key);
+    std::size_t zoneChunkBytes() const;
+    std::size_t textureMemoryBytes() const { return textureBytes; }
+    // Compute-culled indirect drawing of houses; only available on a GL 4.3 context.
+    bool gpuDrivenAvailable() const { return culler.ready(); }
+    bool gpuDrivenEnabled() const { return gpuDriven && culler.ready(); }
+    void setGpuDriven(bool on) { gpuDriven = on; }
+    static constexpr int SHADOW_CASCADES = 4;
+    // Cascades redrawn by the last render(); 0 when the cached maps were reused.
+    int shadowCascadesRendered() const { return cascadesRendered; }
     void render(const RenderFrame& frame);
     void shutdown();
 
 private:
     void destroyGL();
+    bool allocHouseInstances(uint32_t count, uint32_t& first);
+    void freeHouseInstances(uint32_t first, uint32_t count);
+    void cullHouseBatches(const RenderFrame& frame, bool shadows);
+    // CPU path: batches with bounds outside cullViewProj are skipped.
+    void drawHouseBatches(const RenderFrame& frame, int view, const glm::mat4* cullViewProj = nullptr);
+    int updateShadowCascades(const RenderFrame& frame, bool redraw[SHADOW_CASCADES]);
 
     // Programs
+    ShaderCache shaderCache;
     unsigned int progBasic = 0;
     unsigned int progInst = 0;
     unsigned int progGround = 0;
@@ -77,6 +128,7 @@ private:
     unsigned int progSky = 0;
     unsigned int progDepth = 0;
     unsigned int progDepthInst = 0;
+    unsigned int progZone = 0;
 
     // Uniform locations
     int locVP_B = -1;
@@ -87,50 +139,29 @@ private:
     int locVP_I = -1;
     int locC_I = -1;
     int locA_I = -1;
-    int locSunDir_I = -1;
-    int locSunColor_I = -1;
-    int locSunInt_I = -1;
-    int locAmbColor_I = -1;
-    int locAmbInt_I = -1;
-    int locExposure_I = -1;
-    int locLightVP_I = -1;
+    int locTime_I = -1;
     int locShadowMap_I = -1;
-    int locShadowTexel_I = -1;
-    int locShadowStrength_I = -1;
     int locFacadeTex0_I = -1;
     int locFacadeTex1_I = -1;
     int locFacadeTex2_I = -1;
     int locFacadeTex3_I = -1;
     int locFacadeTile_I = -1;
     int locFacadeTint_I = -1;
+    int locMeshBounds_I = -1;
     int locVP_G = -1;
     int locM_G = -1;
     int locGrassTile_G = -1;
     int locNoiseTile_G = -1;
     int locGrassTex_G = -1;
     int locNoiseTex_G = -1;
-    int locSunDir_G = -1;
-    int locSunColor_G = -1;
-    int locSunInt_G = -1;
-    int locAmbColor_G = -1;
-    int locAmbInt_G = -1;
-    int locExposure_G = -1;
-    int locLightVP_G = -1;
     int locShadowMap_G = -1;
-    int locShadowTexel_G = -1;
-    int locShadowStrength_G = -1;
     int locVP_R = -1;
-    int locLightVP_R = -1;
+    int locOrigin_R = -1;
+    int locChunkSize_R = -1;
     int locRoadTex_R = -1;
-    int locSunDir_R = -1;
-    int locSunColor_R = -1;
-    int locSunInt_R = -1;
-    int locAmbColor_R = -1;
-    int locAmbInt_R = -1;
-    int locExposure_R = -1;
     int locShadowMap_R = -1;
-    int locShadowTexel_R = -1;
-    int locShadowStrength_R = -1;
+    int locCongestion_R = -1;
+    int locHeatmap_R = -1;
     int locVP_S = -1;
     int locSkyTex_S = -1;
     int locSkyBright_S = -1;
@@ -139,6 +170,14 @@ private:
     int locLightVP_D = -1;
     int locM_D = -1;
     int locLightVP_DI = -1;
+    int locTime_DI = -1;
+    int locMeshBounds_DI = -1;
+    int locVP_Z = -1;
+    int locOrigin_Z = -1;
+    int locLayer_Z = -1;
+    int locFlags_Z = -1;
+    int locBuildable_Z = -1;
+    int locExposure_Z = -1;
 
     // Buffers / VAOs
     unsigned int vaoGround = 0;
@@ -153,44 +192,91 @@ private:
     unsigned int texOfficeFacade3 = 0;
     unsigned int vaoSkybox = 0;
     unsigned int texSkybox = 0;
+    std::size_t textureBytes = 0;
     unsigned int vaoWater = 0;
     unsigned int vboWater = 0;
 
-    unsigned int vaoRoad = 0;
-    unsigned int vboRoad = 0;
+    struct RoadChunkBuf {
+        unsigned int vao = 0;
+        unsigned int vbo = 0;
+        std::size_t count = 0;
+        std::size_t capacity = 0;
+    };
+    std::unordered_map<uint64_t, RoadChunkBuf> roadChunks;
+    unsigned int tboCongestion = 0;
+    unsigned int texCongestion = 0;
 
     unsigned int vaoPreview = 0;
     unsigned int vboPreview = 0;
 
+    // Zone flags, one R8UI layer per resident chunk
+    unsigned int vaoZone = 0;
+    unsigned int vboZone = 0;
+    unsigned int texZoneFlags = 0;
+    int zoneLayerCap = 0;
+    int zoneLayerMax = 0;
+    std::unordered_map<uint64_t, int> zoneLayers;
+    std::vector<int> freeZoneLayers;
+
     unsigned int vboCube = 0;
     unsigned int vaoCubeSingle = 0;
 
-    unsigned int vaoCubeInstAnim = 0;
-    unsigned int vboInstAnim = 0;
-
+    // Cascaded shadow map, one array layer per cascade. A cascade is redrawn only
+    // when its matrix changes or casters inside it changed.
+    struct ShadowCascade {
+        glm::mat4 viewProj{1.0f};
+        glm::vec3 center{0.0f};
+        glm::vec3 sunDir{0.0f};
+        float radius = 0.0f;
+        float bias = 0.0f; // depth units for the receivers' comparison
+        bool valid = false;
+    };
+    unsigned int uboLighting = 0; // FrameLighting block of the lit programs
     unsigned int shadowFbo = 0;
     unsigned int shadowTex = 0;
     int shadowMapSize = 2048;
+    ShadowCascade cascades[SHADOW_CASCADES];
+    glm::vec3 cascadeOrigin{0.0f};
+    int cascadesRendered = 0;
 
     int viewportW = 0;
     int viewportH = 0;
 
+    // One (chunk, asset) batch: a range of the shared instance buffer plus its
+    // mesh's index ranges, full mesh first, then each simplified level.
+    struct LodRange {
+        unsigned int firstIndex = 0; // in units of indexType
+        int indexCount = 0;
+        float distance = 0.0f;       // camera distance the level starts at
+    };
     struct ChunkBuf {
-        unsigned int vao = 0;
-        unsigned int vbo = 0;
-        unsigned int meshVbo = 0;
-        unsigned int meshEbo = 0;
-        std::size_t vertexCount = 0;
-        std::size_t indexCount = 0;
-        bool indexed = false;
-        std::size_t count = 0;
-        std::size_t capacity = 0;
+        uint32_t first = 0;    // in instances
+        uint32_t count = 0;
+        uint32_t capacity = 0;
+        int baseVertex = 0;
+        LodRange lods[GpuCuller::MAX_LODS];
+        int lodCount = 0;
+        unsigned int indexType = 0; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+        float radius = 0.0f;
     };
     std::unordered_map<uint64_t, std::unordered_map<AssetId, ChunkBuf>> houseChunks;
 
+    // All houses draw through one VAO: mesh attributes from MeshCache's buffers,
+    // instance attributes re-pointed at each batch's range of vboHouseInst.
+    unsigned int vaoHouse = 0;
+    unsigned int meshVboBound = 0;
+    unsigned int meshEboBound = 0;
+    unsigned int meshBoundsTex = 0;
+    unsigned int vboHouseInst = 0;
+    uint32_t houseInstCap = 0;
+    std::map<uint32_t, uint32_t> houseInstFree; // first -> count, coalesced
+
+    GpuCuller culler;
+    bool gpuDriven = true;
+    float houseDrawDistance = 6000.0f; // from the camera; per instance on the GPU path, per batch on the CPU path
+
     // Buffer capacities to avoid reallocation thrash
-    std::size_t capRoad = 0;
+    std::size_t capCongestion = 0;
     std::size_t capWater = 0;
     std::size_t capPreview = 0;
-    std::size_t capInstAnim = 0;
 };
@@ -0,0 +1,554 @@
+#include "road_graph.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float NODE_MERGE_M = 0.5f;
+constexpr float NODE_CELL_M = 32.0f;
+constexpr float SEG_CELL_M = 128.0f;
+
+uint64_t CellKey(int32_t x, int32_t z) {
+    return (uint64_t(uint32_t(x)) << 32) | uint32_t(z);
+}
+
+int32_t CellCoord(float v, float cell) {
+    return (int32_t)std::floor(v / cell);
+}
+
+float Cross2(const glm::vec2& a, const glm::vec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+// Proper or touching intersection of two XZ segments; parallel pairs are ignored.
+bool SegmentCrossXZ(
+    const glm::vec3& a, const glm::vec3& b,
+    const glm::vec3& c, const glm::vec3& d,
+    float& outT, float& outU)
+{
+    glm::vec2 r(b.x - a.x, b.z - a.z);
+    glm::vec2 s(d.x - c.x, d.z - c.z);
+    float denom = Cross2(r, s);
+    float scale = std::sqrt((r.x*r.x + r.y*r.y) * (s.x*s.x + s.y*s.y));
+    if (std::fabs(denom) <= scale * 1e-6f) return false;
+    glm::vec2 qp(c.x - a.x, c.z - a.z);
+    float t = Cross2(qp, s) / denom;
+    float u = Cross2(qp, r) / denom;
+    const float eps = 1e-5f;
+    if (t < -eps || t > 1.0f + eps || u < -eps || u > 1.0f + eps) return false;
+    outT = std::min(std::max(t, 0.0f), 1.0f);
+    outU = std::min(std::max(u, 0.0f), 1.0f);
+    return true;
+}
+
+float DistSqToSegmentXZ(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b) {
+    glm::vec2 ap(p.x - a.x, p.z - a.z);
+    glm::vec2 ab(b.x - a.x, b.z - a.z);
+    float ab2 = ab.x*ab.x + ab.y*ab.y;
+    float t = (ab2 > 1e-8f) ? (ap.x*ab.x + ap.y*ab.y) / ab2 : 0.0f;
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    glm::vec2 d = ap - ab * t;
+    return d.x*d.x + d.y*d.y;
+}
+
+// Cells crossed by a segment, walked one grid column at a time.
+template <typename Fn>
+void ForEachSegmentCell(const glm::vec3& a, const glm::vec3& b, float cell, Fn&& fn) {
+    glm::vec3 p0 = (a.x <= b.x) ? a : b;
+    glm::vec3 p1 = (a.x <= b.x) ? b : a;
+    int32_t cx0 = CellCoord(p0.x, cell);
+    int32_t cx1 = CellCoord(p1.x, cell);
+    float dx = p1.x - p0.x;
+    for (int32_t cx = cx0; cx <= cx1; cx++) {
+        float zA = p0.z;
+        float zB = p1.z;
+        if (dx > 1e-6f) {
+            float xa = std::max(p0.x, cx * cell);
+            float xb = std::min(p1.x, (cx + 1) * cell);
+            zA = p0.z + (p1.z - p0.z) * ((xa - p0.x) / dx);
+            zB = p0.z + (p1.z - p0.z) * ((xb - p0.x) / dx);
+        }
+        int32_t cz0 = CellCoord(std::min(zA, zB), cell);
+        int32_t cz1 = CellCoord(std::max(zA, zB), cell);
+        for (int32_t cz = cz0; cz <= cz1; cz++) fn(CellKey(cx, cz));
+    }
+}
+
+int SegmentIndexAt(const std::vector<float>& cumLen, float d, bool spanEnd) {
+    int last = (int)cumLen.size() - 2;
+    if (last < 0) return 0;
+    auto it = spanEnd ? std::lower_bound(cumLen.begin(), cumLen.end(), d)
+                      : std::upper_bound(cumLen.begin(), cumLen.end(), d);
+    int idx = (int)(it - cumLen.begin()) - 1;
+    return std::min(std::max(idx, 0), last);
+}
+
+} // namespace
+
+void RoadGraph::clear() {
+    for (int i = 0; i < (int)nodeList.size(); i++) {
+        if (nodeList[i].alive) markNode(i);
+    }
+    roads.clear();
+    nodeList.clear();
+    edgeList.clear();
+    freeNodes.clear();
+    freeEdges.clear();
+    nodeGrid.clear();
+    segGrid.clear();
+    liveNodes = 0;
+    liveEdges = 0;
+    topoVersion++;
+}
+
+void RoadGraph::beginBulkLoad() {
+    clear();
+}
+
+void RoadGraph::bulkAddRoad(int roadId, const std::vector<glm::vec3>& pts) {
+    if (pts.size() < 2) return;
+    storeRoad(roadId, pts);
+    insertSegments(roadId, roads[roadId]);
+}
+
+void RoadGraph::endBulkLoad() {
+    struct SweepSeg {
+        int roadId;
+        int seg;
+        float minX, maxX, minZ, maxZ;
+    };
+    std::vector<int> roadIds;
+    roadIds.reserve(roads.size());
+    for (const auto& kv : roads) roadIds.push_back(kv.first);
+    std::sort(roadIds.begin(), roadIds.end());
+
+    std::vector<SweepSeg> segs;
+    for (int id : roadIds) {
+        const RoadEntry& r = roads[id];
+        for (int i = 0; i + 1 < (int)r.pts.size(); i++) {
+            const glm::vec3& a = r.pts[i];
+            const glm::vec3& b = r.pts[i + 1];
+            segs.push_back({id, i,
+                            std::min(a.x, b.x), std::max(a.x, b.x),
+                            std::min(a.z, b.z), std::max(a.z, b.z)});
+        }
+    }
+    std::sort(segs.begin(), segs.end(), [](const SweepSeg& x, const SweepSeg& y) {
+        if (x.minX != y.minX) return x.minX < y.minX;
+        if (x.roadId != y.roadId) return x.roadId < y.roadId;
+        return x.seg < y.seg;
+    });
+
+    // Sweep along x; the active set holds segments whose x-range still overlaps the sweep line.
+    std::vector<int> active;
+    for (int si = 0; si < (int)segs.size(); si++) {
+        const SweepSeg& s = segs[si];
+        RoadEntry& rs = roads[s.roadId];
+        for (size_t k = 0; k < active.size();) {
+            const SweepSeg& o = segs[active[k]];
+            if (o.maxX < s.minX) {
+                active[k] = active.back();
+                active.pop_back();
+                continue;
+            }
+            k++;
+            if (o.maxZ < s.minZ || o.minZ > s.maxZ) continue;
+            if (o.roadId == s.roadId && std::abs(o.seg - s.seg) <= 1) continue;
+            RoadEntry& ro = roads[o.roadId];
+            float t, u;
+            if (!SegmentCrossXZ(rs.pts[s.seg], rs.pts[s.seg + 1], ro.pts[o.seg], ro.pts[o.seg + 1], t, u)) continue;
+            glm::vec3 p = rs.pts[s.seg] + (rs.pts[s.seg + 1] - rs.pts[s.seg]) * t;
+            p.y = 0.0f;
+            float ds = rs.cumLen[s.seg] + (rs.cumLen[s.seg + 1] - rs.cumLen[s.seg]) * t;
+            float dof = ro.cumLen[o.seg] + (ro.cumLen[o.seg + 1] - ro.cumLen[o.seg]) * u;
+            rs.cuts.push_back({ds, p, o.roadId});
+            ro.cuts.push_back({dof, p, s.roadId});
+        }
+        active.push_back(si);
+    }
+
+    for (int id : roadIds) linkRoadEdges(id, roads[id]);
+    topoVersion++;
+}
+
+void RoadGraph::setRoad(int roadId, const std::vector<glm::vec3>& pts) {
+    if (pts.size() < 2) {
+        removeRoad(roadId);
+        return;
+    }
+
+    std::vector<int> touched;
+    auto it = roads.find(roadId);
+    if (it != roads.end()) {
+        RoadEntry& old = it->second;
+        for (const Cut& c : old.cuts) {
+            if (c.otherRoad != roadId) touched.push_back(c.otherRoad);
+        }
+        eraseSegments(roadId, old);
+        unlinkRoadEdges(old);
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        for (int other : touched) dropCutsAgainst(other, roadId);
+    }
+
+    storeRoad(roadId, pts);
+    RoadEntry& r = roads[roadId];
+    insertSegments(roadId, r);
+    collectLocalCrossings(roadId, touched);
+
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (int other : touched) {
+        if (other == roadId) continue;
+        auto oit = roads.find(other);
+        if (oit == roads.end()) continue;
+        unlinkRoadEdges(oit->second);
+        linkRoadEdges(other, oit->second);
+    }
+    linkRoadEdges(roadId, roads[roadId]);
+    topoVersion++;
+}
+
+void RoadGraph::removeRoad(int roadId) {
+    auto it = roads.find(roadId);
+    if (it == roads.end()) return;
+
+    std::vector<int> touched;
+    for (const Cut& c : it->second.cuts) {
+        if (c.otherRoad != roadId) touched.push_back(c.otherRoad);
+    }
+    eraseSegments(roadId, it->second);
+    unlinkRoadEdges(it->second);
+    roads.erase(it);
+
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (int other : touched) {
+        auto oit = roads.find(other);
+        if (oit == roads.end()) continue;
+        dropCutsAgainst(other, roadId);
+        unlinkRoadEdges(oit->second);
+        linkRoadEdges(other, oit->second);
+    }
+    topoVersion++;
+}
+
+int RoadGraph::degree(int node) const {
+    if (node < 0 || node >= (int)nodeList.size()) return 0;
+    return (int)nodeList[node].edges.size();
+}
+
+int RoadGraph::otherNode(int edge, int node) const {
+    if (edge < 0 || edge >= (int)edgeList.size()) return -1;
+    const RoadGraphEdge& e = edgeList[edge];
+    return (e.nodeA == node) ? e.nodeB : e.nodeA;
+}
+
+bool RoadGraph::isCrossing(int node) const {
+    if (node < 0 || node >= (int)nodeList.size()) return false;
+    const RoadGraphNode& n = nodeList[node];
+    if (n.edges.size() >= 3) return true;
+    if (n.edges.size() < 2) return false;
+    return edgeList[n.edges[0]].roadId != edgeList[n.edges[1]].roadId;
+}
+
+const std::vector<int>* RoadGraph::roadEdges(int roadId) const {
+    auto it = roads.find(roadId);
+    if (it == roads.end()) return nullptr;
+    return &it->second.edges;
+}
+
+int RoadGraph::edgeAt(int roadId, float d) const {
+    auto it = roads.find(roadId);
+    if (it == roads.end() || it->second.edges.empty()) return -1;
+    const std::vector<int>& es = it->second.edges;
+    auto e = std::upper_bound(es.begin(), es.end(), d, [&](float v, int edge) {
+        return v < edgeList[edge].d0;
+    });
+    if (e == es.begin()) return es.front();
+    return *(e - 1);
+}
+
+int RoadGraph::findNodeNear(const glm::vec3& p, float radius) const {
+    std::vector<int> found;
+    nodesNear(p, radius, found);
+    int best = -1;
+    float bestSq = radius * radius;
+    for (int n : found) {
+        glm::vec2 d(nodeList[n].pos.x - p.x, nodeList[n].pos.z - p.z);
+        float dsq = d.x*d.x + d.y*d.y;
+        if (dsq <= bestSq) {
+            bestSq = dsq;
+            best = n;
+        }
+    }
+    return best;
+}
+
+void RoadGraph::nodesNear(const glm::vec3& p, float radius, std::vector<int>& out) const {
+    out.clear();
+    float rSq = radius * radius;
+    int32_t x0 = CellCoord(p.x - radius, NODE_CELL_M);
+    int32_t x1 = CellCoord(p.x + radius, NODE_CELL_M);
+    int32_t z0 = CellCoord(p.z - radius, NODE_CELL_M);
+    int32_t z1 = CellCoord(p.z + radius, NODE_CELL_M);
+    for (int32_t cz = z0; cz <= z1; cz++) {
+        for (int32_t cx = x0; cx <= x1; cx++) {
+            auto it = nodeGrid.find(CellKey(cx, cz));
+            if (it == nodeGrid.end()) continue;
+            for (int n : it->second) {
+                glm::vec2 d(nodeList[n].pos.x - p.x, nodeList[n].pos.z - p.z);
+                if (d.x*d.x + d.y*d.y <= rSq) out.push_back(n);
+            }
+        }
+    }
+}
+
+void RoadGraph::segmentsNear(const glm::vec3& p, float radius, std::vector<RoadGraphSegment>& out) const {
+    out.clear();
+    float rSq = radius * radius;
+    std::vector<std::pair<int, int>> cand;
+    int32_t x0 = CellCoord(p.x - radius, SEG_CELL_M);
+    int32_t x1 = CellCoord(p.x + radius, SEG_CELL_M);
+    int32_t z0 = CellCoord(p.z - radius, SEG_CELL_M);
+    int32_t z1 = CellCoord(p.z + radius, SEG_CELL_M);
+    for (int32_t cz = z0; cz <= z1; cz++) {
+        for (int32_t cx = x0; cx <= x1; cx++) {
+            auto it = segGrid.find(CellKey(cx, cz));
+            if (it == segGrid.end()) continue;
+            cand.insert(cand.end(), it->second.begin(), it->second.end());
+        }
+    }
+    std::sort(cand.begin(), cand.end());
+    cand.erase(std::unique(cand.begin(), cand.end()), cand.end());
+    for (const auto& c : cand) {
+        auto rit = roads.find(c.first);
+        if (rit == roads.end()) continue;
+        const glm::vec3& a = rit->second.pts[c.second];
+        const glm::vec3& b = rit->second.pts[c.second + 1];
+        if (DistSqToSegmentXZ(p, a, b) > rSq) continue;
+        out.push_back({c.first, c.second, a, b});
+    }
+}
+
+void RoadGraph::takeChangedNodes(std::vector<int>& out) {
+    out.clear();
+    out.swap(changedNodes);
+    for (int n : out) {
+        if (n < (int)changedFlag.size()) changedFlag[n] = 0;
+    }
+}
+
+void RoadGraph::storeRoad(int roadId, const std::vector<glm::vec3>& pts) {
+    RoadEntry& r = roads[roadId];
+    r.pts = pts;
+    for (auto& p : r.pts) p.y = 0.0f;
+    r.cumLen.clear();
+    r.cumLen.reserve(r.pts.size());
+    float acc = 0.0f;
+    r.cumLen.push_back(0.0f);
+    for (size_t i = 0; i + 1 < r.pts.size(); i++) {
+        glm::vec2 d(r.pts[i + 1].x - r.pts[i].x, r.pts[i + 1].z - r.pts[i].z);
+        acc += std::sqrt(d.x*d.x + d.y*d.y);
+        r.cumLen.push_back(acc);
+    }
+    r.cuts.clear();
+}
+
+void RoadGraph::insertSegments(int roadId, RoadEntry& r) {
+    r.cells.clear();
+    for (int i = 0; i + 1 < (int)r.pts.size(); i++) {
+        ForEachSegmentCell(r.pts[i], r.pts[i + 1], SEG_CELL_M, [&](uint64_t key) {
+            segGrid[key].push_back({roadId, i});
+            r.cells.push_back(key);
+        });
+    }
+    std::sort(r.cells.begin(), r.cells.end());
+    r.cells.erase(std::unique(r.cells.begin(), r.cells.end()), r.cells.end());
+}
+
+void RoadGraph::eraseSegments(int roadId, RoadEntry& r) {
+    for (uint64_t key : r.cells) {
+        auto it = segGrid.find(key);
+        if (it == segGrid.end()) continue;
+        auto& v = it->second;
+        v.erase(std::remove_if(v.begin(), v.end(), [&](const std::pair<int, int>& s) {
+            return s.first == roadId;
+        }), v.end());
+        if (v.empty()) segGrid.erase(it);
+    }
+    r.cells.clear();
+}
+
+void RoadGraph::collectLocalCrossings(int roadId, std::vector<int>& touched) {
+    RoadEntry& r = roads[roadId];
+    std::vector<std::pair<int, int>> cand;
+    for (int i = 0; i + 1 < (int)r.pts.size(); i++) {
+        cand.clear();
+        ForEachSegmentCell(r.pts[i], r.pts[i + 1], SEG_CELL_M, [&](uint64_t key) {
+            auto it = segGrid.find(key);
+            if (it == segGrid.end()) return;
+            cand.insert(cand.end(), it->second.begin(), it->second.end());
+        });
+        std::sort(cand.begin(), cand.end());
+        cand.erase(std::unique(cand.begin(), cand.end()), cand.end());
+
+        for (const auto& c : cand) {
+            int other = c.first;
+            int j = c.second;
+            // Self-crossings are visited once, from the lower segment index.
+            if (other == roadId && j <= i + 1) continue;
+            RoadEntry& ro = roads[other];
+            float t, u;
+            if (!SegmentCrossXZ(r.pts[i], r.pts[i + 1], ro.pts[j], ro.pts[j + 1], t, u)) continue;
+            glm::vec3 p = r.pts[i] + (r.pts[i + 1] - r.pts[i]) * t;
+            p.y = 0.0f;
+            float dr = r.cumLen[i] + (r.cumLen[i + 1] - r.cumLen[i]) * t;
+            float dof = ro.cumLen[j] + (ro.cumLen[j + 1] - ro.cumLen[j]) * u;
+            r.cuts.push_back({dr, p, other});
+            ro.cuts.push_back({dof, p, roadId});
+            if (other != roadId) touched.push_back(other);
+        }
+    }
+}
+
+void RoadGraph::dropCutsAgainst(int roadId, int otherRoad) {
+    auto it = roads.find(roadId);
+    if (it == roads.end()) return;
+    auto& cuts = it->second.cuts;
+    cuts.erase(std::remove_if(cuts.begin(), cuts.end(), [&](const Cut& c) {
+        return c.otherRoad == otherRoad;
+    }), cuts.end());
+}
+
+void RoadGraph::unlinkRoadEdges(RoadEntry& r) {
+    for (int e : r.edges) {
+        RoadGraphEdge& edge = edgeList[e];
+        releaseNodeEdge(edge.nodeA, e);
+        releaseNodeEdge(edge.nodeB, e);
+        edge.alive = false;
+        freeEdges.push_back(e);
+        liveEdges--;
+    }
+    r.edges.clear();
+}
+
+void RoadGraph::linkRoadEdges(int roadId, RoadEntry& r) {
+    r.edges.clear();
+    if (r.pts.size() < 2) return;
+    float total = r.cumLen.back();
+
+    std::vector<Cut> cuts;
+    cuts.reserve(r.cuts.size() + 2);
+    cuts.push_back({0.0f, r.pts.front(), roadId});
+    for (const Cut& c : r.cuts) {
+        if (c.d > 0.0f && c.d < total) cuts.push_back(c);
+    }
+    cuts.push_back({total, r.pts.back(), roadId});
+    std::stable_sort(cuts.begin() + 1, cuts.end() - 1, [](const Cut& a, const Cut& b) { return a.d < b.d; });
+
+    // Collapse cuts closer than the merge distance; the road endpoints always win.
+    std::vector<Cut> merged;
+    merged.reserve(cuts.size());
+    for (size_t i = 0; i < cuts.size(); i++) {
+        bool isEnd = (i + 1 == cuts.size());
+        if (!merged.empty() && cuts[i].d - merged.back().d < NODE_MERGE_M) {
+            if (isEnd && merged.size() > 1) merged.back() = cuts[i];
+            else if (isEnd) merged.push_back(cuts[i]);
+            continue;
+        }
+        merged.push_back(cuts[i]);
+    }
+
+    std::vector<int> nodeIds;
+    nodeIds.reserve(merged.size());
+    for (const Cut& c : merged) nodeIds.push_back(acquireNode(c.pos));
+
+    for (size_t i = 0; i + 1 < merged.size(); i++) {
+        int nA = nodeIds[i];
+        int nB = nodeIds[i + 1];
+        // Both ends merged into one node (a road shorter than the merge
+        // distance, or cuts snapped to the same junction): no self-loops.
+        if (nA == nB || merged[i + 1].d - merged[i].d < 1e-4f) continue;
+
+        int e;
+        if (!freeEdges.empty()) {
+            e = freeEdges.back();
+            freeEdges.pop_back();
+        } else {
+            e = (int)edgeList.size();
+            edgeList.emplace_back();
+        }
+        RoadGraphEdge& edge = edgeList[e];
+        edge.roadId = roadId;
+        edge.nodeA = nA;
+        edge.nodeB = nB;
+        edge.d0 = merged[i].d;
+        edge.d1 = merged[i + 1].d;
+        edge.seg0 = SegmentIndexAt(r.cumLen, edge.d0, false);
+        edge.seg1 = std::max(edge.seg0, SegmentIndexAt(r.cumLen, edge.d1, true));
+        edge.alive = true;
+        liveEdges++;
+        r.edges.push_back(e);
+        nodeList[nA].edges.push_back(e);
+        nodeList[nB].edges.push_back(e);
+        markNode(nA);
+        markNode(nB);
+    }
+
+    // Nodes acquired for a span that produced no edge (degenerate roads) must not linger.
+    for (int n : nodeIds) {
+        RoadGraphNode& node = nodeList[n];
+        if (!node.alive || !node.edges.empty()) continue;
+        releaseNodeEdge(n, -1);
+    }
+}
+
+int RoadGraph::acquireNode(const glm::vec3& p) {
+    int existing = findNodeNear(p, NODE_MERGE_M);
+    if (existing >= 0) return existing;
+
+    int n;
+    if (!freeNodes.empty()) {
+        n = freeNodes.back();
+        freeNodes.pop_back();
+    } else {
+        n = (int)nodeList.size();
+        nodeList.emplace_back();
+    }
+    RoadGraphNode& node = nodeList[n];
+    node.pos = glm::vec3(p.x, 0.0f, p.z);
+    node.edges.clear();
+    node.alive = true;
+    liveNodes++;
+    nodeGrid[CellKey(CellCoord(p.x, NODE_CELL_M), CellCoord(p.z, NODE_CELL_M))].push_back(n);
+    markNode(n);
+    return n;
+}
+
+void RoadGraph::releaseNodeEdge(int node, int edge) {
+    RoadGraphNode& n = nodeList[node];
+    auto& es = n.edges;
+    es.erase(std::remove(es.begin(), es.end(), edge), es.end());
+    markNode(node);
+    if (!es.empty() || !n.alive) return;
+
+    n.alive = false;
+    liveNodes--;
+    freeNodes.push_back(node);
+    auto it = nodeGrid.find(CellKey(CellCoord(n.pos.x, NODE_CELL_M), CellCoord(n.pos.z, NODE_CELL_M)));
+    if (it != nodeGrid.end()) {
+        auto& v = it->second;
+        v.erase(std::remove(v.begin(), v.end(), node), v.end());
+        if (v.empty()) nodeGrid.erase(it);
+    }
+}
+
+void RoadGraph::markNode(int node) {
+    if (node < 0) return;
+    if (node >= (int)changedFlag.size()) changedFlag.resize(node + 1, 0);
+    if (changedFlag[node]) return;
+    changedFlag[node] = 1;
+    changedNodes.push_back(node);
+}
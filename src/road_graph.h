@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Planar road graph: nodes are road endpoints and crossings, edges are spans
+// [d0, d1] (distance along the road polyline) between consecutive nodes.
+struct RoadGraphNode {
+    glm::vec3 pos{};
+    std::vector<int> edges;
+    bool alive = false;
+};
+
+struct RoadGraphEdge {
+    int roadId = 0;
+    int nodeA = -1; // node at d0
+    int nodeB = -1; // node at d1
+    float d0 = 0.0f;
+    float d1 = 0.0f;
+    int seg0 = 0;   // first polyline segment touched by the span
+    int seg1 = 0;   // last polyline segment touched by the span
+    bool alive = false;
+
+    float length() const { return d1 - d0; }
+};
+
+struct RoadGraphSegment {
+    int roadId = 0;
+    int seg = 0;
+    glm::vec3 a{};
+    glm::vec3 b{};
+};
+
+class RoadGraph {
+public:
+    // Bulk load: stage every road, then one sweep-line pass finds all crossings.
+    void beginBulkLoad();
+    void bulkAddRoad(int roadId, const std::vector<glm::vec3>& pts);
+    void endBulkLoad();
+
+    // Single edits: crossings are found with local grid queries and only the
+    // touched roads re-split their edges.
+    void setRoad(int roadId, const std::vector<glm::vec3>& pts);
+    void removeRoad(int roadId);
+    void clear();
+
+    const std::vector<RoadGraphNode>& nodes() const { return nodeList; }
+    const std::vector<RoadGraphEdge>& edges() const { return edgeList; }
+    int nodeCount() const { return liveNodes; }
+    int edgeCount() const { return liveEdges; }
+    int degree(int node) const;
+    int otherNode(int edge, int node) const;
+    bool isCrossing(int node) const;
+    bool hasRoad(int roadId) const { return roads.find(roadId) != roads.end(); }
+    const std::vector<int>* roadEdges(int roadId) const;
+    int edgeAt(int roadId, float d) const;
+
+    int findNodeNear(const glm::vec3& p, float radius) const;
+    void nodesNear(const glm::vec3& p, float radius, std::vector<int>& out) const;
+    void segmentsNear(const glm::vec3& p, float radius, std::vector<RoadGraphSegment>& out) const;
+
+    // Incremented on every topology change; consumers compare against a cached value.
+    uint32_t version() const { return topoVersion; }
+    // Node ids created, removed or re-linked since the last call.
+    void takeChangedNodes(std::vector<int>& out);
+
+private:
+    struct Cut {
+        float d = 0.0f;
+        glm::vec3 pos{};
+        int otherRoad = 0;
+    };
+
+    struct RoadEntry {
+        std::vector<glm::vec3> pts;
+        std::vector<float> cumLen;
+        std::vector<Cut> cuts;
+        std::vector<int> edges;
+        std::vector<uint64_t> cells;
+    };
+
+    void storeRoad(int roadId, const std::vector<glm::vec3>& pts);
+    void insertSegments(int roadId, RoadEntry& r);
+    void eraseSegments(int roadId, RoadEntry& r);
+    void collectLocalCrossings(int roadId, std::vector<int>& touched);
+    void dropCutsAgainst(int roadId, int otherRoad);
+    void unlinkRoadEdges(RoadEntry& r);
+    void linkRoadEdges(int roadId, RoadEntry& r);
+    int acquireNode(const glm::vec3& p);
+    void releaseNodeEdge(int node, int edge);
+    void markNode(int node);
+
+    std::unordered_map<int, RoadEntry> roads;
+    std::vector<RoadGraphNode> nodeList;
+    std::vector<RoadGraphEdge> edgeList;
+    std::vector<int> freeNodes;
+    std::vector<int> freeEdges;
+    std::unordered_map<uint64_t, std::vector<int>> nodeGrid;
+    std::unordered_map<uint64_t, std::vector<std::pair<int, int>>> segGrid;
+    std::vector<int> changedNodes;
+    std::vector<uint8_t> changedFlag;
+    int liveNodes = 0;
+    int liveEdges = 0;
+    uint32_t topoVersion = 0;
+};
@@ -0,0 +1,314 @@
+#include "scalar_field.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SCALAR_FIELD_SSE 1
+#endif
+
+namespace {
+
+constexpr float EMPTY_EPS = 1e-5f;
+
+int FloorDiv(int a, int b) {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// out[i] = sum_j k[j] * in[i + j * stride] for i in [0, count). Rows are contiguous
+// in i, so four outputs share each kernel tap in one SSE register.
+void ConvolveSpan(const float* in, int stride, const float* k, int taps, float* out, int count) {
+    int i = 0;
+#ifdef SCALAR_FIELD_SSE
+    for (; i + 4 <= count; i += 4) {
+        __m128 acc = _mm_setzero_ps();
+        const float* p = in + i;
+        for (int j = 0; j < taps; j++, p += stride) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(k[j]), _mm_loadu_ps(p)));
+        }
+        _mm_storeu_ps(out + i, acc);
+    }
+#endif
+    for (; i < count; i++) {
+        float acc = 0.0f;
+        const float* p = in + i;
+        for (int j = 0; j < taps; j++, p += stride) acc += k[j] * *p;
+        out[i] = acc;
+    }
+}
+
+double MsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+void ScalarField::configure(int diffuseLevel, float sigmaM) {
+    level = std::min(std::max(diffuseLevel, 0), LEVELS - 1);
+    dimL = TILE_DIM >> level;
+    cellL = ZONE_CELL_M * (float)(1 << level);
+
+    float sigma = std::max(sigmaM / cellL, 0.25f);
+    radius = std::min((int)std::ceil(sigma * 3.0f), dimL);
+    kernel.assign(radius * 2 + 1, 0.0f);
+    float sum = 0.0f;
+    for (int i = -radius; i <= radius; i++) {
+        float w = std::exp(-(float)(i * i) / (2.0f * sigma * sigma));
+        kernel[i + radius] = w;
+        sum += w;
+    }
+    for (float& w : kernel) w /= sum;
+
+    // Everything with sources has to be re-diffused with the new kernel.
+    for (auto& kv : tiles) {
+        kv.second.result.clear();
+        if (kv.second.level[0].empty()) continue;
+        int32_t cx, cz;
+        UnpackChunk(kv.first, cx, cz);
+        markDirty(cx * TILE_DIM, cz * TILE_DIM, (cx + 1) * TILE_DIM, (cz + 1) * TILE_DIM);
+    }
+}
+
+ScalarField::Tile& ScalarField::ensureSources(uint64_t key) {
+    Tile& t = tiles[key];
+    if (t.level[0].empty()) {
+        for (int l = 0; l < LEVELS; l++) {
+            int d = TILE_DIM >> l;
+            t.level[l].assign((size_t)d * d, 0.0f);
+        }
+    }
+    return t;
+}
+
+void ScalarField::markDirty(int x0, int z0, int x1, int z1) {
+    if (x1 <= x0 || z1 <= z0) return;
+    dirty.push_back({x0, z0, x1, z1});
+}
+
+void ScalarField::setTileSources(uint64_t key, const std::vector<float>& cells) {
+    auto it = tiles.find(key);
+    const bool had = (it != tiles.end() && !it->second.level[0].empty());
+    const bool clearing = cells.size() != (size_t)TILE_DIM * TILE_DIM;
+    if (!had && clearing) return;
+
+    int minX = TILE_DIM, minZ = TILE_DIM, maxX = -1, maxZ = -1;
+    for (int z = 0; z < TILE_DIM; z++) {
+        for (int x = 0; x < TILE_DIM; x++) {
+            size_t i = (size_t)z * TILE_DIM + x;
+            float oldV = had ? it->second.level[0][i] : 0.0f;
+            float newV = clearing ? 0.0f : cells[i];
+            if (oldV == newV) continue;
+            minX = std::min(minX, x); maxX = std::max(maxX, x);
+            minZ = std::min(minZ, z); maxZ = std::max(maxZ, z);
+        }
+    }
+    if (maxX < 0) return;
+
+    Tile& t = ensureSources(key);
+    if (clearing) std::fill(t.level[0].begin(), t.level[0].end(), 0.0f);
+    else std::memcpy(t.level[0].data(), cells.data(), cells.size() * sizeof(float));
+    pyramidDirty.insert(key);
+
+    int32_t cx, cz;
+    UnpackChunk(key, cx, cz);
+    markDirty(cx * TILE_DIM + minX, cz * TILE_DIM + minZ, cx * TILE_DIM + maxX + 1, cz * TILE_DIM + maxZ + 1);
+}
+
+void ScalarField::addSource(const glm::vec3& pos, float amount) {
+    int gx = (int)std::floor(pos.x / ZONE_CELL_M);
+    int gz = (int)std::floor(pos.z / ZONE_CELL_M);
+    int cx = FloorDiv(gx, TILE_DIM);
+    int cz = FloorDiv(gz, TILE_DIM);
+    uint64_t key = PackChunk(cx, cz);
+    Tile& t = ensureSources(key);
+    t.level[0][(size_t)(gz - cz * TILE_DIM) * TILE_DIM + (gx - cx * TILE_DIM)] += amount;
+    pyramidDirty.insert(key);
+    markDirty(gx, gz, gx + 1, gz + 1);
+}
+
+void ScalarField::stampDisc(const glm::vec3& pos, float radiusM, float amount) {
+    int r = std::max(0, (int)std::ceil(radiusM / ZONE_CELL_M));
+    int gx0 = (int)std::floor(pos.x / ZONE_CELL_M);
+    int gz0 = (int)std::floor(pos.z / ZONE_CELL_M);
+    float rSq = radiusM * radiusM;
+    for (int gz = gz0 - r; gz <= gz0 + r; gz++) {
+        for (int gx = gx0 - r; gx <= gx0 + r; gx++) {
+            float dx = (gx + 0.5f) * ZONE_CELL_M - pos.x;
+            float dz = (gz + 0.5f) * ZONE_CELL_M - pos.z;
+            if (dx * dx + dz * dz > rSq && !(gx == gx0 && gz == gz0)) continue;
+            int cx = FloorDiv(gx, TILE_DIM);
+            int cz = FloorDiv(gz, TILE_DIM);
+            uint64_t key = PackChunk(cx, cz);
+            Tile& t = ensureSources(key);
+            t.level[0][(size_t)(gz - cz * TILE_DIM) * TILE_DIM + (gx - cx * TILE_DIM)] += amount;
+            pyramidDirty.insert(key);
+        }
+    }
+    markDirty(gx0 - r, gz0 - r, gx0 + r + 1, gz0 + r + 1);
+}
+
+void ScalarField::clear() {
+    tiles.clear();
+    pyramidDirty.clear();
+    dirty.clear();
+    stat = ScalarFieldStats{};
+}
+
+std::vector<uint64_t> ScalarField::sourceTileKeys() const {
+    std::vector<uint64_t> keys;
+    for (const auto& kv : tiles) {
+        if (!kv.second.level[0].empty()) keys.push_back(kv.first);
+    }
+    return keys;
+}
+
+void ScalarField::rebuildPyramid(Tile& t) {
+    for (int l = 1; l < LEVELS; l++) {
+        const int d = TILE_DIM >> l;
+        const int ds = d * 2;
+        const std::vector<float>& src = t.level[l - 1];
+        std::vector<float>& dst = t.level[l];
+        for (int z = 0; z < d; z++) {
+            const float* r0 = &src[(size_t)(z * 2) * ds];
+            const float* r1 = r0 + ds;
+            float* o = &dst[(size_t)z * d];
+            for (int x = 0; x < d; x++) {
+                o[x] = 0.25f * (r0[x * 2] + r0[x * 2 + 1] + r1[x * 2] + r1[x * 2 + 1]);
+            }
+        }
+    }
+}
+
+int ScalarField::update() {
+    if (dirty.empty() && pyramidDirty.empty()) return 0;
+    auto t0 = std::chrono::steady_clock::now();
+    if (kernel.empty()) configure(level, cellL * 2.0f);
+
+    for (uint64_t key : pyramidDirty) {
+        auto it = tiles.find(key);
+        if (it == tiles.end() || it->second.level[0].empty()) continue;
+        rebuildPyramid(it->second);
+        bool any = false;
+        for (float v : it->second.level[0]) {
+            if (v != 0.0f) { any = true; break; }
+        }
+        if (!any) {
+            for (auto& l : it->second.level) { l.clear(); l.shrink_to_fit(); }
+        }
+    }
+    pyramidDirty.clear();
+
+    // Dirty rectangles grown by the kernel radius decide which result tiles change.
+    const int scale = 1 << level;
+    std::unordered_set<uint64_t> affected;
+    for (const Rect& r : dirty) {
+        int x0 = FloorDiv(r.x0, scale) - radius;
+        int z0 = FloorDiv(r.z0, scale) - radius;
+        int x1 = FloorDiv(r.x1 - 1, scale) + radius;
+        int z1 = FloorDiv(r.z1 - 1, scale) + radius;
+        for (int cz = FloorDiv(z0, dimL); cz <= FloorDiv(z1, dimL); cz++) {
+            for (int cx = FloorDiv(x0, dimL); cx <= FloorDiv(x1, dimL); cx++) {
+                affected.insert(PackChunk(cx, cz));
+            }
+        }
+    }
+    dirty.clear();
+
+    std::vector<uint64_t> keys(affected.begin(), affected.end());
+    for (uint64_t key : keys) tiles[key]; // create result tiles before the parallel pass
+
+    const int pad = dimL + radius * 2;
+    const int taps = (int)kernel.size();
+    std::vector<std::vector<float>> blockScratch(ParallelWorkerCount());
+    std::vector<std::vector<float>> rowScratch(ParallelWorkerCount());
+    ParallelFor((int)keys.size(), [&](int i, int worker) {
+        int32_t cx, cz;
+        UnpackChunk(keys[i], cx, cz);
+        std::vector<float>& block = blockScratch[worker];
+        std::vector<float>& rows = rowScratch[worker];
+        block.assign((size_t)pad * pad, 0.0f);
+        rows.assign((size_t)pad * dimL, 0.0f);
+
+        // Gather sources of this tile plus a kernel-radius halo from neighbours.
+        bool anySource = false;
+        for (int nz = -1; nz <= 1; nz++) {
+            for (int nx = -1; nx <= 1; nx++) {
+                auto it = tiles.find(PackChunk(cx + nx, cz + nz));
+                if (it == tiles.end() || it->second.level[level].empty()) continue;
+                const std::vector<float>& src = it->second.level[level];
+                int bx0 = std::max(0, nx * dimL + radius);
+                int bx1 = std::min(pad, nx * dimL + radius + dimL);
+                int bz0 = std::max(0, nz * dimL + radius);
+                int bz1 = std::min(pad, nz * dimL + radius + dimL);
+                for (int bz = bz0; bz < bz1; bz++) {
+                    int sz = bz - (nz * dimL + radius);
+                    int sx = bx0 - (nx * dimL + radius);
+                    std::memcpy(&block[(size_t)bz * pad + bx0], &src[(size_t)sz * dimL + sx], (size_t)(bx1 - bx0) * sizeof(float));
+                }
+                anySource = true;
+            }
+        }
+
+        Tile& t = tiles.find(keys[i])->second;
+        if (!anySource) {
+            t.result.clear();
+            t.mean = 0.0f;
+            return;
+        }
+        for (int z = 0; z < pad; z++) {
+            ConvolveSpan(&block[(size_t)z * pad], 1, kernel.data(), taps, &rows[(size_t)z * dimL], dimL);
+        }
+        t.result.assign((size_t)dimL * dimL, 0.0f);
+        for (int z = 0; z < dimL; z++) {
+            ConvolveSpan(&rows[(size_t)z * dimL], dimL, kernel.data(), taps, &t.result[(size_t)z * dimL], dimL);
+        }
+        float sum = 0.0f;
+        for (float v : t.result) sum += v;
+        t.mean = sum / (float)(dimL * dimL);
+        if (t.mean < EMPTY_EPS && t.level[0].empty()) t.result.clear();
+    });
+
+    for (uint64_t key : keys) {
+        auto it = tiles.find(key);
+        if (it != tiles.end() && it->second.result.empty() && it->second.level[0].empty()) tiles.erase(it);
+    }
+
+    stat.tiles = (int)tiles.size();
+    stat.sourceTiles = 0;
+    for (const auto& kv : tiles) {
+        if (!kv.second.level[0].empty()) stat.sourceTiles++;
+    }
+    stat.lastDiffusedTiles = (int)keys.size();
+    stat.lastUpdateMs = MsSince(t0);
+    return (int)keys.size();
+}
+
+float ScalarField::resultAt(int gx, int gz) const {
+    int cx = FloorDiv(gx, dimL);
+    int cz = FloorDiv(gz, dimL);
+    auto it = tiles.find(PackChunk(cx, cz));
+    if (it == tiles.end() || it->second.result.empty()) return 0.0f;
+    return it->second.result[(size_t)(gz - cz * dimL) * dimL + (gx - cx * dimL)];
+}
+
+float ScalarField::sample(const glm::vec3& pos) const {
+    float u = pos.x / cellL - 0.5f;
+    float v = pos.z / cellL - 0.5f;
+    int x0 = (int)std::floor(u);
+    int z0 = (int)std::floor(v);
+    float fx = u - (float)x0;
+    float fz = v - (float)z0;
+    float a = resultAt(x0, z0) + (resultAt(x0 + 1, z0) - resultAt(x0, z0)) * fx;
+    float b = resultAt(x0, z0 + 1) + (resultAt(x0 + 1, z0 + 1) - resultAt(x0, z0 + 1)) * fx;
+    return a + (b - a) * fz;
+}
+
+float ScalarField::tileMean(uint64_t key) const {
+    auto it = tiles.find(key);
+    return (it == tiles.end()) ? 0.0f : it->second.mean;
+}
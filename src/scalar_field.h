@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "zone_grid.h"
+
+struct ScalarFieldStats {
+    int tiles = 0;
+    int sourceTiles = 0;
+    int lastDiffusedTiles = 0;
+    double lastUpdateMs = 0.0;
+};
+
+// Sparse chunk-aligned grid field. Sources live at ZONE_CELL_M in one tile per
+// ZoneChunk with a box-filtered mip pyramid; diffusion (separable Gaussian) runs
+// on a coarser pyramid level and only for tiles reached by a dirty rectangle.
+class ScalarField {
+public:
+    static constexpr int TILE_DIM = ZoneChunk::DIM;
+    static constexpr int LEVELS = 4; // 8, 16, 32, 64 m cells
+
+    // sigmaM is the Gaussian spread in metres; diffusion runs at pyramid level diffuseLevel.
+    void configure(int diffuseLevel, float sigmaM);
+
+    // Replaces a tile's sources (TILE_DIM^2 values, row-major z then x); only the
+    // bounding box of changed cells is marked dirty. An empty vector clears the tile.
+    void setTileSources(uint64_t key, const std::vector<float>& cells);
+    void addSource(const glm::vec3& pos, float amount);
+    void stampDisc(const glm::vec3& pos, float radiusM, float amount);
+    void clear();
+    std::vector<uint64_t> sourceTileKeys() const;
+
+    // Re-diffuses the tiles touched since the last call; returns how many.
+    int update();
+
+    float sample(const glm::vec3& pos) const;
+    float tileMean(uint64_t key) const;
+    const ScalarFieldStats& stats() const { return stat; }
+
+private:
+    struct Tile {
+        std::vector<float> level[LEVELS]; // empty when the tile has no sources
+        std::vector<float> result;        // diffused values at diffuseLevel
+        float mean = 0.0f;
+    };
+    struct Rect {
+        int x0, z0, x1, z1; // global level-0 cells, half-open
+    };
+
+    Tile& ensureSources(uint64_t key);
+    void markDirty(int x0, int z0, int x1, int z1);
+    void rebuildPyramid(Tile& t);
+    float resultAt(int gx, int gz) const;
+
+    int level = 2;
+    int dimL = TILE_DIM >> 2;
+    float cellL = ZONE_CELL_M * 4.0f;
+    int radius = 0;
+    std::vector<float> kernel;
+
+    std::unordered_map<uint64_t, Tile> tiles;
+    std::unordered_set<uint64_t> pyramidDirty;
+    std::vector<Rect> dirty;
+    ScalarFieldStats stat;
+};
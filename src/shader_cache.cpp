@@ -0,0 +1,210 @@
+#include "shader_cache.h"
+
+#include "hash.h"
+
+#include <SDL.h>
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// Core in 4.1; the loader is generated for 3.3, so the entry points are fetched here.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace {
+
+typedef void (APIENTRYP GetProgramBinaryFn)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP ProgramBinaryFn)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriFn)(GLuint program, GLenum pname, GLint value);
+
+GetProgramBinaryFn pGetProgramBinary = nullptr;
+ProgramBinaryFn pProgramBinary = nullptr;
+ProgramParameteriFn pProgramParameteri = nullptr;
+
+constexpr uint32_t PROG_MAGIC = 0x47525043; // "CPRG"
+constexpr uint32_t PROG_VERSION = 1;
+
+struct ProgFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format; // driver-defined binary format
+    uint32_t size;
+    uint64_t key;
+};
+
+uint64_t FnvString(uint64_t h, const char* s) {
+    // The terminator separates consecutive strings.
+    return s ? Fnv1a64(s, std::strlen(s) + 1, h) : Fnv1a64("", 1, h);
+}
+
+bool GLCheckShader(GLuint shader, const char* label) {
+    GLint ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &len);
+        std::string log((size_t)len, '\0');
+        glGetShaderInfoLog(shader, len, &len, log.data());
+        SDL_Log("Shader compile failed (%s): %s", label, log.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool GLCheckProgram(GLuint prog) {
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0;
+        glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
+        std::string log((size_t)len, '\0');
+        glGetProgramInfoLog(prog, len, &len, log.data());
+        SDL_Log("Program link failed: %s", log.c_str());
+        return false;
+    }
+    return true;
+}
+
+GLuint CompileProgram(const char* vsSrc, const char* fsSrc, bool retrievable) {
+    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vs, 1, &vsSrc, nullptr);
+    glCompileShader(vs);
+    if (!GLCheckShader(vs, "VS")) {
+        glDeleteShader(vs);
+        return 0;
+    }
+
+    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fs, 1, &fsSrc, nullptr);
+    glCompileShader(fs);
+    if (!GLCheckShader(fs, "FS")) {
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint prog = glCreateProgram();
+    if (retrievable) pProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(prog, vs);
+    glAttachShader(prog, fs);
+    glLinkProgram(prog);
+    if (!GLCheckProgram(prog)) {
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        glDeleteProgram(prog);
+        return 0;
+    }
+
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    return prog;
+}
+
+// 0 when the file is missing, stale or rejected by the driver.
+GLuint LoadBinary(const std::string& path, uint64_t key) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return 0;
+    ProgFileHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return 0;
+    if (header.magic != PROG_MAGIC || header.version != PROG_VERSION || header.key != key || header.size == 0) return 0;
+    std::vector<char> blob(header.size);
+    if (!in.read(blob.data(), (std::streamsize)blob.size())) return 0;
+
+    GLuint prog = glCreateProgram();
+    pProgramBinary(prog, (GLenum)header.format, blob.data(), (GLsizei)blob.size());
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        glDeleteProgram(prog);
+        return 0;
+    }
+    return prog;
+}
+
+void SaveBinary(const std::string& path, uint64_t key, GLuint prog) {
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> blob((size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    pGetProgramBinary(prog, length, &written, &format, blob.data());
+    if (written <= 0) return;
+
+    // Written under a temporary name so a crash never leaves a torn binary behind.
+    ProgFileHeader header{PROG_MAGIC, PROG_VERSION, (uint32_t)format, (uint32_t)written, key};
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(blob.data(), written);
+        if (!out) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) SDL_Log("Shader cache: could not write %s (%s)", path.c_str(), ec.message().c_str());
+}
+
+} // namespace
+
+void ShaderCache::init(const std::string& cacheDir) {
+    dir = cacheDir;
+    hits = misses = 0;
+    supported = false;
+
+    bool core41 = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1);
+    if (!core41 && SDL_GL_ExtensionSupported("GL_ARB_get_program_binary") != SDL_TRUE) return;
+    pGetProgramBinary = reinterpret_cast<GetProgramBinaryFn>(SDL_GL_GetProcAddress("glGetProgramBinary"));
+    pProgramBinary = reinterpret_cast<ProgramBinaryFn>(SDL_GL_GetProcAddress("glProgramBinary"));
+    pProgramParameteri = reinterpret_cast<ProgramParameteriFn>(SDL_GL_GetProcAddress("glProgramParameteri"));
+    if (!pGetProgramBinary || !pProgramBinary || !pProgramParameteri) return;
+    // Some drivers expose the entry points but no format to store.
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        SDL_Log("Shader cache %s unavailable (%s); compiling from source", dir.c_str(), ec.message().c_str());
+        return;
+    }
+    uint64_t key = Fnv1a64(&PROG_VERSION, sizeof(PROG_VERSION));
+    key = FnvString(key, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    key = FnvString(key, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    key = FnvString(key, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    driverKey = key;
+    supported = true;
+}
+
+unsigned int ShaderCache::build(const char* vsSrc, const char* fsSrc) {
+    if (!supported) {
+        misses++;
+        return CompileProgram(vsSrc, fsSrc, false);
+    }
+
+    uint64_t key = FnvString(FnvString(driverKey, vsSrc), fsSrc);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.prog", (unsigned long long)key);
+    std::string path = dir + "/" + name;
+    if (GLuint prog = LoadBinary(path, key)) {
+        hits++;
+        return prog;
+    }
+
+    misses++;
+    GLuint prog = CompileProgram(vsSrc, fsSrc, true);
+    if (prog) SaveBinary(path, key, prog);
+    return prog;
+}
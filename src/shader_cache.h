@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Builds vertex/fragment programs, keeping their linked binaries under cacheDir
+// (GL 4.1 or ARB_get_program_binary). Files are keyed by the driver strings and
+// both sources, so a driver update or shader edit just recompiles. Without the
+// extension every program is compiled from source as before.
+class ShaderCache {
+public:
+    void init(const std::string& cacheDir);
+
+    // 0 on failure; compile and link errors are logged.
+    unsigned int build(const char* vsSrc, const char* fsSrc);
+
+    bool binariesSupported() const { return supported; }
+    int loaded() const { return hits; }
+    int compiled() const { return misses; }
+
+private:
+    std::string dir;
+    uint64_t driverKey = 0;
+    bool supported = false;
+    int hits = 0;
+    int misses = 0;
+};
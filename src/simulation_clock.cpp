@@ -0,0 +1,105 @@
+#include "simulation_clock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+float Approach(float current, float target, float rate) {
+    return current + (target - current) * rate;
+}
+
+float Clamp01s(float v) {
+    return std::min(1.0f, std::max(-1.0f, v));
+}
+
+} // namespace
+
+void SimulationClock::start(const SimSettings& s) {
+    stop();
+    settings = s;
+    settings.tickHz = std::max(settings.tickHz, 1.0f);
+    quit.store(false);
+    SimResults initial;
+    initial.funds = settings.startingFunds;
+    initial.tickBudgetMs = 1000.0f / settings.tickHz;
+    results.reset(initial);
+    worker = std::thread(&SimulationClock::run, this);
+}
+
+void SimulationClock::stop() {
+    if (!worker.joinable()) return;
+    quit.store(true);
+    worker.join();
+}
+
+void SimulationClock::publishSnapshot(std::shared_ptr<const SimSnapshot> snap) {
+    std::atomic_store(&snapshot, std::move(snap));
+}
+
+void SimulationClock::run() {
+    using clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / settings.tickHz));
+    SimResults r = results.writeSlot();
+    auto next = clock::now() + period;
+    auto windowStart = clock::now();
+    int windowTicks = 0;
+
+    while (!quit.load()) {
+        auto t0 = clock::now();
+        std::shared_ptr<const SimSnapshot> snap = std::atomic_load(&snapshot);
+        if (snap) tick(*snap, r);
+        r.tick++;
+        auto t1 = clock::now();
+        r.tickMs = std::chrono::duration<float, std::milli>(t1 - t0).count();
+        r.tickBudgetMs = 1000.0f / settings.tickHz;
+
+        windowTicks++;
+        float windowSec = std::chrono::duration<float>(t1 - windowStart).count();
+        if (windowSec >= 1.0f) {
+            r.ticksPerSec = (float)windowTicks / windowSec;
+            windowTicks = 0;
+            windowStart = t1;
+        }
+
+        results.writeSlot() = r;
+        results.publish();
+
+        // Fixed rate: a late tick does not shift the schedule, a very late one resyncs.
+        std::this_thread::sleep_until(next);
+        next += period;
+        if (clock::now() > next + period * 4) next = clock::now() + period;
+    }
+}
+
+void SimulationClock::tick(const SimSnapshot& snap, SimResults& r) {
+    const SimSettings& st = settings;
+    float residents = snap.zonedLots[0] * st.residentsPerLot;
+    float jobs = 0.0f;
+    for (int t = 1; t < SIM_ZONE_TYPES; t++) jobs += snap.zonedLots[t] * st.jobsPerLot[t];
+    float workers = residents * 0.6f;
+
+    // Demand: housing follows jobs, retail follows residents, industry and offices
+    // fill the remaining labour pool. Pollution and congestion damp growth.
+    float penalty = 0.3f * snap.avgPollution + 0.2f * std::max(0.0f, snap.avgCongestion - 0.8f);
+    float norm = std::max(50.0f, residents + jobs);
+    float target[SIM_ZONE_TYPES];
+    target[0] = (jobs * 1.1f - workers + 40.0f) / norm * 4.0f * snap.avgLandValue - penalty;
+    target[1] = (residents * 0.15f - snap.zonedLots[1] * st.jobsPerLot[1] + 20.0f) / norm * 4.0f;
+    target[2] = (workers * 0.5f - snap.zonedLots[2] * st.jobsPerLot[2] + 30.0f) / norm * 4.0f - penalty;
+    target[3] = (workers * 0.35f - snap.zonedLots[3] * st.jobsPerLot[3]) / norm * 4.0f * snap.avgLandValue;
+    for (int t = 0; t < SIM_ZONE_TYPES; t++) r.demand[t] = Approach(r.demand[t], Clamp01s(target[t]), 0.05f);
+
+    r.population = (int)std::lround(residents);
+    r.jobs = (int)std::lround(jobs);
+    r.unemployment = (workers > 0.0f) ? std::max(0.0f, (workers - jobs) / workers) : 0.0f;
+
+    int serviceCount = 0;
+    for (int t = 0; t < SIM_SERVICE_TYPES; t++) serviceCount += snap.services[t];
+    float employed = std::min(workers, jobs);
+    r.incomePerDay = residents * st.taxPerResidentDay * snap.avgLandValue + employed * st.taxPerJobDay;
+    r.expensesPerDay = serviceCount * st.serviceUpkeepDay + snap.roadLengthKm * st.roadUpkeepKmDay;
+    r.funds += (double)(r.incomePerDay - r.expensesPerDay) * st.daysPerTick;
+    r.day += st.daysPerTick;
+}
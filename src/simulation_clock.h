@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "triple_buffer.h"
+
+constexpr int SIM_ZONE_TYPES = 4; // residential, commercial, industrial, office
+constexpr int SIM_SERVICE_TYPES = 4;
+
+// Immutable copy of the city state the tick reads; built on the main thread.
+struct SimSnapshot {
+    int zonedLots[SIM_ZONE_TYPES] = {};
+    int buildings = 0;
+    int services[SIM_SERVICE_TYPES] = {};
+    float roadLengthKm = 0.0f;
+    float avgLandValue = 1.0f;
+    float avgPollution = 0.0f;
+    float avgCongestion = 0.0f;
+};
+
+struct SimSettings {
+    float tickHz = 10.0f;
+    float daysPerTick = 1.0f / 24.0f;   // one in-game hour per tick
+    float residentsPerLot = 4.0f;
+    float jobsPerLot[SIM_ZONE_TYPES] = {0.0f, 6.0f, 10.0f, 20.0f};
+    float taxPerResidentDay = 0.9f;
+    float taxPerJobDay = 1.1f;
+    float serviceUpkeepDay = 120.0f;
+    float roadUpkeepKmDay = 35.0f;
+    double startingFunds = 50000.0;
+};
+
+struct SimResults {
+    uint64_t tick = 0;
+    float demand[SIM_ZONE_TYPES] = {}; // -1..1
+    int population = 0;
+    int jobs = 0;
+    float unemployment = 0.0f;
+    double funds = 0.0;
+    float incomePerDay = 0.0f;
+    float expensesPerDay = 0.0f;
+    float day = 0.0f;
+    float tickMs = 0.0f;
+    float tickBudgetMs = 0.0f;
+    float ticksPerSec = 0.0f;
+};
+
+// Runs demand, budget and metrics at a fixed rate on a worker thread. Input is
+// an atomically swapped snapshot pointer; output goes through a triple buffer,
+// so neither side ever blocks.
+class SimulationClock {
+public:
+    ~SimulationClock() { stop(); }
+
+    void start(const SimSettings& s);
+    void stop();
+    bool running() const { return worker.joinable(); }
+
+    void publishSnapshot(std::shared_ptr<const SimSnapshot> snap);
+    // Newest results; call from one thread only (the main thread).
+    SimResults latest() { return results.read(); }
+
+private:
+    void run();
+    void tick(const SimSnapshot& snap, SimResults& r);
+
+    SimSettings settings;
+    std::thread worker;
+    std::atomic<bool> quit{false};
+    std::shared_ptr<const SimSnapshot> snapshot; // std::atomic_load / atomic_store only
+
+    TripleBuffer<SimResults> results;
+};
@@ -0,0 +1,494 @@
+#include "texture_cache.h"
+
+#include "hash.h"
+#include "image_loader.h"
+#include "parallel.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr uint32_t TEX_MAGIC = 0x58455443; // "CTEX"
+constexpr uint32_t TEX_VERSION = 1;
+
+struct TexFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t faces;
+    uint32_t levels;
+    uint32_t format;
+    uint32_t srgb;
+    uint64_t key;
+};
+
+struct TexFileLevel {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pad;
+};
+
+int BlockBytes(TexFormat f) {
+    return (f == TexFormat::BC3) ? 16 : 8;
+}
+
+uint32_t LevelSize(TexFormat f, int w, int h) {
+    if (f == TexFormat::RGBA8) return (uint32_t)w * (uint32_t)h * 4;
+    return (uint32_t)(((w + 3) / 4) * ((h + 3) / 4) * BlockBytes(f));
+}
+
+// Named after the first source's stem for readability and keyed by a hash of
+// every source path, so equal file names in different folders do not collide.
+std::string CachePath(const std::string& dir, const TextureJob& job) {
+    uint64_t h = FNV1A64_OFFSET;
+    for (const std::string& src : job.sources) {
+        std::string p = std::filesystem::path(src).lexically_normal().generic_string();
+        h = Fnv1a64(p.data(), p.size() + 1, h);
+    }
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)h);
+    std::string stem = std::filesystem::path(job.sources[0]).stem().string();
+    return dir + "/" + stem + "-" + hash + (job.sources.size() == 6 ? ".cube" : "") + ".ctex";
+}
+
+bool ParseCooked(const uint8_t* data, std::size_t size, uint64_t key, CookedTexture& tex) {
+    TexFileHeader header{};
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    std::size_t tableBytes = (std::size_t)header.faces * header.levels * sizeof(TexFileLevel);
+    if (header.magic != TEX_MAGIC || header.version != TEX_VERSION || header.key != key ||
+        header.faces == 0 || header.levels == 0 || header.format > (uint32_t)TexFormat::BC4 ||
+        sizeof(header) + tableBytes > size) {
+        return false;
+    }
+    tex.width = (int)header.width;
+    tex.height = (int)header.height;
+    tex.faces = (int)header.faces;
+    tex.levels = (int)header.levels;
+    tex.format = (TexFormat)header.format;
+    tex.srgb = header.srgb != 0;
+    tex.table.resize((size_t)tex.faces * tex.levels);
+    for (size_t i = 0; i < tex.table.size(); i++) {
+        TexFileLevel fl;
+        std::memcpy(&fl, data + sizeof(header) + i * sizeof(fl), sizeof(fl));
+        if (fl.offset + fl.size > size || fl.size != LevelSize(tex.format, (int)fl.width, (int)fl.height)) return false;
+        tex.table[i] = {fl.offset, fl.size, (int)fl.width, (int)fl.height};
+    }
+    return true;
+}
+
+bool OpenCooked(const std::string& path, uint64_t key, CookedTexture& tex) {
+    if (!tex.file.open(path)) return false;
+    if (ParseCooked(tex.file.data(), tex.file.size(), key, tex)) return true;
+    tex.file.close();
+    return false;
+}
+
+// --- mip generation ---
+
+float SrgbToLinear(uint8_t v) {
+    float c = v / 255.0f;
+    return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+uint8_t LinearToSrgb(float c) {
+    c = std::min(std::max(c, 0.0f), 1.0f);
+    float s = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return (uint8_t)(s * 255.0f + 0.5f);
+}
+
+// 2x2 box filter (clamped at odd edges), averaging colour in linear space for sRGB.
+void Downsample(const std::vector<uint8_t>& src, int w, int h, bool srgb, std::vector<uint8_t>& dst, int& dw, int& dh) {
+    // Faces are cooked on several workers; the static's initialization is thread-safe.
+    static const std::array<float, 256> toLinear = [] {
+        std::array<float, 256> t{};
+        for (int i = 0; i < 256; i++) t[i] = SrgbToLinear((uint8_t)i);
+        return t;
+    }();
+    dw = std::max(1, w / 2);
+    dh = std::max(1, h / 2);
+    dst.resize((size_t)dw * dh * 4);
+    for (int y = 0; y < dh; y++) {
+        int y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+        for (int x = 0; x < dw; x++) {
+            int x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+            const uint8_t* p[4] = {&src[((size_t)y0 * w + x0) * 4], &src[((size_t)y0 * w + x1) * 4],
+                                   &src[((size_t)y1 * w + x0) * 4], &src[((size_t)y1 * w + x1) * 4]};
+            uint8_t* d = &dst[((size_t)y * dw + x) * 4];
+            for (int c = 0; c < 4; c++) {
+                if (srgb && c < 3) {
+                    d[c] = LinearToSrgb((toLinear[p[0][c]] + toLinear[p[1][c]] + toLinear[p[2][c]] + toLinear[p[3][c]]) * 0.25f);
+                } else {
+                    d[c] = (uint8_t)((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+void EncodeLevel(const uint8_t* rgba, int w, int h, TexFormat f, uint8_t* out) {
+    if (f == TexFormat::RGBA8) {
+        std::memcpy(out, rgba, (size_t)w * h * 4);
+        return;
+    }
+    const int bw = (w + 3) / 4, bh = (h + 3) / 4;
+    const int bytes = BlockBytes(f);
+    uint8_t block[64];
+    for (int by = 0; by < bh; by++) {
+        for (int bx = 0; bx < bw; bx++) {
+            for (int y = 0; y < 4; y++) {
+                int sy = std::min(by * 4 + y, h - 1);
+                for (int x = 0; x < 4; x++) {
+                    int sx = std::min(bx * 4 + x, w - 1);
+                    std::memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * w + sx) * 4, 4);
+                }
+            }
+            uint8_t* dst = out + ((size_t)by * bw + bx) * bytes;
+            if (f == TexFormat::BC1) EncodeBC1Block(block, dst);
+            else if (f == TexFormat::BC3) EncodeBC3Block(block, dst);
+            else EncodeBC4Block(block, dst);
+        }
+    }
+}
+
+struct FaceWork {
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> rgba;
+    int w = 0;
+    int h = 0;
+    std::vector<std::vector<uint8_t>> levels; // encoded
+    std::vector<std::pair<int, int>> dims;
+};
+
+struct JobWork {
+    uint64_t key = 0;
+    std::string path;
+    std::vector<FaceWork> faces;
+    TexFormat format = TexFormat::RGBA8;
+};
+
+bool DecodeFace(const std::string& path, FaceWork& face) {
+    bool ok = false;
+    if (IsPngData(face.bytes.data(), face.bytes.size())) {
+        ok = DecodePngRows(face.bytes.data(), face.bytes.size(),
+            [&](int w, int h) {
+                face.w = w;
+                face.h = h;
+                face.rgba.resize((size_t)w * h * 4);
+                return true;
+            },
+            [&](int y, const uint8_t* row) {
+                std::memcpy(face.rgba.data() + (size_t)y * face.w * 4, row, (size_t)face.w * 4);
+            });
+    }
+    if (!ok) ok = LoadImageRGBA(path.c_str(), face.rgba, face.w, face.h);
+    face.bytes.clear();
+    face.bytes.shrink_to_fit();
+    return ok;
+}
+
+void CookFace(FaceWork& face, TexFormat format, bool srgb, bool mips) {
+    std::vector<uint8_t> cur = std::move(face.rgba), next;
+    int w = face.w, h = face.h;
+    for (;;) {
+        std::vector<uint8_t> encoded(LevelSize(format, w, h));
+        EncodeLevel(cur.data(), w, h, format, encoded.data());
+        face.levels.push_back(std::move(encoded));
+        face.dims.emplace_back(w, h);
+        if (!mips || (w == 1 && h == 1)) break;
+        int nw, nh;
+        Downsample(cur, w, h, srgb, next, nw, nh);
+        cur.swap(next);
+        w = nw;
+        h = nh;
+    }
+}
+
+bool WriteCooked(const JobWork& work, const TextureJob& job, std::vector<uint8_t>& blob) {
+    const int faces = (int)work.faces.size();
+    const int levels = (int)work.faces[0].levels.size();
+    TexFileHeader header{TEX_MAGIC, TEX_VERSION, (uint32_t)work.faces[0].w, (uint32_t)work.faces[0].h,
+                         (uint32_t)faces, (uint32_t)levels, (uint32_t)work.format, job.srgb ? 1u : 0u, work.key};
+    std::size_t offset = sizeof(header) + (std::size_t)faces * levels * sizeof(TexFileLevel);
+    offset = (offset + 15) & ~std::size_t(15);
+    std::vector<TexFileLevel> table;
+    for (const FaceWork& f : work.faces) {
+        for (int l = 0; l < levels; l++) {
+            TexFileLevel fl{offset, (uint32_t)f.levels[l].size(), (uint32_t)f.dims[l].first, (uint32_t)f.dims[l].second, 0};
+            table.push_back(fl);
+            offset = (offset + fl.size + 15) & ~std::size_t(15);
+        }
+    }
+    blob.assign(offset, 0);
+    std::memcpy(blob.data(), &header, sizeof(header));
+    std::memcpy(blob.data() + sizeof(header), table.data(), table.size() * sizeof(TexFileLevel));
+    size_t i = 0;
+    for (const FaceWork& f : work.faces) {
+        for (int l = 0; l < levels; l++, i++) std::memcpy(blob.data() + table[i].offset, f.levels[l].data(), f.levels[l].size());
+    }
+    // Written under a temporary name so a crash never leaves a torn file to be mapped.
+    std::string tmp = work.path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(blob.data()), (std::streamsize)blob.size());
+        if (!out) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, work.path, ec);
+    return !ec;
+}
+
+// --- block encoders ---
+
+uint16_t To565(const float c[3]) {
+    int r = (int)std::lround(std::min(std::max(c[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::min(std::max(c[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::min(std::max(c[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void From565(uint16_t v, int out[3]) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// Single-channel block (BC4 / BC3 alpha) in the 8-value mode.
+void EncodeChannelBlock(const uint8_t rgba[64], int channel, uint8_t out[8]) {
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; i++) {
+        lo = std::min(lo, (int)rgba[i * 4 + channel]);
+        hi = std::max(hi, (int)rgba[i * 4 + channel]);
+    }
+    out[0] = (uint8_t)hi;
+    out[1] = (uint8_t)lo;
+    uint64_t indices = 0;
+    if (hi > lo) {
+        int pal[8] = {hi, lo};
+        for (int k = 2; k < 8; k++) pal[k] = ((8 - k) * hi + (k - 1) * lo + 3) / 7;
+        for (int i = 0; i < 16; i++) {
+            int v = rgba[i * 4 + channel];
+            int best = 0, bestErr = 1 << 30;
+            for (int k = 0; k < 8; k++) {
+                int e = std::abs(pal[k] - v);
+                if (e < bestErr) { bestErr = e; best = k; }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+    for (int b = 0; b < 6; b++) out[2 + b] = (uint8_t)(indices >> (8 * b));
+}
+
+} // namespace
+
+// Endpoints start at the extremes along the block's principal colour axis and
+// are then refit by least squares to the chosen indices.
+void EncodeBC1Block(const uint8_t rgba[64], uint8_t out[8]) {
+    float mean[3] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) mean[c] += rgba[i * 4 + c];
+    }
+    for (float& m : mean) m /= 16.0f;
+    float cov[6] = {};
+    for (int i = 0; i < 16; i++) {
+        float d[3] = {rgba[i * 4] - mean[0], rgba[i * 4 + 1] - mean[1], rgba[i * 4 + 2] - mean[2]};
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int it = 0; it < 6; it++) {
+        float a[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                      cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                      cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+        float len = std::max(std::max(std::fabs(a[0]), std::fabs(a[1])), std::fabs(a[2]));
+        if (len < 1e-6f) break;
+        for (int c = 0; c < 3; c++) axis[c] = a[c] / len;
+    }
+    float axisLen = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    for (float& a : axis) a /= axisLen;
+    float tMin = 1e30f, tMax = -1e30f;
+    for (int i = 0; i < 16; i++) {
+        float t = (rgba[i * 4] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] + (rgba[i * 4 + 2] - mean[2]) * axis[2];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; c++) {
+        e0[c] = mean[c] + axis[c] * tMax;
+        e1[c] = mean[c] + axis[c] * tMin;
+    }
+
+    uint16_t bestC0 = 0, bestC1 = 0;
+    uint32_t bestIdx = 0;
+    int bestErr = 1 << 30;
+    for (int pass = 0; pass < 2; pass++) {
+        uint16_t c0 = To565(e0), c1 = To565(e1);
+        if (c0 < c1) std::swap(c0, c1);
+        int p[4][3];
+        From565(c0, p[0]);
+        From565(c1, p[1]);
+        for (int c = 0; c < 3; c++) {
+            p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+            p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+        }
+        uint32_t indices = 0;
+        int total = 0;
+        int palCount = (c0 == c1) ? 1 : 4;
+        for (int i = 0; i < 16; i++) {
+            int best = 0, err = 1 << 30;
+            for (int k = 0; k < palCount; k++) {
+                int dr = p[k][0] - rgba[i * 4], dg = p[k][1] - rgba[i * 4 + 1], db = p[k][2] - rgba[i * 4 + 2];
+                int e = dr * dr + dg * dg + db * db;
+                if (e < err) { err = e; best = k; }
+            }
+            indices |= (uint32_t)best << (2 * i);
+            total += err;
+        }
+        if (total < bestErr) {
+            bestErr = total;
+            bestC0 = c0;
+            bestC1 = c1;
+            bestIdx = indices;
+        }
+        if (palCount == 1) break;
+
+        // Least-squares refit: pixel ~= a * e0 + b * e1 with (a, b) fixed by its index.
+        static const float W0[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0, ab = 0, bb = 0, ax[3] = {}, bx[3] = {};
+        for (int i = 0; i < 16; i++) {
+            float a = W0[(indices >> (2 * i)) & 3], b = 1.0f - a;
+            aa += a * a; ab += a * b; bb += b * b;
+            for (int c = 0; c < 3; c++) {
+                ax[c] += a * rgba[i * 4 + c];
+                bx[c] += b * rgba[i * 4 + c];
+            }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f) break;
+        for (int c = 0; c < 3; c++) {
+            e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+            e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+        }
+    }
+    out[0] = (uint8_t)(bestC0 & 0xff);
+    out[1] = (uint8_t)(bestC0 >> 8);
+    out[2] = (uint8_t)(bestC1 & 0xff);
+    out[3] = (uint8_t)(bestC1 >> 8);
+    for (int b = 0; b < 4; b++) out[4 + b] = (uint8_t)(bestIdx >> (8 * b));
+}
+
+void EncodeBC3Block(const uint8_t rgba[64], uint8_t out[16]) {
+    EncodeChannelBlock(rgba, 3, out);
+    EncodeBC1Block(rgba, out + 8);
+}
+
+void EncodeBC4Block(const uint8_t rgba[64], uint8_t out[8]) {
+    EncodeChannelBlock(rgba, 0, out);
+}
+
+std::size_t CookedTexture::gpuBytes() const {
+    std::size_t bytes = 0;
+    for (const TexLevel& l : table) bytes += l.size;
+    return bytes;
+}
+
+void LoadTextureJobs(std::vector<TextureJob>& jobs, const std::string& cacheDir, const TextureCookSettings& settings) {
+    std::vector<JobWork> work(jobs.size());
+
+    // Hash sources and try the cooked files.
+    ParallelFor((int)jobs.size(), [&](int j, int) {
+        TextureJob& job = jobs[j];
+        JobWork& w = work[j];
+        job.ok = false;
+        job.fromCache = false;
+        job.result = std::make_unique<CookedTexture>();
+        if (job.sources.empty()) return;
+        uint32_t flags = TEX_VERSION | (job.srgb << 8) | (job.gray << 9) | (job.mips << 10) |
+                         (settings.allowBC << 11) | (settings.allowSrgbBC << 12);
+        uint64_t key = Fnv1a64(&flags, sizeof(flags));
+        w.faces.resize(job.sources.size());
+        for (size_t f = 0; f < job.sources.size(); f++) {
+            if (!ReadFileBytes(job.sources[f].c_str(), w.faces[f].bytes)) return;
+            key = Fnv1a64(w.faces[f].bytes.data(), w.faces[f].bytes.size(), key);
+        }
+        w.key = key;
+        w.path = CachePath(cacheDir, job);
+        if (OpenCooked(w.path, key, *job.result)) {
+            job.ok = true;
+            job.fromCache = true;
+            w.faces.clear();
+        }
+    });
+
+    struct Unit { int job; int face; };
+    std::vector<Unit> units;
+    for (size_t j = 0; j < jobs.size(); j++) {
+        if (jobs[j].ok || work[j].faces.empty() || work[j].faces[0].bytes.empty()) continue;
+        for (size_t f = 0; f < work[j].faces.size(); f++) units.push_back({(int)j, (int)f});
+    }
+    if (units.empty()) return;
+
+    std::vector<char> decoded(units.size(), 0);
+    ParallelFor((int)units.size(), [&](int u, int) {
+        const Unit& unit = units[u];
+        decoded[u] = DecodeFace(jobs[unit.job].sources[unit.face], work[unit.job].faces[unit.face]);
+    });
+
+    // Pick each job's format once all of its faces are known.
+    std::vector<char> cook(jobs.size(), 0);
+    for (size_t u = 0; u < units.size(); u++) cook[units[u].job] = 1;
+    for (size_t u = 0; u < units.size(); u++) {
+        const FaceWork& f = work[units[u].job].faces[units[u].face];
+        const FaceWork& f0 = work[units[u].job].faces[0];
+        if (!decoded[u] || f.w != f0.w || f.h != f0.h) cook[units[u].job] = 0;
+    }
+    for (size_t j = 0; j < jobs.size(); j++) {
+        if (!cook[j]) continue;
+        const TextureJob& job = jobs[j];
+        bool bcOk = settings.allowBC && (!job.srgb || settings.allowSrgbBC);
+        if (job.gray) {
+            work[j].format = TexFormat::BC4;
+            continue;
+        }
+        bool alpha = false;
+        for (const FaceWork& f : work[j].faces) {
+            for (size_t i = 3; i < f.rgba.size() && !alpha; i += 4) alpha = f.rgba[i] != 255;
+        }
+        work[j].format = !bcOk ? TexFormat::RGBA8 : (alpha ? TexFormat::BC3 : TexFormat::BC1);
+    }
+
+    ParallelFor((int)units.size(), [&](int u, int) {
+        const Unit& unit = units[u];
+        if (!cook[unit.job]) return;
+        CookFace(work[unit.job].faces[unit.face], work[unit.job].format, jobs[unit.job].srgb, jobs[unit.job].mips);
+    });
+
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir, ec);
+    for (size_t j = 0; j < jobs.size(); j++) {
+        if (!cook[j]) continue;
+        TextureJob& job = jobs[j];
+        std::vector<uint8_t> blob;
+        bool written = WriteCooked(work[j], job, blob);
+        CookedTexture& tex = *job.result;
+        if (written && OpenCooked(work[j].path, work[j].key, tex)) {
+            job.ok = true;
+            continue;
+        }
+        SDL_Log("Texture cache: could not write %s, keeping it in memory", work[j].path.c_str());
+        job.ok = ParseCooked(blob.data(), blob.size(), work[j].key, tex);
+        tex.owned = std::move(blob);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+enum class TexFormat : uint32_t {
+    RGBA8 = 0,
+    BC1 = 1, // opaque colour, 4 bits/texel (S3TC DXT1)
+    BC3 = 2, // colour + alpha, 8 bits/texel (S3TC DXT5)
+    BC4 = 3  // single channel, 4 bits/texel (RGTC1, core since GL 3.0)
+};
+
+struct TexLevel {
+    uint64_t offset = 0;
+    uint32_t size = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// A cooked texture: every face and mip level laid out ready for upload. The
+// data lives in the mapped cache file (or in memory if it could not be written).
+struct CookedTexture {
+    int width = 0;
+    int height = 0;
+    int faces = 0;
+    int levels = 0;
+    TexFormat format = TexFormat::RGBA8;
+    bool srgb = false;
+    std::vector<TexLevel> table; // face-major: table[face * levels + level]
+
+    const uint8_t* levelData(int face, int level) const { return base() + table[(size_t)face * levels + level].offset; }
+    const TexLevel& level(int face, int level) const { return table[(size_t)face * levels + level]; }
+    std::size_t gpuBytes() const;
+
+    const uint8_t* base() const { return file.data() ? file.data() : owned.data(); }
+    MappedFile file;
+    std::vector<uint8_t> owned;
+};
+
+struct TextureJob {
+    std::vector<std::string> sources; // 1 image, or 6 cubemap faces (+X -X +Y -Y +Z -Z)
+    bool srgb = true;
+    bool gray = false; // only the red channel is sampled
+    bool mips = true;
+
+    bool ok = false;
+    bool fromCache = false;
+    std::unique_ptr<CookedTexture> result;
+};
+
+struct TextureCookSettings {
+    bool allowBC = false;     // EXT_texture_compression_s3tc
+    bool allowSrgbBC = false; // sRGB variants of the S3TC formats
+};
+
+// Loads every job from its cooked file under cacheDir, cooking (decode, mip
+// chain, block compression) on worker threads whenever the file is missing or
+// was cooked from different sources or settings.
+void LoadTextureJobs(std::vector<TextureJob>& jobs, const std::string& cacheDir, const TextureCookSettings& settings);
+
+// Exposed for the cooker: 4x4 block encoders over RGBA8 input.
+void EncodeBC1Block(const uint8_t rgba[64], uint8_t out[8]);
+void EncodeBC3Block(const uint8_t rgba[64], uint8_t out[16]);
+void EncodeBC4Block(const uint8_t rgba[64], uint8_t out[8]);
@@ -0,0 +1,573 @@
+#include "traffic.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace {
+
+constexpr float INF_TIME = std::numeric_limits<float>::max();
+
+double MsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+uint64_t Mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+float BprTime(float freeTime, float volume, float capacity, float alpha, float beta) {
+    if (capacity <= 0.0f) return freeTime;
+    float r = volume / capacity;
+    return freeTime * (1.0f + alpha * std::pow(r, beta));
+}
+
+} // namespace
+
+uint64_t TrafficModel::EdgeKey(const RoadGraphEdge& e) {
+    uint64_t k = (uint64_t)(uint32_t)e.roadId;
+    k = Mix64(k ^ ((uint64_t)(uint32_t)std::lround(e.d0 * 4.0f) << 32));
+    k = Mix64(k ^ (uint64_t)(uint32_t)std::lround(e.d1 * 4.0f));
+    return k & ~1ULL;
+}
+
+TrafficInput SnapshotTrafficInput(const RoadGraph& graph, std::vector<TrafficLot> lots) {
+    TrafficInput in;
+    in.graphVersion = graph.version();
+    in.nodeAlive.resize(graph.nodes().size());
+    for (size_t n = 0; n < in.nodeAlive.size(); n++) in.nodeAlive[n] = graph.nodes()[n].alive ? 1 : 0;
+    in.edges = graph.edges();
+    in.lotEdge.resize(lots.size());
+    for (size_t i = 0; i < lots.size(); i++) in.lotEdge[i] = graph.edgeAt(lots[i].roadId, lots[i].d);
+    in.lots = std::move(lots);
+    return in;
+}
+
+void TrafficModel::rebuild(const TrafficInput& input) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    // Remember the current solution by road span before dropping the network.
+    if (started) {
+        warmLinks.clear();
+        for (size_t l = 0; l < linkKey.size(); l++) {
+            if (seg.capacity[l] > 0.0f) warmLinks[linkKey[l]] = {seg.time[l], seg.volume[l]};
+        }
+        warmTrips.clear();
+        for (size_t oi = 0; oi < originZones.size(); oi++) {
+            for (size_t di = 0; di < destZones.size(); di++) {
+                float t = trips[oi * destZones.size() + di];
+                if (t > 0.0f) warmTrips[Mix64(zoneKey[originZones[oi]]) ^ zoneKey[destZones[di]]] = t;
+            }
+        }
+    }
+
+    const auto& gEdges = input.edges;
+    std::vector<int> dense(input.nodeAlive.size(), -1);
+    nodeCount = 0;
+    for (size_t n = 0; n < input.nodeAlive.size(); n++) {
+        if (input.nodeAlive[n]) dense[n] = nodeCount++;
+    }
+
+    const int linkCount = (int)gEdges.size() * 2;
+    const float laneCap = settings.laneCapacityVph * (float)std::max(1, settings.lanesPerDirection);
+    linkFrom.assign(linkCount, -1);
+    linkTo.assign(linkCount, -1);
+    linkKey.assign(linkCount, 0);
+    seg.volume.assign(linkCount, 0.0f);
+    seg.capacity.assign(linkCount, 0.0f);
+    seg.freeTime.assign(linkCount, 0.0f);
+    seg.time.assign(linkCount, 0.0f);
+    warmVolume.assign(linkCount, 0.0f);
+    int liveLinks = 0;
+    int warmLinkCount = 0;
+    for (int e = 0; e < (int)gEdges.size(); e++) {
+        const RoadGraphEdge& edge = gEdges[e];
+        if (!edge.alive) continue;
+        int a = dense[edge.nodeA];
+        int b = dense[edge.nodeB];
+        if (a < 0 || b < 0) continue;
+        float t = std::max(edge.length(), 0.1f) / settings.freeSpeedMps;
+        uint64_t key = EdgeKey(edge);
+        for (int dir = 0; dir < 2; dir++) {
+            int l = e * 2 + dir;
+            linkFrom[l] = dir ? b : a;
+            linkTo[l] = dir ? a : b;
+            linkKey[l] = key | (uint64_t)dir;
+            seg.capacity[l] = laneCap;
+            seg.freeTime[l] = t;
+            auto wit = warmLinks.find(linkKey[l]);
+            if (wit != warmLinks.end()) {
+                seg.time[l] = wit->second.time;
+                warmVolume[l] = wit->second.volume;
+                warmLinkCount++;
+            } else {
+                seg.time[l] = t;
+            }
+            liveLinks++;
+        }
+    }
+
+    outStart.assign(nodeCount + 1, 0);
+    for (int l = 0; l < linkCount; l++) {
+        if (linkFrom[l] >= 0) outStart[linkFrom[l] + 1]++;
+    }
+    for (int n = 0; n < nodeCount; n++) outStart[n + 1] += outStart[n];
+    outLinks.assign(outStart[nodeCount], 0);
+    std::vector<int> fill(outStart.begin(), outStart.end() - 1);
+    for (int l = 0; l < linkCount; l++) {
+        if (linkFrom[l] >= 0) outLinks[fill[linkFrom[l]]++] = l;
+    }
+    outTo.resize(outLinks.size());
+    outCost.resize(outLinks.size());
+    for (size_t i = 0; i < outLinks.size(); i++) outTo[i] = linkTo[outLinks[i]];
+
+    // Aggregate lots into chunk zones; each lot feeds the nearer end node of its edge.
+    std::unordered_map<uint64_t, int> zoneByChunk;
+    zoneAccess.clear();
+    zoneProduction.clear();
+    zoneAttraction.clear();
+    zoneKey.clear();
+    for (size_t i = 0; i < input.lots.size(); i++) {
+        const TrafficLot& lot = input.lots[i];
+        int e = input.lotEdge[i];
+        if (e < 0) continue;
+        const RoadGraphEdge& edge = gEdges[e];
+        int node = dense[(lot.d - edge.d0 <= edge.d1 - lot.d) ? edge.nodeA : edge.nodeB];
+        if (node < 0) continue;
+        int32_t cx = (int32_t)std::floor(lot.pos.x / settings.zoneSizeM);
+        int32_t cz = (int32_t)std::floor(lot.pos.z / settings.zoneSizeM);
+        uint64_t ck = (uint64_t(uint32_t(cx)) << 32) | uint32_t(cz);
+        auto it = zoneByChunk.find(ck);
+        int z;
+        if (it == zoneByChunk.end()) {
+            z = (int)zoneAccess.size();
+            zoneByChunk.emplace(ck, z);
+            zoneAccess.emplace_back();
+            zoneProduction.push_back(0.0f);
+            zoneAttraction.push_back(0.0f);
+            zoneKey.push_back(ck);
+        } else {
+            z = it->second;
+        }
+        if (lot.origin) zoneProduction[z] += settings.tripsPerOriginLot;
+        else zoneAttraction[z] += settings.attractionPerLot;
+        zoneAccess[z].push_back(node);
+    }
+    originZones.clear();
+    destZones.clear();
+    for (int z = 0; z < (int)zoneAccess.size(); z++) {
+        auto& acc = zoneAccess[z];
+        std::sort(acc.begin(), acc.end());
+        acc.erase(std::unique(acc.begin(), acc.end()), acc.end());
+        if (zoneProduction[z] > 0.0f) originZones.push_back(z);
+        if (zoneAttraction[z] > 0.0f) destZones.push_back(z);
+    }
+
+    scratch.resize(ParallelWorkerCount());
+    for (Scratch& sc : scratch) {
+        sc.dist.assign(nodeCount, INF_TIME);
+        sc.pred.assign(nodeCount, -1);
+        sc.acc.assign(nodeCount, 0.0f);
+        sc.accOld.assign(nodeCount, 0.0f);
+        sc.order.clear();
+        sc.order.reserve(nodeCount);
+    }
+
+    distributeDemand();
+
+    stat = {};
+    stat.zones = (int)zoneAccess.size();
+    stat.origins = (int)originZones.size();
+    stat.destinations = (int)destZones.size();
+    stat.links = liveLinks;
+    for (float t : trips) stat.totalTrips += t;
+    stat.relativeGap = 1.0f;
+
+    // The previous demand in the new zone layout, for correcting the previous
+    // volumes (see iterate()). After a large network change they are not worth it.
+    warmDemand.clear();
+    if (warmLinkCount >= liveLinks * 9 / 10 && !warmTrips.empty()) {
+        warmDemand.assign(trips.size(), 0.0f);
+        for (size_t oi = 0; oi < originZones.size(); oi++) {
+            for (size_t di = 0; di < destZones.size(); di++) {
+                auto it = warmTrips.find(Mix64(zoneKey[originZones[oi]]) ^ zoneKey[destZones[di]]);
+                if (it != warmTrips.end()) warmDemand[oi * destZones.size() + di] = it->second;
+            }
+        }
+    } else {
+        warmVolume.clear();
+    }
+    stat.buildMs = MsSince(t0);
+    started = false;
+}
+
+void TrafficModel::loadCosts(const std::vector<float>& cost) {
+    for (size_t i = 0; i < outLinks.size(); i++) outCost[i] = cost[outLinks[i]];
+}
+
+void TrafficModel::shortestTree(int origin, Scratch& sc) const {
+    for (int n : sc.order) {
+        sc.dist[n] = INF_TIME;
+        sc.pred[n] = -1;
+    }
+    sc.order.clear();
+
+    // Every node that gets a finite distance is eventually settled, so the settle
+    // order doubles as the reset list for the next search.
+    using Item = std::pair<float, int>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+    for (int n : zoneAccess[origin]) {
+        if (sc.dist[n] == 0.0f) continue;
+        sc.dist[n] = 0.0f;
+        heap.push({0.0f, n});
+    }
+    while (!heap.empty()) {
+        Item top = heap.top();
+        heap.pop();
+        int u = top.second;
+        if (top.first > sc.dist[u]) continue;
+        sc.order.push_back(u);
+        for (int i = outStart[u]; i < outStart[u + 1]; i++) {
+            int v = outTo[i];
+            float nd = top.first + outCost[i];
+            if (nd < sc.dist[v]) {
+                sc.dist[v] = nd;
+                sc.pred[v] = outLinks[i];
+                heap.push({nd, v});
+            }
+        }
+    }
+}
+
+// Makes `volume` balance at every node the way `reference` (a feasible flow of
+// the same demand) does: flow piling up at a node is carried on to the nearest
+// nodes short of it. It moves in a few increments with link times updated in
+// between, so a closed road's traffic spreads over the parallel routes instead
+// of jamming the nearest one. Imbalances below a thousandth of the largest link
+// volume are left alone.
+void TrafficModel::repairFlow(std::vector<float>& volume, const std::vector<float>& reference, Scratch& sc) {
+    std::vector<float> excess(nodeCount, 0.0f);
+    float peak = 0.0f;
+    for (size_t l = 0; l < volume.size(); l++) {
+        if (linkFrom[l] < 0) continue;
+        float d = volume[l] - reference[l];
+        excess[linkTo[l]] += d;
+        excess[linkFrom[l]] -= d;
+        peak = std::max(peak, volume[l]);
+    }
+    const float eps = peak * 1e-3f;
+    std::vector<int> slot(volume.size(), -1);
+    for (size_t i = 0; i < outLinks.size(); i++) slot[outLinks[i]] = (int)i;
+
+    using Item = std::pair<float, int>;
+    constexpr int PASSES = 4;
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (int src = 0; src < nodeCount; src++) {
+            if (excess[src] <= eps) continue;
+            float budget = excess[src] / (float)(PASSES - pass);
+            // sc.order lists every node given a distance, for the reset.
+            for (int n : sc.order) {
+                sc.dist[n] = INF_TIME;
+                sc.pred[n] = -1;
+            }
+            sc.order.clear();
+            std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+            sc.dist[src] = 0.0f;
+            sc.order.push_back(src);
+            heap.push({0.0f, src});
+            while (!heap.empty() && budget > eps * 0.5f) {
+                Item top = heap.top();
+                heap.pop();
+                int u = top.second;
+                if (top.first > sc.dist[u]) continue;
+                if (excess[u] < -eps) {
+                    float moved = std::min(budget, -excess[u]);
+                    for (int v = u; v != src; v = linkFrom[sc.pred[v]]) {
+                        int l = sc.pred[v];
+                        volume[l] += moved;
+                        outCost[slot[l]] = BprTime(seg.freeTime[l], volume[l], seg.capacity[l], settings.bprAlpha, settings.bprBeta);
+                    }
+                    budget -= moved;
+                    excess[src] -= moved;
+                    excess[u] += moved;
+                }
+                for (int i = outStart[u]; i < outStart[u + 1]; i++) {
+                    int v = outTo[i];
+                    float nd = top.first + outCost[i];
+                    if (nd < sc.dist[v]) {
+                        if (sc.dist[v] == INF_TIME) sc.order.push_back(v);
+                        sc.dist[v] = nd;
+                        sc.pred[v] = outLinks[i];
+                        heap.push({nd, v});
+                    }
+                }
+            }
+        }
+    }
+    for (int n : sc.order) {
+        sc.dist[n] = INF_TIME;
+        sc.pred[n] = -1;
+    }
+    sc.order.clear();
+}
+
+void TrafficModel::distributeDemand() {
+    const int nO = (int)originZones.size();
+    const int nD = (int)destZones.size();
+    trips.assign((size_t)nO * nD, 0.0f);
+    if (nO == 0 || nD == 0) return;
+
+    const float beta = settings.gravityBetaPerMin / 60.0f;
+    loadCosts(seg.freeTime);
+    ParallelFor(nO, [&](int oi, int worker) {
+        Scratch& sc = scratch[worker];
+        int oz = originZones[oi];
+        shortestTree(oz, sc);
+        float* row = &trips[(size_t)oi * nD];
+        float sum = 0.0f;
+        for (int di = 0; di < nD; di++) {
+            int dz = destZones[di];
+            if (dz == oz) continue;
+            float best = INF_TIME;
+            for (int n : zoneAccess[dz]) best = std::min(best, sc.dist[n]);
+            if (best == INF_TIME) continue;
+            float w = zoneAttraction[dz] * std::exp(-beta * best);
+            row[di] = w;
+            sum += w;
+        }
+        float scale = (sum > 0.0f) ? zoneProduction[oz] / sum : 0.0f;
+        for (int di = 0; di < nD; di++) row[di] *= scale;
+    });
+}
+
+void TrafficModel::allOrNothing(const std::vector<float>& cost, std::vector<float>& outVolume,
+    const std::vector<float>* oldDemand, std::vector<float>* outOldVolume) {
+    const int nD = (int)destZones.size();
+    const int linkCount = (int)cost.size();
+    for (Scratch& sc : scratch) {
+        sc.volume.assign(linkCount, 0.0f);
+        if (oldDemand) sc.volumeOld.assign(linkCount, 0.0f);
+    }
+
+    loadCosts(cost);
+    ParallelFor((int)originZones.size(), [&](int oi, int worker) {
+        Scratch& sc = scratch[worker];
+        shortestTree(originZones[oi], sc);
+        const float* row = &trips[(size_t)oi * nD];
+        const float* oldRow = oldDemand ? &(*oldDemand)[(size_t)oi * nD] : nullptr;
+        for (int di = 0; di < nD; di++) {
+            if (row[di] <= 0.0f && (!oldRow || oldRow[di] <= 0.0f)) continue;
+            int bestNode = -1;
+            float best = INF_TIME;
+            for (int n : zoneAccess[destZones[di]]) {
+                if (sc.dist[n] < best) {
+                    best = sc.dist[n];
+                    bestNode = n;
+                }
+            }
+            if (bestNode < 0) continue;
+            sc.acc[bestNode] += row[di];
+            if (oldRow) sc.accOld[bestNode] += oldRow[di];
+        }
+        // Push demand back up the tree in reverse settle order: O(nodes) per origin.
+        for (int i = (int)sc.order.size() - 1; i >= 0; i--) {
+            int n = sc.order[i];
+            float a = sc.acc[n];
+            float b = oldRow ? sc.accOld[n] : 0.0f;
+            if (a == 0.0f && b == 0.0f) continue;
+            sc.acc[n] = 0.0f;
+            int l = sc.pred[n];
+            if (oldRow) sc.accOld[n] = 0.0f;
+            if (l < 0) continue;
+            sc.volume[l] += a;
+            sc.acc[linkFrom[l]] += a;
+            if (!oldRow) continue;
+            sc.volumeOld[l] += b;
+            sc.accOld[linkFrom[l]] += b;
+        }
+    });
+
+    outVolume.assign(linkCount, 0.0f);
+    for (const Scratch& sc : scratch) {
+        for (int l = 0; l < linkCount; l++) outVolume[l] += sc.volume[l];
+    }
+    if (!oldDemand) return;
+    outOldVolume->assign(linkCount, 0.0f);
+    for (const Scratch& sc : scratch) {
+        for (int l = 0; l < linkCount; l++) (*outOldVolume)[l] += sc.volumeOld[l];
+    }
+}
+
+void TrafficModel::updateTimes() {
+    for (size_t l = 0; l < seg.time.size(); l++) {
+        seg.time[l] = BprTime(seg.freeTime[l], seg.volume[l], seg.capacity[l], settings.bprAlpha, settings.bprBeta);
+    }
+}
+
+// Bisection on the derivative of the Beckmann objective along V + lambda * (aux - V).
+float TrafficModel::lineSearch(const std::vector<float>& aux) const {
+    float lo = 0.0f;
+    float hi = 1.0f;
+    for (int it = 0; it < 24; it++) {
+        float mid = 0.5f * (lo + hi);
+        double deriv = 0.0;
+        for (size_t l = 0; l < aux.size(); l++) {
+            float dv = aux[l] - seg.volume[l];
+            if (dv == 0.0f) continue;
+            float v = seg.volume[l] + mid * dv;
+            deriv += (double)dv * BprTime(seg.freeTime[l], v, seg.capacity[l], settings.bprAlpha, settings.bprBeta);
+        }
+        if (deriv > 0.0) hi = mid;
+        else lo = mid;
+    }
+    return 0.5f * (lo + hi);
+}
+
+bool TrafficModel::iterate() {
+    if (converged()) return false;
+    auto t0 = std::chrono::steady_clock::now();
+
+    if (!started) {
+        // Initial flow: all-or-nothing on the warm-started (or free-flow) times.
+        if (warmVolume.empty()) {
+            allOrNothing(seg.time, seg.volume);
+        } else {
+            // Warm start: the previous volumes carry the previous demand, so the
+            // old demand's load on the same trees is swapped for the new one's.
+            // Flow on removed links is rerouted; what remains is close to
+            // feasible, and a line search from the all-or-nothing flow decides
+            // how much of it to keep.
+            allOrNothing(seg.time, seg.volume, &warmDemand, &auxVolume);
+            for (size_t l = 0; l < warmVolume.size(); l++) {
+                warmVolume[l] = std::max(warmVolume[l] - auxVolume[l] + seg.volume[l], 0.0f);
+            }
+            repairFlow(warmVolume, seg.volume, scratch[0]);
+            float lambda = lineSearch(warmVolume);
+            for (size_t l = 0; l < seg.volume.size(); l++) seg.volume[l] += lambda * (warmVolume[l] - seg.volume[l]);
+        }
+        warmVolume.clear();
+        warmDemand.clear();
+        updateTimes();
+        started = true;
+        stat.iterations = 1;
+        stat.relativeGap = 1.0f;
+        stat.iterationMs = MsSince(t0);
+        return !converged();
+    }
+
+    allOrNothing(seg.time, auxVolume);
+    double current = 0.0;
+    double shortest = 0.0;
+    for (size_t l = 0; l < seg.time.size(); l++) {
+        current += (double)seg.time[l] * seg.volume[l];
+        shortest += (double)seg.time[l] * auxVolume[l];
+    }
+    stat.relativeGap = (current > 0.0) ? (float)((current - shortest) / current) : 0.0f;
+
+    float lambda = lineSearch(auxVolume);
+    for (size_t l = 0; l < seg.volume.size(); l++) {
+        seg.volume[l] += lambda * (auxVolume[l] - seg.volume[l]);
+    }
+    updateTimes();
+    stat.iterations++;
+    stat.iterationMs = MsSince(t0);
+    return !converged();
+}
+
+void TrafficModel::solve() {
+    while (iterate()) {
+    }
+}
+
+bool TrafficModel::converged() const {
+    if (originZones.empty() || destZones.empty()) return true;
+    if (!started) return false;
+    // A warm start can leave a flow slightly off the demand, which reads as a
+    // negative gap; that is not convergence either.
+    return std::fabs(stat.relativeGap) <= settings.targetRelativeGap || stat.iterations >= settings.maxIterations;
+}
+
+float TrafficModel::congestion(int edge) const {
+    size_t l = (size_t)edge * 2;
+    if (edge < 0 || l + 1 >= seg.capacity.size() || seg.capacity[l] <= 0.0f) return 0.0f;
+    return std::max(seg.volume[l], seg.volume[l + 1]) / seg.capacity[l];
+}
+
+void TrafficSolver::start(const TrafficSettings& s) {
+    stop();
+    settings = s;
+    quit = false;
+    pending.reset();
+    results.reset(TrafficResults{});
+    worker = std::thread(&TrafficSolver::run, this);
+}
+
+void TrafficSolver::stop() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+uint64_t TrafficSolver::requestRebuild(TrafficInput input) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::make_unique<TrafficInput>(std::move(input));
+        id = ++requests;
+    }
+    wake.notify_one();
+    return id;
+}
+
+void TrafficSolver::run() {
+    TrafficModel model;
+    model.setSettings(settings);
+    uint64_t sequence = 0, request = 0;
+    uint32_t graphVersion = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        // Iterate while unconverged; a pending rebuild goes first.
+        wake.wait(lock, [&] { return quit || pending || !model.converged(); });
+        if (quit) return;
+        std::unique_ptr<TrafficInput> input = std::move(pending);
+        uint64_t inputRequest = requests;
+        lock.unlock();
+
+        if (input) {
+            model.rebuild(*input);
+            request = inputRequest;
+            graphVersion = input->graphVersion;
+        } else {
+            model.iterate();
+        }
+
+        // The slot holds an older value; every field is overwritten.
+        TrafficResults& r = results.writeSlot();
+        r.sequence = ++sequence;
+        r.request = request;
+        r.graphVersion = graphVersion;
+        r.converged = model.converged();
+        r.stats = model.stats();
+        const TrafficSegments& seg = model.segments();
+        r.time.assign(seg.time.begin(), seg.time.end());
+        r.congestion.resize(seg.time.size() / 2);
+        for (size_t e = 0; e < r.congestion.size(); e++) r.congestion[e] = model.congestion((int)e);
+        results.publish();
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "road_graph.h"
+#include "triple_buffer.h"
+
+struct TrafficSettings {
+    float zoneSizeM = 1024.0f;           // demand is aggregated per chunk
+    float tripsPerOriginLot = 6.0f;      // peak-hour trips produced by a residential lot
+    float attractionPerLot = 1.0f;       // relative pull of a commercial/industrial/office lot
+    float freeSpeedMps = 13.9f;          // 50 km/h
+    float laneCapacityVph = 900.0f;
+    int lanesPerDirection = 1;
+    float bprAlpha = 0.15f;
+    float bprBeta = 4.0f;
+    float gravityBetaPerMin = 0.08f;
+    float targetRelativeGap = 1e-3f;
+    int maxIterations = 40;
+};
+
+struct TrafficLot {
+    glm::vec3 pos{};
+    int roadId = 0;
+    float d = 0.0f;
+    bool origin = false; // residential lots produce trips, job lots attract them
+};
+
+// What rebuild() reads, copied out of the road graph so the model can be rebuilt
+// on another thread. Lots are resolved to their graph edge (-1 = off the graph).
+struct TrafficInput {
+    uint32_t graphVersion = 0;
+    std::vector<uint8_t> nodeAlive;
+    std::vector<RoadGraphEdge> edges;
+    std::vector<TrafficLot> lots;
+    std::vector<int> lotEdge;
+};
+
+TrafficInput SnapshotTrafficInput(const RoadGraph& graph, std::vector<TrafficLot> lots);
+
+// Directed segments, SoA. Link 2*e runs nodeA->nodeB of road graph edge e and
+// link 2*e+1 the reverse; dead graph edges keep zero capacity.
+struct TrafficSegments {
+    std::vector<float> volume;
+    std::vector<float> capacity;
+    std::vector<float> freeTime;
+    std::vector<float> time;
+};
+
+struct TrafficStats {
+    int zones = 0;
+    int origins = 0;
+    int destinations = 0;
+    int links = 0;
+    float totalTrips = 0.0f;
+    int iterations = 0;
+    float relativeGap = 1.0f;
+    double buildMs = 0.0;
+    double iterationMs = 0.0;
+};
+
+// Static user-equilibrium assignment (Frank-Wolfe over BPR volume-delay functions)
+// of gravity-model demand between chunk zones. Pure CPU, no GL/SDL dependencies.
+class TrafficModel {
+public:
+    void setSettings(const TrafficSettings& s) { settings = s; }
+    const TrafficSettings& getSettings() const { return settings; }
+
+    // Rebuilds network and demand. The previous solution's volumes (or, after a
+    // large demand change, its travel times) seed the next assignment so a local
+    // edit re-equilibrates in a few iterations.
+    void rebuild(const RoadGraph& graph, const std::vector<TrafficLot>& lots) { rebuild(SnapshotTrafficInput(graph, lots)); }
+    void rebuild(const TrafficInput& input);
+    // One Frank-Wolfe step; returns false once converged.
+    bool iterate();
+    void solve();
+    bool converged() const;
+
+    const TrafficSegments& segments() const { return seg; }
+    float congestion(int edge) const;
+    const TrafficStats& stats() const { return stat; }
+
+private:
+    struct Scratch {
+        std::vector<float> dist;
+        std::vector<int> pred;
+        std::vector<int> order;
+        std::vector<float> acc;
+        std::vector<float> volume;
+        std::vector<float> accOld; // warm start: the previous demand on the same trees
+        std::vector<float> volumeOld;
+    };
+
+    void loadCosts(const std::vector<float>& cost);
+    void shortestTree(int origin, Scratch& sc) const;
+    // `oldDemand`, if given, is routed on the same trees into `outOldVolume`.
+    void allOrNothing(const std::vector<float>& cost, std::vector<float>& outVolume,
+        const std::vector<float>* oldDemand = nullptr, std::vector<float>* outOldVolume = nullptr);
+    void repairFlow(std::vector<float>& volume, const std::vector<float>& reference, Scratch& sc);
+    void distributeDemand();
+    void updateTimes();
+    float lineSearch(const std::vector<float>& aux) const;
+    static uint64_t EdgeKey(const RoadGraphEdge& e);
+
+    TrafficSettings settings;
+    TrafficSegments seg;
+    TrafficStats stat;
+
+    // Dense node network (alive graph nodes only) with CSR out-links.
+    int nodeCount = 0;
+    std::vector<int> linkFrom;
+    std::vector<int> linkTo;
+    std::vector<int> outStart;
+    std::vector<int> outLinks;
+    std::vector<int> outTo;    // CSR-ordered copies so the search touches one cache stream
+    std::vector<float> outCost;
+    std::vector<uint64_t> linkKey;
+
+    // Zones: access nodes per zone, origin/destination lists and the trip matrix.
+    std::vector<std::vector<int>> zoneAccess;
+    std::vector<float> zoneProduction;
+    std::vector<float> zoneAttraction;
+    std::vector<int> originZones;
+    std::vector<int> destZones;
+    std::vector<float> trips; // originZones.size() x destZones.size()
+    std::vector<uint64_t> zoneKey; // chunk of each zone
+
+    struct WarmLink {
+        float time = 0.0f;
+        float volume = 0.0f;
+    };
+
+    std::vector<Scratch> scratch;
+    std::vector<float> auxVolume;
+    std::unordered_map<uint64_t, WarmLink> warmLinks; // previous solution by road span
+    std::unordered_map<uint64_t, float> warmTrips;   // previous demand by origin and destination chunk
+    std::vector<float> warmVolume; // per current link; empty = cold start
+    std::vector<float> warmDemand; // warmTrips laid out like `trips`
+    bool started = false;
+};
+
+struct TrafficResults {
+    uint64_t sequence = 0;     // bumped on every publish
+    uint64_t request = 0;      // the requestRebuild() these results answer
+    uint32_t graphVersion = 0;
+    bool converged = true;
+    TrafficStats stats;
+    std::vector<float> congestion; // per road graph edge
+    std::vector<float> time;       // per link, like TrafficSegments
+};
+
+// Runs TrafficModel on a worker thread: rebuilds on request, then iterates to
+// equilibrium, publishing after every step through a triple buffer like
+// SimulationClock. A newer request replaces a pending one and cuts the
+// iterations of the current one short.
+class TrafficSolver {
+public:
+    ~TrafficSolver() { stop(); }
+
+    void start(const TrafficSettings& s);
+    void stop();
+    bool running() const { return worker.joinable(); }
+    const TrafficSettings& getSettings() const { return settings; }
+
+    // Returns the id the results of this rebuild will carry.
+    uint64_t requestRebuild(TrafficInput input);
+    // Newest results; call once per frame from the main thread.
+    const TrafficResults& update() { return results.read(); }
+    // What the last update() returned.
+    const TrafficResults& latest() const { return results.current(); }
+
+private:
+    void run();
+
+    TrafficSettings settings;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit = false;
+    std::unique_ptr<TrafficInput> pending; // under `mutex`
+    uint64_t requests = 0;                 // under `mutex`
+
+    TripleBuffer<TrafficResults> results;
+};
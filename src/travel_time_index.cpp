@@ -0,0 +1,551 @@
+#include "travel_time_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+
+namespace {
+
+constexpr float INF_COST = std::numeric_limits<float>::max();
+constexpr int DISSECT_LEAF = 16;
+
+double MsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+float AddCost(float a, float b) {
+    return (a == INF_COST || b == INF_COST) ? INF_COST : a + b;
+}
+
+} // namespace
+
+TravelTimeGraph SnapshotTravelTimeGraph(const RoadGraph& graph) {
+    const auto& gNodes = graph.nodes();
+    const auto& gEdges = graph.edges();
+    TravelTimeGraph g;
+    g.version = graph.version();
+    g.nodePos.resize(gNodes.size());
+    g.nodeAlive.resize(gNodes.size());
+    for (size_t i = 0; i < gNodes.size(); i++) {
+        g.nodePos[i] = glm::vec2(gNodes[i].pos.x, gNodes[i].pos.z);
+        g.nodeAlive[i] = gNodes[i].alive ? 1 : 0;
+    }
+    g.edgeA.assign(gEdges.size(), -1);
+    g.edgeB.assign(gEdges.size(), -1);
+    g.edgeLength.assign(gEdges.size(), 0.0f);
+    for (size_t e = 0; e < gEdges.size(); e++) {
+        if (!gEdges[e].alive) continue;
+        g.edgeA[e] = gEdges[e].nodeA;
+        g.edgeB[e] = gEdges[e].nodeB;
+        g.edgeLength[e] = gEdges[e].length();
+    }
+    return g;
+}
+
+void TravelTimeIndex::build(const TravelTimeGraph& graph) {
+    auto t0 = std::chrono::steady_clock::now();
+    customized = false;
+    version = graph.version;
+
+    const int nodeSlots = (int)graph.nodePos.size();
+    const int edgeSlots = (int)graph.edgeA.size();
+    graphNodeCapacity = nodeSlots;
+
+    // Temporary dense ids for alive nodes.
+    std::vector<int> dense(nodeSlots, -1);
+    std::vector<int> graphOfDense;
+    for (int i = 0; i < nodeSlots; i++) {
+        if (!graph.nodeAlive[i]) continue;
+        dense[i] = (int)graphOfDense.size();
+        graphOfDense.push_back(i);
+    }
+    n = (int)graphOfDense.size();
+    posX.resize(n);
+    posZ.resize(n);
+    for (int v = 0; v < n; v++) {
+        posX[v] = graph.nodePos[graphOfDense[v]].x;
+        posZ[v] = graph.nodePos[graphOfDense[v]].y;
+    }
+
+    const int linkCount = edgeSlots * 2;
+    std::vector<int> linkFrom(linkCount, -1);
+    std::vector<int> linkTo(linkCount, -1);
+    linkLength.assign(linkCount, 0.0f);
+    for (int e = 0; e < edgeSlots; e++) {
+        if (graph.edgeA[e] < 0) continue;
+        int a = dense[graph.edgeA[e]];
+        int b = dense[graph.edgeB[e]];
+        if (a < 0 || b < 0 || a == b) continue;
+        linkFrom[e * 2] = a;     linkTo[e * 2] = b;
+        linkFrom[e * 2 + 1] = b; linkTo[e * 2 + 1] = a;
+        linkLength[e * 2] = linkLength[e * 2 + 1] = graph.edgeLength[e];
+    }
+
+    auto buildAdjacency = [&]() {
+        adjStart.assign(n + 1, 0);
+        for (int l = 0; l < linkCount; l++) {
+            if (linkFrom[l] >= 0) adjStart[linkFrom[l] + 1]++;
+        }
+        for (int v = 0; v < n; v++) adjStart[v + 1] += adjStart[v];
+        adjTo.assign(adjStart[n], 0);
+        adjLink.assign(adjStart[n], 0);
+        std::vector<int> fill(adjStart.begin(), adjStart.end() - 1);
+        for (int l = 0; l < linkCount; l++) {
+            if (linkFrom[l] < 0) continue;
+            int i = fill[linkFrom[l]]++;
+            adjTo[i] = linkTo[l];
+            adjLink[i] = l;
+        }
+    };
+    buildAdjacency();
+
+    // Metric-independent order: geometric nested dissection, separators ranked last.
+    stamp.assign(n, 0);
+    side.assign(n, 0);
+    stampId = 0;
+    std::vector<int> all(n);
+    for (int v = 0; v < n; v++) all[v] = v;
+    std::vector<int> order;
+    order.reserve(n);
+    dissect(all, order);
+
+    std::vector<int> rankOfDense(n);
+    for (int r = 0; r < n; r++) rankOfDense[order[r]] = r;
+    rankOfGraphNode.assign(nodeSlots, -1);
+    graphNodeOfRank.assign(n, -1);
+    std::vector<float> px(n), pz(n);
+    for (int v = 0; v < n; v++) {
+        int r = rankOfDense[v];
+        rankOfGraphNode[graphOfDense[v]] = r;
+        graphNodeOfRank[r] = graphOfDense[v];
+        px[r] = posX[v];
+        pz[r] = posZ[v];
+    }
+    posX.swap(px);
+    posZ.swap(pz);
+    for (int l = 0; l < linkCount; l++) {
+        if (linkFrom[l] < 0) continue;
+        linkFrom[l] = rankOfDense[linkFrom[l]];
+        linkTo[l] = rankOfDense[linkTo[l]];
+    }
+    buildAdjacency();
+
+    // Symbolic contraction: merging a node's upper neighbours into its lowest upper
+    // neighbour yields the chordal completion (the elimination tree parent).
+    std::vector<std::vector<int>> up(n);
+    for (int l = 0; l < linkCount; l++) {
+        if (linkFrom[l] < 0) continue;
+        int a = linkFrom[l];
+        int b = linkTo[l];
+        if (a < b) up[a].push_back(b);
+    }
+    std::vector<int> merged;
+    for (int v = 0; v < n; v++) {
+        auto& lst = up[v];
+        std::sort(lst.begin(), lst.end());
+        lst.erase(std::unique(lst.begin(), lst.end()), lst.end());
+    }
+    for (int v = 0; v < n; v++) {
+        const auto& lst = up[v];
+        if (lst.size() < 2) continue;
+        auto& pl = up[lst[0]];
+        merged.clear();
+        std::set_union(pl.begin(), pl.end(), lst.begin() + 1, lst.end(), std::back_inserter(merged));
+        pl.swap(merged);
+    }
+
+    upStart.assign(n + 1, 0);
+    for (int v = 0; v < n; v++) upStart[v + 1] = upStart[v] + (int)up[v].size();
+    upHead.resize(upStart[n]);
+    parent.assign(n, -1);
+    for (int v = 0; v < n; v++) {
+        std::copy(up[v].begin(), up[v].end(), upHead.begin() + upStart[v]);
+        if (!up[v].empty()) parent[v] = up[v][0];
+    }
+    upWeight.assign(upHead.size(), INF_COST);
+    downWeight.assign(upHead.size(), INF_COST);
+
+    linkArc.assign(linkCount, -1);
+    linkUpward.assign(linkCount, 0);
+    for (int l = 0; l < linkCount; l++) {
+        if (linkFrom[l] < 0) continue;
+        int a = linkFrom[l];
+        int b = linkTo[l];
+        linkArc[l] = (a < b) ? findArc(a, b) : findArc(b, a);
+        linkUpward[l] = (a < b) ? 1 : 0;
+    }
+
+    distF.assign(n, INF_COST);
+    distB.assign(n, INF_COST);
+    distAll.assign(n, INF_COST);
+    pathF.clear();
+    pathB.clear();
+    prepMs = MsSince(t0);
+}
+
+void TravelTimeIndex::dissect(std::vector<int>& nodes, std::vector<int>& order) {
+    if ((int)nodes.size() <= DISSECT_LEAF) {
+        order.insert(order.end(), nodes.begin(), nodes.end());
+        return;
+    }
+
+    // Median cuts along x, z and both diagonals; keep the one with the smallest
+    // vertex separator (cut endpoints on whichever side has fewer of them).
+    const size_t mid = nodes.size() / 2;
+    std::vector<int> sep;
+    std::vector<int> bestNodes;
+    for (int axis = 0; axis < 4; axis++) {
+        auto key = [&](int v) {
+            switch (axis) {
+            case 0: return posX[v];
+            case 1: return posZ[v];
+            case 2: return posX[v] + posZ[v];
+            default: return posX[v] - posZ[v];
+            }
+        };
+        std::nth_element(nodes.begin(), nodes.begin() + mid, nodes.end(), [&](int a, int b) {
+            float ka = key(a), kb = key(b);
+            return (ka != kb) ? ka < kb : a < b;
+        });
+
+        int id = ++stampId;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            stamp[nodes[i]] = id;
+            side[nodes[i]] = (i < mid) ? 0 : 1;
+        }
+        std::vector<int> cut[2];
+        for (int v : nodes) {
+            for (int i = adjStart[v]; i < adjStart[v + 1]; i++) {
+                int u = adjTo[i];
+                if (stamp[u] == id && side[u] != side[v]) {
+                    cut[side[v]].push_back(v);
+                    break;
+                }
+            }
+        }
+        std::vector<int>& cand = (cut[0].size() <= cut[1].size()) ? cut[0] : cut[1];
+        if (axis == 0 || cand.size() < sep.size()) {
+            sep.swap(cand);
+            bestNodes = nodes;
+        }
+    }
+
+    int id = ++stampId;
+    for (size_t i = 0; i < bestNodes.size(); i++) {
+        stamp[bestNodes[i]] = id;
+        side[bestNodes[i]] = (i < mid) ? 0 : 1;
+    }
+    for (int v : sep) side[v] = 2;
+
+    std::vector<int> parts[2];
+    for (int v : bestNodes) {
+        if (side[v] < 2) parts[side[v]].push_back(v);
+    }
+    nodes.clear();
+    nodes.shrink_to_fit();
+    bestNodes.clear();
+    bestNodes.shrink_to_fit();
+    dissect(parts[0], order);
+    dissect(parts[1], order);
+    order.insert(order.end(), sep.begin(), sep.end());
+}
+
+int TravelTimeIndex::findArc(int lower, int upper) const {
+    auto b = upHead.begin() + upStart[lower];
+    auto e = upHead.begin() + upStart[lower + 1];
+    auto it = std::lower_bound(b, e, upper);
+    if (it == e || *it != upper) return -1;
+    return (int)(it - upHead.begin());
+}
+
+void TravelTimeIndex::customize(const std::vector<float>& linkCost) {
+    auto t0 = std::chrono::steady_clock::now();
+    lastCost = linkCost;
+    lastCost.resize(linkArc.size(), 0.0f);
+    std::fill(upWeight.begin(), upWeight.end(), INF_COST);
+    std::fill(downWeight.begin(), downWeight.end(), INF_COST);
+    for (size_t l = 0; l < linkArc.size(); l++) {
+        int arc = linkArc[l];
+        if (arc < 0) continue;
+        float c = std::max(lastCost[l], 0.0f);
+        if (linkUpward[l]) upWeight[arc] = std::min(upWeight[arc], c);
+        else downWeight[arc] = std::min(downWeight[arc], c);
+    }
+
+    // Lower triangles bottom-up: every arc (v, x) is final once v is reached.
+    for (int v = 0; v < n; v++) {
+        const int s = upStart[v];
+        const int e = upStart[v + 1];
+        for (int i = s; i < e; i++) {
+            int a = upHead[i];
+            int k = upStart[a];
+            const int ke = upStart[a + 1];
+            for (int j = i + 1; j < e; j++) {
+                int b = upHead[j];
+                while (k < ke && upHead[k] < b) k++;
+                if (k >= ke) break;
+                if (upHead[k] != b) continue;
+                upWeight[k] = std::min(upWeight[k], AddCost(downWeight[i], upWeight[j]));
+                downWeight[k] = std::min(downWeight[k], AddCost(downWeight[j], upWeight[i]));
+            }
+        }
+    }
+    custMs = MsSince(t0);
+    customized = true;
+}
+
+void TravelTimeIndex::customizeFromLengths(float speedMps) {
+    std::vector<float> cost(linkLength.size());
+    float inv = 1.0f / std::max(speedMps, 0.1f);
+    for (size_t l = 0; l < cost.size(); l++) cost[l] = linkLength[l] * inv;
+    customize(cost);
+}
+
+void TravelTimeIndex::upwardWalk(int src, bool forward, std::vector<float>& dist, std::vector<int>& path) const {
+    path.clear();
+    for (int v = src; v != -1; v = parent[v]) path.push_back(v);
+    dist[src] = 0.0f;
+    const std::vector<float>& w = forward ? upWeight : downWeight;
+    for (int v : path) {
+        float dv = dist[v];
+        if (dv == INF_COST) continue;
+        for (int i = upStart[v]; i < upStart[v + 1]; i++) {
+            float nd = AddCost(dv, w[i]);
+            if (nd < dist[upHead[i]]) dist[upHead[i]] = nd;
+        }
+    }
+}
+
+// PHAST downward pass: ranks descending, pull from every upper neighbour.
+void TravelTimeIndex::sweepDown(std::vector<float>& dist) const {
+    for (int v = n - 1; v >= 0; v--) {
+        float best = dist[v];
+        for (int i = upStart[v]; i < upStart[v + 1]; i++) {
+            float nd = AddCost(dist[upHead[i]], downWeight[i]);
+            if (nd < best) best = nd;
+        }
+        dist[v] = best;
+    }
+}
+
+float TravelTimeIndex::oneToOne(int fromNode, int toNode) {
+    if (!customized) return -1.0f;
+    if (fromNode < 0 || toNode < 0 || fromNode >= (int)rankOfGraphNode.size() || toNode >= (int)rankOfGraphNode.size()) return -1.0f;
+    int s = rankOfGraphNode[fromNode];
+    int t = rankOfGraphNode[toNode];
+    if (s < 0 || t < 0) return -1.0f;
+
+    upwardWalk(s, true, distF, pathF);
+    upwardWalk(t, false, distB, pathB);
+    float best = INF_COST;
+    for (int v : pathB) best = std::min(best, AddCost(distF[v], distB[v]));
+    for (int v : pathF) distF[v] = INF_COST;
+    for (int v : pathB) distB[v] = INF_COST;
+    return (best == INF_COST) ? -1.0f : best;
+}
+
+void TravelTimeIndex::oneToMany(int fromNode, const std::vector<int>& toNodes, std::vector<float>& outTimes) {
+    outTimes.assign(toNodes.size(), -1.0f);
+    if (!customized || fromNode < 0 || fromNode >= (int)rankOfGraphNode.size()) return;
+    int s = rankOfGraphNode[fromNode];
+    if (s < 0) return;
+
+    // Restricted PHAST: only the elimination-tree ancestors of the targets are swept.
+    int id = ++stampId;
+    std::vector<int> sel;
+    for (int g : toNodes) {
+        if (g < 0 || g >= (int)rankOfGraphNode.size()) continue;
+        for (int v = rankOfGraphNode[g]; v != -1 && stamp[v] != id; v = parent[v]) {
+            stamp[v] = id;
+            sel.push_back(v);
+        }
+    }
+    std::sort(sel.begin(), sel.end(), std::greater<int>());
+
+    upwardWalk(s, true, distF, pathF);
+    for (int v : sel) {
+        float best = distF[v];
+        for (int i = upStart[v]; i < upStart[v + 1]; i++) {
+            float nd = AddCost(distF[upHead[i]], downWeight[i]);
+            if (nd < best) best = nd;
+        }
+        distF[v] = best;
+    }
+    for (size_t k = 0; k < toNodes.size(); k++) {
+        int g = toNodes[k];
+        if (g < 0 || g >= (int)rankOfGraphNode.size() || rankOfGraphNode[g] < 0) continue;
+        float d = distF[rankOfGraphNode[g]];
+        outTimes[k] = (d == INF_COST) ? -1.0f : d;
+    }
+    for (int v : sel) distF[v] = INF_COST;
+    for (int v : pathF) distF[v] = INF_COST;
+}
+
+void TravelTimeIndex::isochrone(int fromNode, float maxSeconds, std::vector<int>& outNodes, std::vector<float>& outTimes) {
+    outNodes.clear();
+    outTimes.clear();
+    if (!customized || fromNode < 0 || fromNode >= (int)rankOfGraphNode.size()) return;
+    int s = rankOfGraphNode[fromNode];
+    if (s < 0) return;
+
+    std::fill(distAll.begin(), distAll.end(), INF_COST);
+    upwardWalk(s, true, distAll, pathF);
+    sweepDown(distAll);
+    for (int v = 0; v < n; v++) {
+        if (distAll[v] > maxSeconds) continue;
+        outNodes.push_back(graphNodeOfRank[v]);
+        outTimes.push_back(distAll[v]);
+    }
+}
+
+float TravelTimeIndex::dijkstraReference(int fromRank, int toRank) const {
+    std::vector<float> dist(n, INF_COST);
+    using Item = std::pair<float, int>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+    dist[fromRank] = 0.0f;
+    heap.push({0.0f, fromRank});
+    while (!heap.empty()) {
+        Item top = heap.top();
+        heap.pop();
+        if (top.first > dist[top.second]) continue;
+        if (top.second == toRank) return top.first;
+        for (int i = adjStart[top.second]; i < adjStart[top.second + 1]; i++) {
+            float nd = top.first + std::max(lastCost[adjLink[i]], 0.0f);
+            if (nd < dist[adjTo[i]]) {
+                dist[adjTo[i]] = nd;
+                heap.push({nd, adjTo[i]});
+            }
+        }
+    }
+    return -1.0f;
+}
+
+TravelTimeBenchmark TravelTimeIndex::runBenchmark(int queries, uint32_t seed) {
+    TravelTimeBenchmark b;
+    if (n < 2 || queries <= 0) return b;
+    if (!customized) customizeFromLengths(13.9f);
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, n - 1);
+    std::vector<std::pair<int, int>> pairs(queries);
+    for (auto& p : pairs) p = {graphNodeOfRank[pick(rng)], graphNodeOfRank[pick(rng)]};
+
+    std::vector<float> recost = lastCost;
+    auto t0 = std::chrono::steady_clock::now();
+    customize(recost);
+    b.customizeMs = MsSince(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    double checksum = 0.0;
+    for (const auto& p : pairs) checksum += oneToOne(p.first, p.second);
+    double totalMs = MsSince(t0);
+    b.queries = queries;
+    b.oneToOneUs = totalMs * 1000.0 / queries;
+    b.oneToOnePerSec = (totalMs > 0.0) ? queries * 1000.0 / totalMs : 0.0;
+
+    const int sweeps = std::min(queries, 16);
+    std::vector<int> nodesOut;
+    std::vector<float> timesOut;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < sweeps; i++) isochrone(pairs[i].first, INF_COST, nodesOut, timesOut);
+    b.oneToAllMs = MsSince(t0) / sweeps;
+
+    const int checks = std::min(queries, 24);
+    for (int i = 0; i < checks; i++) {
+        float ch = oneToOne(pairs[i].first, pairs[i].second);
+        float ref = dijkstraReference(rankOfGraphNode[pairs[i].first], rankOfGraphNode[pairs[i].second]);
+        if (std::fabs(ch - ref) > 1e-3f * std::max(1.0f, std::fabs(ref))) b.mismatches++;
+    }
+    (void)checksum;
+    return b;
+}
+
+void TravelTimeBuilder::start() {
+    stop();
+    quit = false;
+    worker = std::thread(&TravelTimeBuilder::run, this);
+}
+
+void TravelTimeBuilder::stop() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void TravelTimeBuilder::requestBuild(TravelTimeGraph graph, float speedMps) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingGraph = std::make_unique<TravelTimeGraph>(std::move(graph));
+        pendingSpeed = speedMps;
+        pendingCustomize = false;
+    }
+    wake.notify_one();
+}
+
+void TravelTimeBuilder::requestCustomize(uint32_t version, std::vector<float> linkCost) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingCustomize = true;
+        pendingCostVersion = version;
+        pendingCost = std::move(linkCost);
+    }
+    wake.notify_one();
+}
+
+bool TravelTimeBuilder::take(TravelTimeIndex& out) {
+    std::unique_ptr<TravelTimeIndex> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = std::move(finished);
+    }
+    if (!done) return false;
+    out = std::move(*done);
+    return true;
+}
+
+bool TravelTimeBuilder::busy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return working || pendingGraph || pendingCustomize;
+}
+
+void TravelTimeBuilder::run() {
+    // The last built topology; customizations start from a copy of it.
+    std::unique_ptr<TravelTimeIndex> built;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return quit || pendingGraph || pendingCustomize; });
+        if (quit) return;
+        std::unique_ptr<TravelTimeGraph> graph = std::move(pendingGraph);
+        float speed = pendingSpeed;
+        bool recustomize = pendingCustomize && !graph;
+        uint32_t costVersion = pendingCostVersion;
+        std::vector<float> cost;
+        if (recustomize) cost.swap(pendingCost);
+        pendingCustomize = pendingCustomize && !recustomize;
+        working = true;
+        lock.unlock();
+
+        std::unique_ptr<TravelTimeIndex> next;
+        if (graph) {
+            built = std::make_unique<TravelTimeIndex>();
+            built->build(*graph);
+            next = std::make_unique<TravelTimeIndex>(*built);
+            next->customizeFromLengths(speed);
+        } else if (built && built->graphVersion() == costVersion) {
+            next = std::make_unique<TravelTimeIndex>(*built);
+            next->customize(cost);
+        }
+
+        lock.lock();
+        working = false;
+        if (next) finished = std::move(next);
+    }
+}
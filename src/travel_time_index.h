@@ -0,0 +1,144 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "road_graph.h"
+
+struct TravelTimeBenchmark {
+    int queries = 0;
+    double oneToOneUs = 0.0;      // average per query
+    double oneToOnePerSec = 0.0;
+    double oneToAllMs = 0.0;      // average PHAST sweep
+    double customizeMs = 0.0;
+    int mismatches = 0;           // against plain Dijkstra on a sample
+};
+
+// What build() reads from the road graph, copied out so the build can run on
+// another thread. Indexed like the graph; dead edges have edgeA = -1.
+struct TravelTimeGraph {
+    uint32_t version = 0;
+    std::vector<glm::vec2> nodePos; // xz
+    std::vector<uint8_t> nodeAlive;
+    std::vector<int> edgeA;
+    std::vector<int> edgeB;
+    std::vector<float> edgeLength;
+};
+
+TravelTimeGraph SnapshotTravelTimeGraph(const RoadGraph& graph);
+
+// Customizable contraction hierarchy over the road graph. build() computes a
+// metric-independent nested-dissection order and the shortcut topology;
+// customize() only re-runs the cheap triangle pass when travel times change.
+// Queries use per-index scratch and are not thread-safe.
+class TravelTimeIndex {
+public:
+    void build(const RoadGraph& graph) { build(SnapshotTravelTimeGraph(graph)); }
+    void build(const TravelTimeGraph& graph);
+    // Link costs in seconds, indexed like TrafficSegments (2*edge + direction).
+    void customize(const std::vector<float>& linkCost);
+    void customizeFromLengths(float speedMps);
+
+    bool ready() const { return customized; }
+    uint32_t graphVersion() const { return version; }
+    int nodeCount() const { return n; }
+    int arcCount() const { return (int)upHead.size(); }
+    double buildMs() const { return prepMs; }
+    double customizeMs() const { return custMs; }
+
+    // Graph node ids in, seconds out; unreachable targets return a negative value.
+    float oneToOne(int fromNode, int toNode);
+    void oneToMany(int fromNode, const std::vector<int>& toNodes, std::vector<float>& outTimes);
+    void isochrone(int fromNode, float maxSeconds, std::vector<int>& outNodes, std::vector<float>& outTimes);
+
+    TravelTimeBenchmark runBenchmark(int queries, uint32_t seed);
+
+private:
+    void dissect(std::vector<int>& nodes, std::vector<int>& order);
+    void upwardWalk(int src, bool forward, std::vector<float>& dist, std::vector<int>& path) const;
+    void sweepDown(std::vector<float>& dist) const;
+    int findArc(int lower, int upper) const;
+    float dijkstraReference(int fromRank, int toRank) const;
+
+    uint32_t version = 0;
+    int n = 0;
+    int graphNodeCapacity = 0;
+    std::vector<int> rankOfGraphNode; // -1 for dead graph nodes
+    std::vector<int> graphNodeOfRank;
+    std::vector<float> posX;
+    std::vector<float> posZ;
+
+    // Input links (2*edge + dir) mapped to arcs.
+    std::vector<int> linkArc;
+    std::vector<uint8_t> linkUpward;
+    std::vector<float> linkLength;
+
+    // Upward CSR by rank, heads ascending; etree parent is the lowest head.
+    std::vector<int> upStart;
+    std::vector<int> upHead;
+    std::vector<float> upWeight;   // lower -> upper
+    std::vector<float> downWeight; // upper -> lower
+    std::vector<int> parent;
+
+    // Plain adjacency kept for ordering and for benchmark verification.
+    std::vector<int> adjStart;
+    std::vector<int> adjTo;
+    std::vector<int> adjLink;
+
+    std::vector<float> distF;
+    std::vector<float> distB;
+    std::vector<float> distAll;
+    std::vector<int> pathF;
+    std::vector<int> pathB;
+    std::vector<int> stamp;
+    std::vector<uint8_t> side;
+    int stampId = 0;
+    std::vector<float> lastCost;
+
+    double prepMs = 0.0;
+    double custMs = 0.0;
+    bool customized = false;
+};
+
+// Builds and customizes indices on a worker thread so topology edits never
+// stall the frame. Requests coalesce: a newer build replaces a pending one, and
+// a customize is dropped if the topology it was made for has been replaced.
+class TravelTimeBuilder {
+public:
+    ~TravelTimeBuilder() { stop(); }
+
+    void start();
+    void stop();
+
+    // Re-order for a new topology, then customize with free-flow times.
+    void requestBuild(TravelTimeGraph graph, float speedMps);
+    // Re-customize the index of `version` with link costs (see customize()).
+    void requestCustomize(uint32_t version, std::vector<float> linkCost);
+    // Moves the newest finished index into `out`; false if none finished since
+    // the last call.
+    bool take(TravelTimeIndex& out);
+    bool busy() const;
+
+private:
+    void run();
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool quit = false;
+    bool working = false;
+
+    // Pending requests and the finished index, all under `mutex`.
+    std::unique_ptr<TravelTimeGraph> pendingGraph;
+    float pendingSpeed = 0.0f;
+    bool pendingCustomize = false;
+    uint32_t pendingCostVersion = 0;
+    std::vector<float> pendingCost;
+    std::unique_ptr<TravelTimeIndex> finished;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one writer thread to one reader thread without
+// blocking either. Each side owns a slot; the third is swapped through an
+// atomic index, so no slot is ever read and written at the same time.
+template <typename T>
+class TripleBuffer {
+public:
+    // Fills every slot; neither side may be running.
+    void reset(const T& value) {
+        for (T& s : slots) s = value;
+        back = 0;
+        middle.store(1, std::memory_order_relaxed);
+        front = 2;
+    }
+
+    // Writer: fill writeSlot(), then publish() it. The next writeSlot() holds
+    // an older value that must be overwritten in full.
+    T& writeSlot() { return slots[back]; }
+    void publish() { back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+    // Reader: the newest published value, valid until the next read().
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        }
+        return slots[front];
+    }
+    // Reader: the value the last read() returned.
+    const T& current() const { return slots[front]; }
+
+private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4;
+
+    T slots[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0;  // writer's
+    uint8_t front = 2; // reader's
+};
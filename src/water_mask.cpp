@@ -0,0 +1,190 @@
+#include "water_mask.h"
+
+#include "config.h"
+#include "hash.h"
+#include "image_loader.h"
+#include "parallel.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t WATER_CACHE_MAGIC = 0x4B534D57; // "WMSK"
+constexpr uint32_t WATER_CACHE_VERSION = 1;
+
+struct WaterCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dim;
+    uint32_t count;
+    float mapSide;
+    float cellSize;
+};
+
+uint64_t HashBytes(const std::vector<uint8_t>& bytes) {
+    return Fnv1a64(bytes.data(), bytes.size()) ^ bytes.size();
+}
+
+std::string CachePath(const std::string& dir, uint64_t hash, float threshold) {
+    uint32_t tbits;
+    std::memcpy(&tbits, &threshold, sizeof(tbits));
+    char name[64];
+    std::snprintf(name, sizeof(name), "/water_%016llx_%08x.bin", (unsigned long long)hash, tbits);
+    return dir + name;
+}
+
+bool LoadCache(const std::string& path, WaterMaskResult& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    WaterCacheHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != WATER_CACHE_MAGIC || header.version != WATER_CACHE_VERSION ||
+        header.dim != (uint32_t)WaterChunk::DIM || header.mapSide != MAP_SIDE_M || header.cellSize != ZONE_CELL_M) {
+        return false;
+    }
+    out.chunks.reserve(header.count);
+    for (uint32_t i = 0; i < header.count; i++) {
+        uint64_t key = 0;
+        in.read(reinterpret_cast<char*>(&key), sizeof(key));
+        WaterChunk& chunk = out.chunks[key];
+        in.read(reinterpret_cast<char*>(chunk.bits.data()), sizeof(chunk.bits));
+        if (!in) {
+            SDL_Log("Water mask cache %s is truncated", path.c_str());
+            out.chunks.clear();
+            return false;
+        }
+        for (uint64_t word : chunk.bits) {
+            for (; word; word &= word - 1) out.waterCells++;
+        }
+    }
+    return true;
+}
+
+void SaveCache(const std::string& dir, const std::string& path, const WaterMaskResult& mask) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        SDL_Log("Could not write water mask cache %s", path.c_str());
+        return;
+    }
+    WaterCacheHeader header{WATER_CACHE_MAGIC, WATER_CACHE_VERSION, (uint32_t)WaterChunk::DIM,
+                            (uint32_t)mask.chunks.size(), MAP_SIDE_M, ZONE_CELL_M};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& kv : mask.chunks) {
+        out.write(reinterpret_cast<const char*>(&kv.first), sizeof(kv.first));
+        out.write(reinterpret_cast<const char*>(kv.second.bits.data()), sizeof(kv.second.bits));
+    }
+}
+
+// For every zone cell along one axis, the image pixel the old per-cell sampler
+// would have read for it (-1 = not sampled). Cells are indexed from chunk c0.
+struct AxisSamples {
+    int c0 = 0;
+    int chunks = 0;
+    std::vector<int> pixel;
+
+    void build(int imageSize, bool flip) {
+        const float mapHalf = MAP_HALF_M;
+        const float invMap = 1.0f / MAP_SIDE_M;
+        const float start = -mapHalf + ZONE_CELL_M * 0.5f;
+        const int cellsPerSide = (int)std::ceil(MAP_SIDE_M / ZONE_CELL_M);
+        c0 = (int)std::floor(start / CHUNK_SIZE_M);
+        int c1 = (int)std::floor((start + (cellsPerSide - 1) * ZONE_CELL_M) / CHUNK_SIZE_M);
+        chunks = c1 - c0 + 1;
+        pixel.assign((size_t)chunks * WaterChunk::DIM, -1);
+        for (int k = 0; k < cellsPerSide; ++k) {
+            float w = start + k * ZONE_CELL_M;
+            float t = (w + mapHalf) * invMap;
+            if (flip) t = 1.0f - t;
+            if (t < 0.0f || t > 1.0f) continue;
+            int c = (int)std::floor(w / CHUNK_SIZE_M);
+            int i = (int)std::floor((w - c * CHUNK_SIZE_M) / ZONE_CELL_M);
+            if (i < 0 || i >= WaterChunk::DIM) continue;
+            int p = (int)std::floor(t * (float)imageSize);
+            pixel[(size_t)(c - c0) * WaterChunk::DIM + i] = std::min(std::max(p, 0), imageSize - 1);
+        }
+    }
+};
+
+} // namespace
+
+bool BuildWaterMask(const char* imagePath, float threshold, const std::string& cacheDir, WaterMaskResult& out) {
+    out = WaterMaskResult{};
+    std::vector<uint8_t> bytes;
+    if (!ReadFileBytes(imagePath, bytes)) return false;
+    const std::string cachePath = CachePath(cacheDir, HashBytes(bytes), threshold);
+    if (LoadCache(cachePath, out)) {
+        out.fromCache = true;
+        return true;
+    }
+
+    // Same luminance test as before, per RGB sum.
+    bool waterSum[766];
+    for (int sum = 0; sum <= 765; sum++) waterSum[sum] = !(sum * (1.0f / (3.0f * 255.0f)) < threshold);
+
+    int w = 0;
+    int h = 0;
+    std::vector<uint8_t> isWater; // one byte per image pixel
+    auto onSize = [&](int iw, int ih) {
+        w = iw;
+        h = ih;
+        isWater.assign((size_t)iw * (size_t)ih, 0);
+        return iw > 0 && ih > 0;
+    };
+    auto onRow = [&](int y, const uint8_t* rgba) {
+        uint8_t* dst = isWater.data() + (size_t)y * w;
+        for (int x = 0; x < w; x++) {
+            const uint8_t* p = rgba + x * 4;
+            dst[x] = waterSum[p[0] + p[1] + p[2]];
+        }
+    };
+    bool decoded = IsPngData(bytes.data(), bytes.size()) && DecodePngRows(bytes.data(), bytes.size(), onSize, onRow);
+    bytes.clear();
+    bytes.shrink_to_fit();
+    if (!decoded && !ForEachImageRowRGBA(imagePath, onSize, onRow)) return false;
+
+    AxisSamples ax, az;
+    ax.build(w, false);
+    az.build(h, true);
+
+    const int chunkCount = ax.chunks * az.chunks;
+    std::vector<WaterChunk> chunks((size_t)chunkCount);
+    std::vector<int> counts((size_t)chunkCount, 0);
+    ParallelFor(chunkCount, [&](int index, int) {
+        int tx = index % ax.chunks;
+        int tz = index / ax.chunks;
+        WaterChunk& chunk = chunks[(size_t)index];
+        int count = 0;
+        for (int zi = 0; zi < WaterChunk::DIM; ++zi) {
+            int pz = az.pixel[(size_t)tz * WaterChunk::DIM + zi];
+            if (pz < 0) continue;
+            const uint8_t* row = isWater.data() + (size_t)pz * w;
+            const int* cols = ax.pixel.data() + (size_t)tx * WaterChunk::DIM;
+            for (int xi = 0; xi < WaterChunk::DIM; ++xi) {
+                if (cols[xi] < 0 || !row[cols[xi]]) continue;
+                int i = zi * WaterChunk::DIM + xi;
+                chunk.bits[i >> 6] |= uint64_t(1) << (i & 63);
+                count++;
+            }
+        }
+        counts[(size_t)index] = count;
+    });
+
+    for (int index = 0; index < chunkCount; index++) {
+        if (counts[(size_t)index] == 0) continue;
+        uint64_t key = PackChunk(ax.c0 + index % ax.chunks, az.c0 + index / ax.chunks);
+        out.chunks.emplace(key, chunks[(size_t)index]);
+        out.waterCells += counts[(size_t)index];
+    }
+    SaveCache(cacheDir, cachePath, out);
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "zone_grid.h"
+
+struct WaterMaskResult {
+    std::unordered_map<uint64_t, WaterChunk> chunks;
+    int waterCells = 0;
+    bool fromCache = false;
+};
+
+// Stretches the image over the whole map (top row at +Z) and marks every zone
+// cell whose sampled luminance reaches the threshold. Chunks are filled in
+// parallel; the result is cached under cacheDir keyed by a hash of the image
+// bytes and the threshold, so reloading the same map skips decoding entirely.
+bool BuildWaterMask(const char* imagePath, float threshold, const std::string& cacheDir, WaterMaskResult& out);
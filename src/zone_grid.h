@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Chunk addressing and the per-chunk zoning cell grid shared by the city
+// simulation modules.
+constexpr float CHUNK_SIZE_M = 1024.0f;
+struct ChunkCoord { int32_t cx; int32_t cz; };
+inline uint64_t PackChunk(int32_t cx, int32_t cz) {
+    return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cz);
+}
+inline void UnpackChunk(uint64_t key, int32_t& cx, int32_t& cz) {
+    cx = (int32_t)(key >> 32);
+    cz = (int32_t)(key & 0xffffffffu);
+}
+inline ChunkCoord ChunkFromPosXZ(const glm::vec3& p) {
+    return {
+        (int32_t)std::floor(p.x / CHUNK_SIZE_M),
+        (int32_t)std::floor(p.z / CHUNK_SIZE_M)
+    };
+}
+
+struct ZoneChunk {
+    static constexpr int DIM = 128;
+    std::array<uint8_t, DIM * DIM> cells{};
+    void clear() { cells.fill(0); }
+    void set(int x, int z, uint8_t v) {
+        if (x < 0 || x >= DIM || z < 0 || z >= DIM) return;
+        cells[z * DIM + x] = v;
+    }
+    uint8_t get(int x, int z) const {
+        if (x < 0 || x >= DIM || z < 0 || z >= DIM) return 0;
+        return cells[z * DIM + x];
+    }
+};
+
+// One bit per cell, row-major, 64 cells per word.
+struct WaterChunk {
+    static constexpr int DIM = ZoneChunk::DIM;
+    static constexpr int WORDS = DIM * DIM / 64;
+    std::array<uint64_t, WORDS> bits{};
+    void clear() { bits.fill(0); }
+    void set(int x, int z, uint8_t v) {
+        if (x < 0 || x >= DIM || z < 0 || z >= DIM) return;
+        int i = z * DIM + x;
+        if (v) bits[i >> 6] |= uint64_t(1) << (i & 63);
+        else bits[i >> 6] &= ~(uint64_t(1) << (i & 63));
+    }
+    uint8_t get(int x, int z) const {
+        if (x < 0 || x >= DIM || z < 0 || z >= DIM) return 0;
+        return test(bits.data(), z * DIM + x);
+    }
+    static uint8_t test(const uint64_t* words, int i) {
+        return (uint8_t)((words[i >> 6] >> (i & 63)) & 1);
+    }
+};
+
+constexpr uint8_t ZONE_FLAG_BUILDABLE = 1 << 0;
+constexpr uint8_t ZONE_FLAG_ZONED = 1 << 1;
+constexpr uint8_t ZONE_FLAG_BLOCKED = 1 << 2;
+constexpr float ZONE_CELL_M = CHUNK_SIZE_M / ZoneChunk::DIM;
+constexpr uint8_t ZONE_TYPE_SHIFT = 3;
+constexpr uint8_t ZONE_TYPE_MASK = 0x18; // 2 bits for 4 zone types
+
+enum class ZoneType : uint8_t {
+    Residential = 0,
+    Commercial = 1,
+    Industrial = 2,
+    Office = 3
+};
+constexpr int ZONE_TYPE_COUNT = 4;
+
+inline uint8_t ZoneTypeBits(ZoneType t) {
+    return (uint8_t(t) << ZONE_TYPE_SHIFT) & ZONE_TYPE_MASK;
+}
+
+inline ZoneType ZoneTypeFromFlags(uint8_t flags) {
+    return (ZoneType)((flags & ZONE_TYPE_MASK) >> ZONE_TYPE_SHIFT);
+}
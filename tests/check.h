@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal assertions for the CPU-only test programs: failed checks are
+// printed and counted, and main returns TestResult().
+inline int& TestFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            std::printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);     \
+            TestFailures()++;                                                        \
+        }                                                                            \
+    } while (0)
+
+inline int TestResult(const char* name) {
+    if (TestFailures() == 0) {
+        std::printf("%s: all checks passed\n", name);
+        return 0;
+    }
+    std::printf("%s: %d checks failed\n", name, TestFailures());
+    return 1;
+}
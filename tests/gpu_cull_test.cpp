@@ -0,0 +1,244 @@
+// The compute cull against a CPU reference of the same rule: frustum test of the
+// scaled bounding sphere, LOD by distance to the sphere, nothing past the last
+// LOD. Runs on any 4.3 core context (LIBGL_ALWAYS_SOFTWARE=1 gives llvmpipe);
+// exits 77, which CTest reports as skipped, when none can be created.
+#include "gpu_cull.h"
+
+#include <SDL.h>
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "check.h"
+
+namespace {
+
+constexpr int SKIPPED = 77;
+
+// Layout of HouseInstanceGPU; anim.x carries the instance id for the checks.
+struct Instance {
+    glm::vec4 posYaw;
+    glm::vec4 scaleVar;
+    glm::vec4 anim;
+};
+
+// A reference result within this of a plane or LOD threshold may land on either
+// side on the GPU, so it counts as allowed but not required.
+constexpr float MARGIN = 0.05f;
+
+struct Expected {
+    std::vector<std::vector<uint8_t>> state; // per command, per instance: 0 no, 1 maybe, 2 yes
+};
+
+std::vector<Instance> MakeInstances(uint32_t count) {
+    std::vector<Instance> out(count);
+    uint32_t state = 2024u;
+    auto next = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return (float)(state >> 8) / (float)(1u << 24);
+    };
+    for (uint32_t i = 0; i < count; i++) {
+        Instance& inst = out[i];
+        inst.posYaw = glm::vec4(next() * 16000.0f - 8000.0f, next() * 40.0f, next() * 16000.0f - 8000.0f, 0.0f);
+        float s = 0.5f + next() * 2.0f;
+        inst.scaleVar = glm::vec4(s, 0.5f + next() * 2.0f, s, -1.0f);
+        // Some instances are mid-growth with a start scale above one.
+        float grow = next() < 0.2f ? 1.0f + next() : 1.0f;
+        inst.anim = glm::vec4((float)i, 0.0f, grow, grow);
+    }
+    return out;
+}
+
+// Same order as GpuCuller::begin: 16-bit commands of every group, then 32-bit.
+std::vector<std::vector<int>> CommandIndices(const std::vector<GpuCuller::Group>& groups) {
+    std::vector<std::vector<int>> cmd(groups.size());
+    int next = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (std::size_t g = 0; g < groups.size(); g++) {
+            cmd[g].resize((std::size_t)groups[g].lodCount, -1);
+            for (int l = 0; l < groups[g].lodCount; l++) {
+                if (groups[g].lods[l].index16 == (pass == 0)) cmd[g][(std::size_t)l] = next++;
+            }
+        }
+    }
+    return cmd;
+}
+
+Expected Reference(const std::vector<Instance>& instances, const std::vector<GpuCuller::Group>& groups,
+    const std::vector<GpuCuller::Batch>& batches, int view, const glm::mat4& viewProj, const glm::vec3& eye) {
+    std::vector<std::vector<int>> cmd = CommandIndices(groups);
+    std::size_t commandCount = 0;
+    for (const auto& c : cmd) commandCount += c.size();
+    Expected e;
+    e.state.assign(commandCount, std::vector<uint8_t>(instances.size(), 0));
+
+    glm::vec4 planes[6];
+    glm::mat4 t = glm::transpose(viewProj);
+    for (int i = 0; i < 3; i++) {
+        planes[i * 2 + 0] = t[3] + t[i];
+        planes[i * 2 + 1] = t[3] - t[i];
+    }
+    for (glm::vec4& p : planes) p /= glm::length(glm::vec3(p));
+
+    for (const GpuCuller::Batch& b : batches) {
+        if ((b.viewMask & (1u << view)) == 0) continue;
+        const GpuCuller::Group& g = groups[b.group];
+        for (uint32_t i = b.first; i < b.first + b.count; i++) {
+            const Instance& inst = instances[i];
+            glm::vec3 s = glm::vec3(inst.scaleVar) * std::max(1.0f, std::max(inst.anim.z, inst.anim.w));
+            float r = g.radius * std::max(s.x, std::max(s.y, s.z));
+            glm::vec3 c(inst.posYaw);
+            bool inside = true, borderline = false;
+            for (const glm::vec4& p : planes) {
+                float side = glm::dot(glm::vec3(p), c) + p.w + r;
+                inside = inside && side >= 0.0f;
+                borderline = borderline || std::fabs(side) < MARGIN;
+            }
+            if (!inside && !borderline) continue;
+            float d = std::max(glm::distance(c, eye) - r, 0.0f);
+            // The nearest LOD and, if d sits on a threshold, the one beyond it.
+            int lod = 0;
+            while (lod < g.lodCount && d > g.lods[lod].maxDistance) lod++;
+            int other = -1;
+            if (lod < g.lodCount && g.lods[lod].maxDistance - d < MARGIN) other = lod + 1;
+            if (lod > 0 && d - g.lods[lod - 1].maxDistance < MARGIN) other = lod - 1;
+            bool sure = inside && !borderline && other < 0;
+            if (lod < g.lodCount) e.state[(std::size_t)cmd[b.group][(std::size_t)lod]][i] = sure ? 2 : 1;
+            if (other >= 0 && other < g.lodCount) e.state[(std::size_t)cmd[b.group][(std::size_t)other]][i] = 1;
+        }
+    }
+    return e;
+}
+
+// Reads back one view and checks every command against the reference: each
+// output instance is allowed there, appears once, and nothing required is missing.
+void CheckView(const GpuCuller& culler, int view, const Expected& e, uint32_t instanceCount) {
+    std::vector<uint32_t> cmds((std::size_t)culler.commandCount() * 5);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culler.commandBuffer(view));
+    glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, (GLsizeiptr)(cmds.size() * sizeof(uint32_t)), cmds.data());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    CHECK(cmds.size() == e.state.size() * 5);
+    if (cmds.size() != e.state.size() * 5) return;
+
+    uint32_t outputEnd = 0;
+    for (std::size_t c = 0; c < e.state.size(); c++) outputEnd = std::max(outputEnd, cmds[c * 5 + 4] + cmds[c * 5 + 1]);
+    std::vector<Instance> output(outputEnd);
+    glBindBuffer(GL_ARRAY_BUFFER, culler.outputBuffer(view));
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(output.size() * sizeof(Instance)), output.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    int unexpected = 0, duplicated = 0, missing = 0;
+    uint32_t visible = 0;
+    for (std::size_t c = 0; c < e.state.size(); c++) {
+        uint32_t count = cmds[c * 5 + 1], base = cmds[c * 5 + 4];
+        std::vector<uint8_t> seen(instanceCount, 0);
+        for (uint32_t k = 0; k < count; k++) {
+            uint32_t id = (uint32_t)output[base + k].anim.x;
+            if (id >= instanceCount || e.state[c][id] == 0) {
+                unexpected++;
+                continue;
+            }
+            duplicated += seen[id];
+            seen[id] = 1;
+        }
+        for (uint32_t id = 0; id < instanceCount; id++) missing += e.state[c][id] == 2 && !seen[id] ? 1 : 0;
+        visible += count;
+    }
+    CHECK(unexpected == 0);
+    CHECK(duplicated == 0);
+    CHECK(missing == 0);
+    CHECK(visible > 0);
+    CHECK(visible < instanceCount);
+}
+
+void TestCull() {
+    GpuCuller culler;
+    CHECK(culler.init());
+    if (!culler.ready()) return;
+
+    // One mesh with three 16-bit LODs, one with two 32-bit LODs ending at the
+    // draw distance.
+    std::vector<GpuCuller::Group> groups(2);
+    groups[0].lodCount = 3;
+    groups[0].radius = 6.0f;
+    const float dist0[3] = {400.0f, 1500.0f, 6000.0f};
+    for (int l = 0; l < 3; l++) {
+        groups[0].lods[l] = {0, (uint32_t)l * 300, 300u - (uint32_t)l * 90, true, dist0[l]};
+    }
+    groups[1].lodCount = 2;
+    groups[1].radius = 12.0f;
+    groups[1].lods[0] = {100, 0, 600, false, 800.0f};
+    groups[1].lods[1] = {100, 600, 240, false, 6000.0f};
+
+    const uint32_t instanceCount = 80000;
+    std::vector<Instance> instances = MakeInstances(instanceCount);
+    GLuint source = 0;
+    glGenBuffers(1, &source);
+    glBindBuffer(GL_ARRAY_BUFFER, source);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(instances.size() * sizeof(Instance)), instances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glm::vec3 eye(300.0f, 120.0f, -200.0f);
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 10000.0f);
+    glm::mat4 viewProj = proj * glm::lookAt(eye, glm::vec3(1500.0f, 0.0f, 2500.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec3 sun(-2000.0f, 3000.0f, -1000.0f);
+    glm::mat4 shadowProj = glm::ortho(-3000.0f, 3000.0f, -3000.0f, 3000.0f, 10.0f, 9000.0f) *
+        glm::lookAt(sun, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // One batch per instance: more workgroups than a single dispatch may have.
+    std::vector<GpuCuller::Batch> single(instanceCount);
+    for (uint32_t i = 0; i < instanceCount; i++) single[i] = {i, 1, i % 2, 3};
+    // Wide batches, every third one drawn into the shadow map only.
+    std::vector<GpuCuller::Batch> wide;
+    for (uint32_t first = 0, n = 0; first < instanceCount; first += 1000, n++) {
+        wide.push_back({first, std::min(1000u, instanceCount - first), n % 2, n % 3 == 2 ? 2u : 3u});
+    }
+
+    for (const std::vector<GpuCuller::Batch>* batches : {&single, &wide}) {
+        culler.begin(groups, *batches);
+        CHECK(culler.commandCount() == 5);
+        CHECK(culler.submittedInstances() == instanceCount);
+        culler.cull(0, source, viewProj, eye);
+        culler.cull(1, source, shadowProj, eye);
+        culler.finish();
+        CHECK(glGetError() == GL_NO_ERROR);
+        CheckView(culler, 0, Reference(instances, groups, *batches, 0, viewProj, eye), instanceCount);
+        CheckView(culler, 1, Reference(instances, groups, *batches, 1, shadowProj, eye), instanceCount);
+    }
+
+    glDeleteBuffers(1, &source);
+    culler.shutdown();
+}
+
+} // namespace
+
+int main(int, char**) {
+    SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        std::printf("gpu_cull_test: skipped, no video: %s\n", SDL_GetError());
+        return SKIPPED;
+    }
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_Window* window = SDL_CreateWindow("gpu_cull_test", 0, 0, 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext context = window ? SDL_GL_CreateContext(window) : nullptr;
+    if (!context || !gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
+        std::printf("gpu_cull_test: skipped, no 4.3 context: %s\n", SDL_GetError());
+        if (window) SDL_DestroyWindow(window);
+        SDL_Quit();
+        return SKIPPED;
+    }
+
+    TestCull();
+
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return TestResult("gpu_cull_test");
+}
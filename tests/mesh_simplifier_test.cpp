@@ -0,0 +1,307 @@
+// Synthetic meshes through the quadric simplifier: levels stay within their
+// triangle budget and error bound (checked against the real distance of every
+// input vertex to the simplified surface), the base face and the bounds never
+// move, open borders keep their outline, and two runs produce identical output.
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "check.h"
+
+namespace {
+
+// Cube from -1 to 1, each face an n x n grid with its own vertices so the
+// normals split at the edges, as an imported building would.
+ImportedMesh Box(int n) {
+    ImportedMesh mesh;
+    for (int f = 0; f < 6; f++) {
+        const int axis = f / 2, u = (axis + 1) % 3, v = (axis + 2) % 3;
+        const float side = (f % 2) ? 1.0f : -1.0f;
+        glm::vec3 normal(0.0f);
+        normal[axis] = side;
+        uint32_t base = (uint32_t)mesh.positions.size();
+        for (int i = 0; i <= n; i++) {
+            for (int j = 0; j <= n; j++) {
+                glm::vec3 p;
+                p[axis] = side;
+                p[u] = -1.0f + 2.0f * (float)i / (float)n;
+                p[v] = -1.0f + 2.0f * (float)j / (float)n;
+                mesh.positions.push_back(p);
+                mesh.normals.push_back(normal);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                uint32_t a = base + (uint32_t)(i * (n + 1) + j), b = a + (uint32_t)n + 1, c = a + 1, d = b + 1;
+                if (side > 0.0f) mesh.indices.insert(mesh.indices.end(), {a, b, d, a, d, c});
+                else mesh.indices.insert(mesh.indices.end(), {a, d, b, a, c, d});
+            }
+        }
+    }
+    return mesh;
+}
+
+// Unit sphere, n rings by 2n segments, smooth normals.
+ImportedMesh Sphere(int n) {
+    ImportedMesh mesh;
+    const float pi = 3.14159265f;
+    for (int i = 0; i <= n; i++) {
+        for (int j = 0; j <= 2 * n; j++) {
+            float theta = pi * (float)i / (float)n, phi = pi * (float)j / (float)n;
+            glm::vec3 p(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            mesh.positions.push_back(p);
+            mesh.normals.push_back(p);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 2 * n; j++) {
+            uint32_t a = (uint32_t)(i * (2 * n + 1) + j), b = a + (uint32_t)(2 * n + 1);
+            mesh.indices.insert(mesh.indices.end(), {a, a + 1, b + 1, a, b + 1, b});
+        }
+    }
+    return mesh;
+}
+
+// Flat n x n open grid in the z = 0 plane, turned 45 degrees so its borders
+// are diagonal and lie on no bounds face.
+ImportedMesh Diamond(int n) {
+    ImportedMesh mesh;
+    for (int u = 0; u <= n; u++) {
+        for (int v = 0; v <= n; v++) {
+            mesh.positions.push_back(glm::vec3((float)(u - v), (float)(u + v), 0.0f));
+            mesh.normals.push_back(glm::vec3(0.0f, 0.0f, 1.0f));
+        }
+    }
+    for (int u = 0; u < n; u++) {
+        for (int v = 0; v < n; v++) {
+            uint32_t a = (uint32_t)(u * (n + 1) + v), b = a + (uint32_t)n + 1;
+            mesh.indices.insert(mesh.indices.end(), {a, b, b + 1, a, b + 1, a + 1});
+        }
+    }
+    return mesh;
+}
+
+bool ValidIndices(const std::vector<uint32_t>& indices, std::size_t vertexCount) {
+    if (indices.size() % 3 != 0) return false;
+    for (uint32_t i : indices) {
+        if (i >= vertexCount) return false;
+    }
+    return true;
+}
+
+double SegmentDistance(const glm::dvec3& p, const glm::dvec3& a, const glm::dvec3& b) {
+    glm::dvec3 ab = b - a;
+    double t = glm::clamp(glm::dot(p - a, ab) / std::max(glm::dot(ab, ab), 1e-30), 0.0, 1.0);
+    return glm::length(p - (a + ab * t));
+}
+
+// Farthest any input vertex lies from the simplified surface, by brute force:
+// the plane distance where the projection falls inside a triangle, else the
+// nearest edge.
+double VertexToSurface(const ImportedMesh& mesh, const std::vector<uint32_t>& indices) {
+    double worst = 0.0;
+    for (const glm::vec3& v : mesh.positions) {
+        glm::dvec3 p(v);
+        double best = 1e300;
+        for (std::size_t t = 0; t < indices.size(); t += 3) {
+            glm::dvec3 a(mesh.positions[indices[t]]), b(mesh.positions[indices[t + 1]]), c(mesh.positions[indices[t + 2]]);
+            glm::dvec3 n = glm::cross(b - a, c - a);
+            double len = glm::length(n);
+            if (len > 0.0) {
+                n /= len;
+                glm::dvec3 q = p - n * glm::dot(p - a, n);
+                bool inside = glm::dot(glm::cross(b - a, q - a), n) >= 0.0 && glm::dot(glm::cross(c - b, q - b), n) >= 0.0 &&
+                              glm::dot(glm::cross(a - c, q - c), n) >= 0.0;
+                if (inside) best = std::min(best, std::fabs(glm::dot(p - a, n)));
+            }
+            best = std::min({best, SegmentDistance(p, a, b), SegmentDistance(p, b, c), SegmentDistance(p, c, a)});
+        }
+        worst = std::max(worst, best);
+    }
+    return worst;
+}
+
+void Bounds(const ImportedMesh& mesh, const std::vector<uint32_t>& indices, glm::vec3& bmin, glm::vec3& bmax) {
+    bmin = glm::vec3(1e30f);
+    bmax = glm::vec3(-1e30f);
+    for (uint32_t i : indices) {
+        bmin = glm::min(bmin, mesh.positions[i]);
+        bmax = glm::max(bmax, mesh.positions[i]);
+    }
+}
+
+// Triangles lying in the y = -1 face, by corner positions, rotated to start at
+// the smallest corner and sorted.
+std::vector<std::array<float, 9>> BaseTriangles(const ImportedMesh& mesh, const std::vector<uint32_t>& indices) {
+    std::vector<std::array<float, 9>> out;
+    for (std::size_t t = 0; t < indices.size(); t += 3) {
+        std::array<std::array<float, 3>, 3> c;
+        bool onBase = true;
+        for (int k = 0; k < 3; k++) {
+            const glm::vec3& p = mesh.positions[indices[t + k]];
+            c[k] = {p.x, p.y, p.z};
+            onBase = onBase && p.y == -1.0f;
+        }
+        if (!onBase) continue;
+        std::rotate(c.begin(), std::min_element(c.begin(), c.end()), c.end());
+        std::array<float, 9> tri;
+        for (int k = 0; k < 3; k++) std::copy(c[k].begin(), c[k].end(), tri.begin() + k * 3);
+        out.push_back(tri);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+void TestSphereBudget() {
+    const ImportedMesh sphere = Sphere(24);
+    const std::size_t full = sphere.indices.size() / 3;
+
+    // A loose bound: the triangle budget is what stops it.
+    float error = -1.0f;
+    std::vector<uint32_t> coarse = SimplifyMesh(sphere.positions, sphere.normals, sphere.indices, full / 4, 1.0f, error);
+    CHECK(ValidIndices(coarse, sphere.positions.size()));
+    CHECK(coarse.size() / 3 <= full / 4);
+    CHECK(coarse.size() / 3 > full / 8);
+    CHECK(error > 0.0f && error <= 1.0f);
+    CHECK(VertexToSurface(sphere, coarse) <= error * 1.0001 + 1e-6);
+
+    // A tight bound stops it first, above the budget.
+    float tightError = -1.0f;
+    std::vector<uint32_t> fine = SimplifyMesh(sphere.positions, sphere.normals, sphere.indices, full / 4, 0.002f, tightError);
+    CHECK(ValidIndices(fine, sphere.positions.size()));
+    CHECK(fine.size() / 3 > full / 4);
+    CHECK(fine.size() / 3 < full);
+    CHECK(tightError <= 0.002f);
+    CHECK(VertexToSurface(sphere, fine) <= tightError * 1.0001 + 1e-6);
+
+    float againError = -1.0f;
+    std::vector<uint32_t> again = SimplifyMesh(sphere.positions, sphere.normals, sphere.indices, full / 4, 1.0f, againError);
+    CHECK(again == coarse);
+    CHECK(againError == error);
+
+    // Already within budget: returned unchanged.
+    float noError = -1.0f;
+    CHECK(SimplifyMesh(sphere.positions, sphere.normals, sphere.indices, full, 1.0f, noError) == sphere.indices);
+    CHECK(noError == 0.0f);
+}
+
+void TestBoxLocks() {
+    const ImportedMesh box = Box(8);
+    const std::size_t full = box.indices.size() / 3;
+    glm::vec3 fullMin, fullMax;
+    Bounds(box, box.indices, fullMin, fullMax);
+
+    // Faces are flat, so a generous budget reduces them to almost nothing
+    // except the locked base, which keeps every triangle.
+    float error = -1.0f;
+    std::vector<uint32_t> lod = SimplifyMesh(box.positions, box.normals, box.indices, 12, 0.01f, error);
+    CHECK(ValidIndices(lod, box.positions.size()));
+    CHECK(lod.size() / 3 < full / 4);
+    CHECK(error <= 0.01f);
+    CHECK(VertexToSurface(box, lod) <= error + 1e-6);
+    CHECK(BaseTriangles(box, lod) == BaseTriangles(box, box.indices));
+    CHECK(BaseTriangles(box, lod).size() == 8 * 8 * 2);
+
+    glm::vec3 lodMin, lodMax;
+    Bounds(box, lod, lodMin, lodMax);
+    CHECK(lodMin == fullMin);
+    CHECK(lodMax == fullMax);
+
+    // Nothing folds inward, and corners keep their face's normal.
+    int inward = 0, wrongNormal = 0;
+    for (std::size_t t = 0; t < lod.size(); t += 3) {
+        const glm::vec3& a = box.positions[lod[t]];
+        const glm::vec3& b = box.positions[lod[t + 1]];
+        const glm::vec3& c = box.positions[lod[t + 2]];
+        glm::vec3 n = glm::cross(b - a, c - a);
+        if (glm::dot(n, a + b + c) <= 0.0f) inward++;
+        for (int k = 0; k < 3; k++) {
+            if (glm::dot(box.normals[lod[t + k]], n) <= 0.0f) wrongNormal++;
+        }
+    }
+    CHECK(inward == 0);
+    CHECK(wrongNormal == 0);
+}
+
+void TestOpenBorder() {
+    const int n = 8;
+    const ImportedMesh diamond = Diamond(n);
+    float error = -1.0f;
+    std::vector<uint32_t> lod = SimplifyMesh(diamond.positions, diamond.normals, diamond.indices, 2, 0.01f, error);
+    CHECK(ValidIndices(lod, diamond.positions.size()));
+    CHECK(lod.size() / 3 < diamond.indices.size() / 3 / 4);
+    CHECK(error <= 0.01f);
+
+    // Same area, and every border edge still on the outline.
+    float area = 0.0f;
+    std::map<std::pair<uint32_t, uint32_t>, int> edgeUses;
+    for (std::size_t t = 0; t < lod.size(); t += 3) {
+        const glm::vec3& a = diamond.positions[lod[t]];
+        const glm::vec3& b = diamond.positions[lod[t + 1]];
+        const glm::vec3& c = diamond.positions[lod[t + 2]];
+        area += 0.5f * glm::cross(b - a, c - a).z;
+        for (int k = 0; k < 3; k++) {
+            uint32_t p = lod[t + k], q = lod[t + (k + 1) % 3];
+            edgeUses[{std::min(p, q), std::max(p, q)}]++;
+        }
+    }
+    CHECK(std::fabs(area - 2.0f * n * n) < 1e-3f);
+    int offOutline = 0;
+    for (const auto& e : edgeUses) {
+        if (e.second != 1) continue;
+        uint32_t p = e.first.first, q = e.first.second;
+        int up = (int)p / (n + 1), vp = (int)p % (n + 1), uq = (int)q / (n + 1), vq = (int)q % (n + 1);
+        bool onOutline = (up == uq && (up == 0 || up == n)) || (vp == vq && (vp == 0 || vp == n));
+        if (!onOutline) offOutline++;
+    }
+    CHECK(offOutline == 0);
+}
+
+void TestBuildLods() {
+    ImportedMesh sphere = Sphere(24);
+    const std::size_t full = sphere.indices.size() / 3;
+    const std::vector<LodSetting> settings = {{0.5f, 0.01f}, {0.25f, 0.02f}, {0.1f, 0.05f}, {0.05f, 0.1f}};
+    BuildLods(sphere, settings);
+    CHECK(sphere.lods.size() == (std::size_t)MESH_LOD_LEVELS);
+
+    // The sphere's bounds diagonal is 2 * sqrt(3).
+    const float diagonal = 2.0f * std::sqrt(3.0f);
+    std::size_t prev = full;
+    for (std::size_t l = 0; l < sphere.lods.size(); l++) {
+        std::size_t tris = sphere.lods[l].indices.size() / 3;
+        CHECK(ValidIndices(sphere.lods[l].indices, sphere.positions.size()));
+        CHECK(tris <= (std::size_t)((double)full * settings[l].ratio));
+        CHECK(tris * 10 <= prev * 9);
+        CHECK(sphere.lods[l].error <= settings[l].maxError * diagonal);
+        CHECK(VertexToSurface(sphere, sphere.lods[l].indices) <= sphere.lods[l].error * 1.0001 + 1e-6);
+        prev = tris;
+    }
+
+    ImportedMesh again = Sphere(24);
+    BuildLods(again, settings);
+    CHECK(again.lods.size() == sphere.lods.size());
+    for (std::size_t l = 0; l < again.lods.size() && l < sphere.lods.size(); l++) {
+        CHECK(again.lods[l].indices == sphere.lods[l].indices);
+        CHECK(again.lods[l].error == sphere.lods[l].error);
+    }
+
+    // A single quad cannot lose a tenth of its triangles.
+    ImportedMesh quad = Diamond(1);
+    BuildLods(quad, settings);
+    CHECK(quad.lods.empty());
+}
+
+} // namespace
+
+int main() {
+    TestSphereBudget();
+    TestBoxLocks();
+    TestOpenBorder();
+    TestBuildLods();
+    return TestResult("mesh_simplifier_test");
+}
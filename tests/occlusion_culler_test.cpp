@@ -0,0 +1,51 @@
+// One wall in front of the camera: boxes hidden behind it are culled, boxes
+// beside it, in front of it or only partly covered are kept. Built once with
+// the SSE2 rasterizer and once with OCCLUSION_NO_SIMD.
+#include "occlusion_culler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "check.h"
+
+int main() {
+    const glm::vec3 eye(0.0f, 10.0f, 0.0f);
+    const glm::mat4 viewProj = glm::perspective(glm::radians(60.0f), 2.0f, 1.0f, 2000.0f) *
+                               glm::lookAt(eye, glm::vec3(100.0f, 10.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    OcclusionCuller culler;
+    culler.begin(viewProj);
+    CHECK(culler.width() % 4 == 0);
+
+    // Nothing rasterized yet: everything on screen is kept.
+    CHECK(culler.testAabb(glm::vec3(100.0f, 0.0f, -5.0f), glm::vec3(110.0f, 8.0f, 5.0f)));
+
+    // Wall across the view, 40 m ahead, 60 m wide and 20 m tall.
+    CHECK(culler.addOccluderBox(glm::vec3(40.0f, 10.0f, 0.0f), glm::vec3(1.0f, 10.0f, 30.0f), 0.0f));
+    CHECK(culler.stats().occluders == 1);
+
+    int covered = 0;
+    for (int i = 0; i < culler.width() * culler.height(); i++) covered += culler.depth()[i] < 1.0f ? 1 : 0;
+    CHECK(covered > 0);
+
+    // Behind the wall.
+    CHECK(!culler.testAabb(glm::vec3(100.0f, 0.0f, -5.0f), glm::vec3(110.0f, 8.0f, 5.0f)));
+    CHECK(!culler.testAabb(glm::vec3(60.0f, 0.0f, -10.0f), glm::vec3(70.0f, 15.0f, 10.0f)));
+    // Beside it, in front of it, and sticking out past its edge.
+    CHECK(culler.testAabb(glm::vec3(100.0f, 0.0f, 80.0f), glm::vec3(110.0f, 8.0f, 90.0f)));
+    CHECK(culler.testAabb(glm::vec3(20.0f, 0.0f, -5.0f), glm::vec3(25.0f, 8.0f, 5.0f)));
+    CHECK(culler.testAabb(glm::vec3(100.0f, 0.0f, 60.0f), glm::vec3(110.0f, 8.0f, 90.0f)));
+    // Taller than the wall seen from here.
+    CHECK(culler.testAabb(glm::vec3(100.0f, 0.0f, -5.0f), glm::vec3(110.0f, 60.0f, 5.0f)));
+    CHECK(culler.stats().tests == 7);
+    CHECK(culler.stats().culled == 2);
+
+    // An occluder reaching behind the camera is rejected, not rasterized.
+    CHECK(!culler.addOccluderBox(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(5.0f, 5.0f, 5.0f), 0.0f));
+    CHECK(culler.stats().rejectedOccluders == 1);
+
+    // begin() clears the buffer.
+    culler.begin(viewProj);
+    CHECK(culler.testAabb(glm::vec3(100.0f, 0.0f, -5.0f), glm::vec3(110.0f, 8.0f, 5.0f)));
+
+    return TestResult("occlusion_culler");
+}
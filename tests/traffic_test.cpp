@@ -0,0 +1,209 @@
+// Assignment on a crossing-road grid of about 100k segments, headless: the
+// solution conserves flow away from zone access nodes and converges; after a
+// local edit the previous volumes re-converge in fewer iterations than a cold
+// start; the solver thread answers the newest request. Timings are reported.
+// Also the shared ParallelFor pool under concurrent callers.
+#include "traffic.h"
+#include "parallel.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+
+namespace {
+
+constexpr float SPACING = 50.0f;
+constexpr int ROADS = 225; // per direction: 2 * 225 * 224 = 100800 segments
+
+void BuildGrid(RoadGraph& graph) {
+    const float extent = SPACING * (ROADS - 1);
+    graph.beginBulkLoad();
+    for (int i = 0; i < ROADS; i++) {
+        float c = SPACING * i;
+        graph.bulkAddRoad(i * 2 + 1, {glm::vec3(0.0f, 0.0f, c), glm::vec3(extent, 0.0f, c)});
+        graph.bulkAddRoad(i * 2 + 2, {glm::vec3(c, 0.0f, 0.0f), glm::vec3(c, 0.0f, extent)});
+    }
+    graph.endBulkLoad();
+}
+
+// A lot mid-block on every third block; one in four is residential.
+std::vector<TrafficLot> MakeLots() {
+    std::vector<TrafficLot> lots;
+    for (int i = 0; i < ROADS; i++) {
+        for (int k = 0; k + 1 < ROADS; k += 3) {
+            for (int dir = 0; dir < 2; dir++) {
+                TrafficLot lot;
+                lot.roadId = i * 2 + 1 + dir;
+                lot.d = SPACING * (k + 0.5f);
+                float c = SPACING * i;
+                lot.pos = dir == 0 ? glm::vec3(lot.d, 0.0f, c) : glm::vec3(c, 0.0f, lot.d);
+                lot.origin = (i + k + dir) % 4 == 0;
+                lots.push_back(lot);
+            }
+        }
+    }
+    return lots;
+}
+
+double MsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Largest in/out imbalance at a node that no lot feeds, relative to the largest
+// link volume. Lots enter and leave at the nearer end of their edge.
+float FlowImbalance(const TrafficInput& in, const TrafficModel& model) {
+    std::vector<uint8_t> access(in.nodeAlive.size(), 0);
+    for (size_t i = 0; i < in.lots.size(); i++) {
+        int e = in.lotEdge[i];
+        if (e < 0) continue;
+        const RoadGraphEdge& edge = in.edges[e];
+        access[(in.lots[i].d - edge.d0 <= edge.d1 - in.lots[i].d) ? edge.nodeA : edge.nodeB] = 1;
+    }
+    const std::vector<float>& volume = model.segments().volume;
+    std::vector<double> net(in.nodeAlive.size(), 0.0);
+    float peak = 0.0f;
+    for (size_t e = 0; e < in.edges.size(); e++) {
+        if (!in.edges[e].alive) continue;
+        double ab = volume[e * 2] - volume[e * 2 + 1];
+        net[in.edges[e].nodeA] -= ab;
+        net[in.edges[e].nodeB] += ab;
+        peak = std::max(peak, std::max(volume[e * 2], volume[e * 2 + 1]));
+    }
+    double worst = 0.0;
+    for (size_t n = 0; n < net.size(); n++) {
+        if (in.nodeAlive[n] && !access[n]) worst = std::max(worst, std::fabs(net[n]));
+    }
+    return peak > 0.0f ? (float)(worst / peak) : 0.0f;
+}
+
+struct Solve {
+    int iterations = 0;
+    double ms = 0.0;
+};
+
+Solve Run(TrafficModel& model, const TrafficInput& in) {
+    auto t0 = std::chrono::steady_clock::now();
+    model.rebuild(in);
+    model.solve();
+    return {model.stats().iterations, MsSince(t0)};
+}
+
+void TestAssignment() {
+    RoadGraph graph;
+    BuildGrid(graph);
+    std::vector<TrafficLot> lots = MakeLots();
+    TrafficInput in = SnapshotTrafficInput(graph, lots);
+
+    TrafficSettings settings;
+    settings.targetRelativeGap = 4e-3f;
+    settings.laneCapacityVph = 150.0f; // congested enough that routes split
+    TrafficModel model;
+    model.setSettings(settings);
+    Solve cold = Run(model, in);
+    const TrafficStats& st = model.stats();
+    CHECK(st.links / 2 >= 100000);
+    CHECK(st.origins > 50);
+    CHECK(model.converged());
+    CHECK(std::fabs(st.relativeGap) <= settings.targetRelativeGap);
+    CHECK(FlowImbalance(in, model) < 1e-3f);
+    std::printf("traffic_test: %d segments, %d zones, %.0f trips/h\n", st.links / 2, st.zones, st.totalTrips);
+    std::printf("  cold: %d iterations, %.0f ms (build %.0f ms, last iteration %.1f ms)\n",
+        cold.iterations, cold.ms, st.buildMs, st.iterationMs);
+
+    // A local edit: two roads near the middle close, taking their lots along.
+    graph.removeRoad(ROADS + 1);
+    graph.removeRoad(ROADS + 4);
+    TrafficInput edited = SnapshotTrafficInput(graph, lots);
+    Solve warm = Run(model, edited);
+    CHECK(model.converged());
+    CHECK(std::fabs(model.stats().relativeGap) <= settings.targetRelativeGap);
+    CHECK(FlowImbalance(edited, model) < 1e-2f);
+    float warmGap = model.stats().relativeGap;
+
+    TrafficModel fresh;
+    fresh.setSettings(settings);
+    Solve again = Run(fresh, edited);
+    CHECK(warm.iterations < again.iterations);
+    std::printf("  after edit: warm %d iterations, %.0f ms (gap %.4f) | cold %d iterations, %.0f ms\n",
+        warm.iterations, warm.ms, warmGap, again.iterations, again.ms);
+}
+
+// Polls like the frame loop until the results answer `request` and converged.
+bool WaitFor(TrafficSolver& solver, uint64_t request) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(120);
+    while (std::chrono::steady_clock::now() < deadline) {
+        const TrafficResults& r = solver.update();
+        if (r.request == request && r.converged) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+void TestSolver() {
+    RoadGraph graph;
+    BuildGrid(graph);
+    std::vector<TrafficLot> lots = MakeLots();
+    TrafficSettings settings;
+    settings.targetRelativeGap = 1e-2f;
+
+    TrafficSolver solver;
+    solver.start(settings);
+    CHECK(solver.update().converged); // nothing to assign yet
+    uint64_t first = solver.requestRebuild(SnapshotTrafficInput(graph, lots));
+    CHECK(WaitFor(solver, first));
+    const TrafficResults& r = solver.latest();
+    CHECK(r.graphVersion == graph.version());
+    CHECK(r.congestion.size() == graph.edges().size());
+    CHECK(r.time.size() == graph.edges().size() * 2);
+    CHECK(std::fabs(r.stats.relativeGap) <= settings.targetRelativeGap);
+
+    // Two edits in a row: the results end up answering the second.
+    graph.removeRoad(7);
+    solver.requestRebuild(SnapshotTrafficInput(graph, lots));
+    graph.removeRoad(9);
+    uint64_t last = solver.requestRebuild(SnapshotTrafficInput(graph, lots));
+    CHECK(last > first);
+    CHECK(WaitFor(solver, last));
+    CHECK(solver.latest().graphVersion == graph.version());
+    solver.stop();
+    CHECK(!solver.running());
+}
+
+void TestParallelFor() {
+    // Two threads share the pool; each index runs exactly once per call and no
+    // worker id is inside a call twice at the same time.
+    auto hammer = [](int calls, int& wrong) {
+        for (int c = 0; c < calls; c++) {
+            const int count = 1 + (c * 37) % 500;
+            std::vector<std::atomic<int>> hits(count);
+            std::vector<std::atomic<int>> inside(ParallelWorkerCount());
+            std::atomic<int> overlap{0};
+            ParallelFor(count, [&](int i, int worker) {
+                overlap += inside[worker].fetch_add(1) != 0 ? 1 : 0;
+                hits[i]++;
+                inside[worker]--;
+            });
+            for (auto& h : hits) wrong += h.load() != 1 ? 1 : 0;
+            wrong += overlap.load();
+        }
+    };
+    int wrongA = 0, wrongB = 0;
+    std::thread other(hammer, 2000, std::ref(wrongB));
+    hammer(2000, wrongA);
+    other.join();
+    CHECK(wrongA == 0);
+    CHECK(wrongB == 0);
+}
+
+} // namespace
+
+int main() {
+    TestParallelFor();
+    TestAssignment();
+    TestSolver();
+    return TestResult("traffic_test");
+}
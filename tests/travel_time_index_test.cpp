@@ -0,0 +1,274 @@
+// The contraction hierarchy against plain Dijkstra on a crossing-road grid with
+// uneven, direction-dependent link costs: one-to-one, one-to-many and isochrone
+// results must match, and query throughput of both is reported. Then the
+// background builder: its index answers like a synchronous one, and a burst of
+// requests ends with the newest topology.
+#include "travel_time_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+
+namespace {
+
+constexpr float SPACING = 50.0f;
+constexpr int ROADS = 120; // per direction: 14400 crossings
+
+// Full-length roads in both directions plus two diagonals, which cut the grid
+// cells into uneven pieces, and one short road that touches nothing.
+void BuildGrid(RoadGraph& graph) {
+    const float extent = SPACING * (ROADS - 1);
+    graph.beginBulkLoad();
+    int id = 1;
+    for (int i = 0; i < ROADS; i++) {
+        float c = SPACING * i;
+        graph.bulkAddRoad(id++, {glm::vec3(-10.0f, 0.0f, c), glm::vec3(extent + 10.0f, 0.0f, c)});
+        graph.bulkAddRoad(id++, {glm::vec3(c, 0.0f, -10.0f), glm::vec3(c, 0.0f, extent + 10.0f)});
+    }
+    graph.bulkAddRoad(id++, {glm::vec3(5.0f, 0.0f, 7.0f), glm::vec3(extent - 3.0f, 0.0f, extent - 11.0f)});
+    graph.bulkAddRoad(id++, {glm::vec3(3.0f, 0.0f, extent - 9.0f), glm::vec3(extent - 6.0f, 0.0f, 4.0f)});
+    graph.bulkAddRoad(id++, {glm::vec3(-900.0f, 0.0f, -900.0f), glm::vec3(-800.0f, 0.0f, -900.0f)});
+    graph.endBulkLoad();
+}
+
+// Link 2*e runs nodeA->nodeB, 2*e+1 back; each direction gets its own factor.
+std::vector<float> LinkCosts(const RoadGraph& graph, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> factor(0.7f, 2.5f);
+    std::vector<float> cost(graph.edges().size() * 2, 0.0f);
+    for (size_t e = 0; e < graph.edges().size(); e++) {
+        float t = graph.edges()[e].length() / 13.9f;
+        cost[e * 2] = t * factor(rng);
+        cost[e * 2 + 1] = t * factor(rng);
+    }
+    return cost;
+}
+
+struct Reference {
+    std::vector<std::vector<std::pair<int, int>>> out; // (to node, link) per graph node
+
+    explicit Reference(const RoadGraph& graph) : out(graph.nodes().size()) {
+        for (size_t e = 0; e < graph.edges().size(); e++) {
+            const RoadGraphEdge& edge = graph.edges()[e];
+            if (!edge.alive) continue;
+            out[edge.nodeA].push_back({edge.nodeB, (int)e * 2});
+            out[edge.nodeB].push_back({edge.nodeA, (int)e * 2 + 1});
+        }
+    }
+
+    // Seconds to every graph node; negative when unreachable.
+    std::vector<float> fromNode(int source, const std::vector<float>& cost) const {
+        const float inf = std::numeric_limits<float>::max();
+        std::vector<float> dist(out.size(), inf);
+        using Item = std::pair<float, int>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+        dist[source] = 0.0f;
+        heap.push({0.0f, source});
+        while (!heap.empty()) {
+            Item top = heap.top();
+            heap.pop();
+            if (top.first > dist[top.second]) continue;
+            for (const auto& link : out[top.second]) {
+                float nd = top.first + cost[link.second];
+                if (nd < dist[link.first]) {
+                    dist[link.first] = nd;
+                    heap.push({nd, link.first});
+                }
+            }
+        }
+        for (float& d : dist) d = (d == inf) ? -1.0f : d;
+        return dist;
+    }
+};
+
+bool Close(float a, float b) {
+    return std::fabs(a - b) <= 1e-3f * std::max(1.0f, std::fabs(b));
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+std::vector<int> AliveNodes(const RoadGraph& graph) {
+    std::vector<int> alive;
+    for (int i = 0; i < (int)graph.nodes().size(); i++) {
+        if (graph.nodes()[i].alive) alive.push_back(i);
+    }
+    return alive;
+}
+
+void TestQueries(const RoadGraph& graph, const std::vector<float>& cost) {
+    TravelTimeIndex index;
+    index.build(graph);
+    index.customize(cost);
+    CHECK(index.ready());
+    CHECK(index.nodeCount() == graph.nodeCount());
+    CHECK(index.graphVersion() == graph.version());
+
+    Reference ref(graph);
+    std::vector<int> alive = AliveNodes(graph);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> pick(0, alive.size() - 1);
+
+    // One-to-one and one-to-many share a reference tree per source.
+    int oneToOneWrong = 0, oneToManyWrong = 0;
+    std::vector<float> times;
+    for (int s = 0; s < 40; s++) {
+        int from = alive[pick(rng)];
+        std::vector<float> expected = ref.fromNode(from, cost);
+        std::vector<int> targets(300);
+        for (int& t : targets) t = alive[pick(rng)];
+        for (int k = 0; k < 25; k++) {
+            float got = index.oneToOne(from, targets[k]);
+            float want = expected[targets[k]];
+            oneToOneWrong += (want < 0.0f) != (got < 0.0f) || (want >= 0.0f && !Close(got, want)) ? 1 : 0;
+        }
+        index.oneToMany(from, targets, times);
+        for (size_t k = 0; k < targets.size(); k++) {
+            float want = expected[targets[k]];
+            oneToManyWrong += (want < 0.0f) != (times[k] < 0.0f) || (want >= 0.0f && !Close(times[k], want)) ? 1 : 0;
+        }
+    }
+    CHECK(oneToOneWrong == 0);
+    CHECK(oneToManyWrong == 0);
+
+    // The isolated road is unreachable from the grid and back.
+    const int isolated = graph.findNodeNear(glm::vec3(-900.0f, 0.0f, -900.0f), 1.0f);
+    CHECK(isolated >= 0);
+    CHECK(index.oneToOne(alive[pick(rng)], isolated) < 0.0f);
+    CHECK(index.oneToOne(isolated, alive[pick(rng)]) < 0.0f);
+
+    // Isochrones: the same node set as the reference, up to nodes sitting on the
+    // limit, with the same times.
+    int isoWrong = 0;
+    std::vector<int> nodes;
+    for (int s = 0; s < 8; s++) {
+        int from = alive[pick(rng)];
+        std::vector<float> expected = ref.fromNode(from, cost);
+        const float limit = 300.0f;
+        index.isochrone(from, limit, nodes, times);
+        std::vector<uint8_t> inside(expected.size(), 0);
+        for (size_t k = 0; k < nodes.size(); k++) {
+            inside[nodes[k]] = 1;
+            float want = expected[nodes[k]];
+            isoWrong += want < 0.0f || !Close(times[k], want) ? 1 : 0;
+        }
+        for (size_t v = 0; v < expected.size(); v++) {
+            bool within = expected[v] >= 0.0f && expected[v] <= limit;
+            if (within != (inside[v] != 0) && !Close(expected[v], limit)) isoWrong++;
+        }
+        CHECK(nodes.size() > 10);
+    }
+    CHECK(isoWrong == 0);
+
+    // Throughput, reported rather than checked: timings vary by machine.
+    const int queries = 20000;
+    std::vector<std::pair<int, int>> pairs(queries);
+    for (auto& p : pairs) p = {alive[pick(rng)], alive[pick(rng)]};
+    auto t0 = std::chrono::steady_clock::now();
+    double checksum = 0.0;
+    for (const auto& p : pairs) checksum += index.oneToOne(p.first, p.second);
+    double chSec = SecondsSince(t0);
+
+    const int refQueries = 40;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < refQueries; i++) checksum += ref.fromNode(pairs[i].first, cost)[pairs[i].second];
+    double refSec = SecondsSince(t0);
+
+    std::vector<int> targets(1000);
+    for (int& t : targets) t = alive[pick(rng)];
+    const int manyQueries = 200;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < manyQueries; i++) index.oneToMany(pairs[i].first, targets, times);
+    double manySec = SecondsSince(t0);
+
+    const int isoQueries = 50;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < isoQueries; i++) index.isochrone(pairs[i].first, 600.0f, nodes, times);
+    double isoSec = SecondsSince(t0);
+
+    std::printf("travel_time_index_test: %d nodes, %d arcs, build %.1f ms, customize %.1f ms\n",
+        index.nodeCount(), index.arcCount(), index.buildMs(), index.customizeMs());
+    std::printf("  one-to-one:  %.0f queries/s (Dijkstra %.0f queries/s)\n", queries / chSec, refQueries / refSec);
+    std::printf("  one-to-many: %.0f queries/s with %zu targets\n", manyQueries / manySec, targets.size());
+    std::printf("  isochrone:   %.0f queries/s (checksum %.0f)\n", isoQueries / isoSec, checksum);
+}
+
+// Polls the builder until it is idle, keeping the last index it handed over.
+bool WaitForBuilder(TravelTimeBuilder& builder, TravelTimeIndex& out) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (builder.busy() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return builder.take(out);
+}
+
+void TestBuilder(RoadGraph& graph, const std::vector<float>& cost) {
+    TravelTimeIndex direct;
+    direct.build(graph);
+    direct.customize(cost);
+
+    TravelTimeBuilder builder;
+    builder.start();
+    builder.requestBuild(SnapshotTravelTimeGraph(graph), 13.9f);
+    builder.requestCustomize(graph.version(), cost);
+    TravelTimeIndex taken;
+    CHECK(WaitForBuilder(builder, taken));
+    CHECK(taken.ready());
+    CHECK(taken.graphVersion() == graph.version());
+
+    std::vector<int> alive = AliveNodes(graph);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<size_t> pick(0, alive.size() - 1);
+    int differ = 0;
+    for (int i = 0; i < 500; i++) {
+        int a = alive[pick(rng)], b = alive[pick(rng)];
+        differ += direct.oneToOne(a, b) != taken.oneToOne(a, b) ? 1 : 0;
+    }
+    CHECK(differ == 0);
+
+    // A burst of edits: only the newest topology may survive, and a customize
+    // for a replaced topology is dropped rather than applied to the new one.
+    uint32_t oldVersion = graph.version();
+    for (int road = 1; road <= 6; road++) {
+        graph.removeRoad(road);
+        builder.requestBuild(SnapshotTravelTimeGraph(graph), 13.9f);
+    }
+    builder.requestCustomize(oldVersion, cost);
+    CHECK(WaitForBuilder(builder, taken));
+    CHECK(taken.graphVersion() == graph.version());
+    CHECK(taken.nodeCount() == graph.nodeCount());
+
+    TravelTimeIndex freeFlow;
+    freeFlow.build(graph);
+    freeFlow.customizeFromLengths(13.9f);
+    differ = 0;
+    alive = AliveNodes(graph);
+    std::uniform_int_distribution<size_t> pickAfter(0, alive.size() - 1);
+    for (int i = 0; i < 500; i++) {
+        int a = alive[pickAfter(rng)], b = alive[pickAfter(rng)];
+        differ += freeFlow.oneToOne(a, b) != taken.oneToOne(a, b) ? 1 : 0;
+    }
+    CHECK(differ == 0);
+    builder.stop();
+}
+
+} // namespace
+
+int main() {
+    RoadGraph graph;
+    BuildGrid(graph);
+    std::vector<float> cost = LinkCosts(graph, 3);
+    TestQueries(graph, cost);
+    TestBuilder(graph, cost);
+    return TestResult("travel_time_index_test");
+}